@@ -30,5 +30,145 @@ namespace fuziqtests
 
 			Assert::AreEqual(ret, 0);
 		}
+
+		TEST_METHOD(cnx_index)
+		{
+			int ret = cnx_index_test();
+
+			Assert::AreEqual(ret, 0);
+		}
+
+		TEST_METHOD(cid_counter)
+		{
+			int ret = cid_counter_test();
+
+			Assert::AreEqual(ret, 0);
+		}
+
+		TEST_METHOD(frame_index)
+		{
+			int ret = frame_index_test();
+
+			Assert::AreEqual(ret, 0);
+		}
+
+		TEST_METHOD(frame_fuzzer_table)
+		{
+			int ret = frame_fuzzer_table_test();
+
+			Assert::AreEqual(ret, 0);
+		}
+
+		TEST_METHOD(bandit)
+		{
+			int ret = bandit_test();
+
+			Assert::AreEqual(ret, 0);
+		}
+
+		TEST_METHOD(pilot_stream)
+		{
+			int ret = pilot_stream_test();
+
+			Assert::AreEqual(ret, 0);
+		}
+
+		TEST_METHOD(corpus_pack)
+		{
+			int ret = corpus_pack_test();
+
+			Assert::AreEqual(ret, 0);
+		}
+
+		TEST_METHOD(corpus_file)
+		{
+			int ret = corpus_file_test();
+
+			Assert::AreEqual(ret, 0);
+		}
+
+		TEST_METHOD(corpus_class)
+		{
+			int ret = corpus_class_test();
+
+			Assert::AreEqual(ret, 0);
+		}
+
+		TEST_METHOD(corpus_layer)
+		{
+			int ret = corpus_layer_test();
+
+			Assert::AreEqual(ret, 0);
+		}
+
+		TEST_METHOD(corpus_alpn)
+		{
+			int ret = corpus_alpn_test();
+
+			Assert::AreEqual(ret, 0);
+		}
+
+		TEST_METHOD(corpus_check)
+		{
+			int ret = corpus_check_test();
+
+			Assert::AreEqual(ret, 0);
+		}
+
+		TEST_METHOD(entry_stats)
+		{
+			int ret = entry_stats_test();
+
+			Assert::AreEqual(ret, 0);
+		}
+
+		TEST_METHOD(basic_multi)
+		{
+			int ret = fuzi_q_basic_multi_test();
+
+			Assert::AreEqual(ret, 0);
+		}
+
+		TEST_METHOD(link_model)
+		{
+			int ret = fuzi_q_link_model_test();
+
+			Assert::AreEqual(ret, 0);
+		}
+
+		TEST_METHOD(cnx_heap)
+		{
+			int ret = cnx_heap_test();
+
+			Assert::AreEqual(ret, 0);
+		}
+
+		TEST_METHOD(client_options)
+		{
+			int ret = client_options_test();
+
+			Assert::AreEqual(ret, 0);
+		}
+
+		TEST_METHOD(icid_wheel)
+		{
+			int ret = icid_wheel_test();
+
+			Assert::AreEqual(ret, 0);
+		}
+
+		TEST_METHOD(sim_farm)
+		{
+			int ret = fuzi_q_sim_farm_test();
+
+			Assert::AreEqual(ret, 0);
+		}
+
+		TEST_METHOD(sim_event_heap)
+		{
+			int ret = fuzi_q_sim_event_heap_test();
+
+			Assert::AreEqual(ret, 0);
+		}
 	};
 }
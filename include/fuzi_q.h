@@ -23,8 +23,9 @@
 #define FUZI_Q_H
 
 #include <stdint.h>
+#include <stdio.h>
 #include <picoquic.h>
-#include <picosplay.h>
+#include <picoquic_utils.h>
 #include <quicperf.h>
 #include <h3zero.h>
 #include <democlient.h>
@@ -36,6 +37,8 @@ extern "C" {
 #endif
 
 #define FUZI_Q_MAX_SILENCE 3000000
+#define FUZZER_WHEEL_TICK (FUZI_Q_MAX_SILENCE / 4)
+#define FUZZER_WHEEL_SIZE 16
 
 /* Operation modes for the fuzzer
  */
@@ -44,7 +47,9 @@ typedef enum {
     fuzi_q_mode_server,
     fuzi_q_mode_client,
     fuzi_q_mode_clean,
-    fuzi_q_mode_clean_server
+    fuzi_q_mode_clean_server,
+    fuzi_q_mode_corpus,
+    fuzi_q_mode_sim
 } fuzi_q_mode_enum;
 
 /* Fuzzing context per connection. The goals are:
@@ -55,7 +60,7 @@ typedef enum {
  *   ID as seed for the fuzzing sequence.
  * - Work well in either a "client" or "server" setup, which means making
  *   no assumption on connection ID structure, apart from randomness, and
- *   also implies using LRU management of the connection list.
+ *   also implies expiring the contexts of connections that went silent.
  * - Be reasonably fast, which is achieved by using a hash table for
  *   accessing the contexts.
  */
@@ -68,13 +73,34 @@ typedef enum {
     fuzzer_cnx_state_max
 } fuzzer_cnx_state_enum;
 
+/* Stream of pilot bits used by the fuzzing decisions.
+ * Each decision consumes just the bits it needs from a 64 bit reservoir,
+ * which is refilled from the random context of the connection when
+ * exhausted. The stream is deterministic for a given seed.
+ */
+typedef struct st_fuzzer_pilot_t {
+    uint64_t* random_context;
+    uint64_t reservoir;
+    int nb_bits;
+} fuzzer_pilot_t;
+
+void fuzzer_pilot_init(fuzzer_pilot_t* pilot, uint64_t* random_context);
+uint64_t fuzzer_pilot_bits(fuzzer_pilot_t* pilot, int nb_bits);
+uint64_t fuzzer_pilot_range(fuzzer_pilot_t* pilot, uint64_t range);
+uint64_t fuzzer_pilot_word(fuzzer_pilot_t* pilot);
+
+#define FUZZER_NB_TRACKED_ENTRIES 8
+
 typedef struct st_fuzzer_icid_ctx_t {
-    picosplay_node_t icid_node;
-    struct st_fuzzer_icid_ctx_t* icid_before;
-    struct st_fuzzer_icid_ctx_t* icid_after;
+    struct st_fuzzer_icid_ctx_t* wheel_prev;
+    struct st_fuzzer_icid_ctx_t* wheel_next;
+    uint64_t wheel_tick;
     picoquic_connection_id_t icid;
+    uint64_t icid_hash;
     uint64_t last_time;
+    int clock_bit;
     uint64_t random_context;
+    fuzzer_pilot_t pilot;
     fuzzer_cnx_state_enum target_state;
     int target_wait;
     int wait_count[fuzzer_cnx_state_max];
@@ -88,14 +114,291 @@ typedef struct st_fuzzer_icid_ctx_t {
     /* For Handshake Completion/Interruption fuzzing */
     int handshake_done_sent_by_server;
     int client_handshake_confirmed; /* New field for client handshake status */
+    /* For adaptive strategy selection: first strategy used, and its probability */
+    int bandit_arm;
+    double bandit_prob;
+    uint32_t nb_bandit_decisions;
+    /* Corpus view of the application, fuzi_q_alpn_enum, set once the ALPN is known */
+    int alpn_view;
+    /* Corpus entries injected in the connection, credited with its outcome */
+    uint32_t injected_entry[FUZZER_NB_TRACKED_ENTRIES];
+    int nb_injected_entries;
 } fuzzer_icid_ctx_t;
 
+/* Slot of the ICID hash table. The hash is kept next to the pointer,
+ * so that probing does not need to dereference the contexts. */
+typedef struct st_fuzzer_icid_slot_t {
+    uint64_t icid_hash;
+    fuzzer_icid_ctx_t* icid_ctx;
+} fuzzer_icid_slot_t;
+
+/* Index of the frames in a packet, built by parsing the packet once.
+ * Each entry records the offset, length and type of a frame. Trailing
+ * padding, starting at padding_start, is not indexed.
+ * Every frame is at least one byte long, so an index sized to the
+ * largest packet can hold all the frames of any packet. The entries
+ * and the scratch space used when inserting frames are allocated once
+ * per fuzzer context.
+ */
+#define FUZZER_MAX_NB_FRAMES PICOQUIC_MAX_PACKET_SIZE
+
+typedef struct st_fuzzer_frame_t {
+    size_t offset;
+    size_t length;
+    uint64_t frame_type;
+} fuzzer_frame_t;
+
+typedef struct st_fuzzer_frame_index_t {
+    size_t nb_frames;
+    size_t nb_frames_max;
+    size_t padding_start;
+    fuzzer_frame_t* frames;
+    fuzzer_frame_t* scratch;
+} fuzzer_frame_index_t;
+
+int fuzzer_frame_index_init(fuzzer_frame_index_t* frame_index, size_t nb_frames_max);
+void fuzzer_frame_index_release(fuzzer_frame_index_t* frame_index);
+void fuzzer_frame_index_build(fuzzer_frame_index_t* frame_index, uint8_t* bytes, size_t length, size_t header_length);
+void fuzzer_frame_index_insert(fuzzer_frame_index_t* frame_index, uint8_t* bytes, size_t rank, size_t start, size_t end);
+void fuzzer_frame_index_trim(fuzzer_frame_index_t* frame_index, size_t offset);
+
+/* Frame fuzzers are registered in a static table, mapping ranges of
+ * frame types to fuzzing functions. Each entry has a selection weight
+ * and a hit counter in the fuzzer context. The last entry is used for
+ * frame types that are not registered.
+ */
+#define FUZZER_NB_FRAME_FUZZERS 28
+#define FUZZER_FRAME_FUZZER_DEFAULT (FUZZER_NB_FRAME_FUZZERS - 1)
+#define FUZZER_FRAME_FUZZER_MAP_SIZE 64
+
+/* Adaptive selection of the fuzzing strategy.
+ * When enabled, the strategy applied to a packet is chosen with EXP3
+ * among the specific strategies and the generic one, instead of
+ * uniformly. The first strategy applied to a connection is credited
+ * if the connection ends in a time out, in a CONNECTION_CLOSE from the
+ * peer with an unusual error, or while the server appears down.
+ * Decisions and rewards can be written to a trace, and the decisions
+ * of a trace can be replayed. Each fuzzer context buffers its lines of
+ * the trace, and the contexts of all threads share the file.
+ */
+#define FUZZER_NB_STRATEGIES 7
+#define FUZZER_STRATEGY_GENERIC 6
+#define FUZZER_BANDIT_TRACE_SIZE 4096
+
+typedef enum {
+    fuzzer_bandit_none = 0,
+    fuzzer_bandit_exp3,
+    fuzzer_bandit_replay
+} fuzzer_bandit_mode_enum;
+
+typedef struct st_fuzzer_bandit_decision_t {
+    uint64_t icid_hash;
+    uint32_t decision;
+    uint32_t arm;
+} fuzzer_bandit_decision_t;
+
+/* State shared by all the fuzzer contexts of a run */
+typedef struct st_fuzzer_bandit_shared_t {
+    fuzzer_bandit_mode_enum mode;
+    FILE* F_trace;
+    picoquic_mutex_t trace_mutex; /* Created with the trace file */
+    fuzzer_bandit_decision_t* decisions;
+    size_t nb_decisions;
+} fuzzer_bandit_shared_t;
+
+typedef struct st_fuzzer_bandit_t {
+    fuzzer_bandit_shared_t* shared;
+    double weight[FUZZER_NB_STRATEGIES];
+    uint64_t nb_pulls[FUZZER_NB_STRATEGIES];
+    uint64_t nb_rewards[FUZZER_NB_STRATEGIES];
+    uint64_t nb_lost_rewards; /* The context of the connection was evicted */
+    size_t trace_length;
+    char trace[FUZZER_BANDIT_TRACE_SIZE];
+} fuzzer_bandit_t;
+
+/* Test frames for use in fuzzing.
+ * Most test frames are QUIC frames, injected as is. Application layer
+ * test frames, such as HTTP/3 frames or QPACK instructions, are tagged
+ * with their layer, and wrapped in a STREAM frame for the stream on
+ * which that layer expects them when injected.
+ */
+typedef enum {
+    fuzi_q_layer_quic = 0,
+    fuzi_q_layer_h3_control, /* HTTP/3 frames for the control stream */
+    fuzi_q_layer_h3_request, /* HTTP/3 frames for a request stream */
+    fuzi_q_layer_qpack_encoder,
+    fuzi_q_layer_qpack_decoder,
+    fuzi_q_layer_app, /* Other application payloads, sent on a request stream */
+    fuzi_q_layer_max
+} fuzi_q_layer_enum;
+
+typedef struct st_fuzi_q_frames_t {
+    char const* name;
+    uint8_t* val;
+    size_t len;
+    fuzi_q_layer_enum layer;
+} fuzi_q_frames_t;
+
+extern fuzi_q_frames_t fuzi_q_frame_list[];
+extern size_t nb_fuzi_q_frame_list;
+
+/* Packed corpus of test frames.
+ * The bytes of all the frames are stored back to back in a single blob,
+ * followed by their names, and described by a compact index. The corpus
+ * is one allocation, so the frames used for injection share the same
+ * few pages instead of being scattered across the data segment.
+ * Application layer entries have the frame type of the STREAM frame
+ * in which they are wrapped.
+ */
+#define FUZI_Q_CORPUS_FLAG_BAD_TYPE 1 /* The frame type cannot be decoded */
+#define FUZI_Q_CORPUS_FLAG_TRUNCATED 2 /* A frame extends past the end of the entry */
+#define FUZI_Q_CORPUS_FLAG_INVALID 4 /* A frame type is unknown, or a frame cannot be parsed */
+
+typedef struct st_fuzi_q_corpus_entry_t {
+    uint64_t frame_type;
+    uint32_t offset;
+    uint32_t name_offset;
+    uint16_t length;
+    uint16_t flags;
+    uint16_t layer;
+} fuzi_q_corpus_entry_t;
+
+/* Classification of the corpus entries, computed once when the corpus
+ * is set. Entries are listed by frame type, and in buckets per packet
+ * epoch and connection state, holding the entries that are allowed in
+ * packets of that epoch (RFC 9000, table 3) and that state.
+ * Each ALPN has its own view of the corpus, and its own buckets, without
+ * the application layer entries that its application cannot parse.
+ */
+typedef enum {
+    fuzi_q_alpn_any = 0, /* Unknown ALPN, all entries */
+    fuzi_q_alpn_h3,
+    fuzi_q_alpn_hq,
+    fuzi_q_alpn_perf,
+    fuzi_q_alpn_max
+} fuzi_q_alpn_enum;
+
+typedef enum {
+    fuzi_q_epoch_initial = 0,
+    fuzi_q_epoch_0rtt,
+    fuzi_q_epoch_handshake,
+    fuzi_q_epoch_1rtt,
+    fuzi_q_epoch_max
+} fuzi_q_epoch_enum;
+
+#define FUZI_Q_CORPUS_TYPE_MAP_SIZE 64
+#define FUZI_Q_CORPUS_NB_BUCKETS (fuzi_q_alpn_max * fuzi_q_epoch_max * fuzzer_cnx_state_max)
+
+typedef struct st_fuzi_q_corpus_class_t {
+    uint32_t* by_type;
+    uint32_t type_start[FUZI_Q_CORPUS_TYPE_MAP_SIZE + 1];
+    uint32_t* view[fuzi_q_alpn_max];
+    uint32_t view_size[fuzi_q_alpn_max];
+    uint32_t* bucket[FUZI_Q_CORPUS_NB_BUCKETS];
+    uint32_t bucket_size[FUZI_Q_CORPUS_NB_BUCKETS];
+    void* memory;
+} fuzi_q_corpus_class_t;
+
+typedef struct st_fuzi_q_corpus_t {
+    fuzi_q_corpus_entry_t* entries;
+    size_t nb_entries;
+    uint8_t* blob;
+    size_t blob_size;
+    void* memory;
+    size_t mapped_size; /* Non zero if memory is a mapped file */
+    int is_shared; /* Read only view of another corpus, which holds the memory */
+    fuzi_q_corpus_class_t classes;
+} fuzi_q_corpus_t;
+
+/* Corpus files hold a header, the index, and the blob, in the same
+ * layout as the packed corpus, so they can be mapped without copying.
+ * The file is in host byte order; a file written on a host with the
+ * other byte order is rejected because the version does not match.
+ */
+#define FUZI_Q_CORPUS_MAGIC "FQCORPUS"
+#define FUZI_Q_CORPUS_VERSION 2
+
+typedef struct st_fuzi_q_corpus_header_t {
+    uint8_t magic[8];
+    uint32_t version;
+    uint32_t entry_size;
+    uint64_t nb_entries;
+    uint64_t blob_size;
+} fuzi_q_corpus_header_t;
+
+int fuzi_q_corpus_pack(fuzi_q_corpus_t* corpus, const fuzi_q_frames_t* frame_list, size_t nb_frames);
+int fuzi_q_corpus_merge(fuzi_q_corpus_t* corpus, const fuzi_q_corpus_t* other);
+void fuzi_q_corpus_share(fuzi_q_corpus_t* corpus, const fuzi_q_corpus_t* other);
+int fuzi_q_corpus_dedup(fuzi_q_corpus_t* corpus);
+int fuzi_q_corpus_load(fuzi_q_corpus_t* corpus, char const* file_name);
+int fuzi_q_corpus_write(const fuzi_q_corpus_t* corpus, char const* file_name);
+int fuzi_q_corpus_export(char const* corpus_spec, char const* file_name);
+int fuzi_q_corpus_classify(fuzi_q_corpus_t* corpus);
+size_t fuzi_q_corpus_by_type(const fuzi_q_corpus_t* corpus, uint64_t frame_type, const uint32_t** entry_ids);
+size_t fuzi_q_corpus_view(const fuzi_q_corpus_t* corpus, fuzi_q_alpn_enum alpn, const uint32_t** entry_ids);
+size_t fuzi_q_corpus_bucket(const fuzi_q_corpus_t* corpus, fuzi_q_alpn_enum alpn, fuzi_q_epoch_enum epoch,
+    fuzzer_cnx_state_enum cnx_state, const uint32_t** entry_ids);
+fuzi_q_alpn_enum fuzi_q_alpn_from_name(char const* alpn);
+void fuzi_q_corpus_release(fuzi_q_corpus_t* corpus);
+const uint8_t* fuzi_q_corpus_frame(const fuzi_q_corpus_t* corpus, size_t entry_id);
+char const* fuzi_q_corpus_name(const fuzi_q_corpus_t* corpus, size_t entry_id);
+size_t fuzzer_stream_wrap(uint8_t* frame, size_t frame_max, uint64_t stream_id, uint64_t offset,
+    const uint8_t* data, size_t length);
+void fuzzer_app_stream(picoquic_cnx_t* cnx, fuzi_q_layer_enum layer, uint64_t* stream_id, uint64_t* offset);
+
+/* Derivation of the initial CIDs of client connections.
+ * The default scheme chains each CID from the previous one with SHA 256.
+ * The counter scheme computes CID #N directly as a SipHash of N, keyed
+ * from the initial CID, so any connection of a run can be replayed
+ * without computing all the previous ones.
+ */
+typedef enum {
+    fuzzer_cid_scheme_sha256_chain = 0,
+    fuzzer_cid_scheme_counter
+} fuzzer_cid_scheme_enum;
+
+/* Effectiveness of the corpus entries. The injections are counted per
+ * packet, the outcomes per connection: a connection in which an entry
+ * was injected is counted once for that entry, and credited with the way
+ * it ended. Only the first FUZZER_NB_TRACKED_ENTRIES distinct entries
+ * of a connection are tracked.
+ */
+typedef enum {
+    fuzzer_entry_outcome_none = 0, /* Normal end of the connection, or expected rejection */
+    fuzzer_entry_outcome_peer_close, /* Closed by the peer with an unexpected error */
+    fuzzer_entry_outcome_timeout,
+    fuzzer_entry_outcome_server_down,
+    fuzzer_entry_outcome_open_at_end /* Still open when the run ended */
+} fuzzer_entry_outcome_enum;
+
+typedef struct st_fuzi_q_entry_stats_t {
+    uint32_t nb_injected;
+    uint32_t nb_cnx;
+    uint32_t nb_peer_close;
+    uint32_t nb_timeout;
+    uint32_t nb_server_down;
+    uint32_t nb_open_at_end;
+} fuzi_q_entry_stats_t;
+
 typedef struct st_fuzzer_ctx_t {
-    picosplay_tree_t icid_tree;
-    fuzzer_icid_ctx_t* icid_mru;
-    fuzzer_icid_ctx_t* icid_lru;
+    fuzzer_icid_slot_t* icid_table;
+    size_t icid_table_mask;
+    size_t nb_icid;
+    size_t icid_capacity;
+    struct st_fuzzer_icid_chunk_t* icid_chunks;
+    fuzzer_icid_ctx_t* icid_free;
+    fuzzer_icid_ctx_t* icid_wheel[FUZZER_WHEEL_SIZE];
+    uint64_t wheel_sweep_tick;
+    uint64_t wheel_next_time;
+    /* Last connection seen by the fuzzer, and its context */
+    picoquic_cnx_t* last_cnx;
+    fuzzer_icid_ctx_t* last_icid_ctx;
     struct st_fuzi_q_ctx_t* parent;
     picoquic_connection_id_t next_cid;
+    fuzzer_cid_scheme_enum cid_scheme;
+    uint64_t cid_key[2];
+    uint64_t cid_index;
+    uint64_t cid_stride;
     size_t nb_cnx_tried[fuzzer_cnx_state_max];
     size_t nb_cnx_fuzzed[fuzzer_cnx_state_max];
     size_t nb_packets_fuzzed[fuzzer_cnx_state_max];
@@ -106,20 +409,24 @@ typedef struct st_fuzzer_ctx_t {
     uint32_t nb_fuzzed;
     uint32_t nb_fuzzed_length;
     uint32_t nb_header_fuzzed;
+    fuzzer_frame_index_t frame_index;
+    /* Per frame fuzzer weights and hits. Single byte frame types are mapped directly. */
+    uint8_t frame_fuzzer_map[FUZZER_FRAME_FUZZER_MAP_SIZE];
+    int frame_weights_set;
+    uint32_t frame_weight[FUZZER_NB_FRAME_FUZZERS];
+    uint64_t frame_hits[FUZZER_NB_FRAME_FUZZERS];
+    fuzzer_bandit_t bandit;
+    fuzi_q_corpus_t corpus;
+    fuzi_q_entry_stats_t* entry_stats; /* Parallel to the corpus entries */
+    size_t nb_entry_stats;
+    uint64_t nb_lost_outcomes; /* The context of the connection was evicted */
 } fuzzer_ctx_t;
 
+uint64_t fuzzer_icid_hash(const picoquic_connection_id_t* icid);
 fuzzer_icid_ctx_t* fuzzer_get_icid_ctx(fuzzer_ctx_t* ctx, picoquic_connection_id_t* icid, uint64_t current_time);
-
-/* Test frames for use in fuzzing.
- */
-typedef struct st_fuzi_q_frames_t {
-    char const* name;
-    uint8_t* val;
-    size_t len;
-} fuzi_q_frames_t;
-
-extern fuzi_q_frames_t fuzi_q_frame_list[];
-extern size_t nb_fuzi_q_frame_list;
+fuzzer_icid_ctx_t* fuzzer_get_cnx_icid_ctx(fuzzer_ctx_t* ctx, picoquic_cnx_t* cnx, uint64_t current_time);
+fuzzer_icid_ctx_t* fuzzer_find_icid_ctx(fuzzer_ctx_t* ctx, picoquic_connection_id_t* icid);
+void fuzzer_forget_cnx(fuzzer_ctx_t* ctx, picoquic_cnx_t* cnx);
 
 /*
 * Fuzz test, merge of basic fuzzer and initial fuzzer from picoquic tests
@@ -128,7 +435,37 @@ extern size_t nb_fuzi_q_frame_list;
 uint32_t fuzi_q_fuzzer(void* fuzz_ctx, picoquic_cnx_t* cnx,
     uint8_t* bytes, size_t bytes_max, size_t length, size_t header_length);
 void fuzzer_random_cid(fuzzer_ctx_t* ctx, picoquic_connection_id_t* icid);
+void fuzzer_branch_cid(picoquic_connection_id_t* root_cid, int branch, picoquic_connection_id_t* branch_cid);
+void fuzzer_set_cid_scheme(fuzzer_ctx_t* ctx, fuzzer_cid_scheme_enum cid_scheme, uint64_t first_index, uint64_t stride);
+void fuzzer_counter_cid(fuzzer_ctx_t* ctx, uint64_t cid_index, picoquic_connection_id_t* icid);
+int fuzzer_parse_cid_scheme(char const* text, fuzzer_cid_scheme_enum* cid_scheme, uint64_t* first_index);
+void fuzzer_frame_fuzzers_init(fuzzer_ctx_t* ctx);
+size_t fuzzer_frame_fuzzer_find(fuzzer_ctx_t* ctx, uint64_t frame_type);
+char const* fuzzer_frame_fuzzer_name(size_t fuzzer_id);
+int fuzzer_set_frame_weight(fuzzer_ctx_t* ctx, char const* name, uint32_t weight);
+int fuzzer_load_frame_weights(fuzzer_ctx_t* ctx, char const* file_name);
+int frame_header_fuzzer(fuzzer_ctx_t* f_ctx, picoquic_cnx_t* cnx, fuzzer_icid_ctx_t* icid_ctx, fuzzer_pilot_t* pilot,
+    uint8_t* bytes, fuzzer_frame_index_t* frame_index);
+int fuzzer_load_corpus(fuzzer_ctx_t* ctx, char const* corpus_spec);
+int fuzzer_entry_stats_reset(fuzzer_ctx_t* ctx);
+void fuzzer_entry_stats_release(fuzzer_ctx_t* ctx);
+void fuzzer_entry_injected(fuzzer_ctx_t* ctx, fuzzer_icid_ctx_t* icid_ctx, size_t entry_id);
+void fuzzer_entry_outcome(fuzzer_ctx_t* ctx, picoquic_connection_id_t* icid, fuzzer_entry_outcome_enum outcome);
+int fuzzer_entry_stats_merge(fuzzer_ctx_t* summary, const fuzzer_ctx_t* ctx);
+int fuzzer_entry_stats_write(const fuzzer_ctx_t* ctx, char const* file_name);
+int fuzzer_bandit_open(fuzzer_bandit_shared_t* shared, char const* bandit_spec);
+void fuzzer_bandit_close(fuzzer_bandit_shared_t* shared);
+void fuzzer_bandit_enable(fuzzer_ctx_t* ctx, fuzzer_bandit_shared_t* shared);
+uint64_t fuzzer_bandit_select(fuzzer_ctx_t* ctx, fuzzer_icid_ctx_t* icid_ctx, uint64_t fuzz_pilot);
+void fuzzer_bandit_reward(fuzzer_ctx_t* ctx, picoquic_connection_id_t* icid, double reward);
+void fuzzer_bandit_probabilities(fuzzer_bandit_t* bandit, double* prob);
+void fuzzer_bandit_flush(fuzzer_bandit_t* bandit);
+void fuzzer_bandit_merge_weights(double* weight, const double* start_weight, const fuzzer_bandit_t* bandit);
 void fuzi_q_fuzzer_init(fuzzer_ctx_t* fuzz_ctx, picoquic_connection_id_t* init_cid, picoquic_quic_t* quic);
+int fuzi_q_fuzzer_init_shared(fuzzer_ctx_t* fuzz_ctx, picoquic_connection_id_t* init_cid, picoquic_quic_t* quic,
+    const fuzzer_ctx_t* settings);
+void fuzi_q_fuzzer_set_capacity(fuzzer_ctx_t* fuzz_ctx, size_t icid_capacity);
+int fuzi_q_fuzzer_copy_settings(fuzzer_ctx_t* fuzz_ctx, const fuzzer_ctx_t* settings);
 void fuzi_q_fuzzer_release(fuzzer_ctx_t* fuzz_ctx);
 
 /* Unification of initial and basic fuzzer
@@ -139,9 +476,16 @@ typedef struct st_fuzi_q_cnx_ctx_t {
     /* Data required to start client connections */
     picoquic_cnx_t* cnx_client;
     picoquic_connection_id_t icid;
+    uint64_t icid_hash;
+    uint64_t cid_index; /* Index N of the ICID, with the counter scheme */
     picoquic_demo_callback_ctx_t callback_ctx;
     quicperf_ctx_t* quicperf_ctx;
     uint64_t next_time;
+    /* Management of deadlines and state changes by the client loop */
+    struct st_fuzi_q_ctx_t* fuzi_q_ctx;
+    uint64_t heap_time;
+    size_t heap_index;
+    int is_dirty;
     int zero_rtt_available;
     int success_observed;
     int was_fuzzed;
@@ -166,6 +510,21 @@ typedef struct st_fuzi_q_ctx_t {
     uint64_t next_success_time;
     fuzi_q_cnx_ctx_t* cnx_ctx;
     size_t nb_cnx_ctx;
+    /* Open addressing table of started connections, keyed by ICID hash.
+     * Each entry holds the index of a cnx_ctx, or SIZE_MAX if empty. */
+    size_t* cnx_index;
+    size_t cnx_index_mask;
+    /* Min heap of started connections, ordered by heap_time. The heap time
+     * is a lower bound of the connection's next_time, and is only refreshed
+     * when it reaches the top of the heap. */
+    size_t* cnx_heap;
+    size_t cnx_heap_size;
+    /* Connections that need to be checked by the loop, and free slots. */
+    size_t* cnx_dirty;
+    size_t nb_cnx_dirty;
+    size_t* cnx_free;
+    size_t nb_cnx_free;
+    size_t nb_cnx_active;
     size_t nb_cnx_tried;
     size_t nb_cnx_required;
     uint32_t proposed_version;
@@ -175,20 +534,213 @@ typedef struct st_fuzi_q_ctx_t {
     uint64_t cnx_duration_min;
     uint64_t cnx_duration_max;
     picoquic_connection_id_t icid_duration_max;
+    uint64_t cid_index_duration_max;
     /* Management of fuzzing. */
     fuzzer_ctx_t fuzz_ctx;
 } fuzi_q_ctx_t;
 
-int fuzi_q_server(fuzi_q_mode_enum fuzz_mode, picoquic_quic_config_t* config, uint64_t duration_max);
+int fuzi_q_server(fuzi_q_mode_enum fuzz_mode, picoquic_quic_config_t* config, uint64_t duration_max, size_t icid_capacity,
+    char const* frame_weights_file, char const* corpus_spec);
 int fuzi_q_client(fuzi_q_mode_enum fuzz_mode, const char* ip_address_text, int server_port,
     picoquic_quic_config_t* config, size_t nb_cnx_required, uint64_t duration_max,
-    picoquic_connection_id_t* init_cid, char const* client_scenario_text);
+    picoquic_connection_id_t* init_cid, char const* client_scenario_text, int nb_threads,
+    fuzzer_cid_scheme_enum cid_scheme, uint64_t first_cid_index, char const* frame_weights_file,
+    char const* bandit_spec, char const* corpus_spec, char const* entry_stats_file);
+size_t fuzi_q_trials_share(size_t nb_cnx_required, int nb_shares, int share_id);
+int fuzi_q_parse_threads(char const* text, int* nb_threads, int* nb_shards, int* nb_clients);
+int fuzi_q_option_letters_overlap(char const* own, char const* other);
+void fuzi_q_client_merge_stats(fuzi_q_ctx_t* summary, fuzi_q_ctx_t* fuzi_q_ctx);
+void fuzi_q_client_print_stats(fuzi_q_ctx_t* fuzi_q_ctx, size_t nb_cnx_required);
+void fuzi_q_print_icid(fuzzer_cid_scheme_enum cid_scheme, picoquic_connection_id_t* icid, uint64_t cid_index);
+int fuzi_q_create_cnx_ctx(fuzi_q_ctx_t* fuzi_q_ctx, size_t nb_cnx_ctx);
 void fuzi_q_release_client_context(fuzi_q_ctx_t* fuzi_q_ctx);
-void fuzi_q_mark_active(fuzi_q_ctx_t* fuzi_q_ctx, picoquic_connection_id_t* icid, uint64_t current_time, int was_fuzzed);
+void fuzi_q_release_connection(fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_cnx_ctx_t* cnx_ctx);
+void fuzi_q_cnx_index_insert(fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_cnx_ctx_t* cnx_ctx);
+void fuzi_q_cnx_index_remove(fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_cnx_ctx_t* cnx_ctx);
+fuzi_q_cnx_ctx_t* fuzi_q_cnx_index_find(fuzi_q_ctx_t* fuzi_q_ctx, picoquic_connection_id_t* icid, uint64_t icid_hash);
+void fuzi_q_cnx_heap_insert(fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_cnx_ctx_t* cnx_ctx);
+void fuzi_q_cnx_heap_remove(fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_cnx_ctx_t* cnx_ctx);
+void fuzi_q_mark_dirty(fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_cnx_ctx_t* cnx_ctx);
+void fuzi_q_mark_active(fuzi_q_ctx_t* fuzi_q_ctx, picoquic_connection_id_t* icid, uint64_t icid_hash, uint64_t current_time, int was_fuzzed);
 uint64_t fuzi_q_next_time(fuzi_q_ctx_t* fuzi_q_ctx);
 int fuzi_q_loop_check_cnx(fuzi_q_ctx_t* fuzi_q_ctx, uint64_t current_time, int * is_active);
+void fuzi_q_client_end_of_run(fuzi_q_ctx_t* fuzi_q_ctx);
 void fuzzer_random_cid(fuzzer_ctx_t* ctx, picoquic_connection_id_t* icid);
 
+/* Simulation of fuzi_q nodes connected by simulated links, in virtual time.
+ * Each attachment connects a node to the arrival end of a link, at the
+ * node address for that link; packets sent to that address use that
+ * link. A node may have several addresses, the first one is used when
+ * the source address of a packet is not specified.
+ */
+typedef struct st_fuzi_q_sim_attach_t {
+    int node_id;
+    int link_id;
+    struct sockaddr_storage node_addr;
+} fuzi_q_sim_attach_t;
+
+/* Model of a simulated link. The data rate, latency and maximum queue
+ * delay are those of the picoquic link; the impairments are applied by
+ * fuzi_q to the packets leaving that link. Loss follows a Gilbert-Elliott
+ * model: the link switches from the good to the bad state with
+ * probability ge_p_bad at each packet, and back with probability
+ * ge_p_good, and loses packets with probability loss_good or loss_bad
+ * depending on its state. Packets larger than the MTU are dropped.
+ */
+typedef struct st_fuzi_q_link_model_t {
+    double data_rate_in_gbps;
+    uint64_t latency;
+    uint64_t queue_delay_max;
+    uint64_t jitter;
+    double loss_good;
+    double loss_bad;
+    double ge_p_bad;
+    double ge_p_good;
+    double reorder_rate;
+    uint64_t reorder_delay;
+    double duplicate_rate;
+    size_t mtu;
+    uint64_t seed;
+} fuzi_q_link_model_t;
+
+/* State of the impairments of a link, with the packets delayed by jitter
+ * or reordering, in order of arrival time */
+typedef struct st_fuzi_q_link_impair_t {
+    fuzi_q_link_model_t model;
+    uint64_t random_context;
+    int is_bad;
+    struct st_picoquictest_sim_packet_t* first_delayed;
+    uint64_t nb_lost;
+    uint64_t nb_too_big;
+    uint64_t nb_duplicated;
+    uint64_t nb_reordered;
+} fuzi_q_link_impair_t;
+
+void fuzi_q_link_model_init(fuzi_q_link_model_t* model);
+int fuzi_q_link_model_get(char const* link_spec, int link_id, fuzi_q_link_model_t* model);
+void fuzi_q_link_impair_init(fuzi_q_link_impair_t* impair, const fuzi_q_link_model_t* model, int link_id);
+void fuzi_q_link_impair_release(fuzi_q_link_impair_t* impair);
+void fuzi_q_link_impair_submit(fuzi_q_link_impair_t* impair, struct st_picoquictest_sim_packet_t* packet, uint64_t current_time);
+struct st_picoquictest_sim_packet_t* fuzi_q_link_impair_dequeue(fuzi_q_link_impair_t* impair, uint64_t current_time);
+uint64_t fuzi_q_link_impair_next_time(fuzi_q_link_impair_t* impair);
+
+typedef struct st_fuzi_q_sim_config_t {
+    uint64_t simulated_time;
+    char server_cert_file[512];
+    char server_key_file[512];
+    char server_cert_store_file[512];
+    uint8_t ticket_encryption_key[16];
+    int nb_nodes; /* should be 2 in default configuration  */
+    fuzi_q_ctx_t* nodes;
+    uint8_t* node_done;
+    int nb_clients_running;
+    int nb_links; /* should be 2 in default configuration  */
+    struct st_picoquictest_sim_link_t** links;
+    fuzi_q_link_impair_t* impairs;
+    int nb_attachments; /* should be 2 in default configuration  */
+    fuzi_q_sim_attach_t* attachments;
+    /* Hash table of the attachment addresses, and first attachment of each node */
+    int* route_table;
+    size_t route_mask;
+    int* node_attach;
+    /* Min heap of the next event times, nodes first, then links */
+    uint64_t* event_time;
+    int* event_heap;
+    int* event_pos;
+    int nb_events;
+    /* Frame weights and test frames shared by the nodes, or NULL to use the built-in ones */
+    const fuzzer_ctx_t* settings;
+} fuzi_q_sim_config_t;
+
+fuzi_q_sim_config_t* fuzi_q_sim_config_create(int nb_nodes, int nb_links, int nb_attachments,
+    char const* cert_file, char const* key_file, char const* picoquic_solution_dir);
+void fuzi_q_sim_config_delete(fuzi_q_sim_config_t* config);
+int fuzi_q_sim_find_dest_node(fuzi_q_sim_config_t* config, int link_id, struct sockaddr* addr);
+int fuzi_q_sim_find_send_link(fuzi_q_sim_config_t* config, int srce_node_id, const struct sockaddr* dest_addr, struct sockaddr_storage* srce_addr);
+struct sockaddr* fuzi_q_sim_find_node_addr(fuzi_q_sim_config_t* config, int node_id);
+int fuzi_q_sim_routes_init(fuzi_q_sim_config_t* config);
+int fuzi_q_sim_set_client_ctx(fuzi_q_sim_config_t* sim_config, fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_mode_enum fuzz_mode,
+    size_t nb_cnx_ctx, size_t nb_cnx_required, uint64_t duration_max, picoquic_connection_id_t* init_cid,
+    char const* client_scenario_text, struct sockaddr* server_addr, char const* qlog_dir);
+int fuzi_q_sim_set_server_ctx(fuzi_q_sim_config_t* sim_config, fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_mode_enum fuzz_mode,
+    size_t nb_cnx_ctx, uint64_t duration_max, struct sockaddr* server_addr, char const* qlog_dir);
+int fuzi_q_sim_set_link_models(fuzi_q_sim_config_t* config, char const* link_spec);
+fuzi_q_sim_config_t* fuzi_q_sim_topology_create(int nb_clients, int nb_client_addresses, char const* link_spec,
+    fuzi_q_mode_enum client_fuzz_mode, fuzi_q_mode_enum server_fuzz_mode,
+    size_t nb_cnx_ctx, size_t nb_cnx_required, uint64_t duration_max, picoquic_connection_id_t* init_cid,
+    char const* client_scenario_text, char const* qlog_dir, char const* cert_file, char const* key_file,
+    char const* picoquic_solution_dir, const fuzzer_ctx_t* settings);
+fuzi_q_sim_config_t* fuzi_q_sim_basic_config_create(char const* link_spec, fuzi_q_mode_enum client_fuzz_mode, fuzi_q_mode_enum server_fuzz_mode,
+    size_t nb_cnx_ctx, size_t nb_cnx_required, uint64_t duration_max, picoquic_connection_id_t* init_cid,
+    char const* client_scenario_text, char const* qlog_dir, char const* cert_file, char const* key_file,
+    char const* picoquic_solution_dir);
+int fuzi_q_sim_events_init(fuzi_q_sim_config_t* config);
+void fuzi_q_sim_event_update(fuzi_q_sim_config_t* config, int event_id, uint64_t event_time);
+int fuzi_q_sim_loop_step(fuzi_q_sim_config_t* config, int* is_active);
+int fuzi_q_sim_run(fuzi_q_sim_config_t* config, uint64_t max_time, int max_inactive);
+
+/* Farm of simulation shards, as run by fuzi_q_sim. The frame weights and
+ * test frames are loaded once by fuzi_q_sim_farm_init, and copied to the
+ * clients of each shard. The results of the shards are added in the
+ * summary, and the connections in progress in failed shards, or when the
+ * server appeared down, are listed in the order of the shards.
+ */
+typedef struct st_fuzi_q_sim_failure_t {
+    int shard_id;
+    int ret;
+    picoquic_connection_id_t icid;
+    uint64_t cid_index;
+} fuzi_q_sim_failure_t;
+
+typedef struct st_fuzi_q_sim_shard_t {
+    picoquic_connection_id_t shard_cid;
+    size_t nb_cnx_required;
+    size_t nb_cnx_tried;
+    int nb_clients;
+    uint64_t first_cid_index; /* With the counter scheme, client c starts at first_cid_index + c */
+    uint64_t cid_stride;
+    int ret;
+} fuzi_q_sim_shard_t;
+
+typedef struct st_fuzi_q_sim_farm_t {
+    picoquic_quic_config_t* config;
+    size_t nb_cnx_required;
+    uint64_t duration_max;
+    picoquic_connection_id_t root_cid;
+    char const* client_scenario_text;
+    fuzzer_cid_scheme_enum cid_scheme;
+    uint64_t first_cid_index;
+    char const* link_spec;
+    char const* picoquic_solution_dir;
+    fuzzer_bandit_shared_t* bandit_shared;
+    int nb_shards;
+    int nb_clients;
+    fuzzer_ctx_t settings; /* Frame weights and test frames of the clients */
+    int has_entry_stats;
+    /* Shared by the threads: index of the next shard, weights of the strategies */
+    picoquic_mutex_t shard_mutex;
+    int has_mutex;
+    int next_shard;
+    double bandit_weight[FUZZER_NB_STRATEGIES];
+    /* Results */
+    fuzi_q_sim_shard_t* shards;
+    fuzi_q_ctx_t summary;
+    fuzi_q_sim_failure_t* failures;
+    size_t nb_failures;
+    int nb_shards_run;
+    uint64_t simulated_time;
+} fuzi_q_sim_farm_t;
+
+int fuzi_q_sim_farm_init(fuzi_q_sim_farm_t* farm, picoquic_quic_config_t* config, size_t nb_cnx_required,
+    uint64_t duration_max, picoquic_connection_id_t* init_cid, int nb_shards, int nb_clients,
+    char const* frame_weights_file, char const* corpus_spec, int count_entries);
+int fuzi_q_sim_farm_run(fuzi_q_sim_farm_t* farm, int nb_threads);
+void fuzi_q_sim_farm_release(fuzi_q_sim_farm_t* farm);
+int fuzi_q_sim(picoquic_quic_config_t* config, size_t nb_cnx_required, uint64_t duration_max,
+    picoquic_connection_id_t* init_cid, char const* client_scenario_text, int nb_threads, int nb_shards, int nb_clients,
+    fuzzer_cid_scheme_enum cid_scheme, uint64_t first_cid_index, char const* frame_weights_file,
+    char const* bandit_spec, char const* corpus_spec, char const* entry_stats_file, char const* link_spec);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,356 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2021, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <picoquic.h>
+#include <picoquic_utils.h>
+#include "fuzi_q.h"
+
+/* Adaptive selection of the fuzzing strategy, using EXP3.
+ * Each strategy is an arm. The arm is drawn from the fuzz pilot, with
+ * probability p_i = (1 - gamma) * w_i / sum(w) + gamma / K. When the
+ * connection ends, the first arm used on that connection receives a
+ * reward r in [0,1], and its weight is multiplied by exp(gamma*r/(p_i*K)).
+ *
+ * The choices only depend on the pilot and on the rewards received so far,
+ * so a run is reproduced from the initial CID and the sequence of rewards.
+ * Since the rewards depend on the peer, a trace of the decisions can also
+ * be written, and the decisions of a trace can be replayed directly.
+ *
+ * The exponential is computed with a fixed Taylor series rather than
+ * with libm, so that the weights are the same on all platforms.
+ */
+#define FUZZER_BANDIT_GAMMA 0.1
+#define FUZZER_BANDIT_WEIGHT_MAX 1.0e100
+#define FUZZER_BANDIT_TRACE_LINE_MAX 64
+
+static double fuzzer_bandit_exp(double x)
+{
+    /* Only called for x in [0, 1] */
+    double term = 1.0;
+    double sum = 1.0;
+
+    for (int i = 1; i <= 20; i++) {
+        term *= x / (double)i;
+        sum += term;
+    }
+    return sum;
+}
+
+static int fuzzer_bandit_decision_compare(const void* a, const void* b)
+{
+    const fuzzer_bandit_decision_t* da = (const fuzzer_bandit_decision_t*)a;
+    const fuzzer_bandit_decision_t* db = (const fuzzer_bandit_decision_t*)b;
+    int ret = 0;
+
+    if (da->icid_hash != db->icid_hash) {
+        ret = (da->icid_hash < db->icid_hash) ? -1 : 1;
+    }
+    else if (da->decision != db->decision) {
+        ret = (da->decision < db->decision) ? -1 : 1;
+    }
+    return ret;
+}
+
+/* Load the "S" lines of a trace, sorted for lookup */
+static int fuzzer_bandit_load_trace(fuzzer_bandit_shared_t* shared, char const* file_name)
+{
+    int ret = 0;
+    FILE* F = picoquic_file_open(file_name, "r");
+
+    if (F == NULL) {
+        fprintf(stderr, "Cannot open bandit trace: %s\n", file_name);
+        ret = -1;
+    }
+    else {
+        char line[256];
+        size_t nb_alloc = 0;
+
+        while (ret == 0 && fgets(line, sizeof(line), F) != NULL) {
+            uint64_t icid_hash;
+            unsigned int decision;
+            unsigned int arm;
+
+            if (line[0] != 'S' ||
+                sscanf(line + 1, "%" SCNx64 " %u %u", &icid_hash, &decision, &arm) != 3 ||
+                arm >= FUZZER_NB_STRATEGIES) {
+                continue;
+            }
+            if (shared->nb_decisions >= nb_alloc) {
+                size_t new_alloc = (nb_alloc == 0) ? 256 : 2 * nb_alloc;
+                fuzzer_bandit_decision_t* new_decisions = (fuzzer_bandit_decision_t*)realloc(
+                    shared->decisions, new_alloc * sizeof(fuzzer_bandit_decision_t));
+                if (new_decisions == NULL) {
+                    ret = -1;
+                    break;
+                }
+                shared->decisions = new_decisions;
+                nb_alloc = new_alloc;
+            }
+            shared->decisions[shared->nb_decisions].icid_hash = icid_hash;
+            shared->decisions[shared->nb_decisions].decision = decision;
+            shared->decisions[shared->nb_decisions].arm = arm;
+            shared->nb_decisions++;
+        }
+        (void)picoquic_file_close(F);
+
+        if (ret == 0 && shared->nb_decisions > 1) {
+            qsort(shared->decisions, shared->nb_decisions, sizeof(fuzzer_bandit_decision_t),
+                fuzzer_bandit_decision_compare);
+        }
+    }
+    return ret;
+}
+
+/* Parse the bandit specification: "exp3", "exp3:trace_file" or "replay:trace_file" */
+int fuzzer_bandit_open(fuzzer_bandit_shared_t* shared, char const* bandit_spec)
+{
+    int ret = 0;
+
+    memset(shared, 0, sizeof(fuzzer_bandit_shared_t));
+    if (strcmp(bandit_spec, "exp3") == 0) {
+        shared->mode = fuzzer_bandit_exp3;
+    }
+    else if (strncmp(bandit_spec, "exp3:", 5) == 0 && bandit_spec[5] != 0) {
+        shared->mode = fuzzer_bandit_exp3;
+        shared->F_trace = picoquic_file_open(bandit_spec + 5, "w");
+        if (shared->F_trace == NULL) {
+            fprintf(stderr, "Cannot create bandit trace: %s\n", bandit_spec + 5);
+            ret = -1;
+        }
+        else if (picoquic_create_mutex(&shared->trace_mutex) != 0) {
+            (void)picoquic_file_close(shared->F_trace);
+            shared->F_trace = NULL;
+            ret = -1;
+        }
+    }
+    else if (strncmp(bandit_spec, "replay:", 7) == 0 && bandit_spec[7] != 0) {
+        shared->mode = fuzzer_bandit_replay;
+        ret = fuzzer_bandit_load_trace(shared, bandit_spec + 7);
+    }
+    else {
+        ret = -1;
+    }
+
+    if (ret != 0) {
+        fuzzer_bandit_close(shared);
+    }
+    return ret;
+}
+
+void fuzzer_bandit_close(fuzzer_bandit_shared_t* shared)
+{
+    if (shared->F_trace != NULL) {
+        (void)picoquic_file_close(shared->F_trace);
+        (void)picoquic_delete_mutex(&shared->trace_mutex);
+    }
+    if (shared->decisions != NULL) {
+        free(shared->decisions);
+    }
+    memset(shared, 0, sizeof(fuzzer_bandit_shared_t));
+}
+
+void fuzzer_bandit_enable(fuzzer_ctx_t* ctx, fuzzer_bandit_shared_t* shared)
+{
+    memset(&ctx->bandit, 0, sizeof(fuzzer_bandit_t));
+    ctx->bandit.shared = shared;
+    for (int i = 0; i < FUZZER_NB_STRATEGIES; i++) {
+        ctx->bandit.weight[i] = 1.0;
+    }
+}
+
+void fuzzer_bandit_probabilities(fuzzer_bandit_t* bandit, double* prob)
+{
+    double sum = 0;
+
+    for (int i = 0; i < FUZZER_NB_STRATEGIES; i++) {
+        sum += bandit->weight[i];
+    }
+    for (int i = 0; i < FUZZER_NB_STRATEGIES; i++) {
+        prob[i] = (1.0 - FUZZER_BANDIT_GAMMA) * bandit->weight[i] / sum +
+            FUZZER_BANDIT_GAMMA / (double)FUZZER_NB_STRATEGIES;
+    }
+}
+
+/* Write the buffered lines of the trace. The lines of a context are
+ * kept in order, but may be interleaved with those of other contexts
+ * by blocks; the replay does not depend on the order of the lines.
+ */
+void fuzzer_bandit_flush(fuzzer_bandit_t* bandit)
+{
+    if (bandit->shared != NULL && bandit->shared->F_trace != NULL && bandit->trace_length > 0) {
+        picoquic_lock_mutex(&bandit->shared->trace_mutex);
+        (void)fwrite(bandit->trace, 1, bandit->trace_length, bandit->shared->F_trace);
+        picoquic_unlock_mutex(&bandit->shared->trace_mutex);
+    }
+    bandit->trace_length = 0;
+}
+
+/* Add a line to the trace, flushing the buffer first if it is almost full */
+static void fuzzer_bandit_trace(fuzzer_bandit_t* bandit, char const* format, ...)
+{
+    va_list args;
+    int length;
+
+    if (FUZZER_BANDIT_TRACE_SIZE - bandit->trace_length < FUZZER_BANDIT_TRACE_LINE_MAX) {
+        fuzzer_bandit_flush(bandit);
+    }
+    va_start(args, format);
+    length = vsnprintf(bandit->trace + bandit->trace_length, FUZZER_BANDIT_TRACE_LINE_MAX, format, args);
+    va_end(args);
+    if (length > 0 && length < FUZZER_BANDIT_TRACE_LINE_MAX) {
+        bandit->trace_length += (size_t)length;
+    }
+}
+
+static int fuzzer_bandit_replayed_arm(fuzzer_bandit_shared_t* shared, uint64_t icid_hash, uint32_t decision)
+{
+    fuzzer_bandit_decision_t key;
+    fuzzer_bandit_decision_t* found;
+
+    key.icid_hash = icid_hash;
+    key.decision = decision;
+    key.arm = 0;
+    found = (fuzzer_bandit_decision_t*)bsearch(&key, shared->decisions, shared->nb_decisions,
+        sizeof(fuzzer_bandit_decision_t), fuzzer_bandit_decision_compare);
+
+    return (found == NULL) ? -1 : (int)found->arm;
+}
+
+/* Select the strategy, using the 16 low bits of the pilot */
+uint64_t fuzzer_bandit_select(fuzzer_ctx_t* ctx, fuzzer_icid_ctx_t* icid_ctx, uint64_t fuzz_pilot)
+{
+    fuzzer_bandit_t* bandit = &ctx->bandit;
+    double prob[FUZZER_NB_STRATEGIES];
+    int arm = -1;
+
+    fuzzer_bandit_probabilities(bandit, prob);
+    if (bandit->shared->mode == fuzzer_bandit_replay) {
+        arm = fuzzer_bandit_replayed_arm(bandit->shared, icid_ctx->icid_hash, icid_ctx->nb_bandit_decisions);
+    }
+    if (arm < 0) {
+        double x = ((double)(fuzz_pilot & 0xFFFF)) / 65536.0;
+        double cumulative = 0;
+
+        arm = FUZZER_NB_STRATEGIES - 1;
+        for (int i = 0; i < FUZZER_NB_STRATEGIES - 1; i++) {
+            cumulative += prob[i];
+            if (x < cumulative) {
+                arm = i;
+                break;
+            }
+        }
+    }
+
+    if (bandit->shared->F_trace != NULL) {
+        fuzzer_bandit_trace(bandit, "S %016" PRIx64 " %u %d\n",
+            icid_ctx->icid_hash, icid_ctx->nb_bandit_decisions, arm);
+    }
+    icid_ctx->nb_bandit_decisions++;
+    /* The connection is credited to the first strategy applied to it */
+    if (icid_ctx->bandit_arm < 0) {
+        icid_ctx->bandit_arm = arm;
+        icid_ctx->bandit_prob = prob[arm];
+        bandit->nb_pulls[arm]++;
+    }
+
+    return (uint64_t)arm;
+}
+
+/* Credit the reward of a connection to its first strategy */
+void fuzzer_bandit_reward(fuzzer_ctx_t* ctx, picoquic_connection_id_t* icid, double reward)
+{
+    fuzzer_bandit_t* bandit = &ctx->bandit;
+    fuzzer_icid_ctx_t* icid_ctx;
+
+    if (bandit->shared == NULL) {
+        return;
+    }
+    if ((icid_ctx = fuzzer_find_icid_ctx(ctx, icid)) == NULL) {
+        /* The strategy used on the connection is not known anymore */
+        bandit->nb_lost_rewards++;
+        return;
+    }
+    if (icid_ctx->bandit_arm < 0) {
+        return;
+    }
+    if (reward > 1.0) {
+        reward = 1.0;
+    }
+    if (reward > 0) {
+        double max_weight = 0;
+        int arm = icid_ctx->bandit_arm;
+
+        bandit->nb_rewards[arm]++;
+        bandit->weight[arm] *= fuzzer_bandit_exp(FUZZER_BANDIT_GAMMA * reward /
+            (icid_ctx->bandit_prob * (double)FUZZER_NB_STRATEGIES));
+        /* Keep the weights in range, the probabilities only depend on the ratios */
+        for (int i = 0; i < FUZZER_NB_STRATEGIES; i++) {
+            if (bandit->weight[i] > max_weight) {
+                max_weight = bandit->weight[i];
+            }
+        }
+        if (max_weight > FUZZER_BANDIT_WEIGHT_MAX) {
+            for (int i = 0; i < FUZZER_NB_STRATEGIES; i++) {
+                bandit->weight[i] /= max_weight;
+            }
+        }
+    }
+    if (bandit->shared->F_trace != NULL) {
+        fuzzer_bandit_trace(bandit, "R %016" PRIx64 " %d %f\n",
+            icid_ctx->icid_hash, icid_ctx->bandit_arm, reward);
+    }
+    icid_ctx->bandit_arm = -1;
+}
+
+/* Apply to the weights the updates received by a bandit since it started
+ * from start_weight. The updates multiply the weights, so the updates of
+ * several bandits that started from the same weights can be applied one
+ * after the other, in any order. The weights are scaled so that the
+ * largest is 1, which does not change the probabilities.
+ */
+void fuzzer_bandit_merge_weights(double* weight, const double* start_weight, const fuzzer_bandit_t* bandit)
+{
+    double ratio[FUZZER_NB_STRATEGIES];
+    double max_ratio = 0;
+    double max_weight = 0;
+
+    for (int i = 0; i < FUZZER_NB_STRATEGIES; i++) {
+        ratio[i] = bandit->weight[i] / start_weight[i];
+        if (ratio[i] > max_ratio) {
+            max_ratio = ratio[i];
+        }
+    }
+    for (int i = 0; i < FUZZER_NB_STRATEGIES; i++) {
+        weight[i] *= ratio[i] / max_ratio;
+        if (weight[i] > max_weight) {
+            max_weight = weight[i];
+        }
+    }
+    for (int i = 0; i < FUZZER_NB_STRATEGIES; i++) {
+        weight[i] /= max_weight;
+    }
+}
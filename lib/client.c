@@ -24,6 +24,7 @@
 #include <string.h>
 #include <picoquic.h>
 #include <picoquic_internal.h>
+#include <picoquic_utils.h>
 #include <picoquic_packet_loop.h>
 #include <autoqlog.h>
 #include <performance_log.h>
@@ -53,29 +54,255 @@
  * when the client is created.
  */
 
-/* Clear a connection context */
-void fuzi_q_release_connection(fuzi_q_cnx_ctx_t* cnx_ctx)
+/* Index of started connections.
+ * The fuzzer calls `fuzi_q_mark_active` for every packet, so finding the
+ * connection context from the ICID must not require scanning all contexts.
+ * The index is an open addressing table with linear probing, sized to
+ * a power of 2 at least twice the number of connection contexts, so the
+ * load factor never exceeds 1/2. Entries hold the position of the context
+ * in the cnx_ctx array. Deletion uses backward shift, so there is no need
+ * for tombstones. The key is the ICID hash computed by `fuzzer_icid_hash`,
+ * which is the same value used to seed the fuzzer for that connection.
+ */
+static size_t fuzi_q_cnx_index_home(fuzi_q_ctx_t* fuzi_q_ctx, uint64_t icid_hash)
+{
+    return (size_t)(icid_hash ^ (icid_hash >> 32)) & fuzi_q_ctx->cnx_index_mask;
+}
+
+static size_t fuzi_q_cnx_index_lookup(fuzi_q_ctx_t* fuzi_q_ctx, picoquic_connection_id_t* icid, uint64_t icid_hash)
+{
+    size_t x = fuzi_q_cnx_index_home(fuzi_q_ctx, icid_hash);
+
+    while (fuzi_q_ctx->cnx_index[x] != SIZE_MAX) {
+        fuzi_q_cnx_ctx_t* cnx_ctx = &fuzi_q_ctx->cnx_ctx[fuzi_q_ctx->cnx_index[x]];
+        if (cnx_ctx->icid_hash == icid_hash &&
+            picoquic_compare_connection_id(icid, &cnx_ctx->icid) == 0) {
+            return x;
+        }
+        x = (x + 1) & fuzi_q_ctx->cnx_index_mask;
+    }
+    return SIZE_MAX;
+}
+
+void fuzi_q_cnx_index_insert(fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_cnx_ctx_t* cnx_ctx)
+{
+    size_t x = fuzi_q_cnx_index_home(fuzi_q_ctx, cnx_ctx->icid_hash);
+
+    while (fuzi_q_ctx->cnx_index[x] != SIZE_MAX) {
+        x = (x + 1) & fuzi_q_ctx->cnx_index_mask;
+    }
+    fuzi_q_ctx->cnx_index[x] = (size_t)(cnx_ctx - fuzi_q_ctx->cnx_ctx);
+}
+
+void fuzi_q_cnx_index_remove(fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_cnx_ctx_t* cnx_ctx)
+{
+    size_t hole = fuzi_q_cnx_index_lookup(fuzi_q_ctx, &cnx_ctx->icid, cnx_ctx->icid_hash);
+
+    if (hole != SIZE_MAX) {
+        size_t x = (hole + 1) & fuzi_q_ctx->cnx_index_mask;
+
+        while (fuzi_q_ctx->cnx_index[x] != SIZE_MAX) {
+            size_t home = fuzi_q_cnx_index_home(fuzi_q_ctx, fuzi_q_ctx->cnx_ctx[fuzi_q_ctx->cnx_index[x]].icid_hash);
+            /* Move the entry back if the hole is between its home and its current position */
+            if (((x - home) & fuzi_q_ctx->cnx_index_mask) >= ((x - hole) & fuzi_q_ctx->cnx_index_mask)) {
+                fuzi_q_ctx->cnx_index[hole] = fuzi_q_ctx->cnx_index[x];
+                hole = x;
+            }
+            x = (x + 1) & fuzi_q_ctx->cnx_index_mask;
+        }
+        fuzi_q_ctx->cnx_index[hole] = SIZE_MAX;
+    }
+}
+
+fuzi_q_cnx_ctx_t* fuzi_q_cnx_index_find(fuzi_q_ctx_t* fuzi_q_ctx, picoquic_connection_id_t* icid, uint64_t icid_hash)
+{
+    size_t x = fuzi_q_cnx_index_lookup(fuzi_q_ctx, icid, icid_hash);
+
+    return (x == SIZE_MAX) ? NULL : &fuzi_q_ctx->cnx_ctx[fuzi_q_ctx->cnx_index[x]];
+}
+
+/* Create the empty connection contexts and the matching index */
+int fuzi_q_create_cnx_ctx(fuzi_q_ctx_t* fuzi_q_ctx, size_t nb_cnx_ctx)
 {
+    int ret = 0;
+    size_t index_size = 2;
+
+    while (index_size < 2 * nb_cnx_ctx) {
+        index_size *= 2;
+    }
+
+    fuzi_q_ctx->cnx_ctx = (fuzi_q_cnx_ctx_t*)malloc(sizeof(fuzi_q_cnx_ctx_t) * nb_cnx_ctx);
+    fuzi_q_ctx->cnx_index = (size_t*)malloc(sizeof(size_t) * index_size);
+    fuzi_q_ctx->cnx_heap = (size_t*)malloc(sizeof(size_t) * nb_cnx_ctx);
+    fuzi_q_ctx->cnx_dirty = (size_t*)malloc(sizeof(size_t) * nb_cnx_ctx);
+    fuzi_q_ctx->cnx_free = (size_t*)malloc(sizeof(size_t) * nb_cnx_ctx);
+    if (fuzi_q_ctx->cnx_ctx == NULL || fuzi_q_ctx->cnx_index == NULL || fuzi_q_ctx->cnx_heap == NULL ||
+        fuzi_q_ctx->cnx_dirty == NULL || fuzi_q_ctx->cnx_free == NULL) {
+        ret = -1;
+    }
+    else {
+        memset(fuzi_q_ctx->cnx_ctx, 0, sizeof(fuzi_q_cnx_ctx_t) * nb_cnx_ctx);
+        fuzi_q_ctx->nb_cnx_ctx = nb_cnx_ctx;
+        for (size_t i = 0; i < index_size; i++) {
+            fuzi_q_ctx->cnx_index[i] = SIZE_MAX;
+        }
+        fuzi_q_ctx->cnx_index_mask = index_size - 1;
+        /* Free slots are popped from the end, list them so slot 0 is used first */
+        for (size_t i = 0; i < nb_cnx_ctx; i++) {
+            fuzi_q_ctx->cnx_free[i] = nb_cnx_ctx - 1 - i;
+        }
+        fuzi_q_ctx->nb_cnx_free = nb_cnx_ctx;
+        fuzi_q_ctx->cnx_heap_size = 0;
+        fuzi_q_ctx->nb_cnx_dirty = 0;
+        fuzi_q_ctx->nb_cnx_active = 0;
+    }
+
+    return ret;
+}
+
+/* Deadlines of started connections.
+ * The loop needs to find the connections whose next_time has passed, and the
+ * earliest of these times. Instead of scanning all contexts, the connections are
+ * kept in a binary min heap ordered by heap_time. The fuzzer pushes next_time
+ * back on every packet, and updating the heap each time would be wasteful, so
+ * heap_time is allowed to lag behind next_time. When the top of the heap
+ * expires, heap_time is either refreshed from next_time and the entry sifted
+ * down, or the connection has really timed out and is queued for checking.
+ */
+static void fuzi_q_cnx_heap_set(fuzi_q_ctx_t* fuzi_q_ctx, size_t x, size_t cnx_id)
+{
+    fuzi_q_ctx->cnx_heap[x] = cnx_id;
+    fuzi_q_ctx->cnx_ctx[cnx_id].heap_index = x;
+}
+
+static void fuzi_q_cnx_heap_up(fuzi_q_ctx_t* fuzi_q_ctx, size_t x)
+{
+    size_t cnx_id = fuzi_q_ctx->cnx_heap[x];
+    uint64_t heap_time = fuzi_q_ctx->cnx_ctx[cnx_id].heap_time;
+
+    while (x > 0) {
+        size_t parent = (x - 1) / 2;
+        if (fuzi_q_ctx->cnx_ctx[fuzi_q_ctx->cnx_heap[parent]].heap_time <= heap_time) {
+            break;
+        }
+        fuzi_q_cnx_heap_set(fuzi_q_ctx, x, fuzi_q_ctx->cnx_heap[parent]);
+        x = parent;
+    }
+    fuzi_q_cnx_heap_set(fuzi_q_ctx, x, cnx_id);
+}
+
+static void fuzi_q_cnx_heap_down(fuzi_q_ctx_t* fuzi_q_ctx, size_t x)
+{
+    size_t cnx_id = fuzi_q_ctx->cnx_heap[x];
+    uint64_t heap_time = fuzi_q_ctx->cnx_ctx[cnx_id].heap_time;
+
+    while (2 * x + 1 < fuzi_q_ctx->cnx_heap_size) {
+        size_t child = 2 * x + 1;
+        if (child + 1 < fuzi_q_ctx->cnx_heap_size &&
+            fuzi_q_ctx->cnx_ctx[fuzi_q_ctx->cnx_heap[child + 1]].heap_time < fuzi_q_ctx->cnx_ctx[fuzi_q_ctx->cnx_heap[child]].heap_time) {
+            child++;
+        }
+        if (fuzi_q_ctx->cnx_ctx[fuzi_q_ctx->cnx_heap[child]].heap_time >= heap_time) {
+            break;
+        }
+        fuzi_q_cnx_heap_set(fuzi_q_ctx, x, fuzi_q_ctx->cnx_heap[child]);
+        x = child;
+    }
+    fuzi_q_cnx_heap_set(fuzi_q_ctx, x, cnx_id);
+}
+
+void fuzi_q_cnx_heap_insert(fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_cnx_ctx_t* cnx_ctx)
+{
+    size_t x = fuzi_q_ctx->cnx_heap_size++;
+
+    cnx_ctx->heap_time = cnx_ctx->next_time;
+    fuzi_q_cnx_heap_set(fuzi_q_ctx, x, (size_t)(cnx_ctx - fuzi_q_ctx->cnx_ctx));
+    fuzi_q_cnx_heap_up(fuzi_q_ctx, x);
+}
+
+void fuzi_q_cnx_heap_remove(fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_cnx_ctx_t* cnx_ctx)
+{
+    size_t x = cnx_ctx->heap_index;
+
+    fuzi_q_ctx->cnx_heap_size--;
+    if (x < fuzi_q_ctx->cnx_heap_size) {
+        fuzi_q_cnx_heap_set(fuzi_q_ctx, x, fuzi_q_ctx->cnx_heap[fuzi_q_ctx->cnx_heap_size]);
+        fuzi_q_cnx_heap_up(fuzi_q_ctx, x);
+        fuzi_q_cnx_heap_down(fuzi_q_ctx, fuzi_q_ctx->cnx_ctx[fuzi_q_ctx->cnx_heap[x]].heap_index);
+    }
+}
+
+/* Queue a connection for checking in the next loop iteration.
+ * The dirty flag survives the release of the connection context, so that
+ * a slot is never queued twice even if it is released and reused before
+ * the queue is processed.
+ */
+void fuzi_q_mark_dirty(fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_cnx_ctx_t* cnx_ctx)
+{
+    if (!cnx_ctx->is_dirty) {
+        cnx_ctx->is_dirty = 1;
+        fuzi_q_ctx->cnx_dirty[fuzi_q_ctx->nb_cnx_dirty++] = (size_t)(cnx_ctx - fuzi_q_ctx->cnx_ctx);
+    }
+}
+
+/* Application callback for client connections.
+ * Every event reported by picoquic may change the state that the loop checks,
+ * such as the connection becoming ready, closing, or the number of open streams.
+ * Mark the connection dirty, then pass the event to the application.
+ */
+static int fuzi_q_client_callback(picoquic_cnx_t* cnx, uint64_t stream_id, uint8_t* bytes, size_t length,
+    picoquic_call_back_event_t fin_or_event, void* callback_ctx, void* v_stream_ctx)
+{
+    int ret = 0;
+    fuzi_q_cnx_ctx_t* cnx_ctx = (fuzi_q_cnx_ctx_t*)callback_ctx;
+
+    fuzi_q_mark_dirty(cnx_ctx->fuzi_q_ctx, cnx_ctx);
+    if (cnx_ctx->quicperf_ctx != NULL) {
+        ret = quicperf_callback(cnx, stream_id, bytes, length, fin_or_event, cnx_ctx->quicperf_ctx, v_stream_ctx);
+    }
+    else {
+        ret = picoquic_demo_client_callback(cnx, stream_id, bytes, length, fin_or_event, &cnx_ctx->callback_ctx, v_stream_ctx);
+    }
+    return ret;
+}
+
+/* Clear a connection context.
+ * Deleting the connection fires the close callback. The callback is
+ * removed first, so that the slot being released is not queued again,
+ * and the application contexts are not used after being deleted.
+ */
+void fuzi_q_release_connection(fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_cnx_ctx_t* cnx_ctx)
+{
+    int is_dirty = cnx_ctx->is_dirty;
+
+    if (cnx_ctx->cnx_client != NULL) {
+        picoquic_set_callback(cnx_ctx->cnx_client, NULL, NULL);
+    }
     if (cnx_ctx->quicperf_ctx != NULL) {
         quicperf_delete_ctx(cnx_ctx->quicperf_ctx);
     }
     picoquic_demo_client_delete_context(&cnx_ctx->callback_ctx);
     if (cnx_ctx->cnx_client != NULL) {
+        fuzi_q_cnx_index_remove(fuzi_q_ctx, cnx_ctx);
+        fuzi_q_cnx_heap_remove(fuzi_q_ctx, cnx_ctx);
+        fuzzer_forget_cnx(&fuzi_q_ctx->fuzz_ctx, cnx_ctx->cnx_client);
         picoquic_delete_cnx(cnx_ctx->cnx_client);
+        fuzi_q_ctx->cnx_free[fuzi_q_ctx->nb_cnx_free++] = (size_t)(cnx_ctx - fuzi_q_ctx->cnx_ctx);
+        fuzi_q_ctx->nb_cnx_active--;
     }
     memset(cnx_ctx, 0, sizeof(fuzi_q_cnx_ctx_t));
+    cnx_ctx->is_dirty = is_dirty;
 }
 
 /* Mark connection active */
-void fuzi_q_mark_active(fuzi_q_ctx_t* fuzi_q_ctx, picoquic_connection_id_t* icid, uint64_t current_time, int was_fuzzed)
+void fuzi_q_mark_active(fuzi_q_ctx_t* fuzi_q_ctx, picoquic_connection_id_t* icid, uint64_t icid_hash, uint64_t current_time, int was_fuzzed)
 {
-    for (size_t i = 0; i < fuzi_q_ctx->nb_cnx_ctx; i++) {
-        if (fuzi_q_ctx->cnx_ctx[i].cnx_client != NULL &&
-            picoquic_compare_connection_id(icid, &fuzi_q_ctx->cnx_ctx[i].icid) == 0) {
-            fuzi_q_ctx->cnx_ctx[i].next_time = current_time + FUZI_Q_MAX_SILENCE;
-            fuzi_q_ctx->cnx_ctx[i].was_fuzzed |= was_fuzzed;
-            break;
-        }
+    fuzi_q_cnx_ctx_t* cnx_ctx = fuzi_q_cnx_index_find(fuzi_q_ctx, icid, icid_hash);
+
+    if (cnx_ctx != NULL) {
+        cnx_ctx->next_time = current_time + FUZI_Q_MAX_SILENCE;
+        cnx_ctx->was_fuzzed |= was_fuzzed;
+        fuzi_q_mark_dirty(fuzi_q_ctx, cnx_ctx);
     }
 }
 
@@ -89,7 +316,9 @@ int fuzi_q_start_connection(fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_cnx_ctx_t* cnx_ctx,
     char const* ticket_alpn = NULL;
     uint32_t ticket_version = 0;
     /* Create a predictable and random ICID */
+    cnx_ctx->cid_index = fuzi_q_ctx->fuzz_ctx.cid_index;
     fuzzer_random_cid(&fuzi_q_ctx->fuzz_ctx, &cnx_ctx->icid);
+    cnx_ctx->icid_hash = fuzzer_icid_hash(&cnx_ctx->icid);
     /* Try pick the ALPN and version from tickets if there are any */
 
     if (picoquic_demo_client_get_alpn_and_version_from_tickets(fuzi_q_ctx->quic, PICOQUIC_TEST_SNI, alpn,
@@ -110,10 +339,14 @@ int fuzi_q_start_connection(fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_cnx_ctx_t* cnx_ctx,
         ret = -1;
     }
     else {
+        cnx_ctx->fuzi_q_ctx = fuzi_q_ctx;
+        fuzi_q_cnx_index_insert(fuzi_q_ctx, cnx_ctx);
+        fuzi_q_cnx_heap_insert(fuzi_q_ctx, cnx_ctx);
+        fuzi_q_ctx->nb_cnx_active++;
         if (fuzi_q_ctx->is_quicperf) {
             cnx_ctx->quicperf_ctx = quicperf_create_ctx(fuzi_q_ctx->client_scenario_text, stderr);
             if (cnx_ctx->quicperf_ctx != NULL) {
-                picoquic_set_callback(cnx_ctx->cnx_client, quicperf_callback, cnx_ctx->quicperf_ctx);
+                picoquic_set_callback(cnx_ctx->cnx_client, fuzi_q_client_callback, cnx_ctx);
             }
             else {
                 ret = -1;
@@ -126,7 +359,7 @@ int fuzi_q_start_connection(fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_cnx_ctx_t* cnx_ctx,
                 cnx_ctx->callback_ctx.out_dir = fuzi_q_ctx->out_dir;
                 cnx_ctx->callback_ctx.last_interaction_time = current_time;
                 cnx_ctx->callback_ctx.no_print = 1;
-                picoquic_set_callback(cnx_ctx->cnx_client, picoquic_demo_client_callback, &cnx_ctx->callback_ctx);
+                picoquic_set_callback(cnx_ctx->cnx_client, fuzi_q_client_callback, cnx_ctx);
 
                 /* Requires TP grease and enable options for interop tests */
                 cnx_ctx->cnx_client->grease_transport_parameters = 1;
@@ -153,6 +386,8 @@ int fuzi_q_start_connection(fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_cnx_ctx_t* cnx_ctx,
 
         if (ret == 0) {
             cnx_ctx->next_time = current_time + FUZI_Q_MAX_SILENCE;
+            cnx_ctx->heap_time = cnx_ctx->next_time;
+            fuzi_q_cnx_heap_down(fuzi_q_ctx, cnx_ctx->heap_index);
             ret = picoquic_start_client_cnx(cnx_ctx->cnx_client);
         }
         if (ret == 0 && !fuzi_q_ctx->is_quicperf) {
@@ -170,11 +405,12 @@ int fuzi_q_start_connection(fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_cnx_ctx_t* cnx_ctx,
 static const char* test_scenario_default = "0:index.html;4:test.html;8:/1234567;12:main.jpg;16:war-and-peace.txt;20:en/latest/;24:/file-123K";
 
 /* Set quic context for client run.
- * 
+ * The frame weights and test frames are those of settings if it is not
+ * NULL, otherwise the built-in test frames are used.
  */
 int fuzi_q_set_client_context(fuzi_q_mode_enum fuzz_mode, fuzi_q_ctx_t* fuzi_q_ctx, const char* ip_address_text, int server_port,
     picoquic_quic_config_t* config, size_t nb_cnx_required, uint64_t duration_max, picoquic_connection_id_t* init_cid,
-    char const* client_scenario_text, uint64_t* virtual_time)
+    char const* client_scenario_text, uint64_t* virtual_time, const fuzzer_ctx_t* settings)
 {
     int ret = 0;
     uint64_t current_time = (virtual_time == NULL)?picoquic_current_time(): *virtual_time;
@@ -231,7 +467,12 @@ int fuzi_q_set_client_context(fuzi_q_mode_enum fuzz_mode, fuzi_q_ctx_t* fuzi_q_c
             ret = -1;
         }
         else {
-            fuzi_q_fuzzer_init(&fuzi_q_ctx->fuzz_ctx, init_cid, fuzi_q_ctx->quic);
+            if (settings != NULL) {
+                ret = fuzi_q_fuzzer_init_shared(&fuzi_q_ctx->fuzz_ctx, init_cid, fuzi_q_ctx->quic, settings);
+            }
+            else {
+                fuzi_q_fuzzer_init(&fuzi_q_ctx->fuzz_ctx, init_cid, fuzi_q_ctx->quic);
+            }
             fuzi_q_ctx->fuzz_ctx.parent = fuzi_q_ctx;
             /* Always set fuzzing for client and clean modes */
             picoquic_set_fuzz(fuzi_q_ctx->quic, fuzi_q_fuzzer, &fuzi_q_ctx->fuzz_ctx);
@@ -253,14 +494,7 @@ int fuzi_q_set_client_context(fuzi_q_mode_enum fuzz_mode, fuzi_q_ctx_t* fuzi_q_c
 
     /* Create empty connection contexts */
     if (ret == 0) {
-        fuzi_q_ctx->cnx_ctx = (fuzi_q_cnx_ctx_t*)malloc(sizeof(fuzi_q_cnx_ctx_t) * nb_cnx_ctx);
-        if (fuzi_q_ctx->cnx_ctx == NULL) {
-            ret = -1;
-        }
-        else {
-            memset(fuzi_q_ctx->cnx_ctx, 0, sizeof(fuzi_q_cnx_ctx_t) * nb_cnx_ctx);
-            fuzi_q_ctx->nb_cnx_ctx = nb_cnx_ctx;
-        }
+        ret = fuzi_q_create_cnx_ctx(fuzi_q_ctx, nb_cnx_ctx);
     }
 
     return ret;
@@ -270,13 +504,37 @@ void fuzi_q_release_client_context(fuzi_q_ctx_t* fuzi_q_ctx)
 {
     if (fuzi_q_ctx->cnx_ctx != NULL) {
         for (size_t i = 0; i < fuzi_q_ctx->nb_cnx_ctx; i++) {
-            fuzi_q_release_connection(&fuzi_q_ctx->cnx_ctx[i]);
+            fuzi_q_release_connection(fuzi_q_ctx, &fuzi_q_ctx->cnx_ctx[i]);
         }
         free(fuzi_q_ctx->cnx_ctx);
         fuzi_q_ctx->cnx_ctx = NULL;
     }
     fuzi_q_ctx->nb_cnx_ctx = 0;
 
+    if (fuzi_q_ctx->cnx_index != NULL) {
+        free(fuzi_q_ctx->cnx_index);
+        fuzi_q_ctx->cnx_index = NULL;
+    }
+    fuzi_q_ctx->cnx_index_mask = 0;
+
+    if (fuzi_q_ctx->cnx_heap != NULL) {
+        free(fuzi_q_ctx->cnx_heap);
+        fuzi_q_ctx->cnx_heap = NULL;
+    }
+    fuzi_q_ctx->cnx_heap_size = 0;
+
+    if (fuzi_q_ctx->cnx_dirty != NULL) {
+        free(fuzi_q_ctx->cnx_dirty);
+        fuzi_q_ctx->cnx_dirty = NULL;
+    }
+    fuzi_q_ctx->nb_cnx_dirty = 0;
+
+    if (fuzi_q_ctx->cnx_free != NULL) {
+        free(fuzi_q_ctx->cnx_free);
+        fuzi_q_ctx->cnx_free = NULL;
+    }
+    fuzi_q_ctx->nb_cnx_free = 0;
+
     if (fuzi_q_ctx->quic != NULL) {
         picoquic_free(fuzi_q_ctx->quic);
         fuzi_q_ctx->quic = NULL;
@@ -287,6 +545,93 @@ void fuzi_q_release_client_context(fuzi_q_ctx_t* fuzi_q_ctx)
         fuzi_q_ctx->client_sc = NULL;
     }
     fuzi_q_ctx->client_sc_nb = 0;
+
+    fuzi_q_fuzzer_release(&fuzi_q_ctx->fuzz_ctx);
+}
+
+/* Outcome of a connection that ended, used both for the reward of the
+ * fuzzing strategy and for the counters of the test frames injected in it.
+ * Abandoned connections timed out. A close by the peer with an application
+ * error, or with a transport error other than the expected reaction to a
+ * malformed frame, is an unexpected close. Any other end is normal.
+ */
+static fuzzer_entry_outcome_enum fuzi_q_cnx_outcome(fuzi_q_cnx_ctx_t* cnx_ctx, picoquic_state_enum cnx_state)
+{
+    fuzzer_entry_outcome_enum outcome = fuzzer_entry_outcome_none;
+
+    if (cnx_state != picoquic_state_disconnected) {
+        outcome = fuzzer_entry_outcome_timeout;
+    }
+    else {
+        uint64_t remote_error = picoquic_get_remote_error(cnx_ctx->cnx_client);
+
+        if ((remote_error != 0 && remote_error != PICOQUIC_TRANSPORT_FRAME_FORMAT_ERROR &&
+            remote_error != PICOQUIC_TRANSPORT_PROTOCOL_VIOLATION) ||
+            picoquic_get_remote_application_error(cnx_ctx->cnx_client) != 0) {
+            outcome = fuzzer_entry_outcome_peer_close;
+        }
+    }
+    return outcome;
+}
+
+/* Check the state of a started connection, release it if it is finished */
+static int fuzi_q_check_one_cnx(fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_cnx_ctx_t* cnx_ctx, uint64_t current_time, int* is_active)
+{
+    int ret = 0;
+    /* If this is a newly successful connection, update the last success pointer
+     * If this is a disconnected connection, clear the app level data.
+     */
+    picoquic_state_enum cnx_state = picoquic_get_cnx_state(cnx_ctx->cnx_client);
+    int should_abandon = 0;
+
+    if (cnx_state == picoquic_state_ready) {
+        if (!cnx_ctx->success_observed) {
+            fuzi_q_ctx->next_success_time = current_time + fuzi_q_ctx->up_time_interval;
+            cnx_ctx->success_observed = 1;
+            if (ret == 0 && !cnx_ctx->zero_rtt_available) {
+                if (!fuzi_q_ctx->is_quicperf) {
+                    /* Start the download scenario */
+                    ret = picoquic_demo_client_start_streams(cnx_ctx->cnx_client, &cnx_ctx->callback_ctx, PICOQUIC_DEMO_STREAM_ID_INITIAL);
+                    *is_active = 1;
+                }
+            }
+        }
+        else if (cnx_ctx->callback_ctx.nb_open_streams == 0) {
+            ret = picoquic_close(cnx_ctx->cnx_client, 0);
+            *is_active = 1;
+        }
+    }
+    if (cnx_ctx->cnx_client->path[0]->nb_retransmit > 2 || current_time >= cnx_ctx->next_time) {
+        should_abandon = 1;
+    }
+    if (cnx_state == picoquic_state_disconnected || should_abandon) {
+        uint64_t cnx_duration = current_time - cnx_ctx->cnx_client->start_time;
+        fuzzer_entry_outcome_enum outcome;
+        if (cnx_duration > fuzi_q_ctx->cnx_duration_max) {
+            fuzi_q_ctx->cnx_duration_max = cnx_duration;
+            fuzi_q_ctx->icid_duration_max.id_len = picoquic_parse_connection_id(cnx_ctx->cnx_client->initial_cnxid.id,
+                cnx_ctx->cnx_client->initial_cnxid.id_len, &fuzi_q_ctx->icid_duration_max);
+            fuzi_q_ctx->cid_index_duration_max = cnx_ctx->cid_index;
+        }
+        if (cnx_duration < fuzi_q_ctx->cnx_duration_min) {
+            fuzi_q_ctx->cnx_duration_min = cnx_duration;
+        }
+        if (fuzi_q_ctx->fuzz_mode == fuzi_q_mode_client && !cnx_ctx->was_fuzzed) {
+            DBG_PRINTF("Connection stopped without being fuzzed: %02x%02x...", cnx_ctx->icid.id[0], cnx_ctx->icid.id[1]);
+        }
+        outcome = fuzi_q_cnx_outcome(cnx_ctx, cnx_state);
+        if (fuzi_q_ctx->fuzz_ctx.bandit.shared != NULL) {
+            fuzzer_bandit_reward(&fuzi_q_ctx->fuzz_ctx, &cnx_ctx->icid, (outcome != fuzzer_entry_outcome_none) ? 1.0 : 0);
+        }
+        fuzzer_entry_outcome(&fuzi_q_ctx->fuzz_ctx, &cnx_ctx->icid, outcome);
+        fuzi_q_release_connection(fuzi_q_ctx, cnx_ctx);
+        *is_active = 1;
+        if (current_time >= fuzi_q_ctx->end_of_time) {
+            DBG_PRINTF("Abandon fuzz at time = %" PRIu64, current_time);
+        }
+    }
+
+    return ret;
 }
 
 /* Fuzi Q, client loop.
@@ -296,87 +641,103 @@ void fuzi_q_release_client_context(fuzi_q_ctx_t* fuzi_q_ctx)
  * Need to check that some connections are succeeding. This will have to be 
  * coordinated with the fuzzer logic, e.g., do not fuzz before handshake
  * has succeeded for at least some connections. 
+ * The loop only looks at the connections that need attention: those whose
+ * deadline expired, as found at the top of the timer heap, and those that
+ * were marked dirty by the application callback or by the fuzzer since
+ * the previous iteration. New connections are started in free slots.
  * TODO: consider migration trials, key update trials.
  */
 int fuzi_q_loop_check_cnx(fuzi_q_ctx_t* fuzi_q_ctx, uint64_t current_time, int * is_active)
 {
     int ret = 0;
-    int nb_active = 0;
-
-    for (size_t i = 0; i < fuzi_q_ctx->nb_cnx_ctx && ret == 0; i++) {
-        fuzi_q_cnx_ctx_t* cnx_ctx = &fuzi_q_ctx->cnx_ctx[i];
+    size_t nb_dirty;
+    size_t nb_queued;
 
-        if (cnx_ctx->cnx_client != NULL) {
-            /* If this is a newly successful connection, update the last success pointer
-             * If this is a disconnected connection, clear the app level data.
-             */
-            picoquic_state_enum cnx_state = picoquic_get_cnx_state(cnx_ctx->cnx_client);
-            int should_abandon = 0;
-
-            if (cnx_state == picoquic_state_ready) {
-                if (!cnx_ctx->success_observed) {
-                    fuzi_q_ctx->next_success_time = current_time + fuzi_q_ctx->up_time_interval;
-                    cnx_ctx->success_observed = 1;
-                    if (ret == 0 && !cnx_ctx->zero_rtt_available) {
-                        if (!fuzi_q_ctx->is_quicperf) {
-                            /* Start the download scenario */
-                            ret = picoquic_demo_client_start_streams(cnx_ctx->cnx_client, &cnx_ctx->callback_ctx, PICOQUIC_DEMO_STREAM_ID_INITIAL);
-                            *is_active = 1;
-                        }
-                    }
-                }
-                else if (cnx_ctx->callback_ctx.nb_open_streams == 0) {
-                    ret = picoquic_close(cnx_ctx->cnx_client, 0);
-                    *is_active = 1;
-                }
-            }
-            if (cnx_ctx->cnx_client->path[0]->nb_retransmit > 2 || current_time >= cnx_ctx->next_time) {
-                should_abandon = 1;
-            }
-            if (cnx_state == picoquic_state_disconnected || should_abandon) {
-                uint64_t cnx_duration = current_time - cnx_ctx->cnx_client->start_time;
-                if (cnx_duration > fuzi_q_ctx->cnx_duration_max) {
-                    fuzi_q_ctx->cnx_duration_max = cnx_duration;
-                    fuzi_q_ctx->icid_duration_max.id_len = picoquic_parse_connection_id(cnx_ctx->cnx_client->initial_cnxid.id,
-                        cnx_ctx->cnx_client->initial_cnxid.id_len, &fuzi_q_ctx->icid_duration_max);
-                }
-                if (cnx_duration < fuzi_q_ctx->cnx_duration_min) {
-                    fuzi_q_ctx->cnx_duration_min = cnx_duration;
-                }
-                if (fuzi_q_ctx->fuzz_mode == fuzi_q_mode_client && !cnx_ctx->was_fuzzed) {
-                    DBG_PRINTF("Connection stopped without being fuzzed: %02x%02x...", cnx_ctx->icid.id[0], cnx_ctx->icid.id[1]);
-                }
-                fuzi_q_release_connection(cnx_ctx);
-                *is_active = 1;
-            }
+    /* Queue the connections whose deadline has passed */
+    while (fuzi_q_ctx->cnx_heap_size > 0) {
+        fuzi_q_cnx_ctx_t* cnx_ctx = &fuzi_q_ctx->cnx_ctx[fuzi_q_ctx->cnx_heap[0]];
+        if (cnx_ctx->heap_time > current_time) {
+            break;
         }
-        if (cnx_ctx->cnx_client == NULL){
-            if (current_time >= fuzi_q_ctx->end_of_time) {
-                DBG_PRINTF("Abandon fuzz at time = %" PRIu64, current_time);
-            } else if (fuzi_q_ctx->nb_cnx_tried < fuzi_q_ctx->nb_cnx_required) {
-                /* If the required number of trials is not done, try starting a new connection. */
-                fuzi_q_ctx->nb_cnx_tried++;
-                ret = fuzi_q_start_connection(fuzi_q_ctx, cnx_ctx, current_time);
-                *is_active = 1;
-                nb_active++;
-            }
+        if (cnx_ctx->next_time > current_time) {
+            cnx_ctx->heap_time = cnx_ctx->next_time;
         }
         else {
-            nb_active++;
+            /* Will be released when checked. Until then, keep it out of the way. */
+            cnx_ctx->heap_time = UINT64_MAX;
+            fuzi_q_mark_dirty(fuzi_q_ctx, cnx_ctx);
+        }
+        fuzi_q_cnx_heap_down(fuzi_q_ctx, 0);
+    }
+
+    /* Check the queued connections. Connections queued during this pass
+     * are left for the next iteration. */
+    nb_dirty = 0;
+    nb_queued = fuzi_q_ctx->nb_cnx_dirty;
+    while (nb_dirty < nb_queued && ret == 0) {
+        fuzi_q_cnx_ctx_t* cnx_ctx = &fuzi_q_ctx->cnx_ctx[fuzi_q_ctx->cnx_dirty[nb_dirty]];
+
+        nb_dirty++;
+        cnx_ctx->is_dirty = 0;
+        if (cnx_ctx->cnx_client != NULL) {
+            ret = fuzi_q_check_one_cnx(fuzi_q_ctx, cnx_ctx, current_time, is_active);
         }
     }
+    if (nb_dirty > 0) {
+        fuzi_q_ctx->nb_cnx_dirty -= nb_dirty;
+        memmove(fuzi_q_ctx->cnx_dirty, fuzi_q_ctx->cnx_dirty + nb_dirty, fuzi_q_ctx->nb_cnx_dirty * sizeof(size_t));
+    }
 
-    if (ret == 0 && nb_active == 0) {
+    /* If the required number of trials is not done, try starting new connections. */
+    while (ret == 0 && fuzi_q_ctx->nb_cnx_free > 0 && current_time < fuzi_q_ctx->end_of_time &&
+        fuzi_q_ctx->nb_cnx_tried < fuzi_q_ctx->nb_cnx_required) {
+        fuzi_q_cnx_ctx_t* cnx_ctx = &fuzi_q_ctx->cnx_ctx[fuzi_q_ctx->cnx_free[--fuzi_q_ctx->nb_cnx_free]];
+        fuzi_q_ctx->nb_cnx_tried++;
+        ret = fuzi_q_start_connection(fuzi_q_ctx, cnx_ctx, current_time);
+        *is_active = 1;
+        if (cnx_ctx->cnx_client == NULL) {
+            fuzi_q_ctx->cnx_free[fuzi_q_ctx->nb_cnx_free++] = (size_t)(cnx_ctx - fuzi_q_ctx->cnx_ctx);
+        }
+    }
+
+    if (ret == 0 && fuzi_q_ctx->nb_cnx_active == 0) {
             ret = PICOQUIC_NO_ERROR_TERMINATE_PACKET_LOOP;
     }
     else if (current_time > fuzi_q_ctx->next_success_time) {
         fuzi_q_ctx->server_is_down = 1;
         ret = PICOQUIC_NO_ERROR_TERMINATE_PACKET_LOOP;
+        /* Credit the strategies and the test frames of the connections in progress */
+        for (size_t i = 0; i < fuzi_q_ctx->nb_cnx_ctx; i++) {
+            if (fuzi_q_ctx->cnx_ctx[i].cnx_client != NULL) {
+                if (fuzi_q_ctx->fuzz_ctx.bandit.shared != NULL) {
+                    fuzzer_bandit_reward(&fuzi_q_ctx->fuzz_ctx, &fuzi_q_ctx->cnx_ctx[i].icid, 1.0);
+                }
+                fuzzer_entry_outcome(&fuzi_q_ctx->fuzz_ctx, &fuzi_q_ctx->cnx_ctx[i].icid, fuzzer_entry_outcome_server_down);
+            }
+        }
     }
 
     return ret;
 }
 
+/* Count the connections still open when the loop stopped, e.g., after
+ * an error or when the simulation was inactive for too long. They did not
+ * have the time to fail, so they give no reward to the strategy. The
+ * connections in progress when the server appeared down were already
+ * counted as such.
+ */
+void fuzi_q_client_end_of_run(fuzi_q_ctx_t* fuzi_q_ctx)
+{
+    for (size_t i = 0; !fuzi_q_ctx->server_is_down && i < fuzi_q_ctx->nb_cnx_ctx; i++) {
+        if (fuzi_q_ctx->cnx_ctx[i].cnx_client != NULL) {
+            if (fuzi_q_ctx->fuzz_ctx.bandit.shared != NULL) {
+                fuzzer_bandit_reward(&fuzi_q_ctx->fuzz_ctx, &fuzi_q_ctx->cnx_ctx[i].icid, 0);
+            }
+            fuzzer_entry_outcome(&fuzi_q_ctx->fuzz_ctx, &fuzi_q_ctx->cnx_ctx[i].icid, fuzzer_entry_outcome_open_at_end);
+        }
+    }
+}
+
 uint64_t fuzi_q_next_time(fuzi_q_ctx_t* fuzi_q_ctx)
 {
     uint64_t next_event_time = UINT64_MAX;
@@ -386,11 +747,13 @@ uint64_t fuzi_q_next_time(fuzi_q_ctx_t* fuzi_q_ctx)
         if (next_event_time > fuzi_q_ctx->next_success_time) {
             next_event_time = fuzi_q_ctx->next_success_time;
         }
-        for (size_t i = 0; i < fuzi_q_ctx->nb_cnx_ctx; i++) {
-            if (fuzi_q_ctx->cnx_ctx[i].cnx_client != NULL &&
-                fuzi_q_ctx->cnx_ctx[i].next_time < next_event_time) {
-                next_event_time = fuzi_q_ctx->cnx_ctx[i].next_time;
-            }
+        if (fuzi_q_ctx->nb_cnx_dirty > 0) {
+            /* Some connections are waiting to be checked */
+            next_event_time = 0;
+        }
+        else if (fuzi_q_ctx->cnx_heap_size > 0 &&
+            fuzi_q_ctx->cnx_ctx[fuzi_q_ctx->cnx_heap[0]].heap_time < next_event_time) {
+            next_event_time = fuzi_q_ctx->cnx_ctx[fuzi_q_ctx->cnx_heap[0]].heap_time;
         }
     }
 
@@ -403,7 +766,8 @@ void fuzi_q_check_time(fuzi_q_ctx_t* fuzi_q_ctx, packet_loop_time_check_arg_t* t
     uint64_t next_event_time = fuzi_q_next_time(fuzi_q_ctx);
 
     if (next_event_time < next_time) {
-        time_check_arg->delta_t = next_time - time_check_arg->current_time;
+        time_check_arg->delta_t = (next_event_time > time_check_arg->current_time) ?
+            next_event_time - time_check_arg->current_time : 0;
     }
 }
 
@@ -451,55 +815,361 @@ int fuzi_q_client_loop_cb(picoquic_quic_t* quic, picoquic_packet_loop_cb_enum cb
 }
 
 
-/* Fuzi Quic Client
- * TODO: manage loop options like key updates, migrations, etc. 
- */
-int fuzi_q_client(fuzi_q_mode_enum fuzz_mode, const char* ip_address_text, int server_port,
-    picoquic_quic_config_t* config, size_t nb_cnx_required, uint64_t duration_max,
-    picoquic_connection_id_t * init_cid, char const* client_scenario_text)
+/* Run the client loop for one fuzi_q context, until all trials are done */
+static int fuzi_q_client_run(fuzi_q_ctx_t* fuzi_q_ctx)
 {
-    /* Start: start the QUIC process with cert and key files */
     int ret = 0;
-    fuzi_q_ctx_t fuzi_q_ctx = { 0 };
     int is_active = 0;
 
-    ret = fuzi_q_set_client_context(fuzz_mode, &fuzi_q_ctx, ip_address_text, server_port,
-        config, nb_cnx_required, duration_max, init_cid, client_scenario_text, NULL);
-
     /* Start the client connections */
-    if (ret == 0) {
-        ret = fuzi_q_loop_check_cnx(&fuzi_q_ctx, picoquic_get_quic_time(fuzi_q_ctx.quic), &is_active);
-    }
+    ret = fuzi_q_loop_check_cnx(fuzi_q_ctx, picoquic_get_quic_time(fuzi_q_ctx->quic), &is_active);
     /* Wait for packets */
     if (ret == 0) {
 #ifdef _WINDOWS
-        ret = picoquic_packet_loop_win(fuzi_q_ctx.quic, 0, fuzi_q_ctx.server_address.ss_family, 0,
-            (int)fuzi_q_ctx.socket_buffer_size, fuzi_q_client_loop_cb, &fuzi_q_ctx);
+        ret = picoquic_packet_loop_win(fuzi_q_ctx->quic, 0, fuzi_q_ctx->server_address.ss_family, 0,
+            (int)fuzi_q_ctx->socket_buffer_size, fuzi_q_client_loop_cb, fuzi_q_ctx);
 #else
-        ret = picoquic_packet_loop(fuzi_q_ctx.quic, 0, fuzi_q_ctx.server_address.ss_family, 0,
-            fuzi_q_ctx.socket_buffer_size, 0, fuzi_q_client_loop_cb, &fuzi_q_ctx);
+        ret = picoquic_packet_loop(fuzi_q_ctx->quic, 0, fuzi_q_ctx->server_address.ss_family, 0,
+            fuzi_q_ctx->socket_buffer_size, 0, fuzi_q_client_loop_cb, fuzi_q_ctx);
 #endif
     }
+    fuzi_q_client_end_of_run(fuzi_q_ctx);
+
+    return ret;
+}
 
-    fprintf(stdout, "Exit after %zu trials, server appears %s.\n", fuzi_q_ctx.nb_cnx_tried,
-        (fuzi_q_ctx.server_is_down) ? "down" : "up");
+/* Share of the required trials given to one of nb_shares threads, shards or clients.
+ * The first shares get one more trial when the division is not exact. */
+size_t fuzi_q_trials_share(size_t nb_cnx_required, int nb_shares, int share_id)
+{
+    return nb_cnx_required / nb_shares + (((size_t)share_id < nb_cnx_required % nb_shares) ? 1 : 0);
+}
+
+/* Parse the thread option, "threads[:shards[:clients]]". Each number must be
+ * positive. Shards and clients keep their previous values when not specified. */
+int fuzi_q_parse_threads(char const* text, int* nb_threads, int* nb_shards, int* nb_clients)
+{
+    int* values[3] = { nb_threads, nb_shards, nb_clients };
+    int ret = 0;
+
+    for (int i = 0; ret == 0 && i < 3; i++) {
+        char* end_ptr = NULL;
+        long v = strtol(text, &end_ptr, 10);
+
+        if (end_ptr == text || v <= 0 || v > 0x10000) {
+            ret = -1;
+        }
+        else {
+            *values[i] = (int)v;
+            text = end_ptr;
+            if (*text == 0) {
+                break;
+            }
+            else if (*text != ':' || i == 2) {
+                ret = -1;
+            }
+            else {
+                text++;
+            }
+        }
+    }
+    return ret;
+}
+
+/* Return the first option letter found in both option strings, or 0 if
+ * they do not overlap. The ':' marking options with arguments are ignored. */
+int fuzi_q_option_letters_overlap(char const* own, char const* other)
+{
+    for (; *own != 0; own++) {
+        if (*own != ':' && strchr(other, *own) != NULL) {
+            return *own;
+        }
+    }
+    return 0;
+}
+
+/* Multithreaded client.
+ * Each worker thread owns a complete fuzi_q context, with its own QUIC context,
+ * fuzzer context and socket. The worker contexts are created by the main thread
+ * before the threads are started. Worker 0 uses the initial CID specified with -X,
+ * or a random one; the other workers start from a branch of that CID, so the
+ * chains of CID do not overlap and every connection can be replayed with -X.
+ * Only worker 0 uses the ticket and token files of the configuration; the other
+ * workers use a copy without them, so the threads do not write the same files.
+ */
+typedef struct st_fuzi_q_worker_t {
+    fuzi_q_ctx_t fuzi_q_ctx;
+    picoquic_quic_config_t config;
+    picoquic_thread_t thread;
+    int ret;
+} fuzi_q_worker_t;
+
+#ifdef _WINDOWS
+static DWORD WINAPI fuzi_q_client_worker(LPVOID v_worker)
+#else
+static void* fuzi_q_client_worker(void* v_worker)
+#endif
+{
+    fuzi_q_worker_t* worker = (fuzi_q_worker_t*)v_worker;
+
+    worker->ret = fuzi_q_client_run(&worker->fuzi_q_ctx);
+#ifdef _WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+/* Print an ICID, followed by its index N with the counter scheme, so that
+ * the connection can be replayed with -Y counter:N */
+void fuzi_q_print_icid(fuzzer_cid_scheme_enum cid_scheme, picoquic_connection_id_t* icid, uint64_t cid_index)
+{
+    for (uint8_t x = 0; x < icid->id_len; x++) {
+        fprintf(stdout, "%02x", icid->id[x]);
+    }
+    if (cid_scheme == fuzzer_cid_scheme_counter) {
+        fprintf(stdout, ", N: %" PRIu64, cid_index);
+    }
+}
+
+/* Add the results of a worker to the global summary */
+void fuzi_q_client_merge_stats(fuzi_q_ctx_t* summary, fuzi_q_ctx_t* fuzi_q_ctx)
+{
+    summary->nb_cnx_tried += fuzi_q_ctx->nb_cnx_tried;
+    summary->server_is_down |= fuzi_q_ctx->server_is_down;
+    summary->fuzz_ctx.cid_scheme = fuzi_q_ctx->fuzz_ctx.cid_scheme;
+    for (int i = 0; i < fuzzer_cnx_state_max; i++) {
+        summary->fuzz_ctx.nb_cnx_tried[i] += fuzi_q_ctx->fuzz_ctx.nb_cnx_tried[i];
+        summary->fuzz_ctx.nb_cnx_fuzzed[i] += fuzi_q_ctx->fuzz_ctx.nb_cnx_fuzzed[i];
+        summary->fuzz_ctx.nb_packets_fuzzed[i] += fuzi_q_ctx->fuzz_ctx.nb_packets_fuzzed[i];
+        summary->fuzz_ctx.nb_packets_state[i] += fuzi_q_ctx->fuzz_ctx.nb_packets_state[i];
+    }
+    for (size_t i = 0; i < FUZZER_NB_FRAME_FUZZERS; i++) {
+        summary->fuzz_ctx.frame_hits[i] += fuzi_q_ctx->fuzz_ctx.frame_hits[i];
+    }
+    for (int i = 0; i < FUZZER_NB_STRATEGIES; i++) {
+        summary->fuzz_ctx.bandit.nb_pulls[i] += fuzi_q_ctx->fuzz_ctx.bandit.nb_pulls[i];
+        summary->fuzz_ctx.bandit.nb_rewards[i] += fuzi_q_ctx->fuzz_ctx.bandit.nb_rewards[i];
+    }
+    summary->fuzz_ctx.bandit.nb_lost_rewards += fuzi_q_ctx->fuzz_ctx.bandit.nb_lost_rewards;
+    summary->fuzz_ctx.nb_lost_outcomes += fuzi_q_ctx->fuzz_ctx.nb_lost_outcomes;
+    if (fuzi_q_ctx->cnx_duration_min < summary->cnx_duration_min) {
+        summary->cnx_duration_min = fuzi_q_ctx->cnx_duration_min;
+    }
+    if (fuzi_q_ctx->cnx_duration_max > summary->cnx_duration_max) {
+        summary->cnx_duration_max = fuzi_q_ctx->cnx_duration_max;
+        summary->icid_duration_max = fuzi_q_ctx->icid_duration_max;
+        summary->cid_index_duration_max = fuzi_q_ctx->cid_index_duration_max;
+    }
+}
+
+void fuzi_q_client_print_stats(fuzi_q_ctx_t* fuzi_q_ctx, size_t nb_cnx_required)
+{
+    fprintf(stdout, "Exit after %zu trials, server appears %s.\n", fuzi_q_ctx->nb_cnx_tried,
+        (fuzi_q_ctx->server_is_down) ? "down" : "up");
     for (int i = 0; i < fuzzer_cnx_state_max; i++) {
         fprintf(stdout, "State: %d, %zu connections tried, %zu fuzzed, %zu packets fuzzed out of %zu.\n",
-            i, fuzi_q_ctx.fuzz_ctx.nb_cnx_tried[i], fuzi_q_ctx.fuzz_ctx.nb_cnx_fuzzed[i],
-            fuzi_q_ctx.fuzz_ctx.nb_packets_fuzzed[i],
-            fuzi_q_ctx.fuzz_ctx.nb_packets_state[i]);
+            i, fuzi_q_ctx->fuzz_ctx.nb_cnx_tried[i], fuzi_q_ctx->fuzz_ctx.nb_cnx_fuzzed[i],
+            fuzi_q_ctx->fuzz_ctx.nb_packets_fuzzed[i],
+            fuzi_q_ctx->fuzz_ctx.nb_packets_state[i]);
     }
     fprintf(stdout, "Tried %zu connections (target: %zu). Connection min: %fs, max %fs\n",
-        fuzi_q_ctx.nb_cnx_tried, fuzi_q_ctx.nb_cnx_required,
-        ((double)fuzi_q_ctx.cnx_duration_min) / 1000000.0,
-        ((double)fuzi_q_ctx.cnx_duration_max) / 1000000.0);
+        fuzi_q_ctx->nb_cnx_tried, nb_cnx_required,
+        ((double)fuzi_q_ctx->cnx_duration_min) / 1000000.0,
+        ((double)fuzi_q_ctx->cnx_duration_max) / 1000000.0);
     fprintf(stdout, "ID of longest_connection: ");
-    for (uint8_t x = 0; x < fuzi_q_ctx.icid_duration_max.id_len; x++) {
-        fprintf(stdout, "%02x", fuzi_q_ctx.icid_duration_max.id[x]);
+    fuzi_q_print_icid(fuzi_q_ctx->fuzz_ctx.cid_scheme, &fuzi_q_ctx->icid_duration_max, fuzi_q_ctx->cid_index_duration_max);
+    fprintf(stdout, "\n");
+    for (size_t i = 0; i < FUZZER_NB_FRAME_FUZZERS; i++) {
+        if (fuzi_q_ctx->fuzz_ctx.frame_hits[i] > 0) {
+            fprintf(stdout, "Frame fuzzer %s: %" PRIu64 " frames fuzzed.\n",
+                fuzzer_frame_fuzzer_name(i), fuzi_q_ctx->fuzz_ctx.frame_hits[i]);
+        }
+    }
+    for (int i = 0; i < FUZZER_NB_STRATEGIES; i++) {
+        if (fuzi_q_ctx->fuzz_ctx.bandit.nb_pulls[i] > 0) {
+            fprintf(stdout, "Strategy %d: %" PRIu64 " connections, %" PRIu64 " rewarded.\n",
+                i, fuzi_q_ctx->fuzz_ctx.bandit.nb_pulls[i], fuzi_q_ctx->fuzz_ctx.bandit.nb_rewards[i]);
+        }
+    }
+    if (fuzi_q_ctx->fuzz_ctx.bandit.nb_lost_rewards > 0 || fuzi_q_ctx->fuzz_ctx.nb_lost_outcomes > 0) {
+        fprintf(stdout, "Contexts evicted before the end of the connection: %" PRIu64 " rewards, %" PRIu64 " outcomes lost.\n",
+            fuzi_q_ctx->fuzz_ctx.bandit.nb_lost_rewards, fuzi_q_ctx->fuzz_ctx.nb_lost_outcomes);
+    }
+}
+
+static void fuzi_q_print_cid(char const* label, int thread_id, picoquic_connection_id_t* cid)
+{
+    fprintf(stdout, "%s %d, initial CID: ", label, thread_id);
+    for (uint8_t x = 0; x < cid->id_len; x++) {
+        fprintf(stdout, "%02x", cid->id[x]);
     }
     fprintf(stdout, "\n");
+}
+
+static void fuzi_q_print_cid_index(int thread_id, fuzzer_ctx_t* fuzz_ctx)
+{
+    fprintf(stdout, "Thread %d, first CID index: %" PRIu64 ", stride: %" PRIu64 "\n",
+        thread_id, fuzz_ctx->cid_index, fuzz_ctx->cid_stride);
+}
+
+/* Fuzi Quic Client
+ * TODO: manage loop options like key updates, migrations, etc. 
+ */
+int fuzi_q_client(fuzi_q_mode_enum fuzz_mode, const char* ip_address_text, int server_port,
+    picoquic_quic_config_t* config, size_t nb_cnx_required, uint64_t duration_max,
+    picoquic_connection_id_t * init_cid, char const* client_scenario_text, int nb_threads,
+    fuzzer_cid_scheme_enum cid_scheme, uint64_t first_cid_index, char const* frame_weights_file,
+    char const* bandit_spec, char const* corpus_spec, char const* entry_stats_file)
+{
+    /* Start: start the QUIC process with cert and key files */
+    int ret = 0;
+    fuzi_q_worker_t* workers = NULL;
+    fuzi_q_ctx_t summary = { 0 };
+    int nb_started = 0;
+    fuzzer_bandit_shared_t bandit_shared = { 0 };
+
+    if (nb_threads < 1) {
+        nb_threads = 1;
+    }
+    if (bandit_spec != NULL && fuzzer_bandit_open(&bandit_shared, bandit_spec) != 0) {
+        fprintf(stderr, "Invalid bandit specification: %s\n", bandit_spec);
+        ret = -1;
+    }
+    else if ((workers = (fuzi_q_worker_t*)malloc(sizeof(fuzi_q_worker_t) * nb_threads)) == NULL) {
+        ret = -1;
+    }
+    else {
+        memset(workers, 0, sizeof(fuzi_q_worker_t) * nb_threads);
+    }
+
+    /* Create the worker contexts, sharing the required number of trials */
+    for (int i = 0; ret == 0 && i < nb_threads; i++) {
+        size_t nb_required = nb_cnx_required;
+        picoquic_connection_id_t branch_cid;
+        picoquic_connection_id_t* worker_cid = init_cid;
+        picoquic_quic_config_t* worker_config = config;
+
+        if (nb_cnx_required > 0) {
+            nb_required = fuzi_q_trials_share(nb_cnx_required, nb_threads, i);
+            if (nb_required == 0) {
+                break;
+            }
+        }
+        if (i > 0) {
+            /* With the counter scheme, all threads share the key and interleave the indices.
+             * With the SHA 256 chain, each thread uses its own branch of the chain. */
+            if (cid_scheme == fuzzer_cid_scheme_counter) {
+                branch_cid = workers[0].fuzi_q_ctx.fuzz_ctx.next_cid;
+            }
+            else {
+                fuzzer_branch_cid(&workers[0].fuzi_q_ctx.fuzz_ctx.next_cid, i, &branch_cid);
+            }
+            worker_cid = &branch_cid;
+            if (config != NULL) {
+                workers[i].config = *config;
+                workers[i].config.ticket_file_name = NULL;
+                workers[i].config.token_file_name = NULL;
+                worker_config = &workers[i].config;
+            }
+        }
+        /* The first worker loads the frame weights and the test frames, the others share them */
+        ret = fuzi_q_set_client_context(fuzz_mode, &workers[i].fuzi_q_ctx, ip_address_text, server_port,
+            worker_config, nb_required, duration_max, worker_cid, client_scenario_text, NULL,
+            (i == 0) ? NULL : &workers[0].fuzi_q_ctx.fuzz_ctx);
+        nb_started++;
+        if (ret == 0 && i == 0 && frame_weights_file != NULL) {
+            ret = fuzzer_load_frame_weights(&workers[i].fuzi_q_ctx.fuzz_ctx, frame_weights_file);
+        }
+        if (ret == 0 && i == 0 && corpus_spec != NULL) {
+            ret = fuzzer_load_corpus(&workers[i].fuzi_q_ctx.fuzz_ctx, corpus_spec);
+        }
+        if (ret == 0 && bandit_shared.mode != fuzzer_bandit_none) {
+            fuzzer_bandit_enable(&workers[i].fuzi_q_ctx.fuzz_ctx, &bandit_shared);
+        }
+        if (ret == 0) {
+            fuzzer_set_cid_scheme(&workers[i].fuzi_q_ctx.fuzz_ctx, cid_scheme, first_cid_index + i, nb_threads);
+            if (cid_scheme == fuzzer_cid_scheme_counter) {
+                if (i == 0) {
+                    fuzi_q_print_cid("Thread", i, &workers[i].fuzi_q_ctx.fuzz_ctx.next_cid);
+                }
+                if (nb_threads > 1) {
+                    fuzi_q_print_cid_index(i, &workers[i].fuzi_q_ctx.fuzz_ctx);
+                }
+            }
+            else if (nb_threads > 1) {
+                fuzi_q_print_cid("Thread", i, &workers[i].fuzi_q_ctx.fuzz_ctx.next_cid);
+            }
+        }
+    }
+
+    if (ret == 0) {
+        if (nb_started == 1) {
+            workers[0].ret = fuzi_q_client_run(&workers[0].fuzi_q_ctx);
+        }
+        else {
+            int nb_threads_created = 0;
 
-    fuzi_q_release_client_context(&fuzi_q_ctx);
+            for (int i = 0; i < nb_started; i++) {
+                if (picoquic_create_thread(&workers[i].thread, fuzi_q_client_worker, &workers[i]) != 0) {
+                    fprintf(stdout, "Cannot create thread %d\n", i);
+                    workers[i].ret = -1;
+                    break;
+                }
+                nb_threads_created++;
+            }
+            for (int i = 0; i < nb_threads_created; i++) {
+                picoquic_delete_thread(&workers[i].thread);
+            }
+        }
+    }
+
+    summary.cnx_duration_min = UINT64_MAX;
+    for (int i = 0; i < nb_started; i++) {
+        if (ret == 0) {
+            ret = workers[i].ret;
+        }
+        fuzi_q_client_merge_stats(&summary, &workers[i].fuzi_q_ctx);
+    }
+    fuzi_q_client_print_stats(&summary, (nb_cnx_required == 0) ? SIZE_MAX : nb_cnx_required);
+    for (int i = 0; i < nb_started; i++) {
+        /* List the connections that were in progress when the server appeared down */
+        fuzi_q_ctx_t* fuzi_q_ctx = &workers[i].fuzi_q_ctx;
+
+        for (size_t j = 0; fuzi_q_ctx->server_is_down && j < fuzi_q_ctx->nb_cnx_ctx; j++) {
+            if (fuzi_q_ctx->cnx_ctx[j].cnx_client != NULL) {
+                fprintf(stdout, "Thread %d, connection in progress when the server appeared down, ICID: ", i);
+                fuzi_q_print_icid(fuzi_q_ctx->fuzz_ctx.cid_scheme, &fuzi_q_ctx->cnx_ctx[j].icid, fuzi_q_ctx->cnx_ctx[j].cid_index);
+                fprintf(stdout, "\n");
+            }
+        }
+    }
+    if (entry_stats_file != NULL && nb_started > 0) {
+        /* The counters of all workers are added to those of the first one, which holds the corpus */
+        int stats_ret = 0;
+
+        for (int i = 1; stats_ret == 0 && i < nb_started; i++) {
+            stats_ret = fuzzer_entry_stats_merge(&workers[0].fuzi_q_ctx.fuzz_ctx, &workers[i].fuzi_q_ctx.fuzz_ctx);
+        }
+        if (stats_ret == 0) {
+            stats_ret = fuzzer_entry_stats_write(&workers[0].fuzi_q_ctx.fuzz_ctx, entry_stats_file);
+        }
+        if (stats_ret == 0) {
+            fprintf(stdout, "Wrote the counters of %zu test frames to %s\n",
+                workers[0].fuzi_q_ctx.fuzz_ctx.nb_entry_stats, entry_stats_file);
+        }
+        else if (ret == 0) {
+            ret = stats_ret;
+        }
+    }
+
+    if (workers != NULL) {
+        for (int i = 0; i < nb_started; i++) {
+            fuzi_q_release_client_context(&workers[i].fuzi_q_ctx);
+        }
+        free(workers);
+    }
+    fuzzer_bandit_close(&bandit_shared);
 
     return ret;
 }
@@ -28,144 +28,407 @@
 #include <tls_api.h>
 #include "fuzi_q.h"
 
-/* Management of per connection context for fuzzing. */
+/* Management of per connection context for fuzzing.
+ * The contexts are found by ICID, using an open addressing hash table
+ * with Robin Hood probing, keyed by the ICID hash. The table is grown
+ * when its load reaches 3/4. Entries are removed with backward shift,
+ * so there are no tombstones. The contexts are also filed in a time
+ * wheel, so that old contexts can be expired.
+ */
+#define FUZZER_ICID_TABLE_MIN_SIZE 64
 
-static void* fuzi_q_icid_list_node_value(picosplay_node_t* icid_node)
+static size_t fuzi_q_icid_table_home(size_t table_mask, uint64_t icid_hash)
 {
-    return (icid_node == NULL) ? NULL : (void*)((char*)icid_node - offsetof(struct st_fuzzer_icid_ctx_t, icid_node));
+    return (size_t)icid_hash & table_mask;
 }
 
-static int64_t fuzi_q_icid_list_compare(void* l, void* r) {
-    int64_t ret = picoquic_compare_connection_id(&((fuzzer_icid_ctx_t*)l)->icid, &((fuzzer_icid_ctx_t*)r)->icid);
-    return ret;
+static size_t fuzi_q_icid_table_find(fuzzer_ctx_t* ctx, const picoquic_connection_id_t* icid, uint64_t icid_hash)
+{
+    if (ctx->icid_table != NULL) {
+        size_t x = fuzi_q_icid_table_home(ctx->icid_table_mask, icid_hash);
+        size_t d = 0;
+
+        while (ctx->icid_table[x].icid_ctx != NULL) {
+            fuzzer_icid_slot_t* slot = &ctx->icid_table[x];
+            /* Robin Hood invariant: the key is not further than this */
+            if (((x - fuzi_q_icid_table_home(ctx->icid_table_mask, slot->icid_hash)) & ctx->icid_table_mask) < d) {
+                break;
+            }
+            if (slot->icid_hash == icid_hash && picoquic_compare_connection_id(&slot->icid_ctx->icid, icid) == 0) {
+                return x;
+            }
+            x = (x + 1) & ctx->icid_table_mask;
+            d++;
+        }
+    }
+    return SIZE_MAX;
 }
 
-static picosplay_node_t* fuzi_q_icid_list_create_node(void* v_icid)
+static void fuzi_q_icid_table_place(fuzzer_icid_slot_t* table, size_t table_mask, fuzzer_icid_slot_t entry)
 {
-    return &((fuzzer_icid_ctx_t*)v_icid)->icid_node;
+    size_t x = fuzi_q_icid_table_home(table_mask, entry.icid_hash);
+    size_t d = 0;
+
+    while (table[x].icid_ctx != NULL) {
+        size_t d_x = (x - fuzi_q_icid_table_home(table_mask, table[x].icid_hash)) & table_mask;
+        if (d_x < d) {
+            /* Take the place of the entry closer to its home, and carry on with that one */
+            fuzzer_icid_slot_t displaced = table[x];
+            table[x] = entry;
+            entry = displaced;
+            d = d_x;
+        }
+        x = (x + 1) & table_mask;
+        d++;
+    }
+    table[x] = entry;
 }
 
-static void fuzi_q_icid_list_remove(fuzzer_ctx_t* ctx, fuzzer_icid_ctx_t* icid_ctx)
+static int fuzi_q_icid_table_grow(fuzzer_ctx_t* ctx)
 {
-    /* Remove from chained LRU */
-    if (icid_ctx->icid_after == NULL) {
-        ctx->icid_lru = icid_ctx->icid_before;
+    int ret = 0;
+    size_t old_size = (ctx->icid_table == NULL) ? 0 : ctx->icid_table_mask + 1;
+    size_t new_size = (old_size == 0) ? FUZZER_ICID_TABLE_MIN_SIZE : 2 * old_size;
+    fuzzer_icid_slot_t* new_table = (fuzzer_icid_slot_t*)calloc(new_size, sizeof(fuzzer_icid_slot_t));
+
+    if (new_table == NULL) {
+        ret = -1;
     }
     else {
-        icid_ctx->icid_after->icid_before = icid_ctx->icid_before;
+        for (size_t i = 0; i < old_size; i++) {
+            if (ctx->icid_table[i].icid_ctx != NULL) {
+                fuzi_q_icid_table_place(new_table, new_size - 1, ctx->icid_table[i]);
+            }
+        }
+        if (ctx->icid_table != NULL) {
+            free(ctx->icid_table);
+        }
+        ctx->icid_table = new_table;
+        ctx->icid_table_mask = new_size - 1;
+    }
+    return ret;
+}
+
+static int fuzi_q_icid_table_insert(fuzzer_ctx_t* ctx, fuzzer_icid_ctx_t* icid_ctx)
+{
+    int ret = 0;
+
+    if (ctx->icid_table == NULL || 4 * (ctx->nb_icid + 1) > 3 * (ctx->icid_table_mask + 1)) {
+        ret = fuzi_q_icid_table_grow(ctx);
     }
-    if (icid_ctx->icid_before == NULL) {
-        ctx->icid_mru = icid_ctx->icid_after;
+    if (ret == 0) {
+        fuzzer_icid_slot_t entry;
+        entry.icid_hash = icid_ctx->icid_hash;
+        entry.icid_ctx = icid_ctx;
+        fuzi_q_icid_table_place(ctx->icid_table, ctx->icid_table_mask, entry);
+        ctx->nb_icid++;
+    }
+    return ret;
+}
+
+static void fuzi_q_icid_table_remove(fuzzer_ctx_t* ctx, fuzzer_icid_ctx_t* icid_ctx)
+{
+    size_t x = fuzi_q_icid_table_find(ctx, &icid_ctx->icid, icid_ctx->icid_hash);
+
+    if (x != SIZE_MAX) {
+        size_t next = (x + 1) & ctx->icid_table_mask;
+
+        while (ctx->icid_table[next].icid_ctx != NULL &&
+            fuzi_q_icid_table_home(ctx->icid_table_mask, ctx->icid_table[next].icid_hash) != next) {
+            ctx->icid_table[x] = ctx->icid_table[next];
+            x = next;
+            next = (next + 1) & ctx->icid_table_mask;
+        }
+        ctx->icid_table[x].icid_ctx = NULL;
+        ctx->icid_table[x].icid_hash = 0;
+        ctx->nb_icid--;
+    }
+}
+
+/* Expiry of the ICID contexts.
+ * Contexts are filed in a coarse time wheel of FUZZER_WHEEL_SIZE buckets,
+ * each covering FUZZER_WHEEL_TICK microseconds, according to the time at
+ * which they were filed. Lookups do not move contexts between buckets,
+ * they only update the last time and set the CLOCK bit, so the hot path
+ * only writes to the context itself. Once per tick, the buckets old enough
+ * to hold expired contexts are swept: contexts not used for more than
+ * 2*FUZI_Q_MAX_SILENCE are deleted, the others are filed again according
+ * to their last time.
+ */
+#define FUZZER_WHEEL_EXPIRY_TICKS ((2 * FUZI_Q_MAX_SILENCE) / FUZZER_WHEEL_TICK)
+
+static void fuzi_q_icid_wheel_insert(fuzzer_ctx_t* ctx, fuzzer_icid_ctx_t* icid_ctx, uint64_t tick)
+{
+    size_t bucket = (size_t)(tick % FUZZER_WHEEL_SIZE);
+
+    icid_ctx->wheel_tick = tick;
+    icid_ctx->wheel_prev = NULL;
+    icid_ctx->wheel_next = ctx->icid_wheel[bucket];
+    if (icid_ctx->wheel_next != NULL) {
+        icid_ctx->wheel_next->wheel_prev = icid_ctx;
+    }
+    ctx->icid_wheel[bucket] = icid_ctx;
+}
+
+static void fuzi_q_icid_wheel_remove(fuzzer_ctx_t* ctx, fuzzer_icid_ctx_t* icid_ctx)
+{
+    if (icid_ctx->wheel_prev == NULL) {
+        ctx->icid_wheel[icid_ctx->wheel_tick % FUZZER_WHEEL_SIZE] = icid_ctx->wheel_next;
     }
     else {
-        icid_ctx->icid_before->icid_after = icid_ctx->icid_after;
+        icid_ctx->wheel_prev->wheel_next = icid_ctx->wheel_next;
+    }
+    if (icid_ctx->wheel_next != NULL) {
+        icid_ctx->wheel_next->wheel_prev = icid_ctx->wheel_prev;
     }
+    icid_ctx->wheel_next = NULL;
+    icid_ctx->wheel_prev = NULL;
+}
+
+/* Allocation of the ICID contexts.
+ * Contexts are carved from chunks of FUZZER_ICID_CHUNK_SIZE entries. Released
+ * contexts are kept in a free list, chained through wheel_next, and reused
+ * before any new chunk is allocated. Chunks are only freed when the fuzzer
+ * context is released. If a capacity is set, a context that was not used
+ * recently is recycled when the capacity is reached, so memory use is bounded
+ * even when the server is flooded with new connections.
+ */
+#define FUZZER_ICID_CHUNK_SIZE 256
 
-    icid_ctx->icid_after = NULL;
-    icid_ctx->icid_before = NULL;
+typedef struct st_fuzzer_icid_chunk_t {
+    struct st_fuzzer_icid_chunk_t* next_chunk;
+    fuzzer_icid_ctx_t icid_ctx[FUZZER_ICID_CHUNK_SIZE];
+} fuzzer_icid_chunk_t;
+
+static void fuzi_q_icid_free(fuzzer_ctx_t* ctx, fuzzer_icid_ctx_t* icid_ctx)
+{
+    icid_ctx->wheel_next = ctx->icid_free;
+    ctx->icid_free = icid_ctx;
 }
 
-static void fuzi_q_icid_list_delete_node(void* tree, picosplay_node_t* node)
+/* Discard a context that is not filed in the wheel */
+static void fuzi_q_icid_discard(fuzzer_ctx_t* ctx, fuzzer_icid_ctx_t* icid_ctx)
 {
-    /* remove from chained LRU, delete node */
-    if (node != NULL){
-        fuzzer_icid_ctx_t* icid_ctx = (fuzzer_icid_ctx_t*)fuzi_q_icid_list_node_value(node);
-        if (tree != NULL) {
-            fuzzer_ctx_t* ctx = (fuzzer_ctx_t*)((char*)tree - offsetof(struct st_fuzzer_ctx_t, icid_tree));
-            fuzi_q_icid_list_remove(ctx, icid_ctx);
+    if (ctx->last_icid_ctx == icid_ctx) {
+        ctx->last_cnx = NULL;
+        ctx->last_icid_ctx = NULL;
+    }
+    fuzi_q_icid_table_remove(ctx, icid_ctx);
+    fuzi_q_icid_free(ctx, icid_ctx);
+}
+
+static void fuzi_q_icid_delete(fuzzer_ctx_t* ctx, fuzzer_icid_ctx_t* icid_ctx)
+{
+    fuzi_q_icid_wheel_remove(ctx, icid_ctx);
+    fuzi_q_icid_discard(ctx, icid_ctx);
+}
+
+/* Sweep the wheel, at most once per tick */
+static void fuzi_q_icid_wheel_sweep(fuzzer_ctx_t* ctx, uint64_t current_time)
+{
+    if (current_time >= ctx->wheel_next_time) {
+        uint64_t current_tick = current_time / FUZZER_WHEEL_TICK;
+
+        ctx->wheel_next_time = (current_tick + 1) * FUZZER_WHEEL_TICK;
+        if (current_tick > FUZZER_WHEEL_EXPIRY_TICKS) {
+            /* Contexts filed after this tick cannot have expired yet */
+            uint64_t last_tick = current_tick - FUZZER_WHEEL_EXPIRY_TICKS - 1;
+            uint64_t tick = ctx->wheel_sweep_tick;
+
+            if (last_tick >= FUZZER_WHEEL_SIZE && tick < last_tick - FUZZER_WHEEL_SIZE + 1) {
+                tick = last_tick - FUZZER_WHEEL_SIZE + 1;
+            }
+            while (tick <= last_tick) {
+                size_t bucket = (size_t)(tick % FUZZER_WHEEL_SIZE);
+                fuzzer_icid_ctx_t* next = ctx->icid_wheel[bucket];
+
+                ctx->icid_wheel[bucket] = NULL;
+                while (next != NULL) {
+                    fuzzer_icid_ctx_t* icid_ctx = next;
+                    next = icid_ctx->wheel_next;
+                    icid_ctx->wheel_next = NULL;
+                    icid_ctx->wheel_prev = NULL;
+                    if (icid_ctx->last_time + 2 * FUZI_Q_MAX_SILENCE < current_time) {
+                        fuzi_q_icid_discard(ctx, icid_ctx);
+                    }
+                    else {
+                        /* File again, at the latest of last use and next tick */
+                        uint64_t last_use_tick = icid_ctx->last_time / FUZZER_WHEEL_TICK;
+                        icid_ctx->clock_bit = 0;
+                        fuzi_q_icid_wheel_insert(ctx, icid_ctx, (last_use_tick > tick) ? last_use_tick : tick + 1);
+                    }
+                }
+                tick++;
+            }
+            ctx->wheel_sweep_tick = tick;
         }
-        /* Delete node */
-        free(icid_ctx);
     }
 }
 
-static void remove_last_icid_from_list(fuzzer_ctx_t * ctx)
+/* When the capacity is reached, pick a context to recycle using the
+ * CLOCK algorithm: scan the wheel from the oldest tick, clearing the
+ * CLOCK bit of the contexts that were used since the last scan, and
+ * stop at the first context that was not.
+ */
+static void fuzi_q_icid_evict_one(fuzzer_ctx_t* ctx)
 {
-    if (ctx->icid_lru != NULL) {
-        picosplay_delete_hint(&ctx->icid_tree, &ctx->icid_lru->icid_node);
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint64_t i = 0; i < FUZZER_WHEEL_SIZE; i++) {
+            fuzzer_icid_ctx_t* icid_ctx = ctx->icid_wheel[(ctx->wheel_sweep_tick + i) % FUZZER_WHEEL_SIZE];
+
+            while (icid_ctx != NULL) {
+                if (!icid_ctx->clock_bit) {
+                    fuzi_q_icid_delete(ctx, icid_ctx);
+                    return;
+                }
+                icid_ctx->clock_bit = 0;
+                icid_ctx = icid_ctx->wheel_next;
+            }
+        }
     }
 }
 
-static fuzzer_icid_ctx_t* create_icid_ctx(fuzzer_ctx_t* ctx, picoquic_connection_id_t* icid)
+static fuzzer_icid_ctx_t* fuzi_q_icid_alloc(fuzzer_ctx_t* ctx)
 {
-    fuzzer_icid_ctx_t* icid_ctx = (fuzzer_icid_ctx_t*)malloc(sizeof(fuzzer_icid_ctx_t));
+    fuzzer_icid_ctx_t* icid_ctx = NULL;
+
+    if (ctx->icid_capacity > 0 && ctx->nb_icid >= ctx->icid_capacity) {
+        fuzi_q_icid_evict_one(ctx);
+    }
+    if (ctx->icid_free == NULL) {
+        fuzzer_icid_chunk_t* chunk = (fuzzer_icid_chunk_t*)malloc(sizeof(fuzzer_icid_chunk_t));
+        if (chunk != NULL) {
+            chunk->next_chunk = ctx->icid_chunks;
+            ctx->icid_chunks = chunk;
+            for (size_t i = FUZZER_ICID_CHUNK_SIZE; i > 0; i--) {
+                fuzi_q_icid_free(ctx, &chunk->icid_ctx[i - 1]);
+            }
+        }
+    }
+    if (ctx->icid_free != NULL) {
+        icid_ctx = ctx->icid_free;
+        ctx->icid_free = icid_ctx->wheel_next;
+    }
+    return icid_ctx;
+}
+
+/* Hash of the initial CID. The same value seeds the per connection random
+ * context and keys the client table of active connections, so that it
+ * is only computed once per connection.
+ */
+uint64_t fuzzer_icid_hash(const picoquic_connection_id_t* icid)
+{
+    uint8_t default_hash_seed[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+    return picoquic_connection_id_hash(icid, default_hash_seed);
+}
+
+static fuzzer_icid_ctx_t* create_icid_ctx(fuzzer_ctx_t* ctx, picoquic_connection_id_t* icid, uint64_t icid_hash, uint64_t current_time)
+{
+    fuzzer_icid_ctx_t* icid_ctx = fuzi_q_icid_alloc(ctx);
     if (icid_ctx != NULL) {
         memset(icid_ctx, 0, sizeof(fuzzer_icid_ctx_t));
         (void)picoquic_parse_connection_id(icid->id, icid->id_len, &icid_ctx->icid);
-        uint8_t default_hash_seed[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
-        icid_ctx->random_context = picoquic_connection_id_hash(icid, default_hash_seed);
+        icid_ctx->icid_hash = icid_hash;
+        icid_ctx->random_context = icid_ctx->icid_hash;
+        fuzzer_pilot_init(&icid_ctx->pilot, &icid_ctx->random_context);
         /* Set the initial values, e.g. target state */
         uint64_t random_state = (icid_ctx->random_context ^ 0xdeadbeefc001cafeull) % fuzzer_cnx_state_max;
         uint64_t random_wait = (icid_ctx->random_context >> 2) ^ 0xa1a2a3a4a5a6a7a8ull;
         icid_ctx->target_state = (fuzzer_cnx_state_enum)random_state;
         icid_ctx->target_wait = ((int)random_wait) % (ctx->wait_max[icid_ctx->target_state]+1);
-        if (ctx->icid_mru != NULL) {
-            ctx->icid_mru->icid_before = icid_ctx;
-            icid_ctx->icid_after = ctx->icid_mru;
+        icid_ctx->bandit_arm = -1;
+        fuzi_q_icid_wheel_insert(ctx, icid_ctx, current_time / FUZZER_WHEEL_TICK);
+        if (fuzi_q_icid_table_insert(ctx, icid_ctx) != 0) {
+            fuzi_q_icid_wheel_remove(ctx, icid_ctx);
+            fuzi_q_icid_free(ctx, icid_ctx);
+            icid_ctx = NULL;
         }
-        ctx->icid_mru = icid_ctx;
-        
-        if (ctx->icid_lru == NULL) {
-            ctx->icid_lru = icid_ctx;
-        }
-        (void)picosplay_insert(&ctx->icid_tree, icid_ctx);
     }
     return icid_ctx;
 }
 
 fuzzer_icid_ctx_t* fuzzer_get_icid_ctx(fuzzer_ctx_t* ctx, picoquic_connection_id_t* icid, uint64_t current_time)
 {
-    fuzzer_icid_ctx_t test = { 0 };
-    picosplay_node_t* node;
     fuzzer_icid_ctx_t* icid_ctx = NULL;
+    uint64_t icid_hash = fuzzer_icid_hash(icid);
+    size_t x = fuzi_q_icid_table_find(ctx, icid, icid_hash);
 
-    (void)picoquic_parse_connection_id(icid->id, icid->id_len, &test.icid);
-    node = picosplay_find(&ctx->icid_tree, &test);
-    if (node == NULL) {
-        icid_ctx = create_icid_ctx(ctx, icid);
+    if (x == SIZE_MAX) {
+        icid_ctx = create_icid_ctx(ctx, icid, icid_hash, current_time);
     }
     else {
-        icid_ctx = (fuzzer_icid_ctx_t*)fuzi_q_icid_list_node_value(node);
+        icid_ctx = ctx->icid_table[x].icid_ctx;
     }
 
     if (icid_ctx != NULL) {
         icid_ctx->last_time = current_time;
-        if (icid_ctx != ctx->icid_mru) {
-            fuzi_q_icid_list_remove(ctx, icid_ctx);
-            icid_ctx->icid_after = ctx->icid_mru;
-            icid_ctx->icid_before = NULL;
-            if (ctx->icid_mru != NULL) {
-                ctx->icid_mru->icid_before = icid_ctx;
-            }
-            ctx->icid_mru = icid_ctx;
-            if (ctx->icid_lru == NULL) {
-                ctx->icid_lru = icid_ctx;
-            }
-        }
+        icid_ctx->clock_bit = 1;
     }
 
-    while (ctx->icid_lru != NULL && ctx->icid_lru->last_time + 2 * FUZI_Q_MAX_SILENCE < current_time) {
-        remove_last_icid_from_list(ctx);
-    }
+    fuzi_q_icid_wheel_sweep(ctx, current_time);
 
     return icid_ctx;
 }
 
+/* Find the context of an ICID, without creating it */
+fuzzer_icid_ctx_t* fuzzer_find_icid_ctx(fuzzer_ctx_t* ctx, picoquic_connection_id_t* icid)
+{
+    size_t x = fuzi_q_icid_table_find(ctx, icid, fuzzer_icid_hash(icid));
+    return (x == SIZE_MAX) ? NULL : ctx->icid_table[x].icid_ctx;
+}
+
+/* Get the context of a connection.
+ * Consecutive packets usually belong to the same connection. The fuzzer
+ * remembers the last connection and its context, and reuses it if the
+ * same connection comes again, without computing the hash. The ICID is
+ * checked too, in case the connection was deleted and its memory reused.
+ */
+fuzzer_icid_ctx_t* fuzzer_get_cnx_icid_ctx(fuzzer_ctx_t* ctx, picoquic_cnx_t* cnx, uint64_t current_time)
+{
+    fuzzer_icid_ctx_t* icid_ctx;
+
+    if (cnx == ctx->last_cnx && ctx->last_icid_ctx != NULL &&
+        picoquic_compare_connection_id(&cnx->initial_cnxid, &ctx->last_icid_ctx->icid) == 0) {
+        icid_ctx = ctx->last_icid_ctx;
+        icid_ctx->last_time = current_time;
+        icid_ctx->clock_bit = 1;
+        fuzi_q_icid_wheel_sweep(ctx, current_time);
+    }
+    else {
+        icid_ctx = fuzzer_get_icid_ctx(ctx, &cnx->initial_cnxid, current_time);
+        ctx->last_cnx = (icid_ctx == NULL) ? NULL : cnx;
+        ctx->last_icid_ctx = icid_ctx;
+    }
+    return icid_ctx;
+}
+
+/* Forget the association with a connection that is being deleted */
+void fuzzer_forget_cnx(fuzzer_ctx_t* ctx, picoquic_cnx_t* cnx)
+{
+    if (ctx->last_cnx == cnx) {
+        ctx->last_cnx = NULL;
+        ctx->last_icid_ctx = NULL;
+    }
+}
+
 /* Management of the fuzzer context itself.
  * Add definition of picoquic crypto random, so we can use it to 
  * initialize randomness when needed.
  */
 
-void fuzi_q_fuzzer_init(fuzzer_ctx_t* fuzz_ctx, picoquic_connection_id_t * init_cid, picoquic_quic_t * quic)
+static void fuzi_q_fuzzer_init_base(fuzzer_ctx_t* fuzz_ctx, picoquic_connection_id_t* init_cid, picoquic_quic_t* quic)
 {
     memset(fuzz_ctx, 0, sizeof(fuzzer_ctx_t));
-    /* Initialize the tree of connection contexts */
-    picosplay_init_tree(&fuzz_ctx->icid_tree, fuzi_q_icid_list_compare,
-        fuzi_q_icid_list_create_node, fuzi_q_icid_list_delete_node, fuzi_q_icid_list_node_value);
     /* Set all wait_max to 1 */
     for (int i = 0; i < fuzzer_cnx_state_max; i++) {
         fuzz_ctx->wait_max[i] = 1;
     }
+    /* Default weights of the frame fuzzers */
+    fuzzer_frame_fuzzers_init(fuzz_ctx);
+    /* Allocate the scratch space used to index the frames of fuzzed packets */
+    if (fuzzer_frame_index_init(&fuzz_ctx->frame_index, FUZZER_MAX_NB_FRAMES) != 0) {
+        DBG_PRINTF("%s", "Cannot allocate the frame index, frames will not be fuzzed.");
+    }
     /* Init CID. If not already set, initialize from random number */
     if (init_cid == NULL || init_cid->id_len == 0) {
         if (quic != NULL) {
@@ -182,6 +445,59 @@ void fuzi_q_fuzzer_init(fuzzer_ctx_t* fuzz_ctx, picoquic_connection_id_t * init_
     }
 }
 
+void fuzi_q_fuzzer_init(fuzzer_ctx_t* fuzz_ctx, picoquic_connection_id_t * init_cid, picoquic_quic_t * quic)
+{
+    fuzi_q_fuzzer_init_base(fuzz_ctx, init_cid, quic);
+    /* Pack the test frames used for injection */
+    if (fuzi_q_corpus_pack(&fuzz_ctx->corpus, fuzi_q_frame_list, nb_fuzi_q_frame_list) != 0 ||
+        fuzi_q_corpus_dedup(&fuzz_ctx->corpus) != 0 ||
+        fuzi_q_corpus_classify(&fuzz_ctx->corpus) != 0) {
+        DBG_PRINTF("%s", "Cannot pack the test frames, frames will not be injected.");
+    }
+    else if (fuzzer_entry_stats_reset(fuzz_ctx) != 0) {
+        DBG_PRINTF("%s", "Cannot allocate the test frame counters, injections will not be counted.");
+    }
+}
+
+/* Initialize a fuzzer context with the frame weights and the test frames
+ * of another context, instead of packing the built-in test frames. This is
+ * used when many contexts are created, e.g., for the threads of a client
+ * or the nodes of a simulation. The test frames are shared, and settings
+ * must outlive the context. If settings is NULL, the context has no test
+ * frames, as needed by a server that does not fuzz. Fails if the counters
+ * of the test frames cannot be allocated.
+ */
+int fuzi_q_fuzzer_init_shared(fuzzer_ctx_t* fuzz_ctx, picoquic_connection_id_t* init_cid, picoquic_quic_t* quic,
+    const fuzzer_ctx_t* settings)
+{
+    int ret = 0;
+
+    fuzi_q_fuzzer_init_base(fuzz_ctx, init_cid, quic);
+    if (settings != NULL) {
+        ret = fuzi_q_fuzzer_copy_settings(fuzz_ctx, settings);
+    }
+    return ret;
+}
+
+/* Copy the frame weights of another fuzzer context and share its test
+ * frames, so that the files that set them are read once for many contexts.
+ */
+int fuzi_q_fuzzer_copy_settings(fuzzer_ctx_t* fuzz_ctx, const fuzzer_ctx_t* settings)
+{
+    memcpy(fuzz_ctx->frame_weight, settings->frame_weight, sizeof(fuzz_ctx->frame_weight));
+    fuzz_ctx->frame_weights_set = settings->frame_weights_set;
+    fuzi_q_corpus_share(&fuzz_ctx->corpus, &settings->corpus);
+    return fuzzer_entry_stats_reset(fuzz_ctx);
+}
+
+/* Set the maximum number of ICID contexts, or 0 for no limit. */
+void fuzi_q_fuzzer_set_capacity(fuzzer_ctx_t* fuzz_ctx, size_t icid_capacity)
+{
+    fuzz_ctx->icid_capacity = icid_capacity;
+    while (icid_capacity > 0 && fuzz_ctx->nb_icid > icid_capacity) {
+        fuzi_q_icid_evict_one(fuzz_ctx);
+    }
+}
 
 /* Create a random CID as a hash of the previous one.
  * This is useful for ensuring that the client tests are repeatable.
@@ -189,20 +505,165 @@ void fuzi_q_fuzzer_init(fuzzer_ctx_t* fuzz_ctx, picoquic_connection_id_t * init_
 
 void fuzzer_random_cid(fuzzer_ctx_t* ctx, picoquic_connection_id_t* icid)
 {
-    /* Set a hash context for derivation of random CID */
-    void * hash_context = picoquic_hash_create("sha256");
-    uint8_t hash_buffer[256] = { 0 };
-    /* Use the CID that was already prepared */
-    *icid = ctx->next_cid;
-    /* Derive the next CID from the previous value using SHA 256 */
-    picoquic_hash_update((uint8_t *)"fuzi_q", 6, hash_context);
-    picoquic_hash_update(ctx->next_cid.id, ctx->next_cid.id_len, hash_context);
-    picoquic_hash_finalize(hash_buffer, hash_context);
-    memcpy(ctx->next_cid.id, hash_buffer, ctx->next_cid.id_len);
+    if (ctx->cid_scheme == fuzzer_cid_scheme_counter) {
+        fuzzer_counter_cid(ctx, ctx->cid_index, icid);
+        ctx->cid_index += ctx->cid_stride;
+    }
+    else {
+        /* Set a hash context for derivation of random CID */
+        void * hash_context = picoquic_hash_create("sha256");
+        uint8_t hash_buffer[256] = { 0 };
+        /* Use the CID that was already prepared */
+        *icid = ctx->next_cid;
+        /* Derive the next CID from the previous value using SHA 256 */
+        picoquic_hash_update((uint8_t *)"fuzi_q", 6, hash_context);
+        picoquic_hash_update(ctx->next_cid.id, ctx->next_cid.id_len, hash_context);
+        picoquic_hash_finalize(hash_buffer, hash_context);
+        memcpy(ctx->next_cid.id, hash_buffer, ctx->next_cid.id_len);
+    }
+}
+
+/* Derive the first CID of a branch of the CID chain, for example
+ * for the worker threads of a multithreaded client. Branch 0 starts
+ * from the root CID itself, so a single threaded run is unchanged.
+ */
+void fuzzer_branch_cid(picoquic_connection_id_t* root_cid, int branch, picoquic_connection_id_t* branch_cid)
+{
+    *branch_cid = *root_cid;
+    if (branch != 0) {
+        void* hash_context = picoquic_hash_create("sha256");
+        uint8_t hash_buffer[256] = { 0 };
+        uint8_t branch_bytes[4];
+
+        branch_bytes[0] = (uint8_t)(branch >> 24);
+        branch_bytes[1] = (uint8_t)(branch >> 16);
+        branch_bytes[2] = (uint8_t)(branch >> 8);
+        branch_bytes[3] = (uint8_t)branch;
+        picoquic_hash_update((uint8_t*)"fuzi_q_branch", 13, hash_context);
+        picoquic_hash_update(branch_bytes, 4, hash_context);
+        picoquic_hash_update(root_cid->id, root_cid->id_len, hash_context);
+        picoquic_hash_finalize(hash_buffer, hash_context);
+        memcpy(branch_cid->id, hash_buffer, branch_cid->id_len);
+    }
+}
+
+/* Counter mode derivation of CIDs.
+ * CID #N is the SipHash-2-4 of N, keyed from the initial CID. Longer
+ * CIDs use one block of 8 bytes per SipHash, adding the block number
+ * to the message. Computing a CID costs a few dozen arithmetic
+ * operations and no allocation, and the CID of any index can be
+ * computed directly, which allows threads to interleave the indices
+ * and a single connection to be replayed.
+ */
+#define FUZZER_ROTL64(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+#define FUZZER_SIPROUND(v0, v1, v2, v3) \
+    v0 += v1; v1 = FUZZER_ROTL64(v1, 13); v1 ^= v0; v0 = FUZZER_ROTL64(v0, 32); \
+    v2 += v3; v3 = FUZZER_ROTL64(v3, 16); v3 ^= v2; \
+    v0 += v3; v3 = FUZZER_ROTL64(v3, 21); v3 ^= v0; \
+    v2 += v1; v1 = FUZZER_ROTL64(v1, 17); v1 ^= v2; v2 = FUZZER_ROTL64(v2, 32)
+
+static uint64_t fuzzer_siphash_2_4(const uint64_t key[2], uint64_t cid_index, uint64_t block)
+{
+    uint64_t v0 = key[0] ^ 0x736f6d6570736575ull;
+    uint64_t v1 = key[1] ^ 0x646f72616e646f6dull;
+    uint64_t v2 = key[0] ^ 0x6c7967656e657261ull;
+    uint64_t v3 = key[1] ^ 0x7465646279746573ull;
+    /* Message of 16 bytes: index and block number, then the length byte */
+    uint64_t m[3] = { cid_index, block, ((uint64_t)16) << 56 };
+
+    for (int i = 0; i < 3; i++) {
+        v3 ^= m[i];
+        FUZZER_SIPROUND(v0, v1, v2, v3);
+        FUZZER_SIPROUND(v0, v1, v2, v3);
+        v0 ^= m[i];
+    }
+    v2 ^= 0xff;
+    for (int i = 0; i < 4; i++) {
+        FUZZER_SIPROUND(v0, v1, v2, v3);
+    }
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+void fuzzer_counter_cid(fuzzer_ctx_t* ctx, uint64_t cid_index, picoquic_connection_id_t* icid)
+{
+    memset(icid, 0, sizeof(picoquic_connection_id_t));
+    icid->id_len = ctx->next_cid.id_len;
+    for (uint8_t x = 0; x < icid->id_len; x += 8) {
+        uint64_t v = fuzzer_siphash_2_4(ctx->cid_key, cid_index, x / 8);
+        for (uint8_t y = x; y < x + 8 && y < icid->id_len; y++) {
+            icid->id[y] = (uint8_t)(v >> 56);
+            v <<= 8;
+        }
+    }
+}
+
+/* Select the CID scheme. For the counter scheme, the key is derived
+ * from the initial CID, which is not modified afterwards, and the
+ * CIDs used are first_index, first_index + stride, etc.
+ */
+void fuzzer_set_cid_scheme(fuzzer_ctx_t* ctx, fuzzer_cid_scheme_enum cid_scheme, uint64_t first_index, uint64_t stride)
+{
+    ctx->cid_scheme = cid_scheme;
+    ctx->cid_index = first_index;
+    ctx->cid_stride = (stride == 0) ? 1 : stride;
+    if (cid_scheme == fuzzer_cid_scheme_counter) {
+        void* hash_context = picoquic_hash_create("sha256");
+        uint8_t hash_buffer[256] = { 0 };
+
+        picoquic_hash_update((uint8_t*)"fuzi_q_counter", 14, hash_context);
+        picoquic_hash_update(ctx->next_cid.id, ctx->next_cid.id_len, hash_context);
+        picoquic_hash_finalize(hash_buffer, hash_context);
+        ctx->cid_key[0] = PICOPARSE_64(hash_buffer);
+        ctx->cid_key[1] = PICOPARSE_64(hash_buffer + 8);
+    }
+}
+
+/* Parse the CID scheme option, "sha256" or "counter[:first_index]" */
+int fuzzer_parse_cid_scheme(char const* text, fuzzer_cid_scheme_enum* cid_scheme, uint64_t* first_index)
+{
+    int ret = 0;
+
+    *first_index = 0;
+    if (strcmp(text, "sha256") == 0) {
+        *cid_scheme = fuzzer_cid_scheme_sha256_chain;
+    }
+    else if (strncmp(text, "counter", 7) == 0 && (text[7] == 0 || text[7] == ':')) {
+        *cid_scheme = fuzzer_cid_scheme_counter;
+        if (text[7] == ':') {
+            char* end_ptr = NULL;
+            *first_index = (uint64_t)strtoull(text + 8, &end_ptr, 10);
+            if (end_ptr == text + 8 || *end_ptr != 0) {
+                ret = -1;
+            }
+        }
+    }
+    else {
+        ret = -1;
+    }
+    return ret;
 }
 
 /* Release the fuzzer context */
 void fuzi_q_fuzzer_release(fuzzer_ctx_t* fuzz_ctx)
 {
-    picosplay_empty_tree(&fuzz_ctx->icid_tree);
+    fuzzer_bandit_flush(&fuzz_ctx->bandit);
+    while (fuzz_ctx->icid_chunks != NULL) {
+        fuzzer_icid_chunk_t* chunk = fuzz_ctx->icid_chunks;
+        fuzz_ctx->icid_chunks = chunk->next_chunk;
+        free(chunk);
+    }
+    fuzz_ctx->icid_free = NULL;
+    memset(fuzz_ctx->icid_wheel, 0, sizeof(fuzz_ctx->icid_wheel));
+    fuzz_ctx->last_cnx = NULL;
+    fuzz_ctx->last_icid_ctx = NULL;
+    if (fuzz_ctx->icid_table != NULL) {
+        free(fuzz_ctx->icid_table);
+        fuzz_ctx->icid_table = NULL;
+    }
+    fuzz_ctx->icid_table_mask = 0;
+    fuzz_ctx->nb_icid = 0;
+    fuzzer_frame_index_release(&fuzz_ctx->frame_index);
+    fuzi_q_corpus_release(&fuzz_ctx->corpus);
+    fuzzer_entry_stats_release(fuzz_ctx);
 }
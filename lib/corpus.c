@@ -0,0 +1,1074 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2021, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#ifdef _WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include <picoquic.h>
+#include <picoquic_internal.h>
+#include <picoquic_utils.h>
+#include "fuzi_q.h"
+
+/* Check that the frames of an entry parse as QUIC frames. A frame that
+ * cannot be parsed within the entry is parsed again with zeros appended:
+ * if it then parses, the entry is truncated, otherwise it is invalid.
+ * The padded buffer holds the entry followed by enough zeros for any
+ * frame.
+ */
+static uint16_t fuzi_q_corpus_check_frames(const uint8_t* bytes, size_t length, uint8_t* padded, size_t padded_size)
+{
+    uint16_t flags = 0;
+    size_t offset = 0;
+
+    memcpy(padded, bytes, length);
+    memset(padded + length, 0, padded_size - length);
+    while (offset < length) {
+        size_t consumed = 0;
+        int pure_ack = 0;
+
+        if (picoquic_skip_frame(bytes + offset, length - offset, &consumed, &pure_ack) == 0 && consumed > 0) {
+            offset += consumed;
+        }
+        else {
+            if (picoquic_skip_frame(padded + offset, padded_size - offset, &consumed, &pure_ack) == 0 && consumed > 0) {
+                flags = FUZI_Q_CORPUS_FLAG_TRUNCATED;
+            }
+            else {
+                flags = FUZI_Q_CORPUS_FLAG_INVALID;
+            }
+            break;
+        }
+    }
+    return flags;
+}
+
+/* Packing of the test frames.
+ * The frames listed with FUZI_Q_ITEM in fuzzer_frames.c are copied once
+ * in a single allocation: the index first, then the bytes of the frames,
+ * then the null terminated names. The frame type is decoded when packing,
+ * so the fuzzer can select frames by type without parsing them, and the
+ * QUIC frames are checked with picoquic_skip_frame.
+ */
+int fuzi_q_corpus_pack(fuzi_q_corpus_t* corpus, const fuzi_q_frames_t* frame_list, size_t nb_frames)
+{
+    int ret = 0;
+    size_t nb_entries = 0;
+    size_t frames_size = 0;
+    size_t names_size = 0;
+    size_t max_length = 0;
+    size_t padded_size;
+    uint8_t* padded = NULL;
+
+    memset(corpus, 0, sizeof(fuzi_q_corpus_t));
+
+    for (size_t i = 0; i < nb_frames; i++) {
+        if (frame_list[i].len == 0 || frame_list[i].len > UINT16_MAX) {
+            DBG_PRINTF("Frame %s not packed, length %zu", frame_list[i].name, frame_list[i].len);
+            continue;
+        }
+        nb_entries++;
+        frames_size += frame_list[i].len;
+        names_size += strlen(frame_list[i].name) + 1;
+        if (frame_list[i].len > max_length) {
+            max_length = frame_list[i].len;
+        }
+    }
+    padded_size = max_length + PICOQUIC_MAX_PACKET_SIZE;
+
+    if (frames_size + names_size > UINT32_MAX) {
+        ret = -1;
+    }
+    else if ((padded = (uint8_t*)malloc(padded_size)) == NULL ||
+        (corpus->memory = malloc(nb_entries * sizeof(fuzi_q_corpus_entry_t) + frames_size + names_size)) == NULL) {
+        ret = -1;
+    }
+    else {
+        uint32_t offset = 0;
+        uint32_t name_offset = (uint32_t)frames_size;
+
+        corpus->entries = (fuzi_q_corpus_entry_t*)corpus->memory;
+        corpus->blob = ((uint8_t*)corpus->memory) + nb_entries * sizeof(fuzi_q_corpus_entry_t);
+        corpus->blob_size = frames_size + names_size;
+
+        for (size_t i = 0; i < nb_frames; i++) {
+            fuzi_q_corpus_entry_t* entry = &corpus->entries[corpus->nb_entries];
+            size_t name_length;
+
+            if (frame_list[i].len == 0 || frame_list[i].len > UINT16_MAX) {
+                continue;
+            }
+            name_length = strlen(frame_list[i].name) + 1;
+            memcpy(corpus->blob + offset, frame_list[i].val, frame_list[i].len);
+            memcpy(corpus->blob + name_offset, frame_list[i].name, name_length);
+            entry->offset = offset;
+            entry->name_offset = name_offset;
+            entry->length = (uint16_t)frame_list[i].len;
+            entry->flags = 0;
+            entry->layer = (uint16_t)frame_list[i].layer;
+            if (frame_list[i].layer != fuzi_q_layer_quic) {
+                entry->frame_type = picoquic_frame_type_stream_range_min;
+            }
+            else if (picoquic_frames_varint_decode(frame_list[i].val, frame_list[i].val + frame_list[i].len,
+                &entry->frame_type) == NULL) {
+                entry->frame_type = UINT64_MAX;
+                entry->flags |= FUZI_Q_CORPUS_FLAG_BAD_TYPE;
+            }
+            else {
+                entry->flags |= fuzi_q_corpus_check_frames(frame_list[i].val, frame_list[i].len, padded, padded_size);
+            }
+            offset += (uint32_t)frame_list[i].len;
+            name_offset += (uint32_t)name_length;
+            corpus->nb_entries++;
+        }
+    }
+
+    if (padded != NULL) {
+        free(padded);
+    }
+    return ret;
+}
+
+static uint64_t fuzi_q_corpus_entry_hash(const fuzi_q_corpus_t* corpus, size_t entry_id)
+{
+    const uint8_t* bytes = fuzi_q_corpus_frame(corpus, entry_id);
+    uint64_t hash = 0xcbf29ce484222325ull ^ corpus->entries[entry_id].layer;
+
+    /* FNV-1a */
+    for (size_t i = 0; i < corpus->entries[entry_id].length; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static int fuzi_q_corpus_entry_equal(const fuzi_q_corpus_t* corpus, size_t a, size_t b)
+{
+    return corpus->entries[a].length == corpus->entries[b].length &&
+        corpus->entries[a].layer == corpus->entries[b].layer &&
+        memcmp(fuzi_q_corpus_frame(corpus, a), fuzi_q_corpus_frame(corpus, b), corpus->entries[a].length) == 0;
+}
+
+/* Remove the entries whose bytes and layer are identical to those of a
+ * previous entry. If there are duplicates, the result is a new packed
+ * allocation holding only the first of each.
+ */
+int fuzi_q_corpus_dedup(fuzi_q_corpus_t* corpus)
+{
+    int ret = 0;
+    size_t table_size = 16;
+    uint32_t* table = NULL;
+    uint8_t* keep = NULL;
+    size_t nb_kept = 0;
+    size_t blob_size = 0;
+
+    while (table_size < 2 * corpus->nb_entries) {
+        table_size *= 2;
+    }
+    if (corpus->nb_entries > UINT32_MAX - 1 ||
+        (table = (uint32_t*)calloc(table_size, sizeof(uint32_t))) == NULL ||
+        (keep = (uint8_t*)malloc(corpus->nb_entries + 1)) == NULL) {
+        ret = -1;
+    }
+    else {
+        /* Open addressing, the slots hold the entry ID plus 1 */
+        for (size_t i = 0; i < corpus->nb_entries; i++) {
+            size_t slot = (size_t)(fuzi_q_corpus_entry_hash(corpus, i) & (table_size - 1));
+
+            keep[i] = 1;
+            while (table[slot] != 0) {
+                if (fuzi_q_corpus_entry_equal(corpus, table[slot] - 1, i)) {
+                    keep[i] = 0;
+                    break;
+                }
+                slot = (slot + 1) & (table_size - 1);
+            }
+            if (keep[i]) {
+                table[slot] = (uint32_t)(i + 1);
+                nb_kept++;
+                blob_size += corpus->entries[i].length + strlen(fuzi_q_corpus_name(corpus, i)) + 1;
+            }
+        }
+    }
+
+    if (ret == 0 && nb_kept < corpus->nb_entries) {
+        fuzi_q_corpus_t compact;
+
+        memset(&compact, 0, sizeof(fuzi_q_corpus_t));
+        if ((compact.memory = malloc(nb_kept * sizeof(fuzi_q_corpus_entry_t) + blob_size)) == NULL) {
+            ret = -1;
+        }
+        else {
+            uint32_t offset = 0;
+
+            compact.entries = (fuzi_q_corpus_entry_t*)compact.memory;
+            compact.blob = ((uint8_t*)compact.memory) + nb_kept * sizeof(fuzi_q_corpus_entry_t);
+            compact.blob_size = blob_size;
+            /* Frames first, then names, as in a packed corpus */
+            for (size_t i = 0; i < corpus->nb_entries; i++) {
+                if (keep[i]) {
+                    fuzi_q_corpus_entry_t* entry = &compact.entries[compact.nb_entries++];
+                    *entry = corpus->entries[i];
+                    memcpy(compact.blob + offset, fuzi_q_corpus_frame(corpus, i), entry->length);
+                    entry->offset = offset;
+                    offset += entry->length;
+                }
+            }
+            for (size_t i = 0, j = 0; i < corpus->nb_entries; i++) {
+                if (keep[i]) {
+                    char const* name = fuzi_q_corpus_name(corpus, i);
+                    size_t name_length = strlen(name) + 1;
+                    memcpy(compact.blob + offset, name, name_length);
+                    compact.entries[j++].name_offset = offset;
+                    offset += (uint32_t)name_length;
+                }
+            }
+            fuzi_q_corpus_release(corpus);
+            *corpus = compact;
+        }
+    }
+
+    if (table != NULL) {
+        free(table);
+    }
+    if (keep != NULL) {
+        free(keep);
+    }
+    return ret;
+}
+
+/* Merge another corpus after the entries of this one. The result is
+ * a new packed allocation, the other corpus is not modified.
+ */
+int fuzi_q_corpus_merge(fuzi_q_corpus_t* corpus, const fuzi_q_corpus_t* other)
+{
+    int ret = 0;
+    fuzi_q_corpus_t merged;
+    size_t nb_entries = corpus->nb_entries + other->nb_entries;
+    size_t blob_size = corpus->blob_size + other->blob_size;
+
+    memset(&merged, 0, sizeof(fuzi_q_corpus_t));
+    if (blob_size > UINT32_MAX) {
+        ret = -1;
+    }
+    else if ((merged.memory = malloc(nb_entries * sizeof(fuzi_q_corpus_entry_t) + blob_size)) == NULL) {
+        ret = -1;
+    }
+    else {
+        merged.entries = (fuzi_q_corpus_entry_t*)merged.memory;
+        merged.nb_entries = nb_entries;
+        merged.blob = ((uint8_t*)merged.memory) + nb_entries * sizeof(fuzi_q_corpus_entry_t);
+        merged.blob_size = blob_size;
+        if (corpus->nb_entries > 0) {
+            memcpy(merged.entries, corpus->entries, corpus->nb_entries * sizeof(fuzi_q_corpus_entry_t));
+            memcpy(merged.blob, corpus->blob, corpus->blob_size);
+        }
+        if (other->nb_entries > 0) {
+            memcpy(merged.blob + corpus->blob_size, other->blob, other->blob_size);
+        }
+        for (size_t i = 0; i < other->nb_entries; i++) {
+            fuzi_q_corpus_entry_t* entry = &merged.entries[corpus->nb_entries + i];
+            *entry = other->entries[i];
+            entry->offset += (uint32_t)corpus->blob_size;
+            entry->name_offset += (uint32_t)corpus->blob_size;
+        }
+        fuzi_q_corpus_release(corpus);
+        *corpus = merged;
+    }
+    return ret;
+}
+
+/* Replace a corpus by a read only view of another one, classified, so
+ * that many fuzzer contexts use the same test frames without packing or
+ * classifying them again. The other corpus must outlive the view.
+ * Releasing the view does not release the memory, and merging or
+ * deduplicating it creates a new allocation.
+ */
+void fuzi_q_corpus_share(fuzi_q_corpus_t* corpus, const fuzi_q_corpus_t* other)
+{
+    fuzi_q_corpus_release(corpus);
+    *corpus = *other;
+    corpus->is_shared = 1;
+}
+
+/* Map a file in memory, read only */
+static void* fuzi_q_corpus_map_file(char const* file_name, size_t* mapped_size)
+{
+    void* memory = NULL;
+#ifdef _WINDOWS
+    HANDLE h_file = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (h_file != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER file_size;
+        if (GetFileSizeEx(h_file, &file_size) && file_size.QuadPart > 0 && (uint64_t)file_size.QuadPart <= SIZE_MAX) {
+            HANDLE h_map = CreateFileMappingA(h_file, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (h_map != NULL) {
+                memory = MapViewOfFile(h_map, FILE_MAP_READ, 0, 0, 0);
+                if (memory != NULL) {
+                    *mapped_size = (size_t)file_size.QuadPart;
+                }
+                CloseHandle(h_map);
+            }
+        }
+        CloseHandle(h_file);
+    }
+#else
+    int fd = open(file_name, O_RDONLY);
+
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0 && (uint64_t)st.st_size <= SIZE_MAX) {
+            memory = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (memory == MAP_FAILED) {
+                memory = NULL;
+            }
+            else {
+                *mapped_size = (size_t)st.st_size;
+            }
+        }
+        (void)close(fd);
+    }
+#endif
+    return memory;
+}
+
+static void fuzi_q_corpus_unmap(void* memory, size_t mapped_size)
+{
+#ifdef _WINDOWS
+    (void)mapped_size;
+    (void)UnmapViewOfFile(memory);
+#else
+    (void)munmap(memory, mapped_size);
+#endif
+}
+
+/* Load a corpus file. The file is mapped, and the index and blob are
+ * used in place after checking that all entries are within bounds.
+ */
+int fuzi_q_corpus_load(fuzi_q_corpus_t* corpus, char const* file_name)
+{
+    int ret = 0;
+    size_t mapped_size = 0;
+    void* memory = fuzi_q_corpus_map_file(file_name, &mapped_size);
+    const fuzi_q_corpus_header_t* header = (const fuzi_q_corpus_header_t*)memory;
+
+    memset(corpus, 0, sizeof(fuzi_q_corpus_t));
+    if (memory == NULL) {
+        fprintf(stderr, "Cannot map corpus file: %s\n", file_name);
+        ret = -1;
+    }
+    else if (mapped_size < sizeof(fuzi_q_corpus_header_t) ||
+        memcmp(header->magic, FUZI_Q_CORPUS_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != FUZI_Q_CORPUS_VERSION || header->entry_size != sizeof(fuzi_q_corpus_entry_t) ||
+        header->nb_entries > (mapped_size - sizeof(fuzi_q_corpus_header_t)) / sizeof(fuzi_q_corpus_entry_t) ||
+        header->blob_size != mapped_size - sizeof(fuzi_q_corpus_header_t) - header->nb_entries * sizeof(fuzi_q_corpus_entry_t) ||
+        header->blob_size > UINT32_MAX) {
+        fprintf(stderr, "Invalid corpus file: %s\n", file_name);
+        ret = -1;
+    }
+    else {
+        corpus->memory = memory;
+        corpus->mapped_size = mapped_size;
+        corpus->nb_entries = (size_t)header->nb_entries;
+        corpus->entries = (fuzi_q_corpus_entry_t*)(((uint8_t*)memory) + sizeof(fuzi_q_corpus_header_t));
+        corpus->blob_size = (size_t)header->blob_size;
+        corpus->blob = ((uint8_t*)corpus->entries) + corpus->nb_entries * sizeof(fuzi_q_corpus_entry_t);
+
+        for (size_t i = 0; ret == 0 && i < corpus->nb_entries; i++) {
+            const fuzi_q_corpus_entry_t* entry = &corpus->entries[i];
+            if (entry->length == 0 || (size_t)entry->offset + entry->length > corpus->blob_size ||
+                entry->layer >= fuzi_q_layer_max ||
+                entry->name_offset >= corpus->blob_size ||
+                memchr(corpus->blob + entry->name_offset, 0, corpus->blob_size - entry->name_offset) == NULL) {
+                fprintf(stderr, "Invalid entry %zu in corpus file: %s\n", i, file_name);
+                ret = -1;
+            }
+        }
+    }
+
+    if (ret != 0) {
+        if (corpus->memory == NULL && memory != NULL) {
+            fuzi_q_corpus_unmap(memory, mapped_size);
+        }
+        fuzi_q_corpus_release(corpus);
+    }
+    return ret;
+}
+
+int fuzi_q_corpus_write(const fuzi_q_corpus_t* corpus, char const* file_name)
+{
+    int ret = 0;
+    FILE* F = picoquic_file_open(file_name, "wb");
+
+    if (F == NULL) {
+        fprintf(stderr, "Cannot create corpus file: %s\n", file_name);
+        ret = -1;
+    }
+    else {
+        fuzi_q_corpus_header_t header;
+
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, FUZI_Q_CORPUS_MAGIC, sizeof(header.magic));
+        header.version = FUZI_Q_CORPUS_VERSION;
+        header.entry_size = sizeof(fuzi_q_corpus_entry_t);
+        header.nb_entries = corpus->nb_entries;
+        header.blob_size = corpus->blob_size;
+        if (fwrite(&header, sizeof(header), 1, F) != 1 ||
+            (corpus->nb_entries > 0 &&
+                fwrite(corpus->entries, sizeof(fuzi_q_corpus_entry_t), corpus->nb_entries, F) != corpus->nb_entries) ||
+            (corpus->blob_size > 0 && fwrite(corpus->blob, 1, corpus->blob_size, F) != corpus->blob_size)) {
+            fprintf(stderr, "Cannot write corpus file: %s\n", file_name);
+            ret = -1;
+        }
+        (void)picoquic_file_close(F);
+    }
+    return ret;
+}
+
+/* Replace the test frames of the fuzzer by those of a corpus file, or
+ * add them to the current ones if the file name is preceded by '+'.
+ * Duplicate frames are removed.
+ */
+int fuzzer_load_corpus(fuzzer_ctx_t* ctx, char const* corpus_spec)
+{
+    int ret = 0;
+    int do_merge = (corpus_spec[0] == '+');
+    fuzi_q_corpus_t loaded;
+
+    if ((ret = fuzi_q_corpus_load(&loaded, corpus_spec + do_merge)) == 0) {
+        if (do_merge) {
+            ret = fuzi_q_corpus_merge(&ctx->corpus, &loaded);
+            fuzi_q_corpus_release(&loaded);
+        }
+        else {
+            fuzi_q_corpus_release(&ctx->corpus);
+            ctx->corpus = loaded;
+        }
+    }
+    if (ret == 0 && (ret = fuzi_q_corpus_dedup(&ctx->corpus)) == 0 &&
+        (ret = fuzi_q_corpus_classify(&ctx->corpus)) == 0) {
+        ret = fuzzer_entry_stats_reset(ctx);
+    }
+    return ret;
+}
+
+/* Write the built-in test frames, possibly replaced or completed by a
+ * corpus file, to a new corpus file, without duplicates. The frames that
+ * are truncated or that cannot be parsed are listed, so that test frames
+ * that do not match their description can be found.
+ */
+int fuzi_q_corpus_export(char const* corpus_spec, char const* file_name)
+{
+    int ret = 0;
+    fuzzer_ctx_t ctx;
+
+    memset(&ctx, 0, sizeof(ctx));
+    if ((ret = fuzi_q_corpus_pack(&ctx.corpus, fuzi_q_frame_list, nb_fuzi_q_frame_list)) == 0) {
+        size_t nb_packed = ctx.corpus.nb_entries;
+
+        if ((ret = fuzi_q_corpus_dedup(&ctx.corpus)) == 0) {
+            fprintf(stdout, "Removed %zu duplicates from %zu test frames.\n", nb_packed - ctx.corpus.nb_entries, nb_packed);
+        }
+        if (ret == 0 && corpus_spec != NULL) {
+            ret = fuzzer_load_corpus(&ctx, corpus_spec);
+        }
+        if (ret == 0) {
+            size_t nb_app = 0;
+            size_t nb_truncated = 0;
+            size_t nb_invalid = 0;
+
+            for (size_t i = 0; i < ctx.corpus.nb_entries; i++) {
+                char const* check = NULL;
+
+                if (ctx.corpus.entries[i].layer != fuzi_q_layer_quic) {
+                    nb_app++;
+                }
+                else if ((ctx.corpus.entries[i].flags & FUZI_Q_CORPUS_FLAG_TRUNCATED) != 0) {
+                    check = "truncated";
+                    nb_truncated++;
+                }
+                else if ((ctx.corpus.entries[i].flags & (FUZI_Q_CORPUS_FLAG_INVALID | FUZI_Q_CORPUS_FLAG_BAD_TYPE)) != 0) {
+                    check = "invalid";
+                    nb_invalid++;
+                }
+                if (check != NULL) {
+                    fprintf(stdout, "%s: %s\n", fuzi_q_corpus_name(&ctx.corpus, i), check);
+                }
+            }
+            fprintf(stdout, "%zu parseable, %zu truncated, %zu invalid, %zu application layer.\n",
+                ctx.corpus.nb_entries - nb_app - nb_truncated - nb_invalid, nb_truncated, nb_invalid, nb_app);
+            ret = fuzi_q_corpus_write(&ctx.corpus, file_name);
+        }
+        if (ret == 0) {
+            fprintf(stdout, "Wrote %zu frames to %s\n", ctx.corpus.nb_entries, file_name);
+        }
+    }
+    fuzi_q_corpus_release(&ctx.corpus);
+    fuzzer_entry_stats_release(&ctx);
+    return ret;
+}
+
+/* Epochs in which a frame type is allowed, as a bit mask, per RFC 9000,
+ * table 3. Frames whose type cannot be decoded are allowed everywhere.
+ * Extension frames are treated like most frames, allowed in 0-RTT and
+ * 1-RTT packets.
+ */
+#define FUZI_Q_EPOCH_BIT(e) (1 << (e))
+#define FUZI_Q_EPOCHS_ALL 0x0F
+#define FUZI_Q_EPOCHS_IH1 (FUZI_Q_EPOCH_BIT(fuzi_q_epoch_initial) | FUZI_Q_EPOCH_BIT(fuzi_q_epoch_handshake) | FUZI_Q_EPOCH_BIT(fuzi_q_epoch_1rtt))
+#define FUZI_Q_EPOCHS_01 (FUZI_Q_EPOCH_BIT(fuzi_q_epoch_0rtt) | FUZI_Q_EPOCH_BIT(fuzi_q_epoch_1rtt))
+#define FUZI_Q_EPOCHS_1 FUZI_Q_EPOCH_BIT(fuzi_q_epoch_1rtt)
+
+static int fuzi_q_corpus_frame_epochs(const fuzi_q_corpus_entry_t* entry)
+{
+    int epochs = FUZI_Q_EPOCHS_01;
+
+    if ((entry->flags & FUZI_Q_CORPUS_FLAG_BAD_TYPE) != 0) {
+        epochs = FUZI_Q_EPOCHS_ALL;
+    }
+    else {
+        switch (entry->frame_type) {
+        case picoquic_frame_type_padding:
+        case picoquic_frame_type_ping:
+        case picoquic_frame_type_connection_close:
+            epochs = FUZI_Q_EPOCHS_ALL;
+            break;
+        case picoquic_frame_type_ack:
+        case picoquic_frame_type_ack_ecn:
+        case picoquic_frame_type_crypto_hs:
+            epochs = FUZI_Q_EPOCHS_IH1;
+            break;
+        case picoquic_frame_type_new_token:
+        case picoquic_frame_type_path_response:
+        case picoquic_frame_type_handshake_done:
+            epochs = FUZI_Q_EPOCHS_1;
+            break;
+        default:
+            break;
+        }
+    }
+    return epochs;
+}
+
+/* Frames only allowed in 1-RTT packets are only sent once the handshake is complete */
+static fuzzer_cnx_state_enum fuzi_q_corpus_frame_min_state(int epochs)
+{
+    return (epochs == FUZI_Q_EPOCHS_1) ? fuzzer_cnx_state_ready : fuzzer_cnx_state_initial;
+}
+
+typedef struct st_fuzi_q_corpus_type_key_t {
+    uint64_t frame_type;
+    uint32_t entry_id;
+} fuzi_q_corpus_type_key_t;
+
+static int fuzi_q_corpus_type_key_compare(const void* a, const void* b)
+{
+    const fuzi_q_corpus_type_key_t* ka = (const fuzi_q_corpus_type_key_t*)a;
+    const fuzi_q_corpus_type_key_t* kb = (const fuzi_q_corpus_type_key_t*)b;
+    int ret = 0;
+
+    if (ka->frame_type != kb->frame_type) {
+        ret = (ka->frame_type < kb->frame_type) ? -1 : 1;
+    }
+    else if (ka->entry_id != kb->entry_id) {
+        ret = (ka->entry_id < kb->entry_id) ? -1 : 1;
+    }
+    return ret;
+}
+
+/* ALPN for which an entry is relevant. Application layer entries are
+ * only kept for the application that parses them.
+ */
+static int fuzi_q_corpus_alpn_relevant(fuzi_q_alpn_enum alpn, const fuzi_q_corpus_entry_t* entry)
+{
+    int relevant = 1;
+
+    switch (alpn) {
+    case fuzi_q_alpn_h3:
+        relevant = (entry->layer != fuzi_q_layer_app);
+        break;
+    case fuzi_q_alpn_hq:
+    case fuzi_q_alpn_perf:
+        relevant = (entry->layer == fuzi_q_layer_quic);
+        break;
+    default:
+        break;
+    }
+    return relevant;
+}
+
+#define FUZI_Q_CORPUS_BUCKET(alpn, epoch, state) (((alpn) * fuzi_q_epoch_max + (epoch)) * fuzzer_cnx_state_max + (state))
+
+/* List the buckets of an entry, returns their number */
+static int fuzi_q_corpus_entry_buckets(const fuzi_q_corpus_entry_t* entry, int* buckets)
+{
+    int epochs = fuzi_q_corpus_frame_epochs(entry);
+    fuzzer_cnx_state_enum min_state = fuzi_q_corpus_frame_min_state(epochs);
+    int nb_buckets = 0;
+
+    for (int alpn = 0; alpn < fuzi_q_alpn_max; alpn++) {
+        if (!fuzi_q_corpus_alpn_relevant((fuzi_q_alpn_enum)alpn, entry)) {
+            continue;
+        }
+        for (int epoch = 0; epoch < fuzi_q_epoch_max; epoch++) {
+            if ((epochs & FUZI_Q_EPOCH_BIT(epoch)) != 0) {
+                for (int state = min_state; state < fuzzer_cnx_state_max; state++) {
+                    buckets[nb_buckets++] = FUZI_Q_CORPUS_BUCKET(alpn, epoch, state);
+                }
+            }
+        }
+    }
+    return nb_buckets;
+}
+
+int fuzi_q_corpus_classify(fuzi_q_corpus_t* corpus)
+{
+    int ret = 0;
+    fuzi_q_corpus_class_t* classes = &corpus->classes;
+    size_t nb_ids = corpus->nb_entries;
+    fuzi_q_corpus_type_key_t* keys = NULL;
+    int buckets[FUZI_Q_CORPUS_NB_BUCKETS];
+
+    if (corpus->is_shared) {
+        /* The classes belong to the shared corpus */
+        return -1;
+    }
+    if (classes->memory != NULL) {
+        free(classes->memory);
+    }
+    memset(classes, 0, sizeof(fuzi_q_corpus_class_t));
+
+    if (corpus->nb_entries > UINT32_MAX) {
+        return -1;
+    }
+    /* Count the members of each view and bucket */
+    for (size_t i = 0; i < corpus->nb_entries; i++) {
+        int nb_buckets = fuzi_q_corpus_entry_buckets(&corpus->entries[i], buckets);
+
+        for (int alpn = 0; alpn < fuzi_q_alpn_max; alpn++) {
+            if (fuzi_q_corpus_alpn_relevant((fuzi_q_alpn_enum)alpn, &corpus->entries[i])) {
+                classes->view_size[alpn]++;
+                nb_ids++;
+            }
+        }
+        for (int j = 0; j < nb_buckets; j++) {
+            classes->bucket_size[buckets[j]]++;
+        }
+        nb_ids += nb_buckets;
+    }
+
+    if (corpus->nb_entries > 0 &&
+        ((classes->memory = malloc(nb_ids * sizeof(uint32_t))) == NULL ||
+        (keys = (fuzi_q_corpus_type_key_t*)malloc(corpus->nb_entries * sizeof(fuzi_q_corpus_type_key_t))) == NULL)) {
+        ret = -1;
+    }
+    else if (corpus->nb_entries > 0) {
+        uint32_t* next_id = (uint32_t*)classes->memory;
+        uint32_t view_fill[fuzi_q_alpn_max];
+        uint32_t bucket_fill[FUZI_Q_CORPUS_NB_BUCKETS];
+
+        /* Entries sorted by type, with direct access for single byte types */
+        classes->by_type = next_id;
+        next_id += corpus->nb_entries;
+        for (size_t i = 0; i < corpus->nb_entries; i++) {
+            keys[i].frame_type = corpus->entries[i].frame_type;
+            keys[i].entry_id = (uint32_t)i;
+        }
+        qsort(keys, corpus->nb_entries, sizeof(fuzi_q_corpus_type_key_t), fuzi_q_corpus_type_key_compare);
+        for (size_t i = 0, t = 0; i < corpus->nb_entries; i++) {
+            classes->by_type[i] = keys[i].entry_id;
+            while (t <= FUZI_Q_CORPUS_TYPE_MAP_SIZE && t <= keys[i].frame_type) {
+                classes->type_start[t++] = (uint32_t)i;
+            }
+            if (i + 1 == corpus->nb_entries) {
+                while (t <= FUZI_Q_CORPUS_TYPE_MAP_SIZE) {
+                    classes->type_start[t++] = (uint32_t)corpus->nb_entries;
+                }
+            }
+        }
+        /* Fill the views and the buckets, in entry order */
+        for (int alpn = 0; alpn < fuzi_q_alpn_max; alpn++) {
+            classes->view[alpn] = next_id;
+            next_id += classes->view_size[alpn];
+            view_fill[alpn] = 0;
+        }
+        for (int b = 0; b < FUZI_Q_CORPUS_NB_BUCKETS; b++) {
+            classes->bucket[b] = next_id;
+            next_id += classes->bucket_size[b];
+            bucket_fill[b] = 0;
+        }
+        for (size_t i = 0; i < corpus->nb_entries; i++) {
+            int nb_buckets = fuzi_q_corpus_entry_buckets(&corpus->entries[i], buckets);
+
+            for (int alpn = 0; alpn < fuzi_q_alpn_max; alpn++) {
+                if (fuzi_q_corpus_alpn_relevant((fuzi_q_alpn_enum)alpn, &corpus->entries[i])) {
+                    classes->view[alpn][view_fill[alpn]++] = (uint32_t)i;
+                }
+            }
+            for (int j = 0; j < nb_buckets; j++) {
+                classes->bucket[buckets[j]][bucket_fill[buckets[j]]++] = (uint32_t)i;
+            }
+        }
+    }
+
+    if (keys != NULL) {
+        free(keys);
+    }
+    if (ret != 0) {
+        if (classes->memory != NULL) {
+            free(classes->memory);
+        }
+        memset(classes, 0, sizeof(fuzi_q_corpus_class_t));
+    }
+    return ret;
+}
+
+/* Entries of a given frame type, in entry order */
+size_t fuzi_q_corpus_by_type(const fuzi_q_corpus_t* corpus, uint64_t frame_type, const uint32_t** entry_ids)
+{
+    const fuzi_q_corpus_class_t* classes = &corpus->classes;
+    size_t first = 0;
+    size_t last = 0;
+
+    if (classes->by_type == NULL) {
+        /* Not classified */
+    }
+    else if (frame_type < FUZI_Q_CORPUS_TYPE_MAP_SIZE) {
+        first = classes->type_start[frame_type];
+        last = classes->type_start[frame_type + 1];
+    }
+    else {
+        size_t low = classes->type_start[FUZI_Q_CORPUS_TYPE_MAP_SIZE];
+        size_t high = corpus->nb_entries;
+
+        /* Find the first entry with a type larger or equal */
+        while (low < high) {
+            size_t mid = low + (high - low) / 2;
+            if (corpus->entries[classes->by_type[mid]].frame_type < frame_type) {
+                low = mid + 1;
+            }
+            else {
+                high = mid;
+            }
+        }
+        first = low;
+        last = low;
+        while (last < corpus->nb_entries && corpus->entries[classes->by_type[last]].frame_type == frame_type) {
+            last++;
+        }
+    }
+    *entry_ids = (classes->by_type == NULL) ? NULL : classes->by_type + first;
+    return last - first;
+}
+
+/* Entries relevant for an ALPN */
+size_t fuzi_q_corpus_view(const fuzi_q_corpus_t* corpus, fuzi_q_alpn_enum alpn, const uint32_t** entry_ids)
+{
+    size_t nb_ids = 0;
+
+    *entry_ids = NULL;
+    if (alpn >= 0 && alpn < fuzi_q_alpn_max) {
+        *entry_ids = corpus->classes.view[alpn];
+        nb_ids = corpus->classes.view_size[alpn];
+    }
+    return nb_ids;
+}
+
+size_t fuzi_q_corpus_bucket(const fuzi_q_corpus_t* corpus, fuzi_q_alpn_enum alpn, fuzi_q_epoch_enum epoch,
+    fuzzer_cnx_state_enum cnx_state, const uint32_t** entry_ids)
+{
+    size_t nb_ids = 0;
+
+    *entry_ids = NULL;
+    if (alpn >= 0 && alpn < fuzi_q_alpn_max && epoch >= 0 && epoch < fuzi_q_epoch_max &&
+        cnx_state >= 0 && cnx_state < fuzzer_cnx_state_max) {
+        int b = FUZI_Q_CORPUS_BUCKET(alpn, epoch, cnx_state);
+        *entry_ids = corpus->classes.bucket[b];
+        nb_ids = corpus->classes.bucket_size[b];
+    }
+    return nb_ids;
+}
+
+/* Map the ALPN of a connection to the corpus view of its application.
+ * Draft versions, e.g., "h3-29" or "hq-29", use the same view.
+ */
+fuzi_q_alpn_enum fuzi_q_alpn_from_name(char const* alpn)
+{
+    fuzi_q_alpn_enum view = fuzi_q_alpn_any;
+
+    if (alpn == NULL) {
+        /* Not negotiated yet */
+    }
+    else if (strcmp(alpn, QUICPERF_ALPN) == 0) {
+        view = fuzi_q_alpn_perf;
+    }
+    else if (strncmp(alpn, "h3", 2) == 0 && (alpn[2] == 0 || alpn[2] == '-')) {
+        view = fuzi_q_alpn_h3;
+    }
+    else if (strncmp(alpn, "hq", 2) == 0 && (alpn[2] == 0 || alpn[2] == '-')) {
+        view = fuzi_q_alpn_hq;
+    }
+    return view;
+}
+
+void fuzi_q_corpus_release(fuzi_q_corpus_t* corpus)
+{
+    if (corpus->is_shared) {
+        memset(corpus, 0, sizeof(fuzi_q_corpus_t));
+        return;
+    }
+    if (corpus->classes.memory != NULL) {
+        free(corpus->classes.memory);
+    }
+    if (corpus->memory != NULL) {
+        if (corpus->mapped_size > 0) {
+            fuzi_q_corpus_unmap(corpus->memory, corpus->mapped_size);
+        }
+        else {
+            free(corpus->memory);
+        }
+    }
+    memset(corpus, 0, sizeof(fuzi_q_corpus_t));
+}
+
+const uint8_t* fuzi_q_corpus_frame(const fuzi_q_corpus_t* corpus, size_t entry_id)
+{
+    return corpus->blob + corpus->entries[entry_id].offset;
+}
+
+char const* fuzi_q_corpus_name(const fuzi_q_corpus_t* corpus, size_t entry_id)
+{
+    return (char const*)(corpus->blob + corpus->entries[entry_id].name_offset);
+}
+
+/* Counters of the corpus entries, reset when the corpus changes */
+int fuzzer_entry_stats_reset(fuzzer_ctx_t* ctx)
+{
+    int ret = 0;
+
+    fuzzer_entry_stats_release(ctx);
+    if (ctx->corpus.nb_entries > 0) {
+        ctx->entry_stats = (fuzi_q_entry_stats_t*)calloc(ctx->corpus.nb_entries, sizeof(fuzi_q_entry_stats_t));
+        if (ctx->entry_stats == NULL) {
+            ret = -1;
+        }
+        else {
+            ctx->nb_entry_stats = ctx->corpus.nb_entries;
+        }
+    }
+    return ret;
+}
+
+void fuzzer_entry_stats_release(fuzzer_ctx_t* ctx)
+{
+    if (ctx->entry_stats != NULL) {
+        free(ctx->entry_stats);
+    }
+    ctx->entry_stats = NULL;
+    ctx->nb_entry_stats = 0;
+}
+
+/* Count an injection, and remember the entry until the connection ends */
+void fuzzer_entry_injected(fuzzer_ctx_t* ctx, fuzzer_icid_ctx_t* icid_ctx, size_t entry_id)
+{
+    if (entry_id < ctx->nb_entry_stats) {
+        int is_tracked = 0;
+
+        ctx->entry_stats[entry_id].nb_injected++;
+        for (int i = 0; i < icid_ctx->nb_injected_entries; i++) {
+            if (icid_ctx->injected_entry[i] == (uint32_t)entry_id) {
+                is_tracked = 1;
+                break;
+            }
+        }
+        if (!is_tracked && icid_ctx->nb_injected_entries < FUZZER_NB_TRACKED_ENTRIES) {
+            icid_ctx->injected_entry[icid_ctx->nb_injected_entries++] = (uint32_t)entry_id;
+            ctx->entry_stats[entry_id].nb_cnx++;
+        }
+    }
+}
+
+/* Credit the end of a connection to the entries injected in it */
+void fuzzer_entry_outcome(fuzzer_ctx_t* ctx, picoquic_connection_id_t* icid, fuzzer_entry_outcome_enum outcome)
+{
+    fuzzer_icid_ctx_t* icid_ctx = fuzzer_find_icid_ctx(ctx, icid);
+
+    if (icid_ctx == NULL) {
+        /* The entries injected in the connection are not known anymore */
+        ctx->nb_lost_outcomes++;
+        return;
+    }
+    for (int i = 0; i < icid_ctx->nb_injected_entries; i++) {
+        uint32_t entry_id = icid_ctx->injected_entry[i];
+
+        if (entry_id < ctx->nb_entry_stats) {
+            switch (outcome) {
+            case fuzzer_entry_outcome_peer_close:
+                ctx->entry_stats[entry_id].nb_peer_close++;
+                break;
+            case fuzzer_entry_outcome_timeout:
+                ctx->entry_stats[entry_id].nb_timeout++;
+                break;
+            case fuzzer_entry_outcome_server_down:
+                ctx->entry_stats[entry_id].nb_server_down++;
+                break;
+            case fuzzer_entry_outcome_open_at_end:
+                ctx->entry_stats[entry_id].nb_open_at_end++;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    icid_ctx->nb_injected_entries = 0;
+}
+
+/* Add the counters of a worker. The workers use the same corpus. */
+int fuzzer_entry_stats_merge(fuzzer_ctx_t* summary, const fuzzer_ctx_t* ctx)
+{
+    int ret = 0;
+
+    if (summary->nb_entry_stats != ctx->nb_entry_stats) {
+        ret = -1;
+    }
+    else {
+        for (size_t i = 0; i < ctx->nb_entry_stats; i++) {
+            summary->entry_stats[i].nb_injected += ctx->entry_stats[i].nb_injected;
+            summary->entry_stats[i].nb_cnx += ctx->entry_stats[i].nb_cnx;
+            summary->entry_stats[i].nb_peer_close += ctx->entry_stats[i].nb_peer_close;
+            summary->entry_stats[i].nb_timeout += ctx->entry_stats[i].nb_timeout;
+            summary->entry_stats[i].nb_server_down += ctx->entry_stats[i].nb_server_down;
+            summary->entry_stats[i].nb_open_at_end += ctx->entry_stats[i].nb_open_at_end;
+        }
+    }
+    return ret;
+}
+
+/* Names of entries loaded with -Z may contain any character. In CSV,
+ * names with a comma, a quote or a line break are quoted, and quotes
+ * are doubled. In JSON, quotes, backslashes and control characters
+ * are escaped.
+ */
+static void fuzzer_entry_name_write_csv(FILE* F, char const* name)
+{
+    if (strpbrk(name, ",\"\r\n") == NULL) {
+        fputs(name, F);
+    }
+    else {
+        fputc('"', F);
+        for (; *name != 0; name++) {
+            if (*name == '"') {
+                fputc('"', F);
+            }
+            fputc(*name, F);
+        }
+        fputc('"', F);
+    }
+}
+
+static void fuzzer_entry_name_write_json(FILE* F, char const* name)
+{
+    fputc('"', F);
+    for (; *name != 0; name++) {
+        unsigned char c = (unsigned char)*name;
+
+        if (c == '"' || c == '\\') {
+            fputc('\\', F);
+            fputc(c, F);
+        }
+        else if (c == '\n') {
+            fputs("\\n", F);
+        }
+        else if (c < 0x20) {
+            fprintf(F, "\\u%04x", c);
+        }
+        else {
+            fputc(c, F);
+        }
+    }
+    fputc('"', F);
+}
+
+/* Write the counters of the corpus entries, one per line, in CSV, or
+ * in JSON if the file name ends with ".json".
+ */
+int fuzzer_entry_stats_write(const fuzzer_ctx_t* ctx, char const* file_name)
+{
+    int ret = 0;
+    size_t name_len = strlen(file_name);
+    int is_json = (name_len >= 5 && strcmp(file_name + name_len - 5, ".json") == 0);
+    FILE* F = picoquic_file_open(file_name, "w");
+
+    if (F == NULL) {
+        fprintf(stderr, "Cannot create entry statistics file: %s\n", file_name);
+        ret = -1;
+    }
+    else {
+        if (is_json) {
+            fprintf(F, "[\n");
+        }
+        else {
+            fprintf(F, "name,frame_type,layer,injected,connections,peer_close,timeout,server_down,open_at_end\n");
+        }
+        for (size_t i = 0; i < ctx->nb_entry_stats; i++) {
+            const fuzi_q_entry_stats_t* stats = &ctx->entry_stats[i];
+
+            if (is_json) {
+                fprintf(F, "{\"name\": ");
+                fuzzer_entry_name_write_json(F, fuzi_q_corpus_name(&ctx->corpus, i));
+                fprintf(F, ", \"frame_type\": %" PRIu64 ", \"layer\": %u, "
+                    "\"injected\": %" PRIu32 ", \"connections\": %" PRIu32 ", \"peer_close\": %" PRIu32
+                    ", \"timeout\": %" PRIu32 ", \"server_down\": %" PRIu32 ", \"open_at_end\": %" PRIu32 "}%s\n",
+                    ctx->corpus.entries[i].frame_type,
+                    (unsigned int)ctx->corpus.entries[i].layer, stats->nb_injected, stats->nb_cnx,
+                    stats->nb_peer_close, stats->nb_timeout, stats->nb_server_down, stats->nb_open_at_end,
+                    (i + 1 < ctx->nb_entry_stats) ? "," : "");
+            }
+            else {
+                fuzzer_entry_name_write_csv(F, fuzi_q_corpus_name(&ctx->corpus, i));
+                fprintf(F, ",%" PRIu64 ",%u,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 "\n",
+                    ctx->corpus.entries[i].frame_type,
+                    (unsigned int)ctx->corpus.entries[i].layer, stats->nb_injected, stats->nb_cnx,
+                    stats->nb_peer_close, stats->nb_timeout, stats->nb_server_down, stats->nb_open_at_end);
+            }
+        }
+        if (is_json) {
+            fprintf(F, "]\n");
+        }
+        if (ferror(F)) {
+            fprintf(stderr, "Cannot write entry statistics file: %s\n", file_name);
+            ret = -1;
+        }
+        (void)picoquic_file_close(F);
+    }
+    return ret;
+}
@@ -25,12 +25,11 @@
 #include <picoquic_utils.h>
 #include <picoquic_internal.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "fuzi_q.h"
 
-#define FUZZER_MAX_NB_FRAMES 32
-
 /* Forward declarations for picoquic functions/macros if not found by compiler */
 /* These are added as a workaround for potential build environment/include issues. */
 
@@ -87,6 +86,74 @@ void fuzz_random_byte(uint64_t fuzz_pilot, uint8_t* bytes, uint8_t* bytes_max);
 void max_stream_data_frame_fuzzer(uint64_t fuzz_pilot, uint8_t* bytes, uint8_t* bytes_max);
 void max_streams_frame_fuzzer(uint64_t fuzz_pilot, uint8_t* bytes, uint8_t* bytes_max);
 
+/* Pilot bit stream.
+ * The bits are taken from the low end of the reservoir. When the
+ * reservoir does not hold enough bits, the remaining ones are used as
+ * the low bits of the result, and the high bits come from a new random
+ * value. Ranges are drawn by rejection, so that choices are not biased.
+ */
+void fuzzer_pilot_init(fuzzer_pilot_t* pilot, uint64_t* random_context)
+{
+    pilot->random_context = random_context;
+    pilot->reservoir = 0;
+    pilot->nb_bits = 0;
+}
+
+static uint64_t fuzzer_pilot_mask(int nb_bits)
+{
+    return (nb_bits >= 64) ? UINT64_MAX : ((((uint64_t)1) << nb_bits) - 1);
+}
+
+uint64_t fuzzer_pilot_bits(fuzzer_pilot_t* pilot, int nb_bits)
+{
+    uint64_t bits;
+
+    if (nb_bits <= 0) {
+        bits = 0;
+    }
+    else {
+        if (nb_bits > 64) {
+            nb_bits = 64;
+        }
+        if (nb_bits <= pilot->nb_bits) {
+            bits = pilot->reservoir & fuzzer_pilot_mask(nb_bits);
+            pilot->reservoir = (nb_bits >= 64) ? 0 : pilot->reservoir >> nb_bits;
+            pilot->nb_bits -= nb_bits;
+        }
+        else {
+            int nb_high = nb_bits - pilot->nb_bits;
+            uint64_t fresh = picoquic_test_random(pilot->random_context);
+
+            bits = pilot->reservoir | ((fresh & fuzzer_pilot_mask(nb_high)) << pilot->nb_bits);
+            pilot->reservoir = (nb_high >= 64) ? 0 : fresh >> nb_high;
+            pilot->nb_bits = 64 - nb_high;
+        }
+    }
+    return bits;
+}
+
+uint64_t fuzzer_pilot_range(fuzzer_pilot_t* pilot, uint64_t range)
+{
+    uint64_t x = 0;
+
+    if (range > 1) {
+        int nb_bits = 0;
+
+        while (nb_bits < 64 && ((range - 1) >> nb_bits) != 0) {
+            nb_bits++;
+        }
+        do {
+            x = fuzzer_pilot_bits(pilot, nb_bits);
+        } while (x >= range);
+    }
+    return x;
+}
+
+uint64_t fuzzer_pilot_word(fuzzer_pilot_t* pilot)
+{
+    return fuzzer_pilot_bits(pilot, 64);
+}
+
 /*
  * Fuzz packet header bits (Reserved, Spin, Key Phase)
  */
@@ -966,7 +1033,7 @@ void stream_frame_fuzzer(uint64_t fuzz_pilot, uint8_t* bytes, uint8_t* bytes_max
     }
 }
 
-void datagram_frame_fuzzer(fuzzer_ctx_t* ctx, fuzzer_icid_ctx_t* icid_ctx, uint64_t fuzz_pilot, uint8_t* frame_start, uint8_t* frame_max)
+void datagram_frame_fuzzer(fuzzer_ctx_t* ctx, fuzzer_icid_ctx_t* icid_ctx, fuzzer_pilot_t* pilot, uint8_t* frame_start, uint8_t* frame_max)
 {
     if (frame_start >= frame_max) return;
 
@@ -974,7 +1041,7 @@ void datagram_frame_fuzzer(fuzzer_ctx_t* ctx, fuzzer_icid_ctx_t* icid_ctx, uint6
     uint8_t* payload_start = frame_start + 1;
 
     if (payload_start > frame_max) {
-         frame_start[0] ^= (uint8_t)(fuzz_pilot & 0xFF);
+         frame_start[0] ^= (uint8_t)fuzzer_pilot_bits(pilot, 8);
         return;
     }
 
@@ -986,8 +1053,7 @@ void datagram_frame_fuzzer(fuzzer_ctx_t* ctx, fuzzer_icid_ctx_t* icid_ctx, uint6
         if (length_end != NULL && length_start != length_end) {
             uint8_t* data_actual_start = length_end;
 
-            int choice = fuzz_pilot % 8;
-            fuzz_pilot >>= 3;
+            int choice = (int)fuzzer_pilot_bits(pilot, 3);
 
             if (choice < 2) {
                 uint64_t large_value = (choice == 0) ? 65536 : 0x3FFFFFFFFFFFFFFF;
@@ -995,7 +1061,7 @@ void datagram_frame_fuzzer(fuzzer_ctx_t* ctx, fuzzer_icid_ctx_t* icid_ctx, uint6
             } else if (choice == 2) {
                 encode_and_overwrite_varint(length_start, length_end, frame_max, 0);
             } else if (choice < 5) {
-                fuzz_in_place_or_skip_varint(fuzz_pilot, length_start, frame_max, 1);
+                fuzz_in_place_or_skip_varint(fuzzer_pilot_word(pilot), length_start, frame_max, 1);
             }
 
             if (data_actual_start < frame_max) {
@@ -1007,42 +1073,26 @@ void datagram_frame_fuzzer(fuzzer_ctx_t* ctx, fuzzer_icid_ctx_t* icid_ctx, uint6
                 }
 
                 if (fuzzable_data_len > 0) {
-                    size_t num_flips = 1 + (fuzz_pilot % 2);
-                    fuzz_pilot >>= 1;
+                    size_t num_flips = 1 + (size_t)fuzzer_pilot_bits(pilot, 1);
                     for (size_t i = 0; i < num_flips; i++) {
-                        if (fuzzable_data_len == 0) break;
-                        size_t flip_idx = fuzz_pilot % fuzzable_data_len;
-                        if (icid_ctx == NULL && fuzz_pilot == 0) {
-                            fuzz_pilot = frame_start[0];
-                        } else if (fuzz_pilot == 0 && icid_ctx != NULL) {
-                             fuzz_pilot = picoquic_test_random(&icid_ctx->random_context);
-                        }
-                        data_actual_start[flip_idx] ^= (uint8_t)(fuzz_pilot & 0xFF);
-                        fuzz_pilot >>= 8;
+                        size_t flip_idx = (size_t)fuzzer_pilot_range(pilot, fuzzable_data_len);
+                        data_actual_start[flip_idx] ^= (uint8_t)fuzzer_pilot_bits(pilot, 8);
                     }
                 }
             }
         } else {
-            frame_start[0] ^= (uint8_t)(fuzz_pilot & 0xFF);
+            frame_start[0] ^= (uint8_t)fuzzer_pilot_bits(pilot, 8);
         }
     } else {
         if (payload_start < frame_max) {
             size_t data_present_len = frame_max - payload_start;
-            size_t num_flips = 1 + (fuzz_pilot % 3);
-            fuzz_pilot >>= 2;
+            size_t num_flips = 1 + (size_t)fuzzer_pilot_range(pilot, 3);
             for (size_t i = 0; i < num_flips; i++) {
-                if (data_present_len == 0) break;
-                size_t flip_idx = fuzz_pilot % data_present_len;
-                 if (icid_ctx == NULL && fuzz_pilot == 0) {
-                    fuzz_pilot = frame_start[0];
-                } else if (fuzz_pilot == 0 && icid_ctx != NULL) {
-                     fuzz_pilot = picoquic_test_random(&icid_ctx->random_context);
-                }
-                payload_start[flip_idx] ^= (uint8_t)(fuzz_pilot & 0xFF);
-                fuzz_pilot >>= 8;
+                size_t flip_idx = (size_t)fuzzer_pilot_range(pilot, data_present_len);
+                payload_start[flip_idx] ^= (uint8_t)fuzzer_pilot_bits(pilot, 8);
             }
         } else {
-             frame_start[0] ^= (uint8_t)(fuzz_pilot & 0xFF);
+             frame_start[0] ^= (uint8_t)fuzzer_pilot_bits(pilot, 8);
         }
     }
 }
@@ -1063,7 +1113,7 @@ void challenge_frame_fuzzer(uint64_t fuzz_pilot, uint8_t* bytes, uint8_t* bytes_
 }
 
 /* padding_frame_fuzzer: MODIFIED for Handshake Done tracking */
-void padding_frame_fuzzer(picoquic_cnx_t* cnx, fuzzer_icid_ctx_t* icid_ctx, uint64_t fuzz_pilot, uint8_t* bytes, uint8_t* bytes_max)
+void padding_frame_fuzzer(picoquic_cnx_t* cnx, fuzzer_icid_ctx_t* icid_ctx, fuzzer_pilot_t* pilot, uint8_t* bytes, uint8_t* bytes_max)
 {
     size_t l = bytes_max - bytes;
     if (l == 0) return;
@@ -1073,31 +1123,22 @@ void padding_frame_fuzzer(picoquic_cnx_t* cnx, fuzzer_icid_ctx_t* icid_ctx, uint
         icid_ctx->handshake_done_sent_by_server = 1;
     }
 
-    int action_choice = fuzz_pilot % 3;
-    fuzz_pilot >>= 2;
+    int action_choice = (int)fuzzer_pilot_range(pilot, 3);
 
     if (action_choice == 0 && bytes[0] == picoquic_frame_type_padding && l > 1) {
         for (uint8_t* p = bytes + 1; p < bytes_max; p++) {
-            if (fuzz_pilot == 0 && icid_ctx != NULL) {
-                 fuzz_pilot = picoquic_test_random(&icid_ctx->random_context);
-            } else if (fuzz_pilot == 0 && icid_ctx == NULL) {
-                 fuzz_pilot = bytes[0] ^ 0xFF; /* Basic replenishment if no context */
-            }
-            if ((fuzz_pilot & 0x03) == 0) {
-                *p = (uint8_t)((fuzz_pilot >> 2) % 255) + 1;
+            if (fuzzer_pilot_bits(pilot, 2) == 0) {
+                *p = (uint8_t)fuzzer_pilot_range(pilot, 255) + 1;
             }
-            fuzz_pilot >>= 4;
         }
     } else if (action_choice == 1) {
         int fuzz_type_decision = 1;
         if (l > 1) {
-            fuzz_type_decision = (fuzz_pilot & 7) == 0;
-            fuzz_pilot >>= 3;
+            fuzz_type_decision = fuzzer_pilot_bits(pilot, 3) == 0;
         }
 
         if (fuzz_type_decision) {
-            int flip = fuzz_pilot & 1;
-            fuzz_pilot >>=1;
+            int flip = (int)fuzzer_pilot_bits(pilot, 1);
 
             switch (bytes[0]) {
             case picoquic_frame_type_padding:
@@ -1110,7 +1151,7 @@ void padding_frame_fuzzer(picoquic_cnx_t* cnx, fuzzer_icid_ctx_t* icid_ctx, uint
                 bytes[0] = (flip) ? picoquic_frame_type_ping : picoquic_frame_type_padding;
                 break;
             default:
-                bytes[0] ^= (uint8_t)(fuzz_pilot & 0xFF);
+                bytes[0] ^= (uint8_t)fuzzer_pilot_bits(pilot, 8);
                 break;
             }
         }
@@ -1137,14 +1178,13 @@ void padding_frame_fuzzer(picoquic_cnx_t* cnx, fuzzer_icid_ctx_t* icid_ctx, uint
             size_t x_m = insert_table_size;
             do {
                 if (x_m == 0) { x_i = 0; break;} /* Avoid modulo by zero if table is empty or l is too small for all entries */
-                x_i = fuzz_pilot % x_m;
+                x_i = (size_t)fuzzer_pilot_range(pilot, x_m);
                 x_m = x_i;
             } while (x_i > 0 && insert_table[x_i].i_count > l);
 
             if(insert_table[x_i].i_count <= l) { /* Ensure selected frame fits */
                 bytes[0] = insert_table[x_i].i_type;
-                fuzz_pilot >>= 4;
-                varint_frame_fuzzer(fuzz_pilot, bytes, bytes_max, insert_table[x_i].i_count);
+                varint_frame_fuzzer(fuzzer_pilot_word(pilot), bytes, bytes_max, insert_table[x_i].i_count);
             }
         }
     }
@@ -1555,14 +1595,14 @@ void path_abandon_frame_fuzzer(uint64_t fuzz_pilot, uint8_t* frame_start, uint8_
     }
 }
 
-void crypto_frame_fuzzer_logic(uint64_t fuzz_pilot, uint8_t* frame_start, uint8_t* frame_max, fuzzer_ctx_t* ctx, fuzzer_icid_ctx_t* icid_ctx)
+void crypto_frame_fuzzer_logic(fuzzer_pilot_t* pilot, uint8_t* frame_start, uint8_t* frame_max, fuzzer_ctx_t* ctx, fuzzer_icid_ctx_t* icid_ctx)
 {
     uint8_t* p = frame_start;
     int specific_fuzz_applied = 0;
 
     p = (uint8_t*)picoquic_frames_varint_skip(p, frame_max);
     if (p == NULL || p >= frame_max) {
-        default_frame_fuzzer(fuzz_pilot, frame_start, frame_max);
+        default_frame_fuzzer(fuzzer_pilot_word(pilot), frame_start, frame_max);
         return;
     }
 
@@ -1570,7 +1610,7 @@ void crypto_frame_fuzzer_logic(uint64_t fuzz_pilot, uint8_t* frame_start, uint8_
     uint64_t original_offset;
     uint8_t* offset_end = (uint8_t*)picoquic_frames_varint_decode(offset_start, frame_max, &original_offset);
     if (offset_end == NULL || offset_start == offset_end) {
-        default_frame_fuzzer(fuzz_pilot, frame_start, frame_max);
+        default_frame_fuzzer(fuzzer_pilot_word(pilot), frame_start, frame_max);
         return;
     }
 
@@ -1578,7 +1618,7 @@ void crypto_frame_fuzzer_logic(uint64_t fuzz_pilot, uint8_t* frame_start, uint8_
     uint64_t original_length;
     uint8_t* length_end = (uint8_t*)picoquic_frames_varint_decode(length_start, frame_max, &original_length);
     if (length_end == NULL || length_start == length_end) {
-        default_frame_fuzzer(fuzz_pilot, frame_start, frame_max);
+        default_frame_fuzzer(fuzzer_pilot_word(pilot), frame_start, frame_max);
         return;
     }
 
@@ -1588,15 +1628,13 @@ void crypto_frame_fuzzer_logic(uint64_t fuzz_pilot, uint8_t* frame_start, uint8_
         data_present_len = frame_max - data_start;
     }
 
-    if ((fuzz_pilot & 0x01) == 0) {
-        fuzz_pilot >>= 1;
-        int choice = fuzz_pilot % 4;
-        fuzz_pilot >>= 2;
+    if (fuzzer_pilot_bits(pilot, 1) == 0) {
+        int choice = (int)fuzzer_pilot_bits(pilot, 2);
 
         switch (choice) {
         case 0:
             if (offset_start && offset_end) {
-                uint64_t new_offset_val = (fuzz_pilot & 1) ? 0x3FFFFFFFFFFFFFFF : 0;
+                uint64_t new_offset_val = fuzzer_pilot_bits(pilot, 1) ? 0x3FFFFFFFFFFFFFFF : 0;
                 if (encode_and_overwrite_varint(offset_start, offset_end, frame_max, new_offset_val)) {
                     specific_fuzz_applied = 1;
                 }
@@ -1604,7 +1642,7 @@ void crypto_frame_fuzzer_logic(uint64_t fuzz_pilot, uint8_t* frame_start, uint8_
             break;
         case 1:
             if (length_start && length_end) {
-                uint64_t new_length_val = (fuzz_pilot & 1) ? 0x3FFFFFFFFFFFFFFF : 65536;
+                uint64_t new_length_val = fuzzer_pilot_bits(pilot, 1) ? 0x3FFFFFFFFFFFFFFF : 65536;
                 if (encode_and_overwrite_varint(length_start, length_end, frame_max, new_length_val)) {
                     specific_fuzz_applied = 1;
                 }
@@ -1619,18 +1657,10 @@ void crypto_frame_fuzzer_logic(uint64_t fuzz_pilot, uint8_t* frame_start, uint8_
             break;
         case 3:
             if (data_present_len > 0) {
-                size_t num_flips = 1 + (fuzz_pilot % 3);
-                fuzz_pilot >>= 2;
+                size_t num_flips = 1 + (size_t)fuzzer_pilot_range(pilot, 3);
                 for (size_t i = 0; i < num_flips; i++) {
-                    if (data_present_len == 0) break;
-                    size_t flip_idx = fuzz_pilot % data_present_len;
-                    if (icid_ctx == NULL && fuzz_pilot == 0) {
-                        fuzz_pilot = frame_start[0];
-                    } else if (fuzz_pilot == 0 && icid_ctx != NULL) {
-                         fuzz_pilot = picoquic_test_random(&icid_ctx->random_context);
-                    }
-                    data_start[flip_idx] ^= (uint8_t)(fuzz_pilot & 0xFF);
-                    fuzz_pilot >>= 8;
+                    size_t flip_idx = (size_t)fuzzer_pilot_range(pilot, data_present_len);
+                    data_start[flip_idx] ^= (uint8_t)fuzzer_pilot_bits(pilot, 8);
                 }
                 specific_fuzz_applied = 1;
             }
@@ -1639,7 +1669,7 @@ void crypto_frame_fuzzer_logic(uint64_t fuzz_pilot, uint8_t* frame_start, uint8_
     }
 
     if (!specific_fuzz_applied) {
-        default_frame_fuzzer(fuzz_pilot, frame_start, frame_max);
+        default_frame_fuzzer(fuzzer_pilot_word(pilot), frame_start, frame_max);
     }
 }
 
@@ -1777,181 +1807,411 @@ void max_data_fuzzer(uint64_t fuzz_pilot, uint8_t* frame_start, uint8_t* frame_m
     }
 }
 
-/* frame_header_fuzzer: MODIFIED signature */
-int frame_header_fuzzer(fuzzer_ctx_t* f_ctx, picoquic_cnx_t* cnx, fuzzer_icid_ctx_t* icid_ctx, uint64_t fuzz_pilot,
-    uint8_t* bytes, size_t bytes_max, size_t length, size_t header_length)
+/* Registration of the frame fuzzers.
+ * Each entry maps a range of frame types to a fuzzer. All fuzzers are
+ * called through the same signature, using small adapters for the
+ * fuzzers that do not need the contexts. The fuzzers that make many
+ * choices draw from the pilot stream, the others receive a fresh 64 bit
+ * pilot value. To add a fuzzer, add an entry
+ * and increase FUZZER_NB_FRAME_FUZZERS.
+ */
+typedef void (*fuzzer_frame_fn)(fuzzer_ctx_t* ctx, picoquic_cnx_t* cnx, fuzzer_icid_ctx_t* icid_ctx,
+    fuzzer_pilot_t* pilot, uint8_t* frame_start, uint8_t* frame_max);
+
+typedef struct st_fuzzer_frame_fuzzer_t {
+    char const* name;
+    uint64_t frame_type_min;
+    uint64_t frame_type_max;
+    fuzzer_frame_fn fuzz_fn;
+} fuzzer_frame_fuzzer_t;
+
+#define FUZZER_FRAME_ADAPTER(adapter_fn, fuzzer_fn) \
+    static void adapter_fn(fuzzer_ctx_t* ctx, picoquic_cnx_t* cnx, fuzzer_icid_ctx_t* icid_ctx, \
+        fuzzer_pilot_t* pilot, uint8_t* frame_start, uint8_t* frame_max) \
+    { \
+        (void)ctx; (void)cnx; (void)icid_ctx; \
+        fuzzer_fn(fuzzer_pilot_word(pilot), frame_start, frame_max); \
+    }
+
+#define FUZZER_VARINT_ADAPTER(adapter_fn, nb_varints) \
+    static void adapter_fn(fuzzer_ctx_t* ctx, picoquic_cnx_t* cnx, fuzzer_icid_ctx_t* icid_ctx, \
+        fuzzer_pilot_t* pilot, uint8_t* frame_start, uint8_t* frame_max) \
+    { \
+        (void)ctx; (void)cnx; (void)icid_ctx; \
+        varint_frame_fuzzer(fuzzer_pilot_word(pilot), frame_start, frame_max, nb_varints); \
+    }
+
+FUZZER_FRAME_ADAPTER(fuzz_default_frame, default_frame_fuzzer)
+FUZZER_FRAME_ADAPTER(fuzz_stream_frame, stream_frame_fuzzer)
+FUZZER_FRAME_ADAPTER(fuzz_ack_frame, ack_frame_fuzzer)
+FUZZER_FRAME_ADAPTER(fuzz_reset_stream_frame, reset_stream_frame_fuzzer)
+FUZZER_FRAME_ADAPTER(fuzz_stop_sending_frame, stop_sending_frame_fuzzer)
+FUZZER_FRAME_ADAPTER(fuzz_new_token_frame, new_token_frame_fuzzer)
+FUZZER_FRAME_ADAPTER(fuzz_max_stream_data_frame, max_stream_data_frame_fuzzer)
+FUZZER_FRAME_ADAPTER(fuzz_max_streams_frame, max_streams_frame_fuzzer)
+FUZZER_FRAME_ADAPTER(fuzz_retire_connection_id_frame, retire_connection_id_frame_fuzzer)
+FUZZER_FRAME_ADAPTER(fuzz_challenge_frame, challenge_frame_fuzzer)
+FUZZER_FRAME_ADAPTER(fuzz_connection_close_frame, connection_close_frame_fuzzer)
+FUZZER_FRAME_ADAPTER(fuzz_ack_frequency_frame, ack_frequency_frame_fuzzer)
+FUZZER_FRAME_ADAPTER(fuzz_path_abandon_frame, path_abandon_frame_fuzzer)
+FUZZER_FRAME_ADAPTER(fuzz_path_id_sequence_frame, path_id_sequence_frame_fuzzer)
+FUZZER_VARINT_ADAPTER(fuzz_varint2_frame, 2)
+FUZZER_VARINT_ADAPTER(fuzz_varint3_frame, 3)
+FUZZER_VARINT_ADAPTER(fuzz_varint5_frame, 5)
+
+static void fuzz_padding_frame(fuzzer_ctx_t* ctx, picoquic_cnx_t* cnx, fuzzer_icid_ctx_t* icid_ctx,
+    fuzzer_pilot_t* pilot, uint8_t* frame_start, uint8_t* frame_max)
 {
-    uint8_t* frame_head[FUZZER_MAX_NB_FRAMES];
-    uint8_t* frame_next[FUZZER_MAX_NB_FRAMES];
-    uint8_t* last_byte = bytes + bytes_max;
-    size_t nb_frames = 0;
-    int was_fuzzed = 1;
+    (void)ctx;
+    padding_frame_fuzzer(cnx, icid_ctx, pilot, frame_start, frame_max);
+}
+
+static void fuzz_crypto_frame(fuzzer_ctx_t* ctx, picoquic_cnx_t* cnx, fuzzer_icid_ctx_t* icid_ctx,
+    fuzzer_pilot_t* pilot, uint8_t* frame_start, uint8_t* frame_max)
+{
+    (void)cnx;
+    crypto_frame_fuzzer_logic(pilot, frame_start, frame_max, ctx, icid_ctx);
+}
+
+static void fuzz_max_data_frame(fuzzer_ctx_t* ctx, picoquic_cnx_t* cnx, fuzzer_icid_ctx_t* icid_ctx,
+    fuzzer_pilot_t* pilot, uint8_t* frame_start, uint8_t* frame_max)
+{
+    (void)cnx;
+    max_data_fuzzer(fuzzer_pilot_word(pilot), frame_start, frame_max, ctx, icid_ctx);
+}
+
+static void fuzz_new_connection_id_frame(fuzzer_ctx_t* ctx, picoquic_cnx_t* cnx, fuzzer_icid_ctx_t* icid_ctx,
+    fuzzer_pilot_t* pilot, uint8_t* frame_start, uint8_t* frame_max)
+{
+    (void)ctx; (void)cnx;
+    new_connection_id_frame_fuzzer_logic(fuzzer_pilot_word(pilot), frame_start, frame_max, icid_ctx);
+}
 
-    bytes += header_length;
+static void fuzz_datagram_frame(fuzzer_ctx_t* ctx, picoquic_cnx_t* cnx, fuzzer_icid_ctx_t* icid_ctx,
+    fuzzer_pilot_t* pilot, uint8_t* frame_start, uint8_t* frame_max)
+{
+    (void)cnx;
+    datagram_frame_fuzzer(ctx, icid_ctx, pilot, frame_start, frame_max);
+}
 
-    while (bytes != NULL && bytes < last_byte && nb_frames < FUZZER_MAX_NB_FRAMES) {
-        size_t consumed = 0;
-        int is_pure_ack = 1;
-        frame_head[nb_frames] = bytes;
-        if (picoquic_skip_frame(bytes, (size_t)(last_byte - bytes), &consumed, &is_pure_ack) == 0) {
-            bytes += consumed;
-            frame_next[nb_frames] = bytes;
-            nb_frames++;
+static const fuzzer_frame_fuzzer_t fuzzer_frame_fuzzers[FUZZER_NB_FRAME_FUZZERS] = {
+    { "padding", picoquic_frame_type_padding, picoquic_frame_type_padding, fuzz_padding_frame },
+    { "ping", picoquic_frame_type_ping, picoquic_frame_type_ping, fuzz_padding_frame },
+    { "ack", picoquic_frame_type_ack, picoquic_frame_type_ack_ecn, fuzz_ack_frame },
+    { "reset_stream", picoquic_frame_type_reset_stream, picoquic_frame_type_reset_stream, fuzz_reset_stream_frame },
+    { "stop_sending", picoquic_frame_type_stop_sending, picoquic_frame_type_stop_sending, fuzz_stop_sending_frame },
+    { "crypto", picoquic_frame_type_crypto_hs, picoquic_frame_type_crypto_hs, fuzz_crypto_frame },
+    { "new_token", picoquic_frame_type_new_token, picoquic_frame_type_new_token, fuzz_new_token_frame },
+    { "stream", picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max, fuzz_stream_frame },
+    { "max_data", picoquic_frame_type_max_data, picoquic_frame_type_max_data, fuzz_max_data_frame },
+    { "max_stream_data", picoquic_frame_type_max_stream_data, picoquic_frame_type_max_stream_data, fuzz_max_stream_data_frame },
+    { "max_streams", picoquic_frame_type_max_streams_bidir, picoquic_frame_type_max_streams_unidir, fuzz_max_streams_frame },
+    { "data_blocked", picoquic_frame_type_data_blocked, picoquic_frame_type_data_blocked, fuzz_varint2_frame },
+    { "stream_data_blocked", picoquic_frame_type_stream_data_blocked, picoquic_frame_type_stream_data_blocked, fuzz_varint3_frame },
+    { "streams_blocked", picoquic_frame_type_streams_blocked_bidir, picoquic_frame_type_streams_blocked_unidir, fuzz_varint2_frame },
+    { "new_connection_id", picoquic_frame_type_new_connection_id, picoquic_frame_type_new_connection_id, fuzz_new_connection_id_frame },
+    { "retire_connection_id", picoquic_frame_type_retire_connection_id, picoquic_frame_type_retire_connection_id, fuzz_retire_connection_id_frame },
+    { "path_challenge", picoquic_frame_type_path_challenge, picoquic_frame_type_path_response, fuzz_challenge_frame },
+    { "connection_close", picoquic_frame_type_connection_close, picoquic_frame_type_application_close, fuzz_connection_close_frame },
+    { "handshake_done", picoquic_frame_type_handshake_done, picoquic_frame_type_handshake_done, fuzz_padding_frame },
+    { "datagram", picoquic_frame_type_datagram, picoquic_frame_type_datagram_l, fuzz_datagram_frame },
+    { "ack_frequency", picoquic_frame_type_ack_frequency, picoquic_frame_type_ack_frequency, fuzz_ack_frequency_frame },
+    { "time_stamp", picoquic_frame_type_time_stamp, picoquic_frame_type_time_stamp, fuzz_varint2_frame },
+    { "path_abandon", picoquic_frame_type_path_abandon, picoquic_frame_type_path_abandon, fuzz_path_abandon_frame },
+    { "path_available", picoquic_frame_type_path_available, picoquic_frame_type_path_available, fuzz_path_id_sequence_frame },
+    { "path_backup", picoquic_frame_type_path_backup, picoquic_frame_type_path_backup, fuzz_path_id_sequence_frame },
+    { "paths_blocked", picoquic_frame_type_paths_blocked, picoquic_frame_type_paths_blocked, fuzz_varint2_frame },
+    { "bdp", picoquic_frame_type_bdp, picoquic_frame_type_bdp, fuzz_varint5_frame },
+    { "default", UINT64_MAX, 0, fuzz_default_frame }
+};
+
+/* Set the default weights, and map the single byte frame types to
+ * their fuzzer, so that the common frames are dispatched with a
+ * single lookup.
+ */
+void fuzzer_frame_fuzzers_init(fuzzer_ctx_t* ctx)
+{
+    for (size_t i = 0; i < FUZZER_NB_FRAME_FUZZERS; i++) {
+        ctx->frame_weight[i] = 1;
+        ctx->frame_hits[i] = 0;
+    }
+    ctx->frame_weights_set = 0;
+    for (uint64_t frame_type = 0; frame_type < FUZZER_FRAME_FUZZER_MAP_SIZE; frame_type++) {
+        ctx->frame_fuzzer_map[frame_type] = FUZZER_FRAME_FUZZER_DEFAULT;
+        for (size_t i = 0; i < FUZZER_FRAME_FUZZER_DEFAULT; i++) {
+            if (frame_type >= fuzzer_frame_fuzzers[i].frame_type_min && frame_type <= fuzzer_frame_fuzzers[i].frame_type_max) {
+                ctx->frame_fuzzer_map[frame_type] = (uint8_t)i;
+                break;
+            }
         }
-        else {
-            frame_next[nb_frames] = last_byte;
-            bytes = NULL;
+    }
+}
+
+size_t fuzzer_frame_fuzzer_find(fuzzer_ctx_t* ctx, uint64_t frame_type)
+{
+    size_t fuzzer_id = FUZZER_FRAME_FUZZER_DEFAULT;
+
+    if (frame_type < FUZZER_FRAME_FUZZER_MAP_SIZE) {
+        fuzzer_id = ctx->frame_fuzzer_map[frame_type];
+    }
+    else {
+        for (size_t i = 0; i < FUZZER_FRAME_FUZZER_DEFAULT; i++) {
+            if (frame_type >= fuzzer_frame_fuzzers[i].frame_type_min && frame_type <= fuzzer_frame_fuzzers[i].frame_type_max) {
+                fuzzer_id = i;
+                break;
+            }
         }
     }
+    return fuzzer_id;
+}
 
-    if (nb_frames > 0) {
-        size_t fuzzed_frame_idx = (size_t)(fuzz_pilot % nb_frames);
-        uint8_t* frame_byte = frame_head[fuzzed_frame_idx];
-        uint8_t* frame_max = frame_next[fuzzed_frame_idx];
+char const* fuzzer_frame_fuzzer_name(size_t fuzzer_id)
+{
+    return (fuzzer_id < FUZZER_NB_FRAME_FUZZERS) ? fuzzer_frame_fuzzers[fuzzer_id].name : NULL;
+}
 
-        fuzz_pilot >>= 5;
+int fuzzer_set_frame_weight(fuzzer_ctx_t* ctx, char const* name, uint32_t weight)
+{
+    int ret = -1;
 
-        /* HANDSHAKE_DONE tracking moved here */
-        if (cnx != NULL && !picoquic_is_client(cnx) && icid_ctx != NULL && *frame_byte == picoquic_frame_type_handshake_done) {
-            icid_ctx->handshake_done_sent_by_server = 1;
+    for (size_t i = 0; i < FUZZER_NB_FRAME_FUZZERS; i++) {
+        if (strcmp(name, fuzzer_frame_fuzzers[i].name) == 0) {
+            ctx->frame_weight[i] = weight;
+            ctx->frame_weights_set = 1;
+            ret = 0;
+            break;
         }
+    }
+    return ret;
+}
+
+/* Load the frame weights from a file. Each line contains the name of
+ * a frame fuzzer and its weight, e.g., "stream 10". Empty lines and
+ * lines starting with '#' are ignored.
+ */
+int fuzzer_load_frame_weights(fuzzer_ctx_t* ctx, char const* file_name)
+{
+    int ret = 0;
+    FILE* F = picoquic_file_open(file_name, "r");
+
+    if (F == NULL) {
+        fprintf(stderr, "Cannot open frame weights file: %s\n", file_name);
+        ret = -1;
+    }
+    else {
+        char line[256];
+        int line_number = 0;
+
+        while (ret == 0 && fgets(line, sizeof(line), F) != NULL) {
+            char name[64];
+            unsigned int weight;
+            int nb_fields;
 
-        if (PICOQUIC_IN_RANGE(*frame_byte, picoquic_frame_type_stream_range_min, picoquic_frame_type_stream_range_max)) {
-            stream_frame_fuzzer(fuzz_pilot, frame_byte, frame_max);
+            line_number++;
+            nb_fields = sscanf(line, "%63s %u", name, &weight);
+            if (nb_fields <= 0 || name[0] == '#') {
+                continue;
+            }
+            if (nb_fields != 2 || fuzzer_set_frame_weight(ctx, name, (uint32_t)weight) != 0) {
+                fprintf(stderr, "Invalid frame weight in %s, line %d: %s", file_name, line_number, line);
+                ret = -1;
+            }
         }
-        else {
-            switch (*frame_byte) {
-            case picoquic_frame_type_ack:
-            case picoquic_frame_type_ack_ecn:
-                ack_frame_fuzzer(fuzz_pilot, frame_byte, frame_max);
-                break;
-            case picoquic_frame_type_reset_stream:
-                reset_stream_frame_fuzzer(fuzz_pilot, frame_byte, frame_max);
-                break;
-            case picoquic_frame_type_stop_sending:
-                stop_sending_frame_fuzzer(fuzz_pilot, frame_byte, frame_max);
-                break;
-            case picoquic_frame_type_max_data:
-                max_data_fuzzer(fuzz_pilot, frame_byte, frame_max, f_ctx, icid_ctx);
-                break;
-            case picoquic_frame_type_max_stream_data:
-                max_stream_data_frame_fuzzer(fuzz_pilot, frame_byte, frame_max);
-                break;
-            case picoquic_frame_type_max_streams_bidir:
-            case picoquic_frame_type_max_streams_unidir:
-                max_streams_frame_fuzzer(fuzz_pilot, frame_byte, frame_max);
-                break;
-            case picoquic_frame_type_data_blocked:
-                varint_frame_fuzzer(fuzz_pilot, frame_byte, frame_max, 2);
-                break;
-            case picoquic_frame_type_stream_data_blocked:
-                varint_frame_fuzzer(fuzz_pilot, frame_byte, frame_max, 3);
-                break;
-            case picoquic_frame_type_streams_blocked_bidir:
-            case picoquic_frame_type_streams_blocked_unidir:
-                varint_frame_fuzzer(fuzz_pilot, frame_byte, frame_max, 2);
-                break;
-            case picoquic_frame_type_retire_connection_id:
-                retire_connection_id_frame_fuzzer(fuzz_pilot, frame_byte, frame_max);
-                break;
-            case picoquic_frame_type_connection_close:
-            case picoquic_frame_type_application_close:
-                connection_close_frame_fuzzer(fuzz_pilot, frame_byte, frame_max);
-                break;
-            case picoquic_frame_type_datagram:
-            case picoquic_frame_type_datagram_l:
-                datagram_frame_fuzzer(f_ctx, icid_ctx, fuzz_pilot, frame_byte, frame_max);
-                break;
-            case picoquic_frame_type_path_challenge:
-            case picoquic_frame_type_path_response:
-                challenge_frame_fuzzer(fuzz_pilot, frame_byte, frame_max);
-                break;
-            case picoquic_frame_type_crypto_hs:
-                crypto_frame_fuzzer_logic(fuzz_pilot, frame_byte, frame_max, f_ctx, icid_ctx);
-                break;
-            case picoquic_frame_type_padding:
-            case picoquic_frame_type_ping:
-            case picoquic_frame_type_handshake_done:
-                /* Pass cnx and icid_ctx for HANDSHAKE_DONE tracking and random replenishment */
-                padding_frame_fuzzer(cnx, icid_ctx, fuzz_pilot, frame_byte, frame_max);
-                break;
-            case picoquic_frame_type_new_connection_id:
-                new_connection_id_frame_fuzzer_logic(fuzz_pilot, frame_byte, frame_max, icid_ctx);
-                break;
-            case picoquic_frame_type_new_token:
-                new_token_frame_fuzzer(fuzz_pilot, frame_byte, frame_max);
-                break;
-            default: {
-                uint64_t frame_id64;
-                if (picoquic_frames_varint_decode(frame_byte, frame_max, &frame_id64) != NULL) {
-                    switch (frame_id64) {
-                    case picoquic_frame_type_ack_frequency:
-                        ack_frequency_frame_fuzzer(fuzz_pilot, frame_byte, frame_max);
-                        break;
-                    case picoquic_frame_type_time_stamp:
-                        varint_frame_fuzzer(fuzz_pilot, frame_byte, frame_max, 2);
-                        break;
-                    case picoquic_frame_type_path_abandon:
-                        path_abandon_frame_fuzzer(fuzz_pilot, frame_byte, frame_max);
-                        break;
-                    case picoquic_frame_type_path_available:
-                    case picoquic_frame_type_path_backup:
-                        path_id_sequence_frame_fuzzer(fuzz_pilot, frame_byte, frame_max);
-                        break;
-                    case picoquic_frame_type_paths_blocked:
-                        varint_frame_fuzzer(fuzz_pilot, frame_byte, frame_max, 2);
-                        break;
-                    case picoquic_frame_type_bdp:
-                        varint_frame_fuzzer(fuzz_pilot, frame_byte, frame_max, 5);
-                        break;
-                    default:
-                        default_frame_fuzzer(fuzz_pilot, frame_byte, frame_max);
-                        break;
-                    }
-                } else {
-                     default_frame_fuzzer(fuzz_pilot, frame_byte, frame_max);
+        (void)picoquic_file_close(F);
+    }
+    return ret;
+}
+
+/* Pick one of the indexed frames. If weights were set, the probability
+ * of picking a frame is proportional to the weight of its fuzzer.
+ */
+static size_t frame_header_fuzzer_pick(fuzzer_ctx_t* f_ctx, fuzzer_frame_index_t* frame_index, fuzzer_pilot_t* pilot)
+{
+    size_t fuzzed_frame_idx = SIZE_MAX;
+
+    if (!f_ctx->frame_weights_set) {
+        fuzzed_frame_idx = (size_t)fuzzer_pilot_range(pilot, frame_index->nb_frames);
+    }
+    else {
+        uint64_t total_weight = 0;
+
+        for (size_t i = 0; i < frame_index->nb_frames; i++) {
+            total_weight += f_ctx->frame_weight[fuzzer_frame_fuzzer_find(f_ctx, frame_index->frames[i].frame_type)];
+        }
+        if (total_weight > 0) {
+            uint64_t x = fuzzer_pilot_range(pilot, total_weight);
+
+            for (size_t i = 0; i < frame_index->nb_frames; i++) {
+                uint32_t weight = f_ctx->frame_weight[fuzzer_frame_fuzzer_find(f_ctx, frame_index->frames[i].frame_type)];
+                if (x < weight) {
+                    fuzzed_frame_idx = i;
+                    break;
                 }
-                break;
-            }
+                x -= weight;
             }
         }
-    } else {
-        was_fuzzed = 0;
+    }
+    return fuzzed_frame_idx;
+}
+
+/* frame_header_fuzzer: pick one of the indexed frames and fuzz it */
+int frame_header_fuzzer(fuzzer_ctx_t* f_ctx, picoquic_cnx_t* cnx, fuzzer_icid_ctx_t* icid_ctx, fuzzer_pilot_t* pilot,
+    uint8_t* bytes, fuzzer_frame_index_t* frame_index)
+{
+    size_t fuzzed_frame_idx = (frame_index->nb_frames > 0) ? frame_header_fuzzer_pick(f_ctx, frame_index, pilot) : SIZE_MAX;
+    int was_fuzzed = 0;
+
+    if (fuzzed_frame_idx != SIZE_MAX) {
+        fuzzer_frame_t* frame = &frame_index->frames[fuzzed_frame_idx];
+        uint8_t* frame_byte = bytes + frame->offset;
+        uint8_t* frame_max = frame_byte + frame->length;
+        size_t fuzzer_id = fuzzer_frame_fuzzer_find(f_ctx, frame->frame_type);
+
+        /* HANDSHAKE_DONE tracking moved here */
+        if (cnx != NULL && !picoquic_is_client(cnx) && icid_ctx != NULL && *frame_byte == picoquic_frame_type_handshake_done) {
+            icid_ctx->handshake_done_sent_by_server = 1;
+        }
+
+        f_ctx->frame_hits[fuzzer_id]++;
+        fuzzer_frame_fuzzers[fuzzer_id].fuzz_fn(f_ctx, cnx, icid_ctx, pilot, frame_byte, frame_max);
+        was_fuzzed = 1;
     }
 
     return was_fuzzed;
 }
 
-size_t length_non_padded(uint8_t* bytes, size_t length, size_t header_length)
+/* Build the index of the frames in the packet.
+ * The packet is parsed once, and the index is then used by all the
+ * fuzzing strategies, e.g., to find where the trailing padding starts,
+ * or to pick a frame to fuzz. Strategies that modify the packet update
+ * the index by parsing only the bytes that they inserted.
+ */
+int fuzzer_frame_index_init(fuzzer_frame_index_t* frame_index, size_t nb_frames_max)
+{
+    int ret = 0;
+
+    memset(frame_index, 0, sizeof(fuzzer_frame_index_t));
+    frame_index->frames = (fuzzer_frame_t*)malloc(2 * nb_frames_max * sizeof(fuzzer_frame_t));
+    if (frame_index->frames == NULL) {
+        ret = -1;
+    }
+    else {
+        frame_index->scratch = frame_index->frames + nb_frames_max;
+        frame_index->nb_frames_max = nb_frames_max;
+    }
+    return ret;
+}
+
+void fuzzer_frame_index_release(fuzzer_frame_index_t* frame_index)
+{
+    if (frame_index->frames != NULL) {
+        free(frame_index->frames);
+    }
+    memset(frame_index, 0, sizeof(fuzzer_frame_index_t));
+}
+
+static size_t fuzzer_frame_index_parse(fuzzer_frame_t* frames, size_t nb_frames_max, size_t* padding_start,
+    uint8_t* bytes, size_t start, size_t end)
 {
-    uint8_t* bytes_begin = bytes;
-    uint8_t* bytes_last = bytes + length;
-    uint8_t* final_pad = NULL;
-    bytes += header_length;
-    while (bytes != NULL && bytes < bytes_last) {
-        if (*bytes == picoquic_frame_type_padding) {
-            final_pad = bytes;
+    uint8_t* frame_start = bytes + start;
+    uint8_t* bytes_last = bytes + end;
+    size_t nb_frames = 0;
+
+    *padding_start = end;
+    while (frame_start != NULL && frame_start < bytes_last) {
+        uint8_t* frame_next = frame_start;
+        uint64_t frame_type = *frame_start;
+
+        if (*frame_start == picoquic_frame_type_padding) {
             do {
-                bytes++;
-            } while (bytes < bytes_last && *bytes == picoquic_frame_type_padding);
-            if (bytes < bytes_last) {
-                final_pad = NULL;
+                frame_next++;
+            } while (frame_next < bytes_last && *frame_next == picoquic_frame_type_padding);
+            if (frame_next >= bytes_last) {
+                *padding_start = frame_start - bytes;
             }
         }
-        else{
+        else {
             size_t consumed = 0;
             int is_pure_ack = 0;
 
-            if (picoquic_skip_frame(bytes, (size_t)(bytes_last - bytes), &consumed, &is_pure_ack) != 0) {
-                bytes = NULL;
+            if (picoquic_skip_frame(frame_start, (size_t)(bytes_last - frame_start), &consumed, &is_pure_ack) != 0) {
+                frame_next = NULL;
             }
             else {
-                bytes += consumed;
+                frame_next += consumed;
+                if (frame_type >= 0x40) {
+                    (void)picoquic_frames_varint_decode(frame_start, bytes_last, &frame_type);
+                }
             }
         }
+        if (frame_next != NULL && nb_frames < nb_frames_max) {
+            fuzzer_frame_t* frame = &frames[nb_frames++];
+            frame->offset = frame_start - bytes;
+            frame->length = frame_next - frame_start;
+            frame->frame_type = frame_type;
+        }
+        frame_start = frame_next;
     }
+    return nb_frames;
+}
 
-    return (final_pad == NULL) ? length : (final_pad - bytes_begin);
+/* The trailing padding is not sent if the packet is fuzzed, so it is
+ * left out of the index and is never picked by the frame header fuzzer.
+ */
+void fuzzer_frame_index_build(fuzzer_frame_index_t* frame_index, uint8_t* bytes, size_t length, size_t header_length)
+{
+    frame_index->nb_frames = fuzzer_frame_index_parse(frame_index->frames, frame_index->nb_frames_max,
+        &frame_index->padding_start, bytes, header_length, length);
+    fuzzer_frame_index_trim(frame_index, frame_index->padding_start);
+}
+
+/* Index the frames inserted between start and end, at the specified
+ * rank in the index. The frames after that rank are moved by the
+ * length of the insertion. If the index is full, the added frames are
+ * limited to the room left after the rank, and the last frames are
+ * dropped from the index.
+ */
+void fuzzer_frame_index_insert(fuzzer_frame_index_t* frame_index, uint8_t* bytes, size_t rank, size_t start, size_t end)
+{
+    size_t padding_start;
+    size_t room;
+    size_t nb_added;
+    size_t nb_kept;
+
+    if (rank > frame_index->nb_frames) {
+        rank = frame_index->nb_frames;
+    }
+    if (rank >= frame_index->nb_frames_max) {
+        /* No room for the added frames */
+        return;
+    }
+    room = frame_index->nb_frames_max - rank;
+    nb_added = fuzzer_frame_index_parse(frame_index->scratch, room, &padding_start, bytes, start, end);
+    if (nb_added > room) {
+        nb_added = room;
+    }
+    nb_kept = frame_index->nb_frames - rank;
+    if (nb_kept > room - nb_added) {
+        nb_kept = room - nb_added;
+    }
+    if (nb_kept > 0) {
+        memmove(&frame_index->frames[rank + nb_added], &frame_index->frames[rank], nb_kept * sizeof(fuzzer_frame_t));
+        for (size_t i = rank + nb_added; i < rank + nb_added + nb_kept; i++) {
+            frame_index->frames[i].offset += end - start;
+        }
+    }
+    if (nb_added > 0) {
+        memcpy(&frame_index->frames[rank], frame_index->scratch, nb_added * sizeof(fuzzer_frame_t));
+    }
+    frame_index->nb_frames = rank + nb_added + nb_kept;
+}
+
+/* Remove the frames that start at or after the offset */
+void fuzzer_frame_index_trim(fuzzer_frame_index_t* frame_index, size_t offset)
+{
+    while (frame_index->nb_frames > 0 && frame_index->frames[frame_index->nb_frames - 1].offset >= offset) {
+        frame_index->nb_frames--;
+    }
 }
 
 size_t version_negotiation_packet_fuzzer(uint64_t fuzz_pilot, uint8_t* bytes, size_t vn_header_len, size_t current_length, size_t bytes_max)
@@ -2230,19 +2490,101 @@ fuzzer_cnx_state_enum fuzzer_get_cnx_state(picoquic_cnx_t* cnx)
     return fuzz_cnx_state;
 }
 
+/* Wrap application data in a STREAM frame with explicit offset and length.
+ * Returns the length of the frame, or 0 if it does not fit.
+ */
+size_t fuzzer_stream_wrap(uint8_t* frame, size_t frame_max, uint64_t stream_id, uint64_t offset,
+    const uint8_t* data, size_t length)
+{
+    uint8_t* bytes = frame;
+    uint8_t* bytes_max = frame + frame_max;
+    size_t frame_length = 0;
+
+    if (frame_max > 0) {
+        *bytes++ = picoquic_frame_type_stream_range_min | 0x04 | 0x02; /* OFF and LEN bits */
+        if ((bytes = picoquic_frames_varint_encode(bytes, bytes_max, stream_id)) != NULL &&
+            (bytes = picoquic_frames_varint_encode(bytes, bytes_max, offset)) != NULL &&
+            (bytes = picoquic_frames_varint_encode(bytes, bytes_max, length)) != NULL &&
+            bytes + length <= bytes_max) {
+            memcpy(bytes, data, length);
+            frame_length = (bytes + length) - frame;
+        }
+    }
+    return frame_length;
+}
+
+/* Stream on which application layer data is injected, and the offset
+ * at which the peer expects the next bytes. The HTTP/3 control, QPACK
+ * encoder and QPACK decoder streams are the first three unidirectional
+ * streams opened by each side. Other data goes on the last request
+ * stream, which is client initiated and bidirectional.
+ */
+void fuzzer_app_stream(picoquic_cnx_t* cnx, fuzi_q_layer_enum layer, uint64_t* stream_id, uint64_t* offset)
+{
+    picoquic_stream_head_t* stream = NULL;
+
+    *stream_id = 0;
+    *offset = 0;
+    if (layer == fuzi_q_layer_h3_control || layer == fuzi_q_layer_qpack_encoder || layer == fuzi_q_layer_qpack_decoder) {
+        uint64_t rank = (layer == fuzi_q_layer_h3_control) ? 0 : ((layer == fuzi_q_layer_qpack_encoder) ? 1 : 2);
+
+        *stream_id = 4 * rank + 2 + (picoquic_is_client(cnx) ? 0 : 1);
+        stream = picoquic_find_stream(cnx, *stream_id);
+    }
+    else {
+        picoquic_stream_head_t* next = picoquic_first_stream(cnx);
+
+        while (next != NULL) {
+            if ((next->stream_id & 3) == 0 && (stream == NULL || next->stream_id > stream->stream_id)) {
+                stream = next;
+            }
+            next = picoquic_next_stream(next);
+        }
+        if (stream != NULL) {
+            *stream_id = stream->stream_id;
+        }
+    }
+    if (stream != NULL) {
+        *offset = stream->sent_offset;
+    }
+}
+
+/* Epoch of a packet, from the first byte. Long header packet types are
+ * numbered as in QUIC version 1. Retry packets are fuzzed separately.
+ */
+static fuzi_q_epoch_enum fuzzer_packet_epoch(const uint8_t* bytes)
+{
+    fuzi_q_epoch_enum epoch = fuzi_q_epoch_1rtt;
+
+    if ((bytes[0] & 0x80) != 0) {
+        switch ((bytes[0] >> 4) & 3) {
+        case 0:
+            epoch = fuzi_q_epoch_initial;
+            break;
+        case 1:
+            epoch = fuzi_q_epoch_0rtt;
+            break;
+        default:
+            epoch = fuzi_q_epoch_handshake;
+            break;
+        }
+    }
+    return epoch;
+}
+
 /* fuzi_q_fuzzer: MODIFIED for Handshake Interruption */
 uint32_t fuzi_q_fuzzer(void* fuzz_ctx_param, picoquic_cnx_t* cnx,
     uint8_t* bytes, size_t bytes_max, size_t length, size_t header_length)
 {
     fuzzer_ctx_t* ctx = (fuzzer_ctx_t*)fuzz_ctx_param;
     uint64_t current_time = (cnx != NULL && cnx->quic != NULL) ? picoquic_get_quic_time(cnx->quic) : 0;
-    fuzzer_icid_ctx_t* icid_ctx = (cnx != NULL) ? fuzzer_get_icid_ctx(ctx, &cnx->initial_cnxid, current_time) : NULL;
+    fuzzer_icid_ctx_t* icid_ctx = (cnx != NULL) ? fuzzer_get_cnx_icid_ctx(ctx, cnx, current_time) : NULL;
 
     if (icid_ctx == NULL) { /* Should ideally not happen if cnx is valid */
         return (uint32_t)length;
     }
 
-    uint64_t fuzz_pilot = picoquic_test_random(&icid_ctx->random_context);
+    fuzzer_pilot_t* pilot = &icid_ctx->pilot;
     fuzzer_cnx_state_enum fuzz_cnx_state = (cnx != NULL) ? fuzzer_get_cnx_state(cnx) : fuzzer_cnx_state_closing;
     uint32_t fuzzed_length = (uint32_t)length;
 
@@ -2271,8 +2613,7 @@ uint32_t fuzi_q_fuzzer(void* fuzz_ctx_param, picoquic_cnx_t* cnx,
         /* Assuming 'bytes + 5' is a safe upper bound based on 'length >= 5' */
         picoquic_frames_uint32_decode(bytes + 1, bytes + 5, &version_val);
         if (version_val == 0x00000000) {
-            if (!icid_ctx->already_fuzzed || ((fuzz_pilot & 0xf) <= 7)) {
-                fuzz_pilot >>=4;
+            if (!icid_ctx->already_fuzzed || fuzzer_pilot_bits(pilot, 1)) {
                 uint8_t dcid_len = 0;
             uint8_t scid_len = 0;
             size_t vn_header_len = 1 + 4;
@@ -2285,7 +2626,7 @@ uint32_t fuzi_q_fuzzer(void* fuzz_ctx_param, picoquic_cnx_t* cnx,
                     vn_header_len += 1 + scid_len;
                     if (vn_header_len <= length) {
                         if (vn_header_len < length) {
-                            fuzzed_length = (uint32_t)version_negotiation_packet_fuzzer(fuzz_pilot, bytes, vn_header_len, length, bytes_max);
+                            fuzzed_length = (uint32_t)version_negotiation_packet_fuzzer(fuzzer_pilot_word(pilot), bytes, vn_header_len, length, bytes_max);
                         }
                         if (icid_ctx->already_fuzzed == 0) {
                             icid_ctx->already_fuzzed = 1;
@@ -2316,9 +2657,8 @@ uint32_t fuzi_q_fuzzer(void* fuzz_ctx_param, picoquic_cnx_t* cnx,
             }
         }
         if (condition_met) {
-            if (!icid_ctx->already_fuzzed || ((fuzz_pilot & 0xf) <= 7)) {
-                fuzz_pilot >>=4;
-                fuzzed_length = (uint32_t)retry_packet_fuzzer(fuzz_pilot, bytes, length, bytes_max);
+            if (!icid_ctx->already_fuzzed || fuzzer_pilot_bits(pilot, 1)) {
+                fuzzed_length = (uint32_t)retry_packet_fuzzer(fuzzer_pilot_word(pilot), bytes, length, bytes_max);
             if (icid_ctx->already_fuzzed == 0) {
                 icid_ctx->already_fuzzed = 1;
                 ctx->nb_cnx_tried[icid_ctx->target_state] += 1;
@@ -2331,8 +2671,7 @@ uint32_t fuzi_q_fuzzer(void* fuzz_ctx_param, picoquic_cnx_t* cnx,
         return (uint32_t)length;
     }
 
-    int fuzz_again = ((fuzz_pilot & 0xf) <= 7);
-    fuzz_pilot >>= 4; /* Consume bits for fuzz_again for main packet fuzzing */
+    int fuzz_again = (int)fuzzer_pilot_bits(pilot, 1);
 
     if (fuzz_cnx_state < 0 || fuzz_cnx_state >= fuzzer_cnx_state_max) {
         fuzz_cnx_state = fuzzer_cnx_state_closing;
@@ -2353,46 +2692,103 @@ uint32_t fuzi_q_fuzzer(void* fuzz_ctx_param, picoquic_cnx_t* cnx,
                 icid_ctx->wait_count[fuzz_cnx_state] >= icid_ctx->target_wait)) &&
             (!icid_ctx->already_fuzzed || fuzz_again)) {
 
-            uint64_t main_strategy_choice = fuzz_pilot & 0x0F; /* Now 4 bits for up to 16 strategies */
-            fuzz_pilot >>= 4; /* Consume these 4 bits */
+            uint64_t main_strategy_choice;
 
-            size_t final_pad = length_non_padded(bytes, length, header_length);
-            int fuzz_more = ((fuzz_pilot >> 8) & 1) > 0; /* This bit is now relative to already shifted pilot */
+            if (ctx->bandit.shared != NULL) {
+                /* Adaptive choice among the strategies, 16 bits */
+                main_strategy_choice = fuzzer_bandit_select(ctx, icid_ctx, fuzzer_pilot_bits(pilot, 16));
+            }
+            else {
+                main_strategy_choice = fuzzer_pilot_bits(pilot, 4); /* 4 bits for up to 16 strategies */
+            }
+
+            fuzzer_frame_index_t* frame_index = &ctx->frame_index;
+            size_t final_pad;
+            int fuzz_more = (int)fuzzer_pilot_bits(pilot, 1);
             int was_fuzzed = 0;
-            uint64_t sub_fuzzer_pilot = fuzz_pilot; /* Default for strategies not using list */
 
-            if (main_strategy_choice < 3) { /* Strategies 0, 1, 2: Inject from fuzi_q_frame_list */
-                size_t fuzz_frame_id = (size_t)((fuzz_pilot) % nb_fuzi_q_frame_list);
-                /* printf("Fuzzer selected frame for injection: %s (ID: %zu)\n", fuzi_q_frame_list[fuzz_frame_id].name, fuzz_frame_id); */
-                sub_fuzzer_pilot = fuzz_pilot >> 5; /* Consume fuzz_frame_id bits */
+            /* Parse the packet once. Strategies that modify it update the index. */
+            fuzzer_frame_index_build(frame_index, bytes, length, header_length);
+            final_pad = frame_index->padding_start;
+
+            if (main_strategy_choice < 3 && ctx->corpus.nb_entries > 0) { /* Strategies 0, 1, 2: Inject from the test frames */
+                const uint32_t* entry_ids = NULL;
+                size_t nb_ids = 0;
+                size_t fuzz_frame_id;
 
-                size_t len = fuzi_q_frame_list[fuzz_frame_id].len;
+                if (icid_ctx->alpn_view == fuzi_q_alpn_any && cnx != NULL) {
+                    icid_ctx->alpn_view = fuzi_q_alpn_from_name(cnx->alpn);
+                }
+                /* Frames added to the packet are drawn among those expected in this
+                 * packet type and connection state. Replacing the whole packet
+                 * draws from all the frames relevant to the application, so frames
+                 * that are not allowed are still tested. */
+                if (main_strategy_choice < 2) {
+                    nb_ids = fuzi_q_corpus_bucket(&ctx->corpus, (fuzi_q_alpn_enum)icid_ctx->alpn_view,
+                        fuzzer_packet_epoch(bytes), fuzz_cnx_state, &entry_ids);
+                }
+                else {
+                    nb_ids = fuzi_q_corpus_view(&ctx->corpus, (fuzi_q_alpn_enum)icid_ctx->alpn_view, &entry_ids);
+                }
+                if (nb_ids > 0) {
+                    fuzz_frame_id = entry_ids[fuzzer_pilot_range(pilot, nb_ids)];
+                }
+                else {
+                    fuzz_frame_id = (size_t)fuzzer_pilot_range(pilot, ctx->corpus.nb_entries);
+                }
+                const uint8_t* fuzz_frame = fuzi_q_corpus_frame(&ctx->corpus, fuzz_frame_id);
+                /* printf("Fuzzer selected frame for injection: %s (ID: %zu)\n", fuzi_q_corpus_name(&ctx->corpus, fuzz_frame_id), fuzz_frame_id); */
+
+                size_t len = ctx->corpus.entries[fuzz_frame_id].length;
+                uint8_t wrapped[PICOQUIC_MAX_PACKET_SIZE];
+
+                if (ctx->corpus.entries[fuzz_frame_id].layer != fuzi_q_layer_quic && cnx != NULL) {
+                    /* Deliver application layer data on the stream where the peer expects it */
+                    uint64_t stream_id;
+                    uint64_t stream_offset;
+                    size_t wrapped_len;
+
+                    fuzzer_app_stream(cnx, (fuzi_q_layer_enum)ctx->corpus.entries[fuzz_frame_id].layer, &stream_id, &stream_offset);
+                    wrapped_len = fuzzer_stream_wrap(wrapped, sizeof(wrapped), stream_id, stream_offset, fuzz_frame, len);
+                    if (wrapped_len > 0) {
+                        fuzz_frame = wrapped;
+                        len = wrapped_len;
+                    }
+                }
                 switch (main_strategy_choice) {
                 case 0: /* Add random frame at end */
                     if (final_pad + len <= bytes_max) {
-                        memcpy(&bytes[final_pad], fuzi_q_frame_list[fuzz_frame_id].val, len);
+                        memcpy(&bytes[final_pad], fuzz_frame, len);
+                        fuzzer_frame_index_trim(frame_index, final_pad);
+                        fuzzer_frame_index_insert(frame_index, bytes, frame_index->nb_frames, final_pad, final_pad + len);
                         final_pad += len; was_fuzzed++;
                     }
                     break;
                 case 1: /* Add random frame at beginning */
                      if (final_pad + len <= bytes_max && header_length + len <= final_pad) {
                         memmove(bytes + header_length + len, bytes + header_length, final_pad - header_length);
-                        memcpy(&bytes[header_length], fuzi_q_frame_list[fuzz_frame_id].val, len);
+                        memcpy(&bytes[header_length], fuzz_frame, len);
+                        fuzzer_frame_index_trim(frame_index, final_pad);
+                        fuzzer_frame_index_insert(frame_index, bytes, 0, header_length, header_length + len);
                         final_pad += len; was_fuzzed++;
                     } else if (header_length + len <= bytes_max) {
-                        memcpy(&bytes[header_length], fuzi_q_frame_list[fuzz_frame_id].val, len);
+                        memcpy(&bytes[header_length], fuzz_frame, len);
                         final_pad = header_length + len; was_fuzzed++;
+                        fuzzer_frame_index_build(frame_index, bytes, final_pad, header_length);
                     }
                     break;
                 case 2: /* Replace packet with random frame */
                     if (header_length + len <= bytes_max) {
-                        memcpy(&bytes[header_length], fuzi_q_frame_list[fuzz_frame_id].val, len);
+                        memcpy(&bytes[header_length], fuzz_frame, len);
                         final_pad = header_length + len; was_fuzzed++;
+                        fuzzer_frame_index_build(frame_index, bytes, final_pad, header_length);
                     }
                     break;
                 }
+                if (was_fuzzed) {
+                    fuzzer_entry_injected(ctx, icid_ctx, fuzz_frame_id);
+                }
             } else if (main_strategy_choice == 3) { /* Fill with PINGs */
-                sub_fuzzer_pilot = fuzz_pilot; /* Use remaining pilot for frame_header_fuzzer */
                 if (bytes_max > header_length) {
                     size_t current_pos = header_length;
                     size_t ping_count = 0;
@@ -2404,37 +2800,31 @@ uint32_t fuzi_q_fuzzer(void* fuzz_ctx_param, picoquic_cnx_t* cnx,
                     }
                     final_pad = current_pos;
                     if (ping_count > 0) was_fuzzed++;
+                    fuzzer_frame_index_build(frame_index, bytes, final_pad, header_length);
                 }
             } else if (main_strategy_choice == 4 && cnx != NULL && picoquic_is_client(cnx) &&
                        fuzzer_get_cnx_state(cnx) < fuzzer_cnx_state_ready && header_length + 1 <= bytes_max) {
                 /* Client sends HANDSHAKE_DONE */
-                sub_fuzzer_pilot = fuzz_pilot;
                 bytes[header_length] = picoquic_frame_type_handshake_done;
                 final_pad = header_length + 1;
                 was_fuzzed++;
+                fuzzer_frame_index_build(frame_index, bytes, final_pad, header_length);
             } else if (main_strategy_choice == 5 && cnx != NULL && !picoquic_is_client(cnx) &&
                        icid_ctx->handshake_done_sent_by_server == 1) {
                 /* Server sends CRYPTO after HANDSHAKE_DONE */
-                sub_fuzzer_pilot = fuzz_pilot;
-                size_t crypto_frame_idx = 0; /* Find a crypto frame */
-                int found_crypto = 0;
-                for (size_t i = 0; i < nb_fuzi_q_frame_list; i++) {
-                    if (fuzi_q_frame_list[i].val[0] == picoquic_frame_type_crypto_hs) { /* Assuming type is first byte */
-                        crypto_frame_idx = i;
-                        found_crypto = 1;
-                        break;
-                    }
-                }
-                if (found_crypto) {
-                    size_t len = fuzi_q_frame_list[crypto_frame_idx].len;
+                const uint32_t* crypto_ids = NULL;
+                size_t nb_crypto = fuzi_q_corpus_by_type(&ctx->corpus, picoquic_frame_type_crypto_hs, &crypto_ids);
+                if (nb_crypto > 0) {
+                    size_t crypto_frame_idx = crypto_ids[fuzzer_pilot_range(pilot, nb_crypto)];
+                    size_t len = ctx->corpus.entries[crypto_frame_idx].length;
                     if (header_length + len <= bytes_max) {
-                        memcpy(&bytes[header_length], fuzi_q_frame_list[crypto_frame_idx].val, len);
+                        memcpy(&bytes[header_length], fuzi_q_corpus_frame(&ctx->corpus, crypto_frame_idx), len);
                         final_pad = header_length + len;
                         was_fuzzed++;
+                        fuzzer_frame_index_build(frame_index, bytes, final_pad, header_length);
+                        fuzzer_entry_injected(ctx, icid_ctx, crypto_frame_idx);
                     }
                 }
-            } else { /* Other strategies or no specific action taken by main_strategy_choice */
-                 sub_fuzzer_pilot = fuzz_pilot; /* Use remaining pilot */
             }
 
             if (was_fuzzed) {
@@ -2442,6 +2832,8 @@ uint32_t fuzi_q_fuzzer(void* fuzz_ctx_param, picoquic_cnx_t* cnx,
                  if (final_pad < length) {
                      memset(&bytes[final_pad], 0, length - final_pad);
                  }
+                 /* The bytes after final_pad are not sent */
+                 fuzzer_frame_index_trim(frame_index, final_pad);
             } else {
                 fuzzed_length = (uint32_t)length;
             }
@@ -2449,17 +2841,17 @@ uint32_t fuzi_q_fuzzer(void* fuzz_ctx_param, picoquic_cnx_t* cnx,
             if (!was_fuzzed || fuzz_more) {
                 int fuzzed_by_header_fuzzer = 0;
                 if (final_pad > header_length) {
-                    fuzzed_by_header_fuzzer = frame_header_fuzzer(ctx, cnx, icid_ctx, sub_fuzzer_pilot, bytes, bytes_max, final_pad, header_length);
+                    fuzzed_by_header_fuzzer = frame_header_fuzzer(ctx, cnx, icid_ctx, pilot, bytes, frame_index);
                 }
                 if (!fuzzed_by_header_fuzzer && !was_fuzzed) {
-                    fuzzed_length = basic_packet_fuzzer(ctx, sub_fuzzer_pilot, bytes, bytes_max, length, header_length);
+                    fuzzed_length = basic_packet_fuzzer(ctx, fuzzer_pilot_word(pilot), bytes, bytes_max, length, header_length);
                 } else if (fuzzed_by_header_fuzzer) {
                      was_fuzzed = 1;
                      fuzzed_length = (uint32_t)final_pad;
                 }
             }
 
-            if (((fuzz_pilot >> 20) & 0x03) == 0) {
+            if (fuzzer_pilot_bits(pilot, 2) == 0) {
                 if (icid_ctx->new_cid_seq_no_available == 1) {
                     uint8_t retire_frame_buffer[24];
                     uint8_t* p_retire = retire_frame_buffer;
@@ -2492,7 +2884,7 @@ uint32_t fuzi_q_fuzzer(void* fuzz_ctx_param, picoquic_cnx_t* cnx,
         }
 
         if (ctx->parent != NULL) {
-            fuzi_q_mark_active(ctx->parent, &icid_ctx->icid, current_time, icid_ctx->already_fuzzed);
+            fuzi_q_mark_active(ctx->parent, &icid_ctx->icid, icid_ctx->icid_hash, current_time, icid_ctx->already_fuzzed);
         }
     }
     return fuzzed_length;
@@ -3978,9 +3978,15 @@ static uint8_t test_frame_ncid_cid_len_min[] = {
     0xA8,0xA9,0xAA,0xAB,0xAC,0xAD,0xAE,0xAF
 };
 
-#define FUZI_Q_ITEM(n, x) \
-    {                        \
-        n, x, sizeof(x),     \
+#define FUZI_Q_ITEM(n, x)                       \
+    {                                           \
+        n, x, sizeof(x), fuzi_q_layer_quic,     \
+    }
+
+/* Application layer test frames, see fuzi_q_layer_enum */
+#define FUZI_Q_LAYER_ITEM(n, x, l)              \
+    {                                           \
+        n, x, sizeof(x), l,                     \
     }
 
 /* Test Case: RETIRE_CONNECTION_ID with Sequence Number encoded non-canonically (value 1 as 2 bytes). */
@@ -5476,7 +5482,6 @@ fuzi_q_frames_t fuzi_q_frame_list[] = {
     FUZI_Q_ITEM("path_abandon_1", test_frame_type_path_abandon_1),
     FUZI_Q_ITEM("path_backup", test_frame_type_path_backup),
     FUZI_Q_ITEM("path_available", test_frame_type_path_available),
-    FUZI_Q_ITEM("path_backup", test_frame_type_path_backup),
     FUZI_Q_ITEM("path_blocked", test_frame_type_path_blocked),
     FUZI_Q_ITEM("bdp", test_frame_type_bdp),
     FUZI_Q_ITEM("bad_reset_stream_offset", test_frame_type_bad_reset_stream_offset),
@@ -5846,55 +5851,10 @@ fuzi_q_frames_t fuzi_q_frame_list[] = {
     FUZI_Q_ITEM("max_streams_uni_5_nc4", test_max_streams_uni_5_nc4),
     FUZI_Q_ITEM("max_streams_uni_5_nc8", test_max_streams_uni_5_nc8),
     /* RESET_STREAM Stream ID: Non-Canonical Varints */
-    FUZI_Q_ITEM("reset_stream_sid_0_nc2", test_reset_stream_sid_0_nc2),
-    FUZI_Q_ITEM("reset_stream_sid_0_nc4", test_reset_stream_sid_0_nc4),
-    FUZI_Q_ITEM("reset_stream_sid_0_nc8", test_reset_stream_sid_0_nc8),
-    FUZI_Q_ITEM("reset_stream_sid_1_nc2", test_reset_stream_sid_1_nc2),
-    FUZI_Q_ITEM("reset_stream_sid_1_nc4", test_reset_stream_sid_1_nc4),
-    FUZI_Q_ITEM("reset_stream_sid_1_nc8", test_reset_stream_sid_1_nc8),
-    FUZI_Q_ITEM("reset_stream_sid_5_nc2", test_reset_stream_sid_5_nc2),
-    FUZI_Q_ITEM("reset_stream_sid_5_nc4", test_reset_stream_sid_5_nc4),
-    FUZI_Q_ITEM("reset_stream_sid_5_nc8", test_reset_stream_sid_5_nc8),
     /* RESET_STREAM App Error Code: Non-Canonical Varints */
-    FUZI_Q_ITEM("reset_stream_err_0_nc2", test_reset_stream_err_0_nc2),
-    FUZI_Q_ITEM("reset_stream_err_0_nc4", test_reset_stream_err_0_nc4),
-    FUZI_Q_ITEM("reset_stream_err_0_nc8", test_reset_stream_err_0_nc8),
-    FUZI_Q_ITEM("reset_stream_err_1_nc2", test_reset_stream_err_1_nc2),
-    FUZI_Q_ITEM("reset_stream_err_1_nc4", test_reset_stream_err_1_nc4),
-    FUZI_Q_ITEM("reset_stream_err_1_nc8", test_reset_stream_err_1_nc8),
-    FUZI_Q_ITEM("reset_stream_err_5_nc2", test_reset_stream_err_5_nc2),
-    FUZI_Q_ITEM("reset_stream_err_5_nc4", test_reset_stream_err_5_nc4),
-    FUZI_Q_ITEM("reset_stream_err_5_nc8", test_reset_stream_err_5_nc8),
     /* RESET_STREAM Final Size: Non-Canonical Varints */
-    FUZI_Q_ITEM("reset_stream_final_0_nc2", test_reset_stream_final_0_nc2),
-    FUZI_Q_ITEM("reset_stream_final_0_nc4", test_reset_stream_final_0_nc4),
-    FUZI_Q_ITEM("reset_stream_final_0_nc8", test_reset_stream_final_0_nc8),
-    FUZI_Q_ITEM("reset_stream_final_1_nc2", test_reset_stream_final_1_nc2),
-    FUZI_Q_ITEM("reset_stream_final_1_nc4", test_reset_stream_final_1_nc4),
-    FUZI_Q_ITEM("reset_stream_final_1_nc8", test_reset_stream_final_1_nc8),
-    FUZI_Q_ITEM("reset_stream_final_5_nc2", test_reset_stream_final_5_nc2),
-    FUZI_Q_ITEM("reset_stream_final_5_nc4", test_reset_stream_final_5_nc4),
-    FUZI_Q_ITEM("reset_stream_final_5_nc8", test_reset_stream_final_5_nc8),
     /* STOP_SENDING Stream ID: Non-Canonical Varints */
-    FUZI_Q_ITEM("stop_sending_sid_0_nc2", test_stop_sending_sid_0_nc2),
-    FUZI_Q_ITEM("stop_sending_sid_0_nc4", test_stop_sending_sid_0_nc4),
-    FUZI_Q_ITEM("stop_sending_sid_0_nc8", test_stop_sending_sid_0_nc8),
-    FUZI_Q_ITEM("stop_sending_sid_1_nc2", test_stop_sending_sid_1_nc2),
-    FUZI_Q_ITEM("stop_sending_sid_1_nc4", test_stop_sending_sid_1_nc4),
-    FUZI_Q_ITEM("stop_sending_sid_1_nc8", test_stop_sending_sid_1_nc8),
-    FUZI_Q_ITEM("stop_sending_sid_5_nc2", test_stop_sending_sid_5_nc2),
-    FUZI_Q_ITEM("stop_sending_sid_5_nc4", test_stop_sending_sid_5_nc4),
-    FUZI_Q_ITEM("stop_sending_sid_5_nc8", test_stop_sending_sid_5_nc8),
     /* STOP_SENDING App Error Code: Non-Canonical Varints */
-    FUZI_Q_ITEM("stop_sending_err_0_nc2", test_stop_sending_err_0_nc2),
-    FUZI_Q_ITEM("stop_sending_err_0_nc4", test_stop_sending_err_0_nc4),
-    FUZI_Q_ITEM("stop_sending_err_0_nc8", test_stop_sending_err_0_nc8),
-    FUZI_Q_ITEM("stop_sending_err_1_nc2", test_stop_sending_err_1_nc2),
-    FUZI_Q_ITEM("stop_sending_err_1_nc4", test_stop_sending_err_1_nc4),
-    FUZI_Q_ITEM("stop_sending_err_1_nc8", test_stop_sending_err_1_nc8),
-    FUZI_Q_ITEM("stop_sending_err_5_nc2", test_stop_sending_err_5_nc2),
-    FUZI_Q_ITEM("stop_sending_err_5_nc4", test_stop_sending_err_5_nc4),
-    FUZI_Q_ITEM("stop_sending_err_5_nc8", test_stop_sending_err_5_nc8),
     /* DATA_BLOCKED Maximum Data: Non-Canonical Varints */
     FUZI_Q_ITEM("data_blocked_0_nc2", test_data_blocked_0_nc2),
     FUZI_Q_ITEM("data_blocked_0_nc4", test_data_blocked_0_nc4),
@@ -6093,59 +6053,56 @@ fuzi_q_frames_t fuzi_q_frame_list[] = {
     FUZI_Q_ITEM("datagram_len_non_canon", test_frame_datagram_len_non_canon),
     FUZI_Q_ITEM("datagram_very_large", test_frame_datagram_very_large),
     /* HTTP/3 Frame Payloads */
-    FUZI_Q_ITEM("h3_data_payload", test_h3_frame_data_payload),
-    FUZI_Q_ITEM("h3_headers_simple", test_h3_frame_headers_payload_simple),
-    FUZI_Q_ITEM("h3_settings_empty", test_h3_frame_settings_payload_empty),
-    FUZI_Q_ITEM("h3_settings_one", test_h3_frame_settings_payload_one_setting),
-    FUZI_Q_ITEM("h3_goaway", test_h3_frame_goaway_payload),
-    FUZI_Q_ITEM("h3_max_push_id", test_h3_frame_max_push_id_payload),
-    FUZI_Q_ITEM("h3_cancel_push", test_h3_frame_cancel_push_payload),
-    FUZI_Q_ITEM("h3_push_promise_simple", test_h3_frame_push_promise_payload_simple),
-    FUZI_Q_ITEM("h3_origin_val_0x0c", test_frame_h3_origin_val_0x0c),
-    FUZI_Q_ITEM("h3_priority_update_val_0xf0700", test_frame_h3_priority_update_val_0xf0700),
-    FUZI_Q_ITEM("h3_origin_payload", test_h3_frame_origin_payload),
-    FUZI_Q_ITEM("h3_priority_update_request_payload", test_h3_frame_priority_update_request_payload),
-    FUZI_Q_ITEM("h3_priority_update_placeholder_payload", test_h3_frame_priority_update_placeholder_payload),
+    FUZI_Q_LAYER_ITEM("h3_data_payload", test_h3_frame_data_payload, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("h3_headers_simple", test_h3_frame_headers_payload_simple, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("h3_settings_empty", test_h3_frame_settings_payload_empty, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_settings_one", test_h3_frame_settings_payload_one_setting, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_goaway", test_h3_frame_goaway_payload, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_max_push_id", test_h3_frame_max_push_id_payload, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_cancel_push", test_h3_frame_cancel_push_payload, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_push_promise_simple", test_h3_frame_push_promise_payload_simple, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("h3_origin_val_0x0c", test_frame_h3_origin_val_0x0c, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_priority_update_val_0xf0700", test_frame_h3_priority_update_val_0xf0700, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_origin_payload", test_h3_frame_origin_payload, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_priority_update_request_payload", test_h3_frame_priority_update_request_payload, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_priority_update_placeholder_payload", test_h3_frame_priority_update_placeholder_payload, fuzi_q_layer_h3_control),
     /* Additional H3 Frame Payload Variations */
-    FUZI_Q_ITEM("h3_data_empty", test_h3_frame_data_empty),
-    FUZI_Q_ITEM("h3_data_len_non_canon", test_h3_frame_data_len_non_canon),
-    FUZI_Q_ITEM("h3_settings_max_field_section_size_zero", test_h3_settings_max_field_section_size_zero),
-    FUZI_Q_ITEM("h3_settings_max_field_section_size_large", test_h3_settings_max_field_section_size_large),
-    FUZI_Q_ITEM("h3_settings_multiple", test_h3_settings_multiple),
-    FUZI_Q_ITEM("h3_settings_id_non_canon", test_h3_settings_id_non_canon),
-    FUZI_Q_ITEM("h3_settings_val_non_canon", test_h3_settings_val_non_canon),
-	FUZI_Q_ITEM("h3_origin_payload", test_h3_frame_origin_payload),
-    FUZI_Q_ITEM("h3_priority_update_placeholder_payload", test_h3_frame_priority_update_placeholder_payload),
-    FUZI_Q_ITEM("h3_priority_update_request_payload", test_h3_frame_priority_update_request_payload),
-    FUZI_Q_ITEM("h3_goaway_max_id", test_h3_goaway_max_id),
-    FUZI_Q_ITEM("h3_goaway_id_non_canon", test_h3_goaway_id_non_canon),
-    FUZI_Q_ITEM("h3_max_push_id_zero", test_h3_max_push_id_zero),
-    FUZI_Q_ITEM("h3_max_push_id_non_canon", test_h3_max_push_id_non_canon),
-    FUZI_Q_ITEM("h3_cancel_push_max_id", test_h3_cancel_push_max_id),
-    FUZI_Q_ITEM("h3_cancel_push_id_non_canon", test_h3_cancel_push_id_non_canon),
+    FUZI_Q_LAYER_ITEM("h3_data_empty", test_h3_frame_data_empty, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("h3_data_len_non_canon", test_h3_frame_data_len_non_canon, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("h3_settings_max_field_section_size_zero", test_h3_settings_max_field_section_size_zero, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_settings_max_field_section_size_large", test_h3_settings_max_field_section_size_large, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_settings_multiple", test_h3_settings_multiple, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_settings_id_non_canon", test_h3_settings_id_non_canon, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_settings_val_non_canon", test_h3_settings_val_non_canon, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_goaway_max_id", test_h3_goaway_max_id, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_goaway_id_non_canon", test_h3_goaway_id_non_canon, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_max_push_id_zero", test_h3_max_push_id_zero, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_max_push_id_non_canon", test_h3_max_push_id_non_canon, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_cancel_push_max_id", test_h3_cancel_push_max_id, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_cancel_push_id_non_canon", test_h3_cancel_push_id_non_canon, fuzi_q_layer_h3_control),
     /* DoQ Payload */
-    FUZI_Q_ITEM("doq_dns_query_payload", test_doq_dns_query_payload),
+    FUZI_Q_LAYER_ITEM("doq_dns_query_payload", test_doq_dns_query_payload, fuzi_q_layer_app),
 
     /* RFC 9113 (HTTP/2) Frame Types */
-    FUZI_Q_ITEM("h2_data_val_0x0", test_frame_h2_data_val_0x0),
-    FUZI_Q_ITEM("h2_headers_val_0x1", test_frame_h2_headers_val_0x1),
-    FUZI_Q_ITEM("h2_priority_val_0x2", test_frame_h2_priority_val_0x2),
-    FUZI_Q_ITEM("h2_rst_stream_val_0x3", test_frame_h2_rst_stream_val_0x3),
-    FUZI_Q_ITEM("h2_settings_val_0x4", test_frame_h2_settings_val_0x4),
-    FUZI_Q_ITEM("h2_push_promise_val_0x5", test_frame_h2_push_promise_val_0x5),
-    FUZI_Q_ITEM("h2_ping_val_0x6", test_frame_h2_ping_val_0x6),
-    FUZI_Q_ITEM("h2_goaway_val_0x7", test_frame_h2_goaway_val_0x7),
-    FUZI_Q_ITEM("h2_window_update_val_0x8", test_frame_h2_window_update_val_0x8),
-    FUZI_Q_ITEM("h2_continuation_val_0x9", test_frame_h2_continuation_val_0x9),
-    FUZI_Q_ITEM("h2_altsvc_val_0xa", test_frame_h2_altsvc_val_0xa),
+    FUZI_Q_LAYER_ITEM("h2_data_val_0x0", test_frame_h2_data_val_0x0, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("h2_headers_val_0x1", test_frame_h2_headers_val_0x1, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("h2_priority_val_0x2", test_frame_h2_priority_val_0x2, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("h2_rst_stream_val_0x3", test_frame_h2_rst_stream_val_0x3, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("h2_settings_val_0x4", test_frame_h2_settings_val_0x4, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("h2_push_promise_val_0x5", test_frame_h2_push_promise_val_0x5, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("h2_ping_val_0x6", test_frame_h2_ping_val_0x6, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("h2_goaway_val_0x7", test_frame_h2_goaway_val_0x7, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("h2_window_update_val_0x8", test_frame_h2_window_update_val_0x8, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("h2_continuation_val_0x9", test_frame_h2_continuation_val_0x9, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("h2_altsvc_val_0xa", test_frame_h2_altsvc_val_0xa, fuzi_q_layer_app),
 
     /* RFC 6455 (WebSocket) Frame Types */
-    FUZI_Q_ITEM("ws_continuation_val_0x0", test_frame_ws_continuation_val_0x0),
-    FUZI_Q_ITEM("ws_text_val_0x1", test_frame_ws_text_val_0x1),
-    FUZI_Q_ITEM("ws_binary_val_0x2", test_frame_ws_binary_val_0x2),
-    FUZI_Q_ITEM("ws_connection_close_val_0x8", test_frame_ws_connection_close_val_0x8),
-    FUZI_Q_ITEM("ws_ping_val_0x9", test_frame_ws_ping_val_0x9),
-    FUZI_Q_ITEM("ws_pong_val_0xa", test_frame_ws_pong_val_0xa),
+    FUZI_Q_LAYER_ITEM("ws_continuation_val_0x0", test_frame_ws_continuation_val_0x0, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_text_val_0x1", test_frame_ws_text_val_0x1, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_binary_val_0x2", test_frame_ws_binary_val_0x2, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_connection_close_val_0x8", test_frame_ws_connection_close_val_0x8, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_ping_val_0x9", test_frame_ws_ping_val_0x9, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_pong_val_0xa", test_frame_ws_pong_val_0xa, fuzi_q_layer_app),
 
     /* STREAM Frame Variations (RFC 9000, Section 19.8) */
     FUZI_Q_ITEM("stream_0x08_minimal", test_stream_0x08_minimal),
@@ -6274,21 +6231,21 @@ fuzi_q_frames_t fuzi_q_frame_list[] = {
     FUZI_Q_ITEM("test_padding_type_non_canonical_2byte", test_padding_type_non_canonical_2byte),
 
     /* RFC 9204 QPACK Instructions */
-    FUZI_Q_ITEM("qpack_enc_set_dynamic_table_capacity", test_qpack_enc_set_dynamic_table_capacity),
-    FUZI_Q_ITEM("qpack_enc_insert_with_name_ref", test_qpack_enc_insert_with_name_ref),
-    FUZI_Q_ITEM("qpack_enc_insert_without_name_ref", test_qpack_enc_insert_without_name_ref), /* Corresponds to "Insert with Literal Name" */
-    FUZI_Q_ITEM("qpack_enc_duplicate", test_qpack_enc_duplicate),
-    FUZI_Q_ITEM("qpack_dec_header_block_ack", test_qpack_dec_header_block_ack),
-    FUZI_Q_ITEM("qpack_dec_stream_cancellation", test_qpack_dec_stream_cancellation),
-    FUZI_Q_ITEM("qpack_dec_insert_count_increment", test_qpack_dec_insert_count_increment),
-    FUZI_Q_ITEM("qpack_enc_set_dynamic_table_capacity_alt", test_qpack_dec_set_dynamic_table_capacity),
+    FUZI_Q_LAYER_ITEM("qpack_enc_set_dynamic_table_capacity", test_qpack_enc_set_dynamic_table_capacity, fuzi_q_layer_qpack_encoder),
+    FUZI_Q_LAYER_ITEM("qpack_enc_insert_with_name_ref", test_qpack_enc_insert_with_name_ref, fuzi_q_layer_qpack_encoder),
+    FUZI_Q_LAYER_ITEM("qpack_enc_insert_without_name_ref", test_qpack_enc_insert_without_name_ref, fuzi_q_layer_qpack_encoder), /* Corresponds to "Insert with Literal Name" */
+    FUZI_Q_LAYER_ITEM("qpack_enc_duplicate", test_qpack_enc_duplicate, fuzi_q_layer_qpack_encoder),
+    FUZI_Q_LAYER_ITEM("qpack_dec_header_block_ack", test_qpack_dec_header_block_ack, fuzi_q_layer_qpack_decoder),
+    FUZI_Q_LAYER_ITEM("qpack_dec_stream_cancellation", test_qpack_dec_stream_cancellation, fuzi_q_layer_qpack_decoder),
+    FUZI_Q_LAYER_ITEM("qpack_dec_insert_count_increment", test_qpack_dec_insert_count_increment, fuzi_q_layer_qpack_decoder),
+    FUZI_Q_LAYER_ITEM("qpack_enc_set_dynamic_table_capacity_alt", test_qpack_dec_set_dynamic_table_capacity, fuzi_q_layer_qpack_encoder),
     /* WebSocket Frame Types */
-    FUZI_Q_ITEM("test_ws_frame_pong", test_ws_frame_pong),
-    FUZI_Q_ITEM("test_ws_frame_ping", test_ws_frame_ping),
-    FUZI_Q_ITEM("test_ws_frame_connection_close", test_ws_frame_connection_close),
-    FUZI_Q_ITEM("test_ws_frame_binary", test_ws_frame_binary),
-    FUZI_Q_ITEM("test_ws_frame_text", test_ws_frame_text),
-    FUZI_Q_ITEM("test_ws_frame_continuation", test_ws_frame_continuation),
+    FUZI_Q_LAYER_ITEM("test_ws_frame_pong", test_ws_frame_pong, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("test_ws_frame_ping", test_ws_frame_ping, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("test_ws_frame_connection_close", test_ws_frame_connection_close, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("test_ws_frame_binary", test_ws_frame_binary, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("test_ws_frame_text", test_ws_frame_text, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("test_ws_frame_continuation", test_ws_frame_continuation, fuzi_q_layer_app),
 
     /* START OF JULES ADDED FUZI_Q_ITEM ENTRIES (BATCHES 1-8) */
 
@@ -6296,9 +6253,9 @@ fuzi_q_frames_t fuzi_q_frame_list[] = {
     FUZI_Q_ITEM("quic_unknown_frame_0x20", test_frame_quic_unknown_0x20),
     FUZI_Q_ITEM("quic_unknown_0x3f_payload", test_frame_quic_unknown_0x3f_payload),
     FUZI_Q_ITEM("quic_unknown_greased_0x402a", test_frame_quic_unknown_greased_0x402a),
-    FUZI_Q_ITEM("h3_reserved_frame_0x02", test_frame_h3_reserved_0x02),
-    FUZI_Q_ITEM("h3_reserved_frame_0x06", test_frame_h3_reserved_0x06),
-    FUZI_Q_ITEM("h3_unassigned_extension_0x21", test_frame_h3_unassigned_extension_0x21),
+    FUZI_Q_LAYER_ITEM("h3_reserved_frame_0x02", test_frame_h3_reserved_0x02, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("h3_reserved_frame_0x06", test_frame_h3_reserved_0x06, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("h3_unassigned_extension_0x21", test_frame_h3_unassigned_extension_0x21, fuzi_q_layer_h3_request),
 
     /* --- Batch 1: Malformed Frame Lengths --- */
     FUZI_Q_ITEM("quic_stream_len0_with_data", test_frame_quic_stream_len0_with_data),
@@ -6319,8 +6276,8 @@ fuzi_q_frames_t fuzi_q_frame_list[] = {
     FUZI_Q_ITEM("quic_max_data_value0", test_frame_quic_max_data_value0),
     FUZI_Q_ITEM("quic_ack_largest0_delay0_1range0", test_frame_quic_ack_largest0_delay0_1range0),
     FUZI_Q_ITEM("quic_ack_range_count0_first_range_set", test_frame_quic_ack_range_count0_first_range_set),
-    FUZI_Q_ITEM("h3_settings_unknown_id", test_frame_h3_settings_unknown_id),
-    FUZI_Q_ITEM("h3_settings_max_field_section_size0", test_frame_h3_settings_max_field_section_size0),
+    FUZI_Q_LAYER_ITEM("h3_settings_unknown_id", test_frame_h3_settings_unknown_id, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_settings_max_field_section_size0", test_frame_h3_settings_max_field_section_size0, fuzi_q_layer_h3_control),
     FUZI_Q_ITEM("quic_max_stream_data_value0", test_frame_quic_max_stream_data_value0),
     FUZI_Q_ITEM("quic_conn_close_reserved_error", test_frame_quic_conn_close_reserved_error),
     FUZI_Q_ITEM("quic_new_token_zero_len_invalid", test_frame_quic_new_token_zero_len_invalid),
@@ -6345,14 +6302,14 @@ fuzi_q_frames_t fuzi_q_frame_list[] = {
     FUZI_Q_ITEM("datagram_type31_len0_empty_valid", test_frame_datagram_type31_len0_empty_valid),
 
     /* --- Batch 3: User Prioritized Frames (Part 1 - H3 SETTINGS) --- */
-    FUZI_Q_ITEM("h3_settings_unknown_id_b3", test_h3_settings_unknown_id_b3),
-    FUZI_Q_ITEM("h3_settings_duplicate_id", test_h3_settings_duplicate_id),
-    FUZI_Q_ITEM("h3_settings_invalid_value_for_id", test_h3_settings_invalid_value_for_id),
+    FUZI_Q_LAYER_ITEM("h3_settings_unknown_id_b3", test_h3_settings_unknown_id_b3, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_settings_duplicate_id", test_h3_settings_duplicate_id, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_settings_invalid_value_for_id", test_h3_settings_invalid_value_for_id, fuzi_q_layer_h3_control),
 
     /* --- Batch 3: User Prioritized Frames (Part 2 - H3 ORIGIN & QUIC STREAM) --- */
-    FUZI_Q_ITEM("h3_origin_unnegotiated", test_h3_origin_unnegotiated),
-    FUZI_Q_ITEM("h3_origin_multiple_entries", test_h3_origin_multiple_entries),
-    FUZI_Q_ITEM("h3_origin_empty_entry", test_h3_origin_empty_entry),
+    FUZI_Q_LAYER_ITEM("h3_origin_unnegotiated", test_h3_origin_unnegotiated, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_origin_multiple_entries", test_h3_origin_multiple_entries, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_origin_empty_entry", test_h3_origin_empty_entry, fuzi_q_layer_h3_control),
     FUZI_Q_ITEM("stream_len_bit_no_len_field", test_stream_len_bit_no_len_field),
     FUZI_Q_ITEM("stream_off_bit_no_off_field", test_stream_off_bit_no_off_field),
     FUZI_Q_ITEM("stream_len_fin_zero_len_with_data", test_stream_len_fin_zero_len_with_data),
@@ -6365,21 +6322,21 @@ fuzi_q_frames_t fuzi_q_frame_list[] = {
     FUZI_Q_ITEM("type_stream_range_lower_bound", test_frame_type_stream_range_lower_bound),
     FUZI_Q_ITEM("type_stream_range_upper_bound", test_frame_type_stream_range_upper_bound),
     FUZI_Q_ITEM("type_stream_range_just_above", test_frame_type_stream_range_just_above),
-    FUZI_Q_ITEM("ws_control_frame_fin_zero_invalid", test_ws_control_frame_fin_zero_invalid),
-    FUZI_Q_ITEM("ws_text_frame_rsv1_set_invalid", test_ws_text_frame_rsv1_set_invalid),
-    FUZI_Q_ITEM("ws_text_fin0_then_text_continuation_part1", test_ws_text_fin0_then_text_continuation_part1),
-    FUZI_Q_ITEM("ws_text_fin0_then_text_continuation_part2_invalid", test_ws_text_fin0_then_text_continuation_part2_invalid),
-    FUZI_Q_ITEM("ws_len126_data_truncated", test_ws_len126_data_truncated),
-    FUZI_Q_ITEM("ws_len127_data_truncated", test_ws_len127_data_truncated),
+    FUZI_Q_LAYER_ITEM("ws_control_frame_fin_zero_invalid", test_ws_control_frame_fin_zero_invalid, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_text_frame_rsv1_set_invalid", test_ws_text_frame_rsv1_set_invalid, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_text_fin0_then_text_continuation_part1", test_ws_text_fin0_then_text_continuation_part1, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_text_fin0_then_text_continuation_part2_invalid", test_ws_text_fin0_then_text_continuation_part2_invalid, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_len126_data_truncated", test_ws_len126_data_truncated, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_len127_data_truncated", test_ws_len127_data_truncated, fuzi_q_layer_app),
 
     /* --- Batch 4: More Static Frames --- */
     FUZI_Q_ITEM("quic_unknown_frame_high_value", test_frame_quic_unknown_frame_high_value),
-    FUZI_Q_ITEM("h3_reserved_frame_0x08", test_frame_h3_reserved_frame_0x08),
-    FUZI_Q_ITEM("h3_unassigned_type_0x4040", test_frame_h3_unassigned_type_0x4040),
-    FUZI_Q_ITEM("ws_reserved_control_0x0B", test_frame_ws_reserved_control_0x0B),
-    FUZI_Q_ITEM("ws_reserved_non_control_0x03", test_frame_ws_reserved_non_control_0x03),
-    FUZI_Q_ITEM("h3_headers_incomplete_qpack", test_frame_h3_headers_incomplete_qpack),
-    FUZI_Q_ITEM("ws_ping_payload_gt_125", test_frame_ws_ping_payload_gt_125),
+    FUZI_Q_LAYER_ITEM("h3_reserved_frame_0x08", test_frame_h3_reserved_frame_0x08, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("h3_unassigned_type_0x4040", test_frame_h3_unassigned_type_0x4040, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("ws_reserved_control_0x0B", test_frame_ws_reserved_control_0x0B, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_reserved_non_control_0x03", test_frame_ws_reserved_non_control_0x03, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("h3_headers_incomplete_qpack", test_frame_h3_headers_incomplete_qpack, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("ws_ping_payload_gt_125", test_frame_ws_ping_payload_gt_125, fuzi_q_layer_app),
     FUZI_Q_ITEM("quic_max_streams_uni_value0", test_frame_quic_max_streams_uni_value0),
     FUZI_Q_ITEM("quic_ncid_short_token", test_frame_quic_ncid_short_token),
     FUZI_Q_ITEM("quic_ncid_zero_len_cid", test_frame_quic_ncid_zero_len_cid),
@@ -6388,139 +6345,81 @@ fuzi_q_frames_t fuzi_q_frame_list[] = {
 
     /* --- Batch 5: Further Static Frames --- */
     FUZI_Q_ITEM("quic_unknown_frame_grease_0x2A", test_frame_quic_unknown_frame_grease_0x2A),
-    FUZI_Q_ITEM("h3_reserved_frame_0x09", test_frame_h3_reserved_frame_0x09),
-    FUZI_Q_ITEM("ws_control_frame_0x0C_invalid", test_frame_ws_control_frame_0x0C_invalid),
+    FUZI_Q_LAYER_ITEM("h3_reserved_frame_0x09", test_frame_h3_reserved_frame_0x09, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("ws_control_frame_0x0C_invalid", test_frame_ws_control_frame_0x0C_invalid, fuzi_q_layer_app),
     FUZI_Q_ITEM("quic_crypto_len_gt_data_b5", test_frame_quic_crypto_len_gt_data_b5),
-    FUZI_Q_ITEM("h3_push_promise_incomplete_payload", test_frame_h3_push_promise_incomplete_payload),
+    FUZI_Q_LAYER_ITEM("h3_push_promise_incomplete_payload", test_frame_h3_push_promise_incomplete_payload, fuzi_q_layer_h3_request),
     FUZI_Q_ITEM("quic_retire_connection_id_large_seq", test_frame_quic_retire_connection_id_large_seq),
-    FUZI_Q_ITEM("h3_goaway_large_id", test_frame_h3_goaway_large_id),
+    FUZI_Q_LAYER_ITEM("h3_goaway_large_id", test_frame_h3_goaway_large_id, fuzi_q_layer_h3_control),
     FUZI_Q_ITEM("quic_ncid_retire_gt_seq_b5", test_frame_quic_ncid_retire_gt_seq_b5),
     FUZI_Q_ITEM("quic_path_challenge_empty", test_frame_quic_path_challenge_empty),
     FUZI_Q_ITEM("quic_path_response_empty", test_frame_quic_path_response_empty),
     FUZI_Q_ITEM("quic_ack_delay_max_varint", test_frame_quic_ack_delay_max_varint),
     FUZI_Q_ITEM("quic_stream_all_fields_max_varint", test_frame_quic_stream_all_fields_max_varint),
-    FUZI_Q_ITEM("h3_data_len0_with_payload", test_frame_h3_data_len0_with_payload),
-    FUZI_Q_ITEM("ws_close_invalid_code", test_frame_ws_close_invalid_code),
+    FUZI_Q_LAYER_ITEM("h3_data_len0_with_payload", test_frame_h3_data_len0_with_payload, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("ws_close_invalid_code", test_frame_ws_close_invalid_code, fuzi_q_layer_app),
 
     /* --- Batch 8: Combined Set (original Batch 6/7 + 4 new from user) --- */
-    FUZI_Q_ITEM("h2_window_update_increment0_b7", test_frame_h2_window_update_increment0_b7),
+    FUZI_Q_LAYER_ITEM("h2_window_update_increment0_b7", test_frame_h2_window_update_increment0_b7, fuzi_q_layer_app),
     FUZI_Q_ITEM("quic_conn_close_transport_app_err_code_b7", test_frame_quic_conn_close_transport_app_err_code_b7),
-    FUZI_Q_ITEM("h3_max_push_id_value0_b7", test_frame_h3_max_push_id_value0_b7),
+    FUZI_Q_LAYER_ITEM("h3_max_push_id_value0_b7", test_frame_h3_max_push_id_value0_b7, fuzi_q_layer_h3_control),
     FUZI_Q_ITEM("quic_ncid_cid_len_gt_pico_max_b7", test_frame_quic_ncid_cid_len_gt_pico_max_b7),
-    FUZI_Q_ITEM("ws_text_rsv2_set", test_frame_ws_text_rsv2_set),
-    FUZI_Q_ITEM("ws_text_rsv3_set", test_frame_ws_text_rsv3_set),
+    FUZI_Q_LAYER_ITEM("ws_text_rsv2_set", test_frame_ws_text_rsv2_set, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_text_rsv3_set", test_frame_ws_text_rsv3_set, fuzi_q_layer_app),
     FUZI_Q_ITEM("quic_ack_non_ecn_with_ecn_counts_b7", test_frame_quic_ack_non_ecn_with_ecn_counts_b7),
     FUZI_Q_ITEM("quic_greased_type_0x5BEE_with_payload", test_frame_quic_greased_type_0x5BEE_with_payload),
-    FUZI_Q_ITEM("h3_reserved_type_4byte_varint", test_frame_h3_reserved_type_4byte_varint),
-    FUZI_Q_ITEM("ws_continuation_fin1_with_payload", test_frame_ws_continuation_fin1_with_payload),
+    FUZI_Q_LAYER_ITEM("h3_reserved_type_4byte_varint", test_frame_h3_reserved_type_4byte_varint, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("ws_continuation_fin1_with_payload", test_frame_ws_continuation_fin1_with_payload, fuzi_q_layer_app),
     FUZI_Q_ITEM("quic_ncid_large_retire_small_seq", test_frame_quic_ncid_large_retire_small_seq),
     FUZI_Q_ITEM("quic_extension_0x21", test_frame_quic_extension_0x21),
-    FUZI_Q_ITEM("h3_extension_0x2F", test_frame_h3_extension_0x2F),
+    FUZI_Q_LAYER_ITEM("h3_extension_0x2F", test_frame_h3_extension_0x2F, fuzi_q_layer_h3_request),
     FUZI_Q_ITEM("quic_ack_double_zero_range", test_frame_quic_ack_double_zero_range),
-    FUZI_Q_ITEM("ws_all_rsv_set", test_frame_ws_all_rsv_set),
+    FUZI_Q_LAYER_ITEM("ws_all_rsv_set", test_frame_ws_all_rsv_set, fuzi_q_layer_app),
 
     /* HTTP/2 and HPACK Frame Types */
-    FUZI_Q_ITEM("test_h2_frame_type_altsvc", test_h2_frame_type_altsvc),
-    FUZI_Q_ITEM("test_hpack_dynamic_table_size_update", test_hpack_dynamic_table_size_update),
-    FUZI_Q_ITEM("test_hpack_literal_never_indexed", test_hpack_literal_never_indexed),
-    FUZI_Q_ITEM("test_hpack_literal_no_indexing", test_hpack_literal_no_indexing),
-    FUZI_Q_ITEM("test_hpack_literal_inc_indexing", test_hpack_literal_inc_indexing),
-    FUZI_Q_ITEM("test_hpack_indexed_header_field", test_hpack_indexed_header_field),
-    FUZI_Q_ITEM("test_h2_frame_type_continuation", test_h2_frame_type_continuation),
-    FUZI_Q_ITEM("test_h2_frame_type_window_update", test_h2_frame_type_window_update),
-    FUZI_Q_ITEM("test_h2_frame_type_goaway", test_h2_frame_type_goaway),
-    FUZI_Q_ITEM("test_h2_frame_type_ping", test_h2_frame_type_ping),
-    FUZI_Q_ITEM("test_h2_frame_type_push_promise", test_h2_frame_type_push_promise),
-    FUZI_Q_ITEM("test_h2_frame_type_settings", test_h2_frame_type_settings),
-    FUZI_Q_ITEM("test_h2_frame_type_rst_stream", test_h2_frame_type_rst_stream),
-    FUZI_Q_ITEM("test_h2_frame_type_priority", test_h2_frame_type_priority),
-    FUZI_Q_ITEM("test_h2_frame_type_headers", test_h2_frame_type_headers),
-    FUZI_Q_ITEM("test_h2_frame_type_data", test_h2_frame_type_data),
+    FUZI_Q_LAYER_ITEM("test_h2_frame_type_altsvc", test_h2_frame_type_altsvc, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("test_hpack_dynamic_table_size_update", test_hpack_dynamic_table_size_update, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("test_hpack_literal_never_indexed", test_hpack_literal_never_indexed, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("test_hpack_literal_no_indexing", test_hpack_literal_no_indexing, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("test_hpack_literal_inc_indexing", test_hpack_literal_inc_indexing, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("test_hpack_indexed_header_field", test_hpack_indexed_header_field, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("test_h2_frame_type_continuation", test_h2_frame_type_continuation, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("test_h2_frame_type_window_update", test_h2_frame_type_window_update, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("test_h2_frame_type_goaway", test_h2_frame_type_goaway, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("test_h2_frame_type_ping", test_h2_frame_type_ping, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("test_h2_frame_type_push_promise", test_h2_frame_type_push_promise, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("test_h2_frame_type_settings", test_h2_frame_type_settings, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("test_h2_frame_type_rst_stream", test_h2_frame_type_rst_stream, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("test_h2_frame_type_priority", test_h2_frame_type_priority, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("test_h2_frame_type_headers", test_h2_frame_type_headers, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("test_h2_frame_type_data", test_h2_frame_type_data, fuzi_q_layer_app),
 
     /* START OF JULES ADDED FUZI_Q_ITEM ENTRIES (BATCHES 1-8) */
 
     /* --- Batch 1: Unknown or Unassigned Frame Types --- */
-    FUZI_Q_ITEM("quic_unknown_frame_0x20", test_frame_quic_unknown_0x20),
-    FUZI_Q_ITEM("h3_reserved_frame_0x02", test_frame_h3_reserved_0x02),
-    FUZI_Q_ITEM("h3_reserved_frame_0x06", test_frame_h3_reserved_0x06),
 
     /* --- Batch 1: Malformed Frame Lengths --- */
-    FUZI_Q_ITEM("quic_stream_len0_with_data", test_frame_quic_stream_len0_with_data),
-    FUZI_Q_ITEM("quic_stream_len_gt_data", test_frame_quic_stream_len_gt_data),
-    FUZI_Q_ITEM("quic_stream_len_lt_data", test_frame_quic_stream_len_lt_data),
 
     /* --- Batch 1: Invalid Frame Field Values --- */
-    FUZI_Q_ITEM("quic_max_streams_bidi_value0", test_frame_quic_max_streams_bidi_value0),
-    FUZI_Q_ITEM("quic_stop_sending_large_error", test_frame_quic_stop_sending_large_error),
 
     /* --- Batch 2: More Invalid Frame Field Values --- */
-    FUZI_Q_ITEM("quic_max_data_value0", test_frame_quic_max_data_value0),
-    FUZI_Q_ITEM("quic_ack_largest0_delay0_1range0", test_frame_quic_ack_largest0_delay0_1range0),
-    FUZI_Q_ITEM("quic_ack_range_count0_first_range_set", test_frame_quic_ack_range_count0_first_range_set),
-    FUZI_Q_ITEM("h3_settings_unknown_id", test_frame_h3_settings_unknown_id),
-    FUZI_Q_ITEM("h3_settings_max_field_section_size0", test_frame_h3_settings_max_field_section_size0),
 
     /* --- Batch 2: Padding Fuzzing --- */
-    FUZI_Q_ITEM("quic_padding_excessive_70bytes", test_frame_quic_padding_excessive_70bytes),
 
     /* --- Batch 2: Stream ID Fuzzing (static part) --- */
-    FUZI_Q_ITEM("quic_stream_id0", test_frame_quic_stream_id0),
 
     /* --- Batch 3: User Prioritized Frames (Part 1 - DATAGRAM & H3 SETTINGS) --- */
-    FUZI_Q_ITEM("datagram_type30_with_len_data_error", test_frame_datagram_type30_with_len_data_error),
-    FUZI_Q_ITEM("datagram_type31_missing_len_error", test_frame_datagram_type31_missing_len_error),
-    FUZI_Q_ITEM("datagram_type31_len_zero_with_data_error", test_frame_datagram_type31_len_zero_with_data_error),
-    FUZI_Q_ITEM("h3_settings_excessive_pairs", test_h3_settings_excessive_pairs),
+    FUZI_Q_LAYER_ITEM("h3_settings_excessive_pairs", test_h3_settings_excessive_pairs, fuzi_q_layer_h3_control),
 
     /* --- Batch 3: User Prioritized Frames (Part 2 - H3 ORIGIN & QUIC STREAM) --- */
-    FUZI_Q_ITEM("h3_origin_unnegotiated", test_h3_origin_unnegotiated),
-    FUZI_Q_ITEM("stream_len_bit_no_len_field", test_stream_len_bit_no_len_field),
-    FUZI_Q_ITEM("stream_off_bit_no_off_field", test_stream_off_bit_no_off_field),
-    FUZI_Q_ITEM("stream_len_fin_zero_len_with_data", test_stream_len_fin_zero_len_with_data),
 
     /* --- Batch 3: User Prioritized Frames (Part 3 - QUIC STREAM type range & WebSocket) --- */
-    FUZI_Q_ITEM("type_stream_range_just_below", test_frame_type_stream_range_just_below),
-    FUZI_Q_ITEM("type_stream_range_lower_bound", test_frame_type_stream_range_lower_bound),
-    FUZI_Q_ITEM("type_stream_range_upper_bound", test_frame_type_stream_range_upper_bound),
-    FUZI_Q_ITEM("type_stream_range_just_above", test_frame_type_stream_range_just_above),
-    FUZI_Q_ITEM("ws_control_frame_fin_zero_invalid", test_ws_control_frame_fin_zero_invalid),
-    FUZI_Q_ITEM("ws_text_fin0_then_text_continuation_part1", test_ws_text_fin0_then_text_continuation_part1),
-    FUZI_Q_ITEM("ws_text_fin0_then_text_continuation_part2_invalid", test_ws_text_fin0_then_text_continuation_part2_invalid),
 
     /* --- Batch 4: More Static Frames --- */
-    FUZI_Q_ITEM("quic_unknown_frame_high_value", test_frame_quic_unknown_frame_high_value),
-    FUZI_Q_ITEM("h3_reserved_frame_0x08", test_frame_h3_reserved_frame_0x08),
-    FUZI_Q_ITEM("h3_unassigned_type_0x4040", test_frame_h3_unassigned_type_0x4040),
-    FUZI_Q_ITEM("ws_reserved_control_0x0B", test_frame_ws_reserved_control_0x0B),
-    FUZI_Q_ITEM("ws_reserved_non_control_0x03", test_frame_ws_reserved_non_control_0x03),
-    FUZI_Q_ITEM("h3_headers_incomplete_qpack", test_frame_h3_headers_incomplete_qpack),
-    FUZI_Q_ITEM("ws_ping_payload_gt_125", test_frame_ws_ping_payload_gt_125),
-    FUZI_Q_ITEM("quic_max_streams_uni_value0", test_frame_quic_max_streams_uni_value0),
-    FUZI_Q_ITEM("quic_ncid_short_token", test_frame_quic_ncid_short_token),
-    FUZI_Q_ITEM("quic_ncid_zero_len_cid", test_frame_quic_ncid_zero_len_cid),
 
     /* --- Batch 5: Further Static Frames --- */
-    FUZI_Q_ITEM("quic_unknown_frame_grease_0x2A", test_frame_quic_unknown_frame_grease_0x2A),
-    FUZI_Q_ITEM("h3_reserved_frame_0x09", test_frame_h3_reserved_frame_0x09),
-    FUZI_Q_ITEM("ws_control_frame_0x0C_invalid", test_frame_ws_control_frame_0x0C_invalid),
-    FUZI_Q_ITEM("h3_push_promise_incomplete_payload", test_frame_h3_push_promise_incomplete_payload),
-    FUZI_Q_ITEM("quic_retire_connection_id_large_seq", test_frame_quic_retire_connection_id_large_seq),
-    FUZI_Q_ITEM("h3_goaway_large_id", test_frame_h3_goaway_large_id),
-    FUZI_Q_ITEM("quic_path_challenge_empty", test_frame_quic_path_challenge_empty),
-    FUZI_Q_ITEM("quic_path_response_empty", test_frame_quic_path_response_empty),
 
     /* --- Batch 8: Combined Set (original Batch 6/7 + 4 new from user) --- */
-    FUZI_Q_ITEM("h2_window_update_increment0_b7", test_frame_h2_window_update_increment0_b7),
-    FUZI_Q_ITEM("quic_conn_close_transport_app_err_code_b7", test_frame_quic_conn_close_transport_app_err_code_b7),
-    FUZI_Q_ITEM("h3_max_push_id_value0_b7", test_frame_h3_max_push_id_value0_b7),
-    FUZI_Q_ITEM("quic_ncid_cid_len_gt_pico_max_b7", test_frame_quic_ncid_cid_len_gt_pico_max_b7),
-    FUZI_Q_ITEM("ws_text_rsv2_set", test_frame_ws_text_rsv2_set),
-    FUZI_Q_ITEM("ws_text_rsv3_set", test_frame_ws_text_rsv3_set),
-    FUZI_Q_ITEM("quic_ack_non_ecn_with_ecn_counts_b7", test_frame_quic_ack_non_ecn_with_ecn_counts_b7),
-    FUZI_Q_ITEM("quic_greased_type_0x5BEE_with_payload", test_frame_quic_greased_type_0x5BEE_with_payload),
-    FUZI_Q_ITEM("h3_reserved_type_4byte_varint", test_frame_h3_reserved_type_4byte_varint),
-    FUZI_Q_ITEM("ws_continuation_fin1_with_payload", test_frame_ws_continuation_fin1_with_payload),
-    FUZI_Q_ITEM("quic_ncid_large_retire_small_seq", test_frame_quic_ncid_large_retire_small_seq),
 
     /* New QUIC negative test cases */
     FUZI_Q_ITEM("quic_conn_close_missing_error", test_quic_conn_close_missing_error),
@@ -6686,28 +6585,28 @@ fuzi_q_frames_t fuzi_q_frame_list[] = {
     /* Additional Advanced Protocol Violation Test Cases */
     
     /* HTTP/3 Protocol Violations */
-    FUZI_Q_ITEM("h3_settings_frame_on_request_stream", test_frame_h3_settings_frame_on_request_stream),
-    FUZI_Q_ITEM("h3_data_frame_without_headers", test_frame_h3_data_frame_without_headers),
-    FUZI_Q_ITEM("h3_headers_after_trailers", test_frame_h3_headers_after_trailers),
-    FUZI_Q_ITEM("h3_push_promise_on_unidirectional", test_frame_h3_push_promise_on_unidirectional),
-    FUZI_Q_ITEM("h3_goaway_with_invalid_id", test_frame_h3_goaway_with_invalid_id),
-    FUZI_Q_ITEM("h3_max_push_id_decrease", test_frame_h3_max_push_id_decrease),
-    FUZI_Q_ITEM("h3_cancel_push_nonexistent", test_frame_h3_cancel_push_nonexistent),
-    FUZI_Q_ITEM("h3_duplicate_settings", test_frame_h3_duplicate_settings),
-    FUZI_Q_ITEM("h3_reserved_setting_values", test_frame_h3_reserved_setting_values),
-    FUZI_Q_ITEM("h3_qpack_encoder_stream_wrong_type", test_frame_h3_qpack_encoder_stream_wrong_type),
+    FUZI_Q_LAYER_ITEM("h3_settings_frame_on_request_stream", test_frame_h3_settings_frame_on_request_stream, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("h3_data_frame_without_headers", test_frame_h3_data_frame_without_headers, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("h3_headers_after_trailers", test_frame_h3_headers_after_trailers, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("h3_push_promise_on_unidirectional", test_frame_h3_push_promise_on_unidirectional, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_goaway_with_invalid_id", test_frame_h3_goaway_with_invalid_id, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_max_push_id_decrease", test_frame_h3_max_push_id_decrease, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_cancel_push_nonexistent", test_frame_h3_cancel_push_nonexistent, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_duplicate_settings", test_frame_h3_duplicate_settings, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_reserved_setting_values", test_frame_h3_reserved_setting_values, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("h3_qpack_encoder_stream_wrong_type", test_frame_h3_qpack_encoder_stream_wrong_type, fuzi_q_layer_qpack_encoder),
     
     /* WebSocket Protocol Violations */
-    FUZI_Q_ITEM("ws_continuation_without_start", test_frame_ws_continuation_without_start),
-    FUZI_Q_ITEM("ws_text_after_binary_start", test_frame_ws_text_after_binary_start),
-    FUZI_Q_ITEM("ws_control_frame_fragmented", test_frame_ws_control_frame_fragmented),
-    FUZI_Q_ITEM("ws_close_after_close", test_frame_ws_close_after_close),
-    FUZI_Q_ITEM("ws_invalid_utf8_text", test_frame_ws_invalid_utf8_text),
-    FUZI_Q_ITEM("ws_mask_bit_server_to_client", test_frame_ws_mask_bit_server_to_client),
-    FUZI_Q_ITEM("ws_unmask_bit_client_to_server", test_frame_ws_unmask_bit_client_to_server),
-    FUZI_Q_ITEM("ws_invalid_close_code_1005", test_frame_ws_invalid_close_code_1005),
-    FUZI_Q_ITEM("ws_close_reason_without_code", test_frame_ws_close_reason_without_code),
-    FUZI_Q_ITEM("ws_pong_without_ping", test_frame_ws_pong_without_ping),
+    FUZI_Q_LAYER_ITEM("ws_continuation_without_start", test_frame_ws_continuation_without_start, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_text_after_binary_start", test_frame_ws_text_after_binary_start, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_control_frame_fragmented", test_frame_ws_control_frame_fragmented, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_close_after_close", test_frame_ws_close_after_close, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_invalid_utf8_text", test_frame_ws_invalid_utf8_text, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_mask_bit_server_to_client", test_frame_ws_mask_bit_server_to_client, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_unmask_bit_client_to_server", test_frame_ws_unmask_bit_client_to_server, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_invalid_close_code_1005", test_frame_ws_invalid_close_code_1005, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_close_reason_without_code", test_frame_ws_close_reason_without_code, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_pong_without_ping", test_frame_ws_pong_without_ping, fuzi_q_layer_app),
     
     /* QUIC Connection Migration Attacks */
     FUZI_Q_ITEM("quic_path_challenge_wrong_dcid", test_frame_quic_path_challenge_wrong_dcid),
@@ -6790,26 +6689,26 @@ fuzi_q_frames_t fuzi_q_frame_list[] = {
     /* === ADDITIONAL ADVANCED ATTACK VECTORS FUZI_Q_ITEM ENTRIES === */
     
     /* HTTP/2 Specific Violations */
-    FUZI_Q_ITEM("h2_headers_invalid_padding", test_frame_h2_headers_invalid_padding),
-    FUZI_Q_ITEM("h2_data_invalid_padding_len", test_frame_h2_data_invalid_padding_len),
-    FUZI_Q_ITEM("h2_priority_self_dependency", test_frame_h2_priority_self_dependency),
-    FUZI_Q_ITEM("h2_window_update_zero_increment", test_frame_h2_window_update_zero_increment),
-    FUZI_Q_ITEM("h2_settings_ack_with_payload", test_frame_h2_settings_ack_with_payload),
-    FUZI_Q_ITEM("h2_goaway_invalid_last_stream", test_frame_h2_goaway_invalid_last_stream),
-    FUZI_Q_ITEM("h2_rst_stream_invalid_error", test_frame_h2_rst_stream_invalid_error),
-    FUZI_Q_ITEM("h2_push_promise_invalid_id", test_frame_h2_push_promise_invalid_id),
-    FUZI_Q_ITEM("h2_continuation_without_headers", test_frame_h2_continuation_without_headers),
-    FUZI_Q_ITEM("h2_reserved_flags_set", test_frame_h2_reserved_flags_set),
+    FUZI_Q_LAYER_ITEM("h2_headers_invalid_padding", test_frame_h2_headers_invalid_padding, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("h2_data_invalid_padding_len", test_frame_h2_data_invalid_padding_len, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("h2_priority_self_dependency", test_frame_h2_priority_self_dependency, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("h2_window_update_zero_increment", test_frame_h2_window_update_zero_increment, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("h2_settings_ack_with_payload", test_frame_h2_settings_ack_with_payload, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("h2_goaway_invalid_last_stream", test_frame_h2_goaway_invalid_last_stream, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("h2_rst_stream_invalid_error", test_frame_h2_rst_stream_invalid_error, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("h2_push_promise_invalid_id", test_frame_h2_push_promise_invalid_id, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("h2_continuation_without_headers", test_frame_h2_continuation_without_headers, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("h2_reserved_flags_set", test_frame_h2_reserved_flags_set, fuzi_q_layer_app),
     
     /* QPACK Specific Attacks */
-    FUZI_Q_ITEM("qpack_encoder_invalid_instruction", test_frame_qpack_encoder_invalid_instruction),
-    FUZI_Q_ITEM("qpack_decoder_malformed_ack", test_frame_qpack_decoder_malformed_ack),
-    FUZI_Q_ITEM("qpack_table_size_overflow", test_frame_qpack_table_size_overflow),
-    FUZI_Q_ITEM("qpack_invalid_name_index", test_frame_qpack_invalid_name_index),
-    FUZI_Q_ITEM("qpack_duplicate_invalid_index", test_frame_qpack_duplicate_invalid_index),
-    FUZI_Q_ITEM("qpack_circular_reference", test_frame_qpack_circular_reference),
-    FUZI_Q_ITEM("qpack_cancellation_out_of_order", test_frame_qpack_cancellation_out_of_order),
-    FUZI_Q_ITEM("qpack_insert_count_overflow", test_frame_qpack_insert_count_overflow),
+    FUZI_Q_LAYER_ITEM("qpack_encoder_invalid_instruction", test_frame_qpack_encoder_invalid_instruction, fuzi_q_layer_qpack_encoder),
+    FUZI_Q_LAYER_ITEM("qpack_decoder_malformed_ack", test_frame_qpack_decoder_malformed_ack, fuzi_q_layer_qpack_decoder),
+    FUZI_Q_LAYER_ITEM("qpack_table_size_overflow", test_frame_qpack_table_size_overflow, fuzi_q_layer_qpack_encoder),
+    FUZI_Q_LAYER_ITEM("qpack_invalid_name_index", test_frame_qpack_invalid_name_index, fuzi_q_layer_qpack_encoder),
+    FUZI_Q_LAYER_ITEM("qpack_duplicate_invalid_index", test_frame_qpack_duplicate_invalid_index, fuzi_q_layer_qpack_encoder),
+    FUZI_Q_LAYER_ITEM("qpack_circular_reference", test_frame_qpack_circular_reference, fuzi_q_layer_qpack_encoder),
+    FUZI_Q_LAYER_ITEM("qpack_cancellation_out_of_order", test_frame_qpack_cancellation_out_of_order, fuzi_q_layer_qpack_decoder),
+    FUZI_Q_LAYER_ITEM("qpack_insert_count_overflow", test_frame_qpack_insert_count_overflow, fuzi_q_layer_qpack_decoder),
     
     /* Multi-Protocol Confusion Attacks */
     FUZI_Q_ITEM("tls_alert_in_crypto", test_frame_tls_alert_in_crypto),
@@ -6821,13 +6720,13 @@ fuzi_q_frames_t fuzi_q_frame_list[] = {
     FUZI_Q_ITEM("sip_in_stream", test_frame_sip_in_stream),
     
     /* Advanced WebSocket Edge Cases */
-    FUZI_Q_ITEM("ws_invalid_payload_len_encoding", test_frame_ws_invalid_payload_len_encoding),
-    FUZI_Q_ITEM("ws_ping_oversized", test_frame_ws_ping_oversized),
-    FUZI_Q_ITEM("ws_close_truncated_reason", test_frame_ws_close_truncated_reason),
-    FUZI_Q_ITEM("ws_mask_key_all_zeros", test_frame_ws_mask_key_all_zeros),
-    FUZI_Q_ITEM("ws_predictable_mask", test_frame_ws_predictable_mask),
-    FUZI_Q_ITEM("ws_binary_text_content", test_frame_ws_binary_text_content),
-    FUZI_Q_ITEM("ws_text_binary_content", test_frame_ws_text_binary_content),
+    FUZI_Q_LAYER_ITEM("ws_invalid_payload_len_encoding", test_frame_ws_invalid_payload_len_encoding, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_ping_oversized", test_frame_ws_ping_oversized, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_close_truncated_reason", test_frame_ws_close_truncated_reason, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_mask_key_all_zeros", test_frame_ws_mask_key_all_zeros, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_predictable_mask", test_frame_ws_predictable_mask, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_binary_text_content", test_frame_ws_binary_text_content, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("ws_text_binary_content", test_frame_ws_text_binary_content, fuzi_q_layer_app),
     
     /* Packet Fragmentation and Reassembly Attacks */
     FUZI_Q_ITEM("stream_overlapping_ranges", test_frame_stream_overlapping_ranges),
@@ -7304,17 +7203,17 @@ fuzi_q_frames_t fuzi_q_frame_list[] = {
     FUZI_Q_ITEM("rfc9369_v2_packet_protection_bypass", test_frame_rfc9369_v2_packet_protection_bypass),
     
     /* RFC 9114 - HTTP/3 */
-    FUZI_Q_ITEM("rfc9114_h3_frame_length_overflow", test_frame_rfc9114_h3_frame_length_overflow),
-    FUZI_Q_ITEM("rfc9114_h3_settings_duplicate", test_frame_rfc9114_h3_settings_duplicate),
-    FUZI_Q_ITEM("rfc9114_h3_push_promise_violation", test_frame_rfc9114_h3_push_promise_violation),
-    FUZI_Q_ITEM("rfc9114_h3_goaway_invalid_stream", test_frame_rfc9114_h3_goaway_invalid_stream),
-    FUZI_Q_ITEM("rfc9114_h3_max_push_id_regression", test_frame_rfc9114_h3_max_push_id_regression),
+    FUZI_Q_LAYER_ITEM("rfc9114_h3_frame_length_overflow", test_frame_rfc9114_h3_frame_length_overflow, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("rfc9114_h3_settings_duplicate", test_frame_rfc9114_h3_settings_duplicate, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("rfc9114_h3_push_promise_violation", test_frame_rfc9114_h3_push_promise_violation, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("rfc9114_h3_goaway_invalid_stream", test_frame_rfc9114_h3_goaway_invalid_stream, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("rfc9114_h3_max_push_id_regression", test_frame_rfc9114_h3_max_push_id_regression, fuzi_q_layer_h3_control),
     
     /* RFC 9204 - QPACK Field Compression */
     FUZI_Q_ITEM("rfc9204_qpack_encoder_stream_corruption", test_frame_rfc9204_qpack_encoder_stream_corruption),
     FUZI_Q_ITEM("rfc9204_qpack_decoder_stream_overflow", test_frame_rfc9204_qpack_decoder_stream_overflow),
-    FUZI_Q_ITEM("rfc9204_qpack_dynamic_table_corruption", test_frame_rfc9204_qpack_dynamic_table_corruption),
-    FUZI_Q_ITEM("rfc9204_qpack_header_block_dependency", test_frame_rfc9204_qpack_header_block_dependency),
+    FUZI_Q_LAYER_ITEM("rfc9204_qpack_dynamic_table_corruption", test_frame_rfc9204_qpack_dynamic_table_corruption, fuzi_q_layer_qpack_encoder),
+    FUZI_Q_LAYER_ITEM("rfc9204_qpack_header_block_dependency", test_frame_rfc9204_qpack_header_block_dependency, fuzi_q_layer_qpack_encoder),
     
     /* RFC 9220 - Bootstrapping WebSockets with HTTP/3 */
     FUZI_Q_ITEM("rfc9220_websocket_upgrade_injection", test_frame_rfc9220_websocket_upgrade_injection),
@@ -7322,8 +7221,8 @@ fuzi_q_frames_t fuzi_q_frame_list[] = {
     FUZI_Q_ITEM("rfc9220_websocket_protocol_confusion", test_frame_rfc9220_websocket_protocol_confusion),
     
     /* RFC 9412 - ORIGIN Extension in HTTP/3 */
-    FUZI_Q_ITEM("rfc9412_origin_frame_spoofing", test_frame_rfc9412_origin_frame_spoofing),
-    FUZI_Q_ITEM("rfc9412_origin_authority_bypass", test_frame_rfc9412_origin_authority_bypass),
+    FUZI_Q_LAYER_ITEM("rfc9412_origin_frame_spoofing", test_frame_rfc9412_origin_frame_spoofing, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("rfc9412_origin_authority_bypass", test_frame_rfc9412_origin_authority_bypass, fuzi_q_layer_h3_control),
     
     /* RFC 9250 - DNS over QUIC (DoQ) */
     FUZI_Q_ITEM("rfc9250_doq_malformed_query", test_frame_rfc9250_doq_malformed_query),
@@ -7342,11 +7241,11 @@ fuzi_q_frames_t fuzi_q_frame_list[] = {
     /* RFC 9110/9111/9112/9113 - HTTP Semantics Violations */
     FUZI_Q_ITEM("rfc9110_http_method_smuggling", test_frame_rfc9110_http_method_smuggling),
     FUZI_Q_ITEM("rfc9111_cache_poisoning_via_vary", test_frame_rfc9111_cache_poisoning_via_vary),
-    FUZI_Q_ITEM("rfc9113_h2_frame_injection", test_frame_rfc9113_h2_frame_injection),
+    FUZI_Q_LAYER_ITEM("rfc9113_h2_frame_injection", test_frame_rfc9113_h2_frame_injection, fuzi_q_layer_app),
     
     /* RFC 7541 - HPACK vs QPACK Confusion */
-    FUZI_Q_ITEM("rfc7541_hpack_in_qpack_context", test_frame_rfc7541_hpack_in_qpack_context),
-    FUZI_Q_ITEM("rfc7541_hpack_huffman_bomb", test_frame_rfc7541_hpack_huffman_bomb),
+    FUZI_Q_LAYER_ITEM("rfc7541_hpack_in_qpack_context", test_frame_rfc7541_hpack_in_qpack_context, fuzi_q_layer_app),
+    FUZI_Q_LAYER_ITEM("rfc7541_hpack_huffman_bomb", test_frame_rfc7541_hpack_huffman_bomb, fuzi_q_layer_app),
     
     /* RFC 7838 - HTTP Alternative Services Abuse */
     FUZI_Q_ITEM("rfc7838_alt_svc_redirection_attack", test_frame_rfc7838_alt_svc_redirection_attack),
@@ -7404,7 +7303,7 @@ fuzi_q_frames_t fuzi_q_frame_list[] = {
     FUZI_Q_ITEM("rfc6455_ws_extension_hijack", test_frame_rfc6455_ws_extension_hijack),
     
     /* RFC 8441 - HTTP/2 over QUIC Violations */
-    FUZI_Q_ITEM("rfc8441_h2_over_quic_settings", test_frame_rfc8441_h2_over_quic_settings),
+    FUZI_Q_LAYER_ITEM("rfc8441_h2_over_quic_settings", test_frame_rfc8441_h2_over_quic_settings, fuzi_q_layer_h3_control),
     FUZI_Q_ITEM("rfc8441_h2_quic_stream_mapping", test_frame_rfc8441_h2_quic_stream_mapping),
     FUZI_Q_ITEM("rfc8441_extended_connect_abuse", test_frame_rfc8441_extended_connect_abuse),
     
@@ -7428,17 +7327,17 @@ fuzi_q_frames_t fuzi_q_frame_list[] = {
     FUZI_Q_ITEM("rfc9002_loss_detection_evasion", test_frame_rfc9002_loss_detection_evasion),
     
     /* Advanced RFC 9114 HTTP/3 Frame Attacks */
-    FUZI_Q_ITEM("rfc9114_h3_cancel_push_invalid", test_frame_rfc9114_h3_cancel_push_invalid),
-    FUZI_Q_ITEM("rfc9114_h3_headers_after_trailers", test_frame_rfc9114_h3_headers_after_trailers),
-    FUZI_Q_ITEM("rfc9114_h3_data_after_fin", test_frame_rfc9114_h3_data_after_fin),
-    FUZI_Q_ITEM("rfc9114_h3_unknown_frame_critical", test_frame_rfc9114_h3_unknown_frame_critical),
-    FUZI_Q_ITEM("rfc9114_h3_settings_after_request", test_frame_rfc9114_h3_settings_after_request),
+    FUZI_Q_LAYER_ITEM("rfc9114_h3_cancel_push_invalid", test_frame_rfc9114_h3_cancel_push_invalid, fuzi_q_layer_h3_control),
+    FUZI_Q_LAYER_ITEM("rfc9114_h3_headers_after_trailers", test_frame_rfc9114_h3_headers_after_trailers, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("rfc9114_h3_data_after_fin", test_frame_rfc9114_h3_data_after_fin, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("rfc9114_h3_unknown_frame_critical", test_frame_rfc9114_h3_unknown_frame_critical, fuzi_q_layer_h3_request),
+    FUZI_Q_LAYER_ITEM("rfc9114_h3_settings_after_request", test_frame_rfc9114_h3_settings_after_request, fuzi_q_layer_h3_control),
     
     /* Advanced RFC 9204 QPACK Compression Attacks */
-    FUZI_Q_ITEM("rfc9204_qpack_table_update_race", test_frame_rfc9204_qpack_table_update_race),
-    FUZI_Q_ITEM("rfc9204_qpack_name_reference_oob", test_frame_rfc9204_qpack_name_reference_oob),
-    FUZI_Q_ITEM("rfc9204_qpack_huffman_bomb_extended", test_frame_rfc9204_qpack_huffman_bomb_extended),
-    FUZI_Q_ITEM("rfc9204_qpack_post_base_index", test_frame_rfc9204_qpack_post_base_index),
+    FUZI_Q_LAYER_ITEM("rfc9204_qpack_table_update_race", test_frame_rfc9204_qpack_table_update_race, fuzi_q_layer_qpack_encoder),
+    FUZI_Q_LAYER_ITEM("rfc9204_qpack_name_reference_oob", test_frame_rfc9204_qpack_name_reference_oob, fuzi_q_layer_qpack_encoder),
+    FUZI_Q_LAYER_ITEM("rfc9204_qpack_huffman_bomb_extended", test_frame_rfc9204_qpack_huffman_bomb_extended, fuzi_q_layer_qpack_encoder),
+    FUZI_Q_LAYER_ITEM("rfc9204_qpack_post_base_index", test_frame_rfc9204_qpack_post_base_index, fuzi_q_layer_qpack_encoder),
     
     /* Advanced RFC 9221 Datagram Extension Exploits */
     FUZI_Q_ITEM("rfc9221_datagram_id_reuse", test_frame_rfc9221_datagram_id_reuse),
@@ -7455,7 +7354,7 @@ fuzi_q_frames_t fuzi_q_frame_list[] = {
     FUZI_Q_ITEM("cross_rfc_h3_quic_version_confusion", test_frame_cross_rfc_h3_quic_version_confusion),
     FUZI_Q_ITEM("cross_rfc_tls_quic_key_mismatch", test_frame_cross_rfc_tls_quic_key_mismatch),
     FUZI_Q_ITEM("cross_rfc_http_quic_stream_leak", test_frame_cross_rfc_http_quic_stream_leak),
-    FUZI_Q_ITEM("cross_rfc_qpack_hpack_confusion", test_frame_cross_rfc_qpack_hpack_confusion),
+    FUZI_Q_LAYER_ITEM("cross_rfc_qpack_hpack_confusion", test_frame_cross_rfc_qpack_hpack_confusion, fuzi_q_layer_app),
     
     /* === EXTENDED RFC-SPECIFIC ATTACK VECTORS FUZI_Q_ITEM ENTRIES === */
     
@@ -0,0 +1,297 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2021, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <picoquic.h>
+#include <picoquic_utils.h>
+#include "fuzi_q.h"
+
+/* Impairment of simulated links.
+ *
+ * The models are described by a text specification, a list of items
+ * separated by ';'. Each item is a list of parameters separated by ',',
+ * optionally preceded by a link number and ':'. Items without a link
+ * number apply to all links, the others only to that link, and later
+ * items override earlier ones. For example, "bw=100,lat=20000;0:ge=0.01:0.2"
+ * sets all links to 100 Mbps and 20 ms, with burst losses on link 0.
+ * The parameters are:
+ *
+ *   bw=mbps               data rate, in Mbps
+ *   lat=us                latency, in microseconds
+ *   queue=us              maximum queue delay, 0 for no limit
+ *   jitter=us             random extra delay, uniform between 0 and jitter
+ *   loss=p                loss rate in the good state
+ *   ge=p_bad:p_good[:l]   Gilbert-Elliott transitions, loss rate l in the
+ *                         bad state, 1 by default
+ *   reorder=p:us          rate of packets held back by that delay
+ *   dup=p                 rate of duplicated packets
+ *   mtu=bytes             packets larger than that are dropped
+ *   seed=n                seed of the random draws
+ *
+ * The random draws of each link depend only on the seed and the link
+ * number, so a run can be replayed with the same specification.
+ */
+
+void fuzi_q_link_model_init(fuzi_q_link_model_t* model)
+{
+    memset(model, 0, sizeof(fuzi_q_link_model_t));
+    model->data_rate_in_gbps = 0.01;
+    model->latency = 10000;
+    model->loss_bad = 1.0;
+}
+
+static char const* fuzi_q_link_parse_uint64(char const* text, uint64_t* v)
+{
+    char* end_ptr = NULL;
+
+    if (*text < '0' || *text > '9') {
+        return NULL;
+    }
+    *v = (uint64_t)strtoull(text, &end_ptr, 10);
+    return end_ptr;
+}
+
+static char const* fuzi_q_link_parse_double(char const* text, double* v, double v_max)
+{
+    char* end_ptr = NULL;
+
+    if ((*text < '0' || *text > '9') && *text != '.') {
+        return NULL;
+    }
+    *v = strtod(text, &end_ptr);
+    return (*v > v_max) ? NULL : end_ptr;
+}
+
+static char const* fuzi_q_link_parse_param(char const* text, fuzi_q_link_model_t* model)
+{
+    uint64_t x = 0;
+
+    if (strncmp(text, "bw=", 3) == 0) {
+        double mbps = 0;
+        if ((text = fuzi_q_link_parse_double(text + 3, &mbps, 1000000.0)) != NULL) {
+            if (mbps <= 0) {
+                text = NULL;
+            }
+            else {
+                model->data_rate_in_gbps = mbps / 1000.0;
+            }
+        }
+    }
+    else if (strncmp(text, "lat=", 4) == 0) {
+        text = fuzi_q_link_parse_uint64(text + 4, &model->latency);
+    }
+    else if (strncmp(text, "queue=", 6) == 0) {
+        text = fuzi_q_link_parse_uint64(text + 6, &model->queue_delay_max);
+    }
+    else if (strncmp(text, "jitter=", 7) == 0) {
+        text = fuzi_q_link_parse_uint64(text + 7, &model->jitter);
+    }
+    else if (strncmp(text, "loss=", 5) == 0) {
+        text = fuzi_q_link_parse_double(text + 5, &model->loss_good, 1.0);
+    }
+    else if (strncmp(text, "ge=", 3) == 0) {
+        model->loss_bad = 1.0;
+        if ((text = fuzi_q_link_parse_double(text + 3, &model->ge_p_bad, 1.0)) != NULL) {
+            if (*text != ':' || (text = fuzi_q_link_parse_double(text + 1, &model->ge_p_good, 1.0)) == NULL) {
+                text = NULL;
+            }
+            else if (*text == ':') {
+                text = fuzi_q_link_parse_double(text + 1, &model->loss_bad, 1.0);
+            }
+        }
+    }
+    else if (strncmp(text, "reorder=", 8) == 0) {
+        if ((text = fuzi_q_link_parse_double(text + 8, &model->reorder_rate, 1.0)) != NULL) {
+            text = (*text == ':') ? fuzi_q_link_parse_uint64(text + 1, &model->reorder_delay) : NULL;
+        }
+    }
+    else if (strncmp(text, "dup=", 4) == 0) {
+        text = fuzi_q_link_parse_double(text + 4, &model->duplicate_rate, 1.0);
+    }
+    else if (strncmp(text, "mtu=", 4) == 0) {
+        if ((text = fuzi_q_link_parse_uint64(text + 4, &x)) != NULL) {
+            model->mtu = (size_t)x;
+        }
+    }
+    else if (strncmp(text, "seed=", 5) == 0) {
+        text = fuzi_q_link_parse_uint64(text + 5, &model->seed);
+    }
+    else {
+        text = NULL;
+    }
+
+    return text;
+}
+
+/* Get the model of a link. All items are parsed, so that a
+ * specification with errors is rejected whatever the link.
+ */
+int fuzi_q_link_model_get(char const* link_spec, int link_id, fuzi_q_link_model_t* model)
+{
+    int ret = 0;
+    char const* text = link_spec;
+    fuzi_q_link_model_t ignored;
+
+    fuzi_q_link_model_init(model);
+    while (ret == 0 && text != NULL && *text != 0) {
+        fuzi_q_link_model_t* target = model;
+
+        if (*text >= '0' && *text <= '9') {
+            uint64_t item_link = 0;
+            if ((text = fuzi_q_link_parse_uint64(text, &item_link)) == NULL || *text != ':') {
+                ret = -1;
+                break;
+            }
+            text++;
+            if (item_link != (uint64_t)link_id) {
+                target = &ignored;
+            }
+        }
+        while (ret == 0) {
+            if ((text = fuzi_q_link_parse_param(text, target)) == NULL) {
+                ret = -1;
+            }
+            else if (*text == ',') {
+                text++;
+            }
+            else {
+                if (*text == ';') {
+                    text++;
+                }
+                else if (*text != 0) {
+                    ret = -1;
+                }
+                break;
+            }
+        }
+    }
+
+    return ret;
+}
+
+void fuzi_q_link_impair_init(fuzi_q_link_impair_t* impair, const fuzi_q_link_model_t* model, int link_id)
+{
+    memset(impair, 0, sizeof(fuzi_q_link_impair_t));
+    impair->model = *model;
+    impair->random_context = (model->seed ^ 0x5eed11c0ffee1234ull) + 0x9E3779B97F4A7C15ull * (uint64_t)(link_id + 1);
+}
+
+void fuzi_q_link_impair_release(fuzi_q_link_impair_t* impair)
+{
+    while (impair->first_delayed != NULL) {
+        picoquictest_sim_packet_t* packet = impair->first_delayed;
+        impair->first_delayed = packet->next_packet;
+        free(packet);
+    }
+}
+
+static int fuzi_q_link_draw(fuzi_q_link_impair_t* impair, double rate)
+{
+    return (rate > 0 &&
+        (double)(picoquic_test_random(&impair->random_context) >> 11) / 9007199254740992.0 < rate);
+}
+
+/* Insert a packet in the delayed list, after those that arrive at the same time */
+static void fuzi_q_link_impair_insert(fuzi_q_link_impair_t* impair, picoquictest_sim_packet_t* packet)
+{
+    picoquictest_sim_packet_t** pp = &impair->first_delayed;
+
+    while (*pp != NULL && (*pp)->arrival_time <= packet->arrival_time) {
+        pp = &(*pp)->next_packet;
+    }
+    packet->next_packet = *pp;
+    *pp = packet;
+}
+
+static void fuzi_q_link_impair_delay(fuzi_q_link_impair_t* impair, picoquictest_sim_packet_t* packet, uint64_t current_time)
+{
+    packet->arrival_time = current_time;
+    if (impair->model.jitter > 0) {
+        packet->arrival_time += picoquic_test_uniform_random(&impair->random_context, impair->model.jitter + 1);
+    }
+    if (fuzi_q_link_draw(impair, impair->model.reorder_rate)) {
+        packet->arrival_time += impair->model.reorder_delay;
+        impair->nb_reordered++;
+    }
+    fuzi_q_link_impair_insert(impair, packet);
+}
+
+/* Apply the impairments to a packet that just left the link. The packet
+ * is either freed, or queued until its arrival time, possibly with a copy.
+ */
+void fuzi_q_link_impair_submit(fuzi_q_link_impair_t* impair, picoquictest_sim_packet_t* packet, uint64_t current_time)
+{
+    fuzi_q_link_model_t* model = &impair->model;
+    int is_lost = 0;
+
+    if (impair->is_bad) {
+        impair->is_bad = !fuzi_q_link_draw(impair, model->ge_p_good);
+    }
+    else {
+        impair->is_bad = fuzi_q_link_draw(impair, model->ge_p_bad);
+    }
+    is_lost = fuzi_q_link_draw(impair, (impair->is_bad) ? model->loss_bad : model->loss_good);
+
+    if (model->mtu > 0 && packet->length > model->mtu) {
+        impair->nb_too_big++;
+        free(packet);
+    }
+    else if (is_lost) {
+        impair->nb_lost++;
+        free(packet);
+    }
+    else {
+        if (fuzi_q_link_draw(impair, model->duplicate_rate)) {
+            picoquictest_sim_packet_t* copy = picoquictest_sim_link_create_packet();
+
+            if (copy != NULL) {
+                memcpy(copy, packet, sizeof(picoquictest_sim_packet_t));
+                copy->next_packet = NULL;
+                impair->nb_duplicated++;
+                fuzi_q_link_impair_delay(impair, copy, current_time);
+            }
+        }
+        fuzi_q_link_impair_delay(impair, packet, current_time);
+    }
+}
+
+picoquictest_sim_packet_t* fuzi_q_link_impair_dequeue(fuzi_q_link_impair_t* impair, uint64_t current_time)
+{
+    picoquictest_sim_packet_t* packet = impair->first_delayed;
+
+    if (packet != NULL && packet->arrival_time <= current_time) {
+        impair->first_delayed = packet->next_packet;
+        packet->next_packet = NULL;
+    }
+    else {
+        packet = NULL;
+    }
+    return packet;
+}
+
+uint64_t fuzi_q_link_impair_next_time(fuzi_q_link_impair_t* impair)
+{
+    return (impair->first_delayed == NULL) ? UINT64_MAX : impair->first_delayed->arrival_time;
+}
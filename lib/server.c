@@ -66,7 +66,8 @@ int fuzi_q_server_loop_cb(picoquic_quic_t* quic, picoquic_packet_loop_cb_enum cb
 /* Fuzi Quic Server
  * TODO: manage loop options like key updates, migrations, etc. 
  */
-int fuzi_q_server(fuzi_q_mode_enum fuzz_mode, picoquic_quic_config_t* config, uint64_t duration_max)
+int fuzi_q_server(fuzi_q_mode_enum fuzz_mode, picoquic_quic_config_t* config, uint64_t duration_max, size_t icid_capacity,
+    char const* frame_weights_file, char const* corpus_spec)
 {
     /* Start: start the QUIC process with cert and key files */
     int ret = 0;
@@ -94,6 +95,13 @@ fuzi_q_ctx.quic = picoquic_create_and_configure(config, NULL, &picoquic_file_par
         else {
             fuzi_q_ctx.fuzz_mode = fuzz_mode;
             fuzi_q_fuzzer_init(&fuzi_q_ctx.fuzz_ctx, NULL, NULL);
+            fuzi_q_fuzzer_set_capacity(&fuzi_q_ctx.fuzz_ctx, icid_capacity);
+            if (frame_weights_file != NULL) {
+                ret = fuzzer_load_frame_weights(&fuzi_q_ctx.fuzz_ctx, frame_weights_file);
+            }
+            if (ret == 0 && corpus_spec != NULL) {
+                ret = fuzzer_load_corpus(&fuzi_q_ctx.fuzz_ctx, corpus_spec);
+            }
             picoquic_set_fuzz(fuzi_q_ctx.quic, fuzi_q_fuzzer, &fuzi_q_ctx.fuzz_ctx);
             picoquic_set_key_log_file_from_env(fuzi_q_ctx.quic);
 
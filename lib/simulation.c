@@ -0,0 +1,1408 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2021, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <picoquic.h>
+#include <picoquic_utils.h>
+#include <picoquic_config.h>
+#include <autoqlog.h>
+#include "fuzi_q.h"
+
+/* Simulation of fuzi_q nodes in a single process.
+ * The nodes are connected by simulated links, and the loop always
+ * processes the next event, either a node ready to send or a packet
+ * arriving at the end of a link, at the simulated time of that event.
+ * There are no sockets and no timers, so the simulation runs as fast
+ * as the nodes can process packets.
+ */
+
+/* Routing of packets.
+ * Each attachment connects a node to the arrival end of a link, at the
+ * node address for that link, so the destination address of a packet
+ * is enough to find the link on which it travels and the node at the
+ * end of it. The addresses of the attachments are kept in an open
+ * addressing hash table, so routing a packet does not depend on the
+ * number of nodes and addresses. The table is built once the
+ * attachments are set, by fuzi_q_sim_routes_init.
+ */
+static uint64_t fuzi_q_sim_addr_hash(const struct sockaddr* addr)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    const uint8_t* x = NULL;
+    size_t len = 0;
+    uint16_t port = 0;
+
+    if (addr->sa_family == AF_INET) {
+        x = (const uint8_t*)&((struct sockaddr_in*)addr)->sin_addr;
+        len = 4;
+        port = ((struct sockaddr_in*)addr)->sin_port;
+    }
+    else if (addr->sa_family == AF_INET6) {
+        x = (const uint8_t*)&((struct sockaddr_in6*)addr)->sin6_addr;
+        len = 16;
+        port = ((struct sockaddr_in6*)addr)->sin6_port;
+    }
+    for (size_t i = 0; i < len; i++) {
+        h ^= x[i];
+        h *= 0x100000001b3ull;
+    }
+    h ^= port;
+    h *= 0x100000001b3ull;
+    h ^= (h >> 29);
+
+    return h;
+}
+
+/* Find the attachment at that address, or -1 if there is none */
+static int fuzi_q_sim_find_attach(fuzi_q_sim_config_t* config, const struct sockaddr* addr)
+{
+    size_t i = (size_t)fuzi_q_sim_addr_hash(addr) & config->route_mask;
+
+    while (config->route_table[i] >= 0) {
+        int attach_id = config->route_table[i];
+        if (picoquic_compare_addr((struct sockaddr*)&config->attachments[attach_id].node_addr, addr) == 0) {
+            return attach_id;
+        }
+        i = (i + 1) & config->route_mask;
+    }
+    return -1;
+}
+
+/* Build the route table. Fails if two attachments have the same address */
+int fuzi_q_sim_routes_init(fuzi_q_sim_config_t* config)
+{
+    int ret = 0;
+    size_t table_size = 16;
+
+    while (table_size < 2 * (size_t)config->nb_attachments) {
+        table_size *= 2;
+    }
+    if (config->route_table != NULL) {
+        free(config->route_table);
+    }
+    if (config->node_attach != NULL) {
+        free(config->node_attach);
+    }
+    config->route_table = (int*)malloc(table_size * sizeof(int));
+    config->node_attach = (int*)malloc(config->nb_nodes * sizeof(int));
+    if (config->route_table == NULL || config->node_attach == NULL) {
+        ret = -1;
+    }
+    else {
+        config->route_mask = table_size - 1;
+        for (size_t i = 0; i < table_size; i++) {
+            config->route_table[i] = -1;
+        }
+        for (int i = 0; i < config->nb_nodes; i++) {
+            config->node_attach[i] = -1;
+        }
+        for (int attach_id = 0; ret == 0 && attach_id < config->nb_attachments; attach_id++) {
+            fuzi_q_sim_attach_t* p_attach = &config->attachments[attach_id];
+
+            if (p_attach->node_id < 0 || p_attach->node_id >= config->nb_nodes ||
+                p_attach->link_id < 0 || p_attach->link_id >= config->nb_links ||
+                fuzi_q_sim_find_attach(config, (struct sockaddr*)&p_attach->node_addr) >= 0) {
+                DBG_PRINTF("Invalid or duplicate attachment %d", attach_id);
+                ret = -1;
+            }
+            else {
+                size_t i = (size_t)fuzi_q_sim_addr_hash((struct sockaddr*)&p_attach->node_addr) & config->route_mask;
+                while (config->route_table[i] >= 0) {
+                    i = (i + 1) & config->route_mask;
+                }
+                config->route_table[i] = attach_id;
+                if (config->node_attach[p_attach->node_id] < 0) {
+                    config->node_attach[p_attach->node_id] = attach_id;
+                }
+            }
+        }
+    }
+
+    return ret;
+}
+
+/* Find arrival context by link ID and destination address */
+int fuzi_q_sim_find_dest_node(fuzi_q_sim_config_t* config, int link_id, struct sockaddr* addr)
+{
+    int attach_id = fuzi_q_sim_find_attach(config, addr);
+
+    return (attach_id >= 0 && config->attachments[attach_id].link_id == link_id) ?
+        config->attachments[attach_id].node_id : -1;
+}
+
+/* Find departure link by destination address.
+ * If srce_addr is present and set to AF_UNSPEC, it is filled with the
+ * first address of the source node.
+ */
+int fuzi_q_sim_find_send_link(fuzi_q_sim_config_t* config, int srce_node_id, const struct sockaddr* dest_addr, struct sockaddr_storage* srce_addr)
+{
+    int attach_id = fuzi_q_sim_find_attach(config, dest_addr);
+    int dest_link_id = -1;
+
+    if (attach_id >= 0 && config->node_attach[srce_node_id] >= 0) {
+        if (srce_addr != NULL && srce_addr->ss_family == AF_UNSPEC) {
+            picoquic_store_addr(srce_addr,
+                (struct sockaddr*)&config->attachments[config->node_attach[srce_node_id]].node_addr);
+        }
+        dest_link_id = config->attachments[attach_id].link_id;
+    }
+
+    return dest_link_id;
+}
+
+/* Find the first address of a node */
+struct sockaddr* fuzi_q_sim_find_node_addr(fuzi_q_sim_config_t* config, int node_id)
+{
+    return (config->node_attach[node_id] < 0) ? NULL :
+        (struct sockaddr*)&config->attachments[config->node_attach[node_id]].node_addr;
+}
+
+/* Scheduling of events.
+ * The next event time of each node and of each link is kept in a min heap,
+ * nodes numbered first, then links. The time of a node only changes when
+ * that node sends or receives a packet, and the time of a link when a
+ * packet is submitted to it or dequeued from it, so each step only updates
+ * the entries of the node and the link that it touched, instead of
+ * polling all nodes and links. Ties go to the lowest number, i.e., to
+ * nodes before links.
+ */
+static int fuzi_q_sim_event_less(fuzi_q_sim_config_t* config, int a, int b)
+{
+    return (config->event_time[a] < config->event_time[b] ||
+        (config->event_time[a] == config->event_time[b] && a < b));
+}
+
+static void fuzi_q_sim_event_set(fuzi_q_sim_config_t* config, int x, int event_id)
+{
+    config->event_heap[x] = event_id;
+    config->event_pos[event_id] = x;
+}
+
+static void fuzi_q_sim_event_up(fuzi_q_sim_config_t* config, int x)
+{
+    int event_id = config->event_heap[x];
+
+    while (x > 0) {
+        int parent = (x - 1) / 2;
+        if (!fuzi_q_sim_event_less(config, event_id, config->event_heap[parent])) {
+            break;
+        }
+        fuzi_q_sim_event_set(config, x, config->event_heap[parent]);
+        x = parent;
+    }
+    fuzi_q_sim_event_set(config, x, event_id);
+}
+
+static void fuzi_q_sim_event_down(fuzi_q_sim_config_t* config, int x)
+{
+    int event_id = config->event_heap[x];
+
+    while (1) {
+        int child = 2 * x + 1;
+        if (child >= config->nb_events) {
+            break;
+        }
+        if (child + 1 < config->nb_events &&
+            fuzi_q_sim_event_less(config, config->event_heap[child + 1], config->event_heap[child])) {
+            child++;
+        }
+        if (!fuzi_q_sim_event_less(config, config->event_heap[child], event_id)) {
+            break;
+        }
+        fuzi_q_sim_event_set(config, x, config->event_heap[child]);
+        x = child;
+    }
+    fuzi_q_sim_event_set(config, x, event_id);
+}
+
+void fuzi_q_sim_event_update(fuzi_q_sim_config_t* config, int event_id, uint64_t event_time)
+{
+    if (config->event_heap != NULL) {
+        uint64_t old_time = config->event_time[event_id];
+
+        config->event_time[event_id] = event_time;
+        if (event_time < old_time) {
+            fuzi_q_sim_event_up(config, config->event_pos[event_id]);
+        }
+        else if (event_time > old_time) {
+            fuzi_q_sim_event_down(config, config->event_pos[event_id]);
+        }
+    }
+}
+
+static void fuzi_q_sim_update_node(fuzi_q_sim_config_t* config, int node_id)
+{
+    /* Look at both quic timer and fuzi level timer */
+    uint64_t quic_time = picoquic_get_next_wake_time(config->nodes[node_id].quic, config->simulated_time);
+    uint64_t fuzz_time = (config->node_done[node_id]) ? UINT64_MAX : fuzi_q_next_time(&config->nodes[node_id]);
+
+    fuzi_q_sim_event_update(config, node_id, (quic_time < fuzz_time) ? quic_time : fuzz_time);
+}
+
+static void fuzi_q_sim_update_link(fuzi_q_sim_config_t* config, int link_id)
+{
+    picoquictest_sim_packet_t* first_packet = config->links[link_id]->first_packet;
+    uint64_t delayed_time = fuzi_q_link_impair_next_time(&config->impairs[link_id]);
+
+    fuzi_q_sim_event_update(config, config->nb_nodes + link_id,
+        (first_packet != NULL && first_packet->arrival_time < delayed_time) ? first_packet->arrival_time : delayed_time);
+}
+
+/* Build the heap from the current state of the nodes and links */
+int fuzi_q_sim_events_init(fuzi_q_sim_config_t* config)
+{
+    int ret = 0;
+    int nb_events = config->nb_nodes + config->nb_links;
+
+    if (config->event_heap == NULL) {
+        config->event_time = (uint64_t*)malloc(nb_events * sizeof(uint64_t));
+        config->event_heap = (int*)malloc(nb_events * sizeof(int));
+        config->event_pos = (int*)malloc(nb_events * sizeof(int));
+        if (config->event_time == NULL || config->event_heap == NULL || config->event_pos == NULL) {
+            ret = -1;
+        }
+    }
+    if (ret == 0) {
+        config->nb_events = nb_events;
+        for (int i = 0; i < nb_events; i++) {
+            config->event_time[i] = UINT64_MAX;
+            fuzi_q_sim_event_set(config, i, i);
+        }
+        for (int i = 0; i < config->nb_nodes; i++) {
+            fuzi_q_sim_update_node(config, i);
+        }
+        for (int i = 0; i < config->nb_links; i++) {
+            fuzi_q_sim_update_link(config, i);
+        }
+    }
+    return ret;
+}
+
+/* Packet departure from selected node */
+static int fuzi_q_sim_packet_departure(fuzi_q_sim_config_t* config, int node_id, int* is_active)
+{
+    int ret = 0;
+    picoquictest_sim_packet_t* packet = picoquictest_sim_link_create_packet();
+
+    if (packet == NULL) {
+        /* memory error during test. Something is really wrong. */
+        ret = -1;
+    }
+    else {
+        /* check whether there is something to send */
+        int if_index = 0;
+
+        ret = picoquic_prepare_next_packet(config->nodes[node_id].quic, config->simulated_time,
+            packet->bytes, PICOQUIC_MAX_PACKET_SIZE, &packet->length,
+            &packet->addr_to, &packet->addr_from, &if_index, NULL, NULL);
+
+        if (ret != 0)
+        {
+            /* useless test, but makes it easier to add a breakpoint under debugger */
+            free(packet);
+            ret = -1;
+        }
+        else if (packet->length > 0) {
+            /* Find the exit link. This assumes destination addresses are available on only one link */
+            int link_id = fuzi_q_sim_find_send_link(config, node_id, (struct sockaddr*)&packet->addr_to, &packet->addr_from);
+
+            if (link_id >= 0) {
+                *is_active = 1;
+                picoquictest_sim_link_submit(config->links[link_id], packet, config->simulated_time);
+                fuzi_q_sim_update_link(config, link_id);
+            }
+            else {
+                /* packet cannot be routed. */
+                free(packet);
+            }
+        }
+        else {
+            free(packet);
+        }
+    }
+
+    return ret;
+}
+
+static int fuzi_q_sim_post_departure(fuzi_q_sim_config_t* config, int node_id, int* is_active)
+{
+    fuzi_q_ctx_t * fuzi_q_ctx = &config->nodes[node_id];
+    int ret = 0;
+
+    if ((fuzi_q_ctx->fuzz_mode == fuzi_q_mode_client ||
+        fuzi_q_ctx->fuzz_mode == fuzi_q_mode_clean) && !config->node_done[node_id]) {
+        ret = fuzi_q_loop_check_cnx(fuzi_q_ctx, config->simulated_time, is_active);
+        if (ret == PICOQUIC_NO_ERROR_TERMINATE_PACKET_LOOP && !fuzi_q_ctx->server_is_down) {
+            /* This client is done, the simulation goes on until all are */
+            config->node_done[node_id] = 1;
+            config->nb_clients_running--;
+            if (config->nb_clients_running > 0) {
+                ret = 0;
+            }
+        }
+    }
+
+    return ret;
+}
+
+/* Process arrival of a packet from a link. The packets leaving the
+ * picoquic link go through the impairments of the link, which may
+ * lose, duplicate or delay them; the packets are delivered to the
+ * destination node when their arrival time comes.
+ */
+static int fuzi_q_sim_packet_arrival(fuzi_q_sim_config_t* config, int link_id, int* is_active)
+{
+    int ret = 0;
+    picoquictest_sim_link_t* link = config->links[link_id];
+    fuzi_q_link_impair_t* impair = &config->impairs[link_id];
+    picoquictest_sim_packet_t* packet = NULL;
+
+    if (link->first_packet != NULL && link->first_packet->arrival_time <= config->simulated_time &&
+        link->first_packet->arrival_time < fuzi_q_link_impair_next_time(impair)) {
+        packet = picoquictest_sim_link_dequeue(link, config->simulated_time);
+        if (packet == NULL) {
+            /* unexpected, probably bug in test program */
+            ret = -1;
+        }
+        else {
+            fuzi_q_link_impair_submit(impair, packet, config->simulated_time);
+        }
+    }
+
+    if (ret == 0 && (packet = fuzi_q_link_impair_dequeue(impair, config->simulated_time)) != NULL) {
+        int node_id = fuzi_q_sim_find_dest_node(config, link_id, (struct sockaddr*)&packet->addr_to);
+
+        if (node_id >= 0) {
+            *is_active = 1;
+
+            ret = picoquic_incoming_packet(config->nodes[node_id].quic,
+                packet->bytes, (uint32_t)packet->length,
+                (struct sockaddr*)&packet->addr_from,
+                (struct sockaddr*)&packet->addr_to, 0, 0,
+                config->simulated_time);
+            fuzi_q_sim_update_node(config, node_id);
+        }
+        free(packet);
+    }
+    fuzi_q_sim_update_link(config, link_id);
+
+    return ret;
+}
+
+/* Execute the next event */
+int fuzi_q_sim_loop_step(fuzi_q_sim_config_t* config, int* is_active)
+{
+    int ret = 0;
+    uint64_t next_time;
+    int event_id;
+
+    if ((config->route_table == NULL && fuzi_q_sim_routes_init(config) != 0) ||
+        (config->event_heap == NULL && fuzi_q_sim_events_init(config) != 0)) {
+        return -1;
+    }
+    event_id = config->event_heap[0];
+    next_time = config->event_time[event_id];
+
+    if (next_time < UINT64_MAX) {
+        /* Update the time */
+        if (next_time > config->simulated_time) {
+            config->simulated_time = next_time;
+        }
+        if (event_id < config->nb_nodes) {
+            /* The node is ready to send data */
+            ret = fuzi_q_sim_packet_departure(config, event_id, is_active);
+            if (ret == 0) {
+                ret = fuzi_q_sim_post_departure(config, event_id, is_active);
+            }
+            fuzi_q_sim_update_node(config, event_id);
+        }
+        else {
+            /* Take next packet, find destination by address, and submit to end-of-link context */
+            ret = fuzi_q_sim_packet_arrival(config, event_id - config->nb_nodes, is_active);
+        }
+    }
+    else {
+        ret = -1;
+    }
+
+    return ret;
+}
+
+/* Start the client connections, then run the simulation until the clients
+ * terminate the loop, or until the simulated time reaches max_time.
+ * The simulation fails if max_inactive consecutive steps neither send
+ * nor receive a packet.
+ */
+int fuzi_q_sim_run(fuzi_q_sim_config_t* config, uint64_t max_time, int max_inactive)
+{
+    int ret = 0;
+    int nb_steps = 0;
+    int nb_inactive = 0;
+
+    config->nb_clients_running = 0;
+    for (int i = 0; i < config->nb_nodes; i++) {
+        config->node_done[i] = 0;
+        if (config->nodes[i].fuzz_mode == fuzi_q_mode_client ||
+            config->nodes[i].fuzz_mode == fuzi_q_mode_clean) {
+            config->nb_clients_running++;
+        }
+    }
+    for (int i = 0; ret == 0 && i < config->nb_nodes; i++) {
+        int is_active = 0;
+        ret = fuzi_q_sim_post_departure(config, i, &is_active);
+    }
+    if (ret == 0) {
+        ret = fuzi_q_sim_events_init(config);
+    }
+
+    while (ret == 0 && config->simulated_time < max_time) {
+        int is_active = 0;
+
+        ret = fuzi_q_sim_loop_step(config, &is_active);
+        if (ret == PICOQUIC_NO_ERROR_TERMINATE_PACKET_LOOP) {
+            ret = 0;
+            break;
+        }
+
+        if (ret != 0) {
+            DBG_PRINTF("Fail on loop step %d, %d, active: ret=%d", nb_steps, is_active, ret);
+            break;
+        }
+
+        nb_steps++;
+
+        if (is_active) {
+            nb_inactive = 0;
+        }
+        else {
+            nb_inactive++;
+            if (nb_inactive >= max_inactive) {
+                DBG_PRINTF("Exit loop after too many inactive: %d", nb_inactive);
+                ret = -1;
+                break;
+            }
+        }
+    }
+
+    return ret;
+}
+
+/* Set the model of each link, from a link specification, or the default
+ * model if the specification is NULL. The links are created again, so
+ * this is only done before running the simulation.
+ */
+int fuzi_q_sim_set_link_models(fuzi_q_sim_config_t* config, char const* link_spec)
+{
+    int ret = 0;
+
+    for (int i = 0; ret == 0 && i < config->nb_links; i++) {
+        fuzi_q_link_model_t model;
+
+        if (fuzi_q_link_model_get(link_spec, i, &model) != 0) {
+            DBG_PRINTF("Invalid link specification: %s", link_spec);
+            ret = -1;
+        }
+        else {
+            if (config->links[i] != NULL) {
+                picoquictest_sim_link_delete(config->links[i]);
+            }
+            fuzi_q_link_impair_release(&config->impairs[i]);
+            config->links[i] = picoquictest_sim_link_create(model.data_rate_in_gbps, model.latency, NULL,
+                model.queue_delay_max, config->simulated_time);
+            fuzi_q_link_impair_init(&config->impairs[i], &model, i);
+            if (config->links[i] == NULL) {
+                ret = -1;
+            }
+        }
+    }
+
+    return ret;
+}
+
+/* Delete a configuration */
+void fuzi_q_sim_config_delete(fuzi_q_sim_config_t* config)
+{
+    if (config->nodes != NULL) {
+        for (int i = 0; i < config->nb_nodes; i++) {
+            fuzi_q_release_client_context(&config->nodes[i]);
+        }
+        free(config->nodes);
+    }
+
+    if (config->node_done != NULL) {
+        free(config->node_done);
+    }
+
+    if (config->links != NULL) {
+        for (int i = 0; i < config->nb_links; i++) {
+            if (config->links[i] != NULL) {
+                picoquictest_sim_link_delete(config->links[i]);
+            }
+        }
+        free(config->links);
+    }
+
+    if (config->impairs != NULL) {
+        for (int i = 0; i < config->nb_links; i++) {
+            fuzi_q_link_impair_release(&config->impairs[i]);
+        }
+        free(config->impairs);
+    }
+
+    if (config->route_table != NULL) {
+        free(config->route_table);
+    }
+
+    if (config->node_attach != NULL) {
+        free(config->node_attach);
+    }
+
+    if (config->attachments != NULL) {
+        free(config->attachments);
+    }
+
+    if (config->event_time != NULL) {
+        free(config->event_time);
+    }
+
+    if (config->event_heap != NULL) {
+        free(config->event_heap);
+    }
+
+    if (config->event_pos != NULL) {
+        free(config->event_pos);
+    }
+
+    free(config);
+}
+
+/* Create a configuration.
+ * The server uses the certificate and key files if specified, or else
+ * the test certificate and key found in the Picoquic solution.
+ */
+fuzi_q_sim_config_t* fuzi_q_sim_config_create(int nb_nodes, int nb_links, int nb_attachments,
+    char const* cert_file, char const* key_file, char const* picoquic_solution_dir)
+{
+    fuzi_q_sim_config_t* config = (fuzi_q_sim_config_t*)malloc(sizeof(fuzi_q_sim_config_t));
+
+    if (config != NULL) {
+        int success = 1;
+
+        memset(config, 0, sizeof(fuzi_q_sim_config_t));
+        memset(config->ticket_encryption_key, 0x55, sizeof(config->ticket_encryption_key));
+
+        if (cert_file != NULL && key_file != NULL) {
+            if (picoquic_sprintf(config->server_cert_file, sizeof(config->server_cert_file), NULL, "%s", cert_file) != 0 ||
+                picoquic_sprintf(config->server_key_file, sizeof(config->server_key_file), NULL, "%s", key_file) != 0) {
+                success = 0;
+            }
+        }
+        /* Locate the default cert, key and root in the Picoquic solution*/
+        else if (picoquic_get_input_path(config->server_cert_file, sizeof(config->server_cert_file),
+            picoquic_solution_dir, PICOQUIC_TEST_FILE_SERVER_CERT) != 0 ||
+            picoquic_get_input_path(config->server_key_file, sizeof(config->server_key_file),
+                picoquic_solution_dir, PICOQUIC_TEST_FILE_SERVER_KEY) != 0 ||
+            picoquic_get_input_path(config->server_cert_store_file, sizeof(config->server_cert_store_file),
+                picoquic_solution_dir, PICOQUIC_TEST_FILE_CERT_STORE) != 0) {
+            success = 0;
+        }
+
+        if (nb_nodes <= 0 || nb_nodes > 0xffff) {
+            success = 0;
+        }
+        else if (success) {
+            config->nodes = (fuzi_q_ctx_t*)malloc(nb_nodes * sizeof(fuzi_q_ctx_t));
+            config->node_done = (uint8_t*)malloc(nb_nodes);
+            success &= (config->nodes != NULL && config->node_done != NULL);
+            if (success) {
+                memset(config->nodes, 0, nb_nodes * sizeof(fuzi_q_ctx_t));
+                memset(config->node_done, 0, nb_nodes);
+                config->nb_nodes = nb_nodes;
+            }
+        }
+
+        if (nb_links <= 0 || nb_links > 0xffff) {
+            success = 0;
+        }
+        else if (success) {
+            config->links = (picoquictest_sim_link_t**)malloc(nb_links * sizeof(picoquictest_sim_link_t*));
+            config->impairs = (fuzi_q_link_impair_t*)malloc(nb_links * sizeof(fuzi_q_link_impair_t));
+            success &= (config->links != NULL && config->impairs != NULL);
+
+            if (success) {
+                memset(config->links, 0, nb_links * sizeof(picoquictest_sim_link_t*));
+                memset(config->impairs, 0, nb_links * sizeof(fuzi_q_link_impair_t));
+                config->nb_links = nb_links;
+                success &= (fuzi_q_sim_set_link_models(config, NULL) == 0);
+            }
+        }
+
+
+        if (nb_attachments <= 0 || nb_attachments > 0xffff) {
+            success = 0;
+        }
+        else if (success) {
+            config->attachments = (fuzi_q_sim_attach_t*)malloc(nb_attachments * sizeof(fuzi_q_sim_attach_t));
+            success &= (config->attachments != NULL);
+
+            if (success) {
+                memset(config->attachments, 0, nb_attachments * sizeof(fuzi_q_sim_attach_t));
+                config->nb_attachments = nb_attachments;
+                for (int i = 0; success && (i < config->nb_attachments); i++) {
+                    char addr_text[128];
+                    fuzi_q_sim_attach_t* p_attach = &config->attachments[i];
+
+                    if (picoquic_sprintf(addr_text, sizeof(addr_text), NULL, "%x::%x", i + 0x1000, i + 0x1000) == 0) {
+                        picoquic_store_text_addr(&p_attach->node_addr, addr_text, i + 0x1000);
+                    }
+                    else {
+                        success = 0;
+                    }
+                }
+            }
+        }
+
+        if (!success) {
+            fuzi_q_sim_config_delete(config);
+            config = NULL;
+        }
+    }
+
+    return config;
+}
+
+/* Scenario of the simulated clients, if none is specified */
+static const char* fuzi_q_sim_scenario_default = "0:index.html;4:0:/1000;8:4:/12345";
+
+/* Set a client node. If init_cid is NULL, the fuzzer starts from its
+ * default CID, so that runs are reproducible; if it is set but empty,
+ * the initial CID is picked at random.
+ */
+int fuzi_q_sim_set_client_ctx(fuzi_q_sim_config_t* sim_config, fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_mode_enum fuzz_mode,
+    size_t nb_cnx_ctx, size_t nb_cnx_required, uint64_t duration_max, picoquic_connection_id_t* init_cid,
+    char const * client_scenario_text, struct sockaddr* server_addr, char const * qlog_dir)
+{
+    int ret = 0;
+    uint64_t current_time = sim_config->simulated_time;
+    picoquic_quic_config_t config = { 0 };
+    config.nb_connections = (uint32_t)(2*nb_cnx_ctx);
+    config.cnx_id_length = 8;
+
+    fuzi_q_ctx->fuzz_mode = fuzz_mode;
+    fuzi_q_ctx->config = NULL;
+    fuzi_q_ctx->up_time_interval = 60000000; /* Use 1 minute by default -- hanshake timer is set to 30 seconds. */
+    fuzi_q_ctx->cnx_duration_min = UINT64_MAX;
+
+    fuzi_q_ctx->end_of_time = (duration_max == 0) ? UINT64_MAX : current_time + duration_max * 1000000;
+    fuzi_q_ctx->nb_cnx_required = (nb_cnx_required == 0) ? SIZE_MAX : nb_cnx_required;
+    fuzi_q_ctx->next_success_time = current_time + fuzi_q_ctx->up_time_interval;
+
+    if (fuzi_q_ctx->alpn != NULL && strcmp(fuzi_q_ctx->alpn, QUICPERF_ALPN) == 0) {
+        /* Set a QUICPERF client */
+        fuzi_q_ctx->is_quicperf = 1;
+        fprintf(stdout, "Getting ready to fuzz QUICPERF server\n");
+    }
+    else {
+        if (client_scenario_text == NULL) {
+            client_scenario_text = fuzi_q_sim_scenario_default;
+        }
+
+        ret = demo_client_parse_scenario_desc(client_scenario_text, &fuzi_q_ctx->client_sc_nb, &fuzi_q_ctx->client_sc);
+        if (ret != 0) {
+            fprintf(stdout, "Cannot parse the specified scenario.\n");
+        }
+    }
+
+    /* Create QUIC context */
+    if (ret == 0) {
+        fuzi_q_ctx->quic = picoquic_create_and_configure(&config, NULL, NULL, current_time, &sim_config->simulated_time);
+        if (fuzi_q_ctx->quic == NULL) {
+            ret = -1;
+        }
+        else {
+            if (sim_config->settings != NULL) {
+                ret = fuzi_q_fuzzer_init_shared(&fuzi_q_ctx->fuzz_ctx, init_cid, (init_cid == NULL) ? NULL : fuzi_q_ctx->quic,
+                    sim_config->settings);
+            }
+            else {
+                fuzi_q_fuzzer_init(&fuzi_q_ctx->fuzz_ctx, init_cid, (init_cid == NULL) ? NULL : fuzi_q_ctx->quic);
+            }
+            fuzi_q_ctx->fuzz_ctx.parent = fuzi_q_ctx;
+            if (fuzz_mode != fuzi_q_mode_clean) {
+                picoquic_set_fuzz(fuzi_q_ctx->quic, fuzi_q_fuzzer, &fuzi_q_ctx->fuzz_ctx);
+            }
+
+            if (qlog_dir != NULL) {
+                picoquic_set_qlog(fuzi_q_ctx->quic, qlog_dir);
+            }
+        }
+    }
+
+    /* Create empty connection contexts */
+    if (ret == 0) {
+        picoquic_store_addr(&fuzi_q_ctx->server_address, server_addr);
+        ret = fuzi_q_create_cnx_ctx(fuzi_q_ctx, nb_cnx_ctx);
+    }
+
+    return ret;
+}
+
+int fuzi_q_sim_set_server_ctx(fuzi_q_sim_config_t* sim_config, fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_mode_enum fuzz_mode,
+    size_t nb_cnx_ctx, uint64_t duration_max, struct sockaddr* server_addr, char const* qlog_dir)
+{
+    int ret = 0;
+    picoquic_quic_config_t config = { 0 };
+    config.nb_connections = (uint32_t)(4*nb_cnx_ctx);
+    config.server_cert_file = sim_config->server_cert_file;
+    config.server_key_file = sim_config->server_key_file;
+    config.cnx_id_length = 8;
+
+    if (server_addr != NULL) {
+        if (server_addr->sa_family == AF_INET) {
+            config.server_port = ((struct sockaddr_in*)server_addr)->sin_port;
+        }
+        else if (server_addr->sa_family == AF_INET6) {
+            config.server_port = ((struct sockaddr_in6*)server_addr)->sin6_port;
+        }
+    }
+
+    fuzi_q_ctx->quic = picoquic_create_and_configure(&config, NULL, NULL, sim_config->simulated_time,
+        &sim_config->simulated_time);
+    if (fuzi_q_ctx->quic == NULL) {
+        ret = -1;
+    }
+    else {
+        fuzi_q_ctx->fuzz_mode = fuzz_mode;
+        if (fuzz_mode == fuzi_q_mode_clean_server) {
+            /* The server does not fuzz, it needs no test frames */
+            (void)fuzi_q_fuzzer_init_shared(&fuzi_q_ctx->fuzz_ctx, NULL, NULL, NULL);
+        }
+        else if (sim_config->settings != NULL) {
+            ret = fuzi_q_fuzzer_init_shared(&fuzi_q_ctx->fuzz_ctx, NULL, NULL, sim_config->settings);
+        }
+        else {
+            fuzi_q_fuzzer_init(&fuzi_q_ctx->fuzz_ctx, NULL, NULL);
+        }
+        if (fuzz_mode != fuzi_q_mode_clean_server) {
+            picoquic_set_fuzz(fuzi_q_ctx->quic, fuzi_q_fuzzer, &fuzi_q_ctx->fuzz_ctx);
+        }
+
+        picoquic_set_alpn_select_fn(fuzi_q_ctx->quic, (picoquic_alpn_select_fn)picoquic_demo_server_callback_select_alpn);
+
+        picoquic_set_mtu_max(fuzi_q_ctx->quic, PICOQUIC_MAX_PACKET_SIZE);
+
+        if (qlog_dir != NULL)
+        {
+            picoquic_set_qlog(fuzi_q_ctx->quic, qlog_dir);
+        }
+    }
+
+    return ret;
+}
+
+/* Create a configuration with one server and nb_clients client nodes.
+ * The server is on node 0, and client c on node c + 1. Each client has
+ * nb_client_addresses addresses, for example to test migration. The
+ * packets sent to the server all go through the same link, so the
+ * server sees the load of all clients; each client address is at the
+ * end of its own link. Attachment i is on link i: attachment 0 is the
+ * server, and attachment 1 + c*nb_client_addresses + k is the address k
+ * of client c.
+ *
+ * The connections required are split between the clients. Client 0
+ * starts from the initial CID, as in the basic configuration, and each
+ * other client from its own branch of the CID of client 0.
+ */
+fuzi_q_sim_config_t* fuzi_q_sim_topology_create(int nb_clients, int nb_client_addresses, char const* link_spec,
+    fuzi_q_mode_enum client_fuzz_mode, fuzi_q_mode_enum server_fuzz_mode,
+    size_t nb_cnx_ctx, size_t nb_cnx_required, uint64_t duration_max, picoquic_connection_id_t* init_cid,
+    char const* client_scenario_text, char const* qlog_dir, char const* cert_file, char const* key_file,
+    char const* picoquic_solution_dir, const fuzzer_ctx_t* settings)
+{
+    fuzi_q_sim_config_t* config = NULL;
+    struct sockaddr* server_addr = NULL;
+    int nb_attachments;
+    int a_ret = 0;
+    int s_ret = 0;
+    int c_ret = 0;
+
+    if (nb_cnx_required > 0 && (size_t)nb_clients > nb_cnx_required) {
+        /* No client without a connection to try */
+        nb_clients = (int)nb_cnx_required;
+    }
+    if (nb_clients <= 0 || nb_client_addresses <= 0 || nb_clients > 0xfffe ||
+        nb_client_addresses > 0xfffe / nb_clients) {
+        return NULL;
+    }
+    nb_attachments = 1 + nb_clients * nb_client_addresses;
+    config = fuzi_q_sim_config_create(1 + nb_clients, nb_attachments, nb_attachments, cert_file, key_file, picoquic_solution_dir);
+
+    if (config != NULL) {
+        config->settings = settings;
+        /* Populate the attachments */
+        for (int i = 0; i < nb_attachments; i++) {
+            config->attachments[i].link_id = i;
+            config->attachments[i].node_id = (i == 0) ? 0 : 1 + (i - 1) / nb_client_addresses;
+        }
+        /* Set the desired link models, then find the server address */
+        if (link_spec != NULL) {
+            a_ret = fuzi_q_sim_set_link_models(config, link_spec);
+        }
+        if (a_ret == 0 && (a_ret = fuzi_q_sim_routes_init(config)) == 0 &&
+            (server_addr = fuzi_q_sim_find_node_addr(config, 0)) == NULL) {
+            a_ret = -1;
+        }
+        if (a_ret == 0) {
+            /* configure server on nodes[0], clients on the other nodes.
+             * Apply fuzz_mode to clients and to server
+             */
+            s_ret = fuzi_q_sim_set_server_ctx(config, &config->nodes[0], server_fuzz_mode,
+                nb_clients * nb_cnx_ctx, duration_max, server_addr, qlog_dir);
+            for (int c = 0; s_ret == 0 && c_ret == 0 && c < nb_clients; c++) {
+                size_t nb_required = nb_cnx_required;
+
+                if (nb_cnx_required > 0) {
+                    nb_required = fuzi_q_trials_share(nb_cnx_required, nb_clients, c);
+                }
+                c_ret = fuzi_q_sim_set_client_ctx(config, &config->nodes[1 + c], client_fuzz_mode,
+                    nb_cnx_ctx, nb_required, duration_max, init_cid, client_scenario_text,
+                    server_addr, qlog_dir);
+                if (c_ret == 0 && c > 0) {
+                    fuzzer_branch_cid(&config->nodes[1].fuzz_ctx.next_cid, c, &config->nodes[1 + c].fuzz_ctx.next_cid);
+                }
+            }
+        }
+        if (a_ret != 0 || s_ret != 0 || c_ret != 0) {
+            DBG_PRINTF("Configuration failed, address: %d, server: %d, client: %d", a_ret, s_ret, c_ret);
+            fuzi_q_sim_config_delete(config);
+            config = NULL;
+        }
+    }
+    return config;
+}
+
+/* Create a configuration with just two nodes, two links, one source and two attachment points.
+ * The server is on node 0, the client on node 1. */
+fuzi_q_sim_config_t* fuzi_q_sim_basic_config_create(char const* link_spec, fuzi_q_mode_enum client_fuzz_mode, fuzi_q_mode_enum server_fuzz_mode,
+    size_t nb_cnx_ctx, size_t nb_cnx_required, uint64_t duration_max, picoquic_connection_id_t* init_cid,
+    char const* client_scenario_text, char const* qlog_dir, char const* cert_file, char const* key_file,
+    char const* picoquic_solution_dir)
+{
+    return fuzi_q_sim_topology_create(1, 1, link_spec, client_fuzz_mode, server_fuzz_mode, nb_cnx_ctx,
+        nb_cnx_required, duration_max, init_cid, client_scenario_text, qlog_dir, cert_file, key_file,
+        picoquic_solution_dir, NULL);
+}
+
+/* Simulation mode of fuzi_q. The fuzzing client and a clean picoquic
+ * server run in the same process, connected by simulated links, in
+ * virtual time. The duration limit is expressed in simulated seconds.
+ *
+ * The trials are shared between independent shards, each with its own
+ * server and nb_clients fuzzing clients, and the shards are run by a
+ * pool of threads.
+ * A thread takes the next shard to run when it is done with the previous
+ * one, so a slow shard does not hold the other threads. The frame weights
+ * and test frames are loaded once in the farm, and shared by the nodes.
+ * The threads share the index of the next shard and the weights of the
+ * fuzzing strategies: a shard starts from the current weights, and adds
+ * the updates of its clients when it ends, so that what a shard learned
+ * is used by the next ones. Each thread adds the results of its shards
+ * to its own summary, and the summaries are added when all threads are
+ * done.
+ *
+ * As in the multithreaded client, shard 0 starts from the initial CID,
+ * and each other shard from its own branch of that CID, or with the
+ * counter scheme, from its own interleaved range of CID numbers.
+ */
+#define FUZI_Q_SIM_MAX_INACTIVE 1024
+#ifdef _WINDOWS
+#define FUZI_Q_SIM_PICOQUIC_SOLUTION_DIR "..\\picoquic\\"
+#else
+#define FUZI_Q_SIM_PICOQUIC_SOLUTION_DIR "../picoquic/"
+#endif
+
+typedef struct st_fuzi_q_sim_worker_t {
+    fuzi_q_sim_farm_t* farm;
+    picoquic_thread_t thread;
+    fuzi_q_ctx_t summary;
+    fuzi_q_sim_failure_t* failures;
+    size_t nb_failures;
+    size_t nb_failures_alloc;
+    int nb_shards_run;
+    uint64_t simulated_time;
+    int ret;
+} fuzi_q_sim_worker_t;
+
+static void fuzi_q_sim_shard_cid(fuzi_q_sim_farm_t* farm, int shard_id, picoquic_connection_id_t* shard_cid)
+{
+    if (farm->cid_scheme == fuzzer_cid_scheme_counter) {
+        *shard_cid = farm->root_cid;
+    }
+    else {
+        fuzzer_branch_cid(&farm->root_cid, shard_id, shard_cid);
+    }
+}
+
+static int fuzi_q_sim_add_failure(fuzi_q_sim_worker_t* worker, int shard_id, int ret, picoquic_connection_id_t* icid, uint64_t cid_index)
+{
+    if (worker->nb_failures >= worker->nb_failures_alloc) {
+        size_t new_alloc = (worker->nb_failures_alloc == 0) ? 16 : 2 * worker->nb_failures_alloc;
+        fuzi_q_sim_failure_t* new_failures = (fuzi_q_sim_failure_t*)realloc(worker->failures,
+            new_alloc * sizeof(fuzi_q_sim_failure_t));
+        if (new_failures == NULL) {
+            return -1;
+        }
+        worker->failures = new_failures;
+        worker->nb_failures_alloc = new_alloc;
+    }
+    worker->failures[worker->nb_failures].shard_id = shard_id;
+    worker->failures[worker->nb_failures].ret = ret;
+    worker->failures[worker->nb_failures].icid = *icid;
+    worker->failures[worker->nb_failures].cid_index = cid_index;
+    worker->nb_failures++;
+    return 0;
+}
+
+static int fuzi_q_sim_shard_run(fuzi_q_sim_worker_t* worker, int shard_id)
+{
+    int ret = 0;
+    fuzi_q_sim_farm_t* farm = worker->farm;
+    fuzi_q_sim_shard_t* shard = &farm->shards[shard_id];
+    fuzi_q_sim_config_t* sim_config = NULL;
+    size_t nb_cnx_ctx = (farm->config->nb_connections > 0) ? farm->config->nb_connections : 1;
+    double start_weight[FUZZER_NB_STRATEGIES];
+
+    shard->nb_cnx_required = farm->nb_cnx_required;
+    if (farm->nb_cnx_required > 0) {
+        shard->nb_cnx_required = fuzi_q_trials_share(farm->nb_cnx_required, farm->nb_shards, shard_id);
+        if (shard->nb_cnx_required == 0) {
+            return 0;
+        }
+    }
+    fuzi_q_sim_shard_cid(farm, shard_id, &shard->shard_cid);
+    /* The base and stride of the indices use the client count of the farm,
+     * not that of the shard, which is lower when the shard has fewer trials
+     * than clients, so that the indices of different shards never overlap. */
+    shard->first_cid_index = farm->first_cid_index + (uint64_t)shard_id * farm->nb_clients;
+    shard->cid_stride = (uint64_t)farm->nb_shards * farm->nb_clients;
+    picoquic_lock_mutex(&farm->shard_mutex);
+    memcpy(start_weight, farm->bandit_weight, sizeof(start_weight));
+    picoquic_unlock_mutex(&farm->shard_mutex);
+
+    if ((sim_config = fuzi_q_sim_topology_create(farm->nb_clients, 1, farm->link_spec, fuzi_q_mode_client, fuzi_q_mode_clean_server,
+        nb_cnx_ctx, shard->nb_cnx_required, farm->duration_max, &shard->shard_cid, farm->client_scenario_text, farm->config->qlog_dir,
+        farm->config->server_cert_file, farm->config->server_key_file, farm->picoquic_solution_dir, &farm->settings)) == NULL) {
+        ret = -1;
+    }
+    else {
+        /* Clients are on nodes 1 to nb_nodes - 1. With the counter scheme,
+         * they share the key of the shard and interleave the indices. */
+        int nb_clients = sim_config->nb_nodes - 1;
+
+        shard->nb_clients = nb_clients;
+
+        for (int c = 0; ret == 0 && c < nb_clients; c++) {
+            fuzzer_ctx_t* fuzz_ctx = &sim_config->nodes[1 + c].fuzz_ctx;
+
+            if (farm->bandit_shared != NULL && farm->bandit_shared->mode != fuzzer_bandit_none) {
+                fuzzer_bandit_enable(fuzz_ctx, farm->bandit_shared);
+                memcpy(fuzz_ctx->bandit.weight, start_weight, sizeof(start_weight));
+            }
+            if (ret == 0) {
+                if (farm->cid_scheme == fuzzer_cid_scheme_counter) {
+                    fuzz_ctx->next_cid = shard->shard_cid;
+                }
+                fuzzer_set_cid_scheme(fuzz_ctx, farm->cid_scheme, shard->first_cid_index + c, shard->cid_stride);
+            }
+        }
+        if (ret == 0) {
+            ret = fuzi_q_sim_run(sim_config, UINT64_MAX, FUZI_Q_SIM_MAX_INACTIVE);
+        }
+        for (int c = 0; c < nb_clients; c++) {
+            fuzi_q_client_end_of_run(&sim_config->nodes[1 + c]);
+        }
+        if (farm->bandit_shared != NULL && farm->bandit_shared->mode != fuzzer_bandit_none) {
+            picoquic_lock_mutex(&farm->shard_mutex);
+            for (int c = 0; c < nb_clients; c++) {
+                if (sim_config->nodes[1 + c].fuzz_ctx.bandit.shared != NULL) {
+                    fuzzer_bandit_merge_weights(farm->bandit_weight, start_weight, &sim_config->nodes[1 + c].fuzz_ctx.bandit);
+                }
+            }
+            picoquic_unlock_mutex(&farm->shard_mutex);
+        }
+        for (int c = 0; c < nb_clients; c++) {
+            fuzi_q_ctx_t* client_ctx = &sim_config->nodes[1 + c];
+
+            if (ret != 0 || client_ctx->server_is_down) {
+                /* Report the connections that were in progress */
+                for (size_t i = 0; i < client_ctx->nb_cnx_ctx; i++) {
+                    if (client_ctx->cnx_ctx[i].cnx_client != NULL) {
+                        (void)fuzi_q_sim_add_failure(worker, shard_id, ret, &client_ctx->cnx_ctx[i].icid,
+                            client_ctx->cnx_ctx[i].cid_index);
+                    }
+                }
+            }
+            shard->nb_cnx_tried += client_ctx->nb_cnx_tried;
+            fuzi_q_client_merge_stats(&worker->summary, client_ctx);
+            if (worker->summary.fuzz_ctx.nb_entry_stats > 0 &&
+                fuzzer_entry_stats_merge(&worker->summary.fuzz_ctx, &client_ctx->fuzz_ctx) != 0 && ret == 0) {
+                ret = -1;
+            }
+        }
+        worker->simulated_time += sim_config->simulated_time;
+        worker->nb_shards_run++;
+        fuzi_q_sim_config_delete(sim_config);
+    }
+    shard->ret = ret;
+    return ret;
+}
+
+#ifdef _WINDOWS
+static DWORD WINAPI fuzi_q_sim_worker(LPVOID v_worker)
+#else
+static void* fuzi_q_sim_worker(void* v_worker)
+#endif
+{
+    fuzi_q_sim_worker_t* worker = (fuzi_q_sim_worker_t*)v_worker;
+    fuzi_q_sim_farm_t* farm = worker->farm;
+
+    while (1) {
+        int shard_id;
+        int shard_ret;
+
+        picoquic_lock_mutex(&farm->shard_mutex);
+        shard_id = farm->next_shard;
+        if (shard_id < farm->nb_shards) {
+            farm->next_shard++;
+        }
+        picoquic_unlock_mutex(&farm->shard_mutex);
+        if (shard_id >= farm->nb_shards) {
+            break;
+        }
+        if ((shard_ret = fuzi_q_sim_shard_run(worker, shard_id)) != 0) {
+            if (worker->ret == 0) {
+                worker->ret = shard_ret;
+            }
+            if (worker->nb_failures == 0 || worker->failures[worker->nb_failures - 1].shard_id != shard_id) {
+                /* With the counter scheme, the shard starts at the index of its first client */
+                (void)fuzi_q_sim_add_failure(worker, shard_id, shard_ret, &farm->shards[shard_id].shard_cid,
+                    farm->shards[shard_id].first_cid_index);
+            }
+        }
+    }
+#ifdef _WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+static int fuzi_q_sim_failure_compare(const void* a, const void* b)
+{
+    const fuzi_q_sim_failure_t* fa = (const fuzi_q_sim_failure_t*)a;
+    const fuzi_q_sim_failure_t* fb = (const fuzi_q_sim_failure_t*)b;
+
+    return (fa->shard_id < fb->shard_id) ? -1 : ((fa->shard_id > fb->shard_id) ? 1 : 0);
+}
+
+/* Set the parameters of a farm, and load the frame weights and the test
+ * frames of the clients. The other parameters, such as the scenario, the
+ * CID scheme or the links, may be set by the caller before the run.
+ */
+int fuzi_q_sim_farm_init(fuzi_q_sim_farm_t* farm, picoquic_quic_config_t* config, size_t nb_cnx_required,
+    uint64_t duration_max, picoquic_connection_id_t* init_cid, int nb_shards, int nb_clients,
+    char const* frame_weights_file, char const* corpus_spec, int count_entries)
+{
+    int ret = 0;
+
+    memset(farm, 0, sizeof(fuzi_q_sim_farm_t));
+    farm->config = config;
+    farm->nb_cnx_required = nb_cnx_required;
+    farm->duration_max = duration_max;
+    farm->picoquic_solution_dir = FUZI_Q_SIM_PICOQUIC_SOLUTION_DIR;
+    farm->nb_shards = (nb_shards < 1) ? 1 : nb_shards;
+    farm->nb_clients = (nb_clients < 1) ? 1 : nb_clients;
+    farm->summary.cnx_duration_min = UINT64_MAX;
+    for (int i = 0; i < FUZZER_NB_STRATEGIES; i++) {
+        farm->bandit_weight[i] = 1.0;
+    }
+    if (init_cid != NULL && init_cid->id_len > 0) {
+        farm->root_cid = *init_cid;
+    }
+    else {
+        picoquic_public_random(farm->root_cid.id, 8);
+        farm->root_cid.id_len = 8;
+    }
+
+    /* The test frames are packed and classified once, and shared by all the nodes */
+    fuzi_q_fuzzer_init(&farm->settings, NULL, NULL);
+    if (frame_weights_file != NULL) {
+        ret = fuzzer_load_frame_weights(&farm->settings, frame_weights_file);
+    }
+    if (ret == 0 && corpus_spec != NULL) {
+        ret = fuzzer_load_corpus(&farm->settings, corpus_spec);
+    }
+    if (ret == 0 && count_entries) {
+        /* Same test frames as the clients, to add their counters */
+        farm->has_entry_stats = 1;
+        ret = fuzi_q_fuzzer_init_shared(&farm->summary.fuzz_ctx, NULL, NULL, &farm->settings);
+    }
+    if (ret == 0 && (farm->shards = (fuzi_q_sim_shard_t*)calloc(farm->nb_shards, sizeof(fuzi_q_sim_shard_t))) == NULL) {
+        ret = -1;
+    }
+    if (ret == 0) {
+        if (picoquic_create_mutex(&farm->shard_mutex) != 0) {
+            ret = -1;
+        }
+        else {
+            farm->has_mutex = 1;
+        }
+    }
+    return ret;
+}
+
+/* Run the shards on nb_threads threads, and add their results */
+int fuzi_q_sim_farm_run(fuzi_q_sim_farm_t* farm, int nb_threads)
+{
+    int ret = 0;
+    fuzi_q_sim_worker_t* workers = NULL;
+
+    if (nb_threads < 1) {
+        nb_threads = 1;
+    }
+    if (nb_threads > farm->nb_shards) {
+        nb_threads = farm->nb_shards;
+    }
+    if ((workers = (fuzi_q_sim_worker_t*)malloc(sizeof(fuzi_q_sim_worker_t) * nb_threads)) == NULL) {
+        return -1;
+    }
+    memset(workers, 0, sizeof(fuzi_q_sim_worker_t) * nb_threads);
+    for (int i = 0; ret == 0 && i < nb_threads; i++) {
+        workers[i].farm = farm;
+        workers[i].summary.cnx_duration_min = UINT64_MAX;
+        if (farm->has_entry_stats) {
+            ret = fuzi_q_fuzzer_init_shared(&workers[i].summary.fuzz_ctx, NULL, NULL, &farm->settings);
+        }
+    }
+
+    if (ret == 0) {
+        if (nb_threads == 1) {
+            (void)fuzi_q_sim_worker(&workers[0]);
+        }
+        else {
+            int nb_threads_created = 0;
+
+            for (int i = 0; i < nb_threads; i++) {
+                if (picoquic_create_thread(&workers[i].thread, fuzi_q_sim_worker, &workers[i]) != 0) {
+                    fprintf(stdout, "Cannot create thread %d\n", i);
+                    workers[i].ret = -1;
+                    break;
+                }
+                nb_threads_created++;
+            }
+            for (int i = 0; i < nb_threads_created; i++) {
+                picoquic_delete_thread(&workers[i].thread);
+            }
+        }
+
+        for (int i = 0; i < nb_threads; i++) {
+            if (ret == 0) {
+                ret = workers[i].ret;
+            }
+            fuzi_q_client_merge_stats(&farm->summary, &workers[i].summary);
+            if (farm->has_entry_stats && fuzzer_entry_stats_merge(&farm->summary.fuzz_ctx, &workers[i].summary.fuzz_ctx) != 0 &&
+                ret == 0) {
+                ret = -1;
+            }
+            farm->simulated_time += workers[i].simulated_time;
+            farm->nb_shards_run += workers[i].nb_shards_run;
+            farm->nb_failures += workers[i].nb_failures;
+        }
+    }
+
+    /* List the failures in the order of the shards, whatever the thread that ran them */
+    if (farm->nb_failures > 0 &&
+        (farm->failures = (fuzi_q_sim_failure_t*)malloc(farm->nb_failures * sizeof(fuzi_q_sim_failure_t))) == NULL) {
+        farm->nb_failures = 0;
+    }
+    else if (farm->nb_failures > 0) {
+        size_t nb_copied = 0;
+
+        for (int i = 0; i < nb_threads; i++) {
+            if (workers[i].nb_failures > 0) {
+                memcpy(farm->failures + nb_copied, workers[i].failures, workers[i].nb_failures * sizeof(fuzi_q_sim_failure_t));
+                nb_copied += workers[i].nb_failures;
+            }
+        }
+        qsort(farm->failures, farm->nb_failures, sizeof(fuzi_q_sim_failure_t), fuzi_q_sim_failure_compare);
+    }
+
+    for (int i = 0; i < nb_threads; i++) {
+        fuzi_q_fuzzer_release(&workers[i].summary.fuzz_ctx);
+        if (workers[i].failures != NULL) {
+            free(workers[i].failures);
+        }
+    }
+    free(workers);
+
+    return ret;
+}
+
+void fuzi_q_sim_farm_release(fuzi_q_sim_farm_t* farm)
+{
+    fuzi_q_fuzzer_release(&farm->settings);
+    fuzi_q_fuzzer_release(&farm->summary.fuzz_ctx);
+    if (farm->shards != NULL) {
+        free(farm->shards);
+    }
+    if (farm->failures != NULL) {
+        free(farm->failures);
+    }
+    if (farm->has_mutex) {
+        (void)picoquic_delete_mutex(&farm->shard_mutex);
+    }
+    memset(farm, 0, sizeof(fuzi_q_sim_farm_t));
+}
+
+static void fuzi_q_sim_print_cid(picoquic_connection_id_t* cid)
+{
+    for (uint8_t x = 0; x < cid->id_len; x++) {
+        fprintf(stdout, "%02x", cid->id[x]);
+    }
+}
+
+/* Check that the server certificate and key can be read before starting
+ * the shards. Without -c and -k, the test files of the picoquic sources
+ * are used, which are only found if fuzi_q runs next to them.
+ */
+static int fuzi_q_sim_check_file(char const* file_name, char const* file_role)
+{
+    FILE* F = picoquic_file_open(file_name, "r");
+
+    if (F == NULL) {
+        fprintf(stderr, "Cannot open the server %s: %s\n", file_role, file_name);
+        return -1;
+    }
+    (void)picoquic_file_close(F);
+    return 0;
+}
+
+static int fuzi_q_sim_check_cert(picoquic_quic_config_t* config)
+{
+    int ret = 0;
+    char cert_file[512];
+    char key_file[512];
+
+    if ((config->server_cert_file == NULL) != (config->server_key_file == NULL)) {
+        fprintf(stderr, "In sim mode, set both the server certificate and key, with -c and -k.\n");
+        ret = -1;
+    }
+    else if (config->server_cert_file != NULL) {
+        if (fuzi_q_sim_check_file(config->server_cert_file, "certificate") != 0 ||
+            fuzi_q_sim_check_file(config->server_key_file, "key") != 0) {
+            ret = -1;
+        }
+    }
+    else if (picoquic_get_input_path(cert_file, sizeof(cert_file), FUZI_Q_SIM_PICOQUIC_SOLUTION_DIR, PICOQUIC_TEST_FILE_SERVER_CERT) != 0 ||
+        picoquic_get_input_path(key_file, sizeof(key_file), FUZI_Q_SIM_PICOQUIC_SOLUTION_DIR, PICOQUIC_TEST_FILE_SERVER_KEY) != 0 ||
+        fuzi_q_sim_check_file(cert_file, "certificate") != 0 || fuzi_q_sim_check_file(key_file, "key") != 0) {
+        fprintf(stderr, "The test certificate of picoquic was not found in %s, set the server certificate and key with -c and -k.\n",
+            FUZI_Q_SIM_PICOQUIC_SOLUTION_DIR);
+        ret = -1;
+    }
+    return ret;
+}
+
+int fuzi_q_sim(picoquic_quic_config_t* config, size_t nb_cnx_required, uint64_t duration_max,
+    picoquic_connection_id_t* init_cid, char const* client_scenario_text, int nb_threads, int nb_shards, int nb_clients,
+    fuzzer_cid_scheme_enum cid_scheme, uint64_t first_cid_index, char const* frame_weights_file,
+    char const* bandit_spec, char const* corpus_spec, char const* entry_stats_file, char const* link_spec)
+{
+    int ret = 0;
+    fuzi_q_sim_farm_t farm;
+    fuzi_q_link_model_t link_model;
+    fuzzer_bandit_shared_t bandit_shared = { 0 };
+    uint64_t start_time = picoquic_current_time();
+
+    memset(&farm, 0, sizeof(fuzi_q_sim_farm_t));
+    if (nb_threads < 1) {
+        nb_threads = 1;
+    }
+    if (nb_shards < 1) {
+        nb_shards = nb_threads;
+    }
+    if (nb_threads > nb_shards) {
+        nb_threads = nb_shards;
+    }
+
+    if (fuzi_q_sim_check_cert(config) != 0) {
+        ret = -1;
+    }
+    else if (bandit_spec != NULL && fuzzer_bandit_open(&bandit_shared, bandit_spec) != 0) {
+        fprintf(stderr, "Invalid bandit specification: %s\n", bandit_spec);
+        ret = -1;
+    }
+    else if (link_spec != NULL && fuzi_q_link_model_get(link_spec, 0, &link_model) != 0) {
+        fprintf(stderr, "Invalid link specification: %s\n", link_spec);
+        ret = -1;
+    }
+    else if ((ret = fuzi_q_sim_farm_init(&farm, config, nb_cnx_required, duration_max, init_cid, nb_shards, nb_clients,
+        frame_weights_file, corpus_spec, entry_stats_file != NULL)) == 0) {
+        farm.client_scenario_text = client_scenario_text;
+        farm.cid_scheme = cid_scheme;
+        farm.first_cid_index = first_cid_index;
+        farm.link_spec = link_spec;
+        farm.bandit_shared = &bandit_shared;
+
+        fprintf(stdout, "Simulation, %d shards of %d clients on %d threads, initial CID: ", farm.nb_shards, farm.nb_clients, nb_threads);
+        fuzi_q_sim_print_cid(&farm.root_cid);
+        fprintf(stdout, "\n");
+        fprintf(stdout, "Testing scenario: <%s>\n", (client_scenario_text == NULL) ? fuzi_q_sim_scenario_default : client_scenario_text);
+
+        ret = fuzi_q_sim_farm_run(&farm, nb_threads);
+
+        fuzi_q_client_print_stats(&farm.summary, (nb_cnx_required == 0) ? SIZE_MAX : nb_cnx_required);
+        fprintf(stdout, "Ran %d shards, simulated %fs in %fs.\n", farm.nb_shards_run,
+            ((double)farm.simulated_time) / 1000000.0, ((double)(picoquic_current_time() - start_time)) / 1000000.0);
+        if (farm.nb_failures > 0) {
+            fprintf(stdout, "%zu connections in progress in failed shards, or when the server appeared down:\n", farm.nb_failures);
+            for (size_t j = 0; j < farm.nb_failures; j++) {
+                fprintf(stdout, "Shard %d (initial CID ", farm.failures[j].shard_id);
+                fuzi_q_sim_print_cid(&farm.shards[farm.failures[j].shard_id].shard_cid);
+                fprintf(stdout, "), ret %d, ICID: ", farm.failures[j].ret);
+                fuzi_q_print_icid(cid_scheme, &farm.failures[j].icid, farm.failures[j].cid_index);
+                fprintf(stdout, "\n");
+            }
+        }
+        if (entry_stats_file != NULL && fuzzer_entry_stats_write(&farm.summary.fuzz_ctx, entry_stats_file) != 0 &&
+            ret == 0) {
+            ret = -1;
+        }
+    }
+    fuzi_q_sim_farm_release(&farm);
+    fuzzer_bandit_close(&bandit_shared);
+
+    return ret;
+}
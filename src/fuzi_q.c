@@ -63,24 +63,68 @@
 #include <performance_log.h>
 #include "fuzi_q.h"
 
+/* Letters of the fuzi_q options. They are placed before the picoquic
+ * options in the getopt string, and must not be used by picoquic. */
+#define FUZI_Q_OPTION_LETTERS "d:f:X:J:Y:g:A:Z:H:y:"
+#define FUZI_Q_OPTION_LENGTH 20
 
 void usage()
 {
     fprintf(stderr, "fuzi_q: over the net quic fuzzer\n");
     fprintf(stderr, "Usage: fuzi_q <options> fuzz_mode [server_name port [scenario]] \n");
+    fprintf(stderr, "       fuzi_q <options> server [max_contexts]\n");
+    fprintf(stderr, "       fuzi_q [-Z corpus] corpus file_name\n");
+    fprintf(stderr, "       fuzi_q <options> sim [scenario]\n");
     fprintf(stderr, "  fuzz_mode can be one of client, clean or server.");
     fprintf(stderr, "  For the client or clean fuzz_mode, specify server_name and port.\n");
     fprintf(stderr, "  For the server fuzz_mode, use -p to specify the port,\n");
     fprintf(stderr, "  and also -c and -k for certificate and matching private key.\n");
+    fprintf(stderr, "  The server keeps at most max_contexts fuzzing contexts, by default no limit.\n");
+    fprintf(stderr, "  The corpus mode checks the test frames, removes duplicates,\n");
+    fprintf(stderr, "  and writes them to a corpus file.\n");
+    fprintf(stderr, "  The sim mode runs the fuzzing client and a picoquic server in the same\n");
+    fprintf(stderr, "  process, over simulated links, in virtual time. With -d, the duration\n");
+    fprintf(stderr, "  is in simulated seconds. The server uses -c and -k if specified, or the\n");
+    fprintf(stderr, "  test certificate of the picoquic sources in ../picoquic, if found there.\n");
     picoquic_config_usage();
     fprintf(stderr, "fuzi_q options:\n");
     fprintf(stderr, "  -f nb_fuzz_trials     Number of trials to be attempted.\n");
     fprintf(stderr, "  -d duration_max       Duration of the test, in seconds.\n");
     fprintf(stderr, "  -X initial_cid        CID of first client connection.\n");
+    fprintf(stderr, "  -J threads[:shards[:clients]] Number of client threads, each with its own connections;\n");
+    fprintf(stderr, "                        in sim mode, also the number of servers, default one per thread,\n");
+    fprintf(stderr, "                        and of clients per server.\n");
+    fprintf(stderr, "  -Y cid_scheme         Derivation of CIDs, sha256 (default) or counter[:first_index].\n");
+    fprintf(stderr, "  -g weights_file       Weights of the frame fuzzers, one \"name weight\" per line.\n");
+    fprintf(stderr, "  -A bandit             Adaptive choice of strategies, exp3[:trace_file] or replay:trace_file.\n");
+    fprintf(stderr, "  -Z [+]corpus_file     Test frames loaded from a corpus file, added to the built-in ones with +.\n");
+    fprintf(stderr, "  -H stats_file         Counters of the test frames written at exit, as CSV, or JSON if *.json.\n");
+    fprintf(stderr, "  -y link_spec          Models of the links in sim mode, e.g. \"bw=100,lat=20000;0:ge=0.01:0.2\",\n");
+    fprintf(stderr, "                        with bw, lat, queue, jitter, loss, ge, reorder, dup, mtu, seed.\n");
     fprintf(stderr, "\nThe scenario argument is same as for picoquicdemo.\n");
     fprintf(stderr, "\nThe fuzzing of a connection depends on the value of the initial CID for that connection. On the client,\n");
     fprintf(stderr, "these CIDs are derived from the previous one using SHA 256. By default, the very first CID is picked\n");
     fprintf(stderr, "at random, but it can be specifed using the parameter -X when reproducing a previous fuzz.\n");
+    fprintf(stderr, "\nWith -J, the trials are shared between the threads. Each thread opens up to the number of\n");
+    fprintf(stderr, "connections set with -x, and derives its own chain of CIDs from a branch of the initial CID.\n");
+    fprintf(stderr, "The first CID of each thread is printed, and can be used with -X to replay that thread.\n");
+    fprintf(stderr, "\nIn sim mode, the trials are shared between the shards set with -J, each running its own\n");
+    fprintf(stderr, "clients and server, and the threads run the shards. Like client threads, shard N\n");
+    fprintf(stderr, "starts from branch N of the initial CID, or from CID number N with -Y counter.\n");
+    fprintf(stderr, "\nWith -Y counter, CID number N is derived directly from the initial CID and N, and threads\n");
+    fprintf(stderr, "interleave the values of N. A single connection can be replayed with -X, -Y counter:N and -f 1.\n");
+    fprintf(stderr, "\nWith -A exp3, the client favors the fuzzing strategies that led to time outs, unusual\n");
+    fprintf(stderr, "errors or a server failure. The decisions can be saved to a trace and replayed with -A replay.\n");
+    fprintf(stderr, "\nWith -H, the client counts how often each test frame was injected, and how many of the\n");
+    fprintf(stderr, "connections in which it was injected were closed by the peer with an unusual error, timed out\n");
+    fprintf(stderr, "or saw the server fail. These are also the outcomes that -A exp3 favors. Connections still\n");
+    fprintf(stderr, "open at the end of the run are counted apart.\n");
+    fprintf(stderr, "\nThe frame fuzzers named in the weights file are picked in proportion to their weight, and\n");
+    fprintf(stderr, "frames with a weight of 0 are not fuzzed. The default weight is 1. Frame fuzzers:\n");
+    for (size_t i = 0; i < FUZZER_NB_FRAME_FUZZERS; i++) {
+        fprintf(stderr, "%s%s", (i % 6 == 0) ? "\n    " : ", ", fuzzer_frame_fuzzer_name(i));
+    }
+    fprintf(stderr, "\n");
     exit(1);
 }
 
@@ -106,6 +150,18 @@ int main(int argc, char** argv)
     size_t nb_fuzz_trials = 0;
     uint64_t fuzz_duration_max = 0;
     int arg_as_int;
+    int nb_threads = 1;
+    int nb_shards = 0;
+    int nb_sim_clients = 1;
+    size_t icid_capacity = 0;
+    fuzzer_cid_scheme_enum cid_scheme = fuzzer_cid_scheme_sha256_chain;
+    uint64_t first_cid_index = 0;
+    char const* frame_weights_file = NULL;
+    char const* bandit_spec = NULL;
+    char const* corpus_spec = NULL;
+    char const* corpus_file = NULL;
+    char const* entry_stats_file = NULL;
+    char const* link_spec = NULL;
     picoquic_connection_id_t init_cid = { 0 };
     char const* scenario = NULL;
 #ifdef _WINDOWS
@@ -113,8 +169,14 @@ int main(int argc, char** argv)
     (void)WSA_START(MAKEWORD(2, 2), &wsaData);
 #endif
     picoquic_config_init(&config);
-    memcpy(option_string, "d:f:X:", 6);
-    ret = picoquic_config_option_letters(option_string + 6, sizeof(option_string) - 6, NULL);
+    memcpy(option_string, FUZI_Q_OPTION_LETTERS, FUZI_Q_OPTION_LENGTH);
+    ret = picoquic_config_option_letters(option_string + FUZI_Q_OPTION_LENGTH,
+        sizeof(option_string) - FUZI_Q_OPTION_LENGTH, NULL);
+    if (ret == 0 && (opt = fuzi_q_option_letters_overlap(FUZI_Q_OPTION_LETTERS, option_string + FUZI_Q_OPTION_LENGTH)) != 0) {
+        /* getopt would match the fuzi_q option, and hide the picoquic one */
+        fprintf(stderr, "Option -%c is defined by both fuzi_q and picoquic.\n", opt);
+        exit(1);
+    }
 
     if (ret == 0) {
         /* Get the parameters */
@@ -144,6 +206,42 @@ int main(int argc, char** argv)
                     usage();
                 }
                 break;
+            case 'J':
+                if (fuzi_q_parse_threads(optarg, &nb_threads, &nb_shards, &nb_sim_clients) != 0) {
+                    fprintf(stderr, "Invalid number of threads, shards or clients: %s\n", optarg);
+                    usage();
+                }
+                break;
+            case 'g':
+                frame_weights_file = optarg;
+                break;
+            case 'A':
+                bandit_spec = optarg;
+                break;
+            case 'Z':
+                corpus_spec = optarg;
+                break;
+            case 'H':
+                entry_stats_file = optarg;
+                break;
+            case 'y': {
+                fuzi_q_link_model_t link_model;
+
+                if (fuzi_q_link_model_get(optarg, 0, &link_model) != 0) {
+                    fprintf(stderr, "Invalid link specification: %s\n", optarg);
+                    usage();
+                }
+                else {
+                    link_spec = optarg;
+                }
+                break;
+            }
+            case 'Y':
+                if (fuzzer_parse_cid_scheme(optarg, &cid_scheme, &first_cid_index) != 0) {
+                    fprintf(stderr, "Invalid CID scheme: %s\n", optarg);
+                    usage();
+                }
+                break;
             default:
                 if (picoquic_config_command_line(opt, &optind, argc, (char const**)argv, optarg, &config) != 0) {
                     usage();
@@ -165,6 +263,12 @@ int main(int argc, char** argv)
         else if (strcmp(a_fuzz_mode, "clean") == 0) {
             fuzz_mode = fuzi_q_mode_clean;
         }
+        else if (strcmp(a_fuzz_mode, "corpus") == 0) {
+            fuzz_mode = fuzi_q_mode_corpus;
+        }
+        else if (strcmp(a_fuzz_mode, "sim") == 0) {
+            fuzz_mode = fuzi_q_mode_sim;
+        }
         else {
             fprintf(stdout, "Fuzz mode incorrect, %s\n", a_fuzz_mode);
         }
@@ -196,6 +300,30 @@ int main(int argc, char** argv)
                 scenario = argv[optind++];
             }
         }
+        else if (fuzz_mode == fuzi_q_mode_sim) {
+            if (optind < argc) {
+                scenario = argv[optind++];
+            }
+        }
+        else if (fuzz_mode == fuzi_q_mode_server) {
+            if (optind < argc) {
+                if ((arg_as_int = atoi(argv[optind])) <= 0) {
+                    fprintf(stderr, "Invalid number of contexts: %s\n", argv[optind]);
+                    usage();
+                }
+                icid_capacity = (size_t)arg_as_int;
+                optind++;
+            }
+        }
+        else if (fuzz_mode == fuzi_q_mode_corpus) {
+            if (optind >= argc) {
+                fprintf(stdout, "Expected file name after corpus\n");
+                usage();
+            }
+            else {
+                corpus_file = argv[optind++];
+            }
+        }
 
         if (optind < argc) {
             fprintf(stderr, "Unexpected arguments: %s\n", argv[optind]);
@@ -205,10 +333,18 @@ int main(int argc, char** argv)
 
     /* Run */
     if (fuzz_mode == fuzi_q_mode_client || fuzz_mode == fuzi_q_mode_clean) {
-        ret = fuzi_q_client(fuzz_mode, server_name, server_port, &config, nb_fuzz_trials, fuzz_duration_max, &init_cid, scenario);
+        ret = fuzi_q_client(fuzz_mode, server_name, server_port, &config, nb_fuzz_trials, fuzz_duration_max, &init_cid, scenario, nb_threads,
+            cid_scheme, first_cid_index, frame_weights_file, bandit_spec, corpus_spec, entry_stats_file);
+    }
+    else if (fuzz_mode == fuzi_q_mode_sim) {
+        ret = fuzi_q_sim(&config, nb_fuzz_trials, fuzz_duration_max, &init_cid, scenario, nb_threads, nb_shards, nb_sim_clients,
+            cid_scheme, first_cid_index, frame_weights_file, bandit_spec, corpus_spec, entry_stats_file, link_spec);
+    }
+    else if (fuzz_mode == fuzi_q_mode_corpus) {
+        ret = fuzi_q_corpus_export(corpus_spec, corpus_file);
     }
     else {
-        ret = fuzi_q_server(fuzz_mode, &config, fuzz_duration_max);
+        ret = fuzi_q_server(fuzz_mode, &config, fuzz_duration_max, icid_capacity, frame_weights_file, corpus_spec);
     }
     /* Clean up */
     picoquic_config_clear(&config);
@@ -24,6 +24,7 @@
 #endif
 #include "fuzi_q_tests.h"
 #include "picoquic_utils.h"
+#include "fuzi_q.h"
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
@@ -32,6 +33,7 @@
 typedef struct st_fuzi_q_test_def_t {
     char const* test_name;
     int (*test_fn)();
+    int is_bench;
 } fuzi_q_test_def_t;
 
 typedef enum {
@@ -45,7 +47,29 @@ static const fuzi_q_test_def_t test_table[] =
 {
     { "basic", fuzi_q_basic_test },
     { "basic_client", fuzi_q_basic_client_test },
-    { "icid_table", icid_table_test}
+    { "icid_table", icid_table_test},
+    { "cnx_index", cnx_index_test},
+    { "cid_counter", cid_counter_test},
+    { "frame_index", frame_index_test},
+    { "frame_fuzzer_table", frame_fuzzer_table_test},
+    { "bandit", bandit_test},
+    { "pilot_stream", pilot_stream_test},
+    { "corpus_pack", corpus_pack_test},
+    { "corpus_file", corpus_file_test},
+    { "corpus_class", corpus_class_test},
+    { "corpus_layer", corpus_layer_test},
+    { "corpus_alpn", corpus_alpn_test},
+    { "corpus_check", corpus_check_test},
+    { "entry_stats", entry_stats_test},
+    { "basic_multi", fuzi_q_basic_multi_test},
+    { "sim_event_heap", fuzi_q_sim_event_heap_test},
+    { "sim_farm", fuzi_q_sim_farm_test},
+    { "link_model", fuzi_q_link_model_test},
+    { "cnx_heap", cnx_heap_test},
+    { "client_options", client_options_test},
+    { "icid_wheel", icid_wheel_test},
+    /* Benchmarks are only run by name, or with -b */
+    { "icid_table_bench", icid_table_bench, 1}
 };
 
 static size_t const nb_tests = sizeof(test_table) / sizeof(fuzi_q_test_def_t);
@@ -93,11 +117,13 @@ int usage(char const* argv0)
     }
     fprintf(stderr, "Options: \n");
     fprintf(stderr, "  -x test           Do not run the specified test.\n");
+    fprintf(stderr, "  -b                Also run the benchmarks when no test is specified.\n");
     fprintf(stderr, "  -n                Disable debug prints.\n");
     fprintf(stderr, "  -r                Retry failed tests with debug print enabled.\n");
     fprintf(stderr, "  -h                Print this help message\n");
     fprintf(stderr, "  -S solution_dir   Set the path to the source files to find the default files\n");
     fprintf(stderr, "  -P picoquic_dir   Set the path to the picoquic sources to find the cert files\n");
+    fprintf(stderr, "  -l link_spec      Models of the simulated links, as in fuzi_q -y\n");
 
     return -1;
 }
@@ -124,6 +150,7 @@ int main(int argc, char** argv)
     int opt;
     int disable_debug = 0;
     int retry_failed_test = 0;
+    int run_benches = 0;
 
     if (test_status == NULL)
     {
@@ -132,7 +159,7 @@ int main(int argc, char** argv)
     }
     else
     {
-        while (ret == 0 && (opt = getopt(argc, argv, "P:S:x:nrh")) != -1) {
+        while (ret == 0 && (opt = getopt(argc, argv, "P:S:l:x:bnrh")) != -1) {
             switch (opt) {
             case 'x': {
                 int test_number = get_test_number(optarg);
@@ -152,6 +179,21 @@ int main(int argc, char** argv)
             case 'S':
                 fuzi_q_test_solution_dir = optarg;
                 break;
+            case 'l': {
+                fuzi_q_link_model_t link_model;
+
+                if (fuzi_q_link_model_get(optarg, 0, &link_model) != 0) {
+                    fprintf(stderr, "Invalid link specification: %s\n", optarg);
+                    ret = usage(argv[0]);
+                }
+                else {
+                    fuzi_q_test_link_spec = optarg;
+                }
+                break;
+            }
+            case 'b':
+                run_benches = 1;
+                break;
             case 'n':
                 disable_debug = 1;
                 break;
@@ -180,7 +222,10 @@ int main(int argc, char** argv)
         {
             if (optind >= argc) {
                 for (size_t i = 0; i < nb_tests; i++) {
-                    if (test_status[i] == test_not_run) {
+                    if (test_table[i].is_bench && !run_benches) {
+                        continue;
+                    }
+                    else if (test_status[i] == test_not_run) {
                         nb_test_tried++;
                         if (do_one_test(i, stdout) != 0) {
                             test_status[i] = test_failed;
@@ -45,635 +45,548 @@
 
 char const* fuzi_q_test_picoquic_solution_dir = fuzi_q_PICOQUIC_DEFAULT_SOLUTION_DIR;
 char const* fuzi_q_test_solution_dir = fuzi_q_DEFAULT_SOLUTION_DIR;
+/* Models of the simulated links, default model if NULL */
+char const* fuzi_q_test_link_spec = NULL;
 
 
-typedef struct st_fuzi_q_test_attach_t {
-    int node_id;
-    int link_id;
-    struct sockaddr_storage node_addr;
-} fuzi_q_test_attach_t;
-
-typedef struct st_fuzi_q_test_config_t {
-    uint64_t simulated_time;
-    uint64_t simulate_loss;
-    char test_server_cert_file[512];
-    char test_server_key_file[512];
-    char test_server_cert_store_file[512];
-    uint8_t ticket_encryption_key[16];
-    int nb_nodes; /* should be 2 in default configuration  */
-    fuzi_q_ctx_t* nodes;
-    int nb_links; /* should be 2 in default configuration  */
-    picoquictest_sim_link_t** links;
-    int* return_links;
-    int nb_attachments; /* should be 2 in default configuration  */
-    fuzi_q_test_attach_t* attachments;
-    uint64_t cnx_error_client;
-    uint64_t cnx_error_server;
-} fuzi_q_test_config_t;
-
-/* Find arrival context by link ID and destination address */
-int fuzi_q_test_find_dest_node(fuzi_q_test_config_t* config, int link_id, struct sockaddr* addr)
+int fuzi_q_test_check_fuzz(size_t nb_cnx_required, fuzzer_ctx_t * fuzz_ctx)
 {
-    int node_id = -1;
+    size_t total_tried = 0;
+    int ret = 0;
 
-    for (int d_attach = 0; d_attach < config->nb_attachments; d_attach++) {
-        if (config->attachments[d_attach].link_id == link_id &&
-            picoquic_compare_addr((struct sockaddr*)&config->attachments[d_attach].node_addr, addr) == 0) {
-            node_id = config->attachments[d_attach].node_id;
-            break;
+    for (int i = 0; ret == 0 && i < fuzzer_cnx_state_max; i++)
+    {
+        total_tried += fuzz_ctx->nb_cnx_tried[i];
+        if (fuzz_ctx->nb_cnx_tried[i] == 0) {
+            DBG_PRINTF("No trials for connection fuzzing state %d", i);
+            ret = -1;
         }
-    }
-    return (node_id);
-}
-
-/* Find departure link by destination address.
- * The code verifies that the return link is present.
- * If srce_addr is prsent and set to AF_UNSPEC, it is filled with appropriate address.
- */
-int fuzi_q_test_find_send_link(fuzi_q_test_config_t* config, int srce_node_id, const struct sockaddr* dest_addr, struct sockaddr_storage* srce_addr)
-{
-    int dest_link_id = -1;
-
-    for (int s_attach = 0; s_attach < config->nb_attachments && dest_link_id == -1; s_attach++) {
-        if (config->attachments[s_attach].node_id == srce_node_id) {
-            int link_id = config->return_links[config->attachments[s_attach].link_id];
-            for (int d_attach = 0; d_attach < config->nb_attachments; d_attach++) {
-                if (config->attachments[d_attach].link_id == link_id &&
-                    picoquic_compare_addr((struct sockaddr*)&config->attachments[d_attach].node_addr, dest_addr) == 0) {
-                    if (srce_addr != NULL && srce_addr->ss_family == AF_UNSPEC) {
-                        picoquic_store_addr(srce_addr, (struct sockaddr*)&config->attachments[s_attach].node_addr);
-                    }
-                    dest_link_id = config->attachments[d_attach].link_id;
-                    break;
-                }
-            }
+        else if (fuzz_ctx->nb_cnx_tried[i] > fuzz_ctx->nb_cnx_fuzzed[i]) {
+            DBG_PRINTF("Connection fuzzing state % d, tried %zu, fuzzed %zu", i,
+                fuzz_ctx->nb_cnx_tried[i], fuzz_ctx->nb_cnx_fuzzed[i]);
+            ret = -1;
         }
     }
 
-    return dest_link_id;
-}
-
-/* Find destination address from source and destination node id. */
-struct sockaddr* fuzi_q_test_find_send_addr(fuzi_q_test_config_t* config, int srce_node_id, int dest_node_id)
-{
-    struct sockaddr* dest_addr = NULL;
-    for (int s_attach = 0; s_attach < config->nb_attachments && dest_addr == NULL; s_attach++) {
-        if (config->attachments[s_attach].node_id == srce_node_id) {
-            int link_id = config->return_links[config->attachments[s_attach].link_id];
-            for (int d_attach = 0; d_attach < config->nb_attachments; d_attach++) {
-                if (config->attachments[d_attach].link_id == link_id &&
-                    config->attachments[d_attach].node_id == dest_node_id) {
-                    dest_addr = (struct sockaddr*)&config->attachments[d_attach].node_addr;
-                    break;
-                }
-            }
-        }
+    if (fuzz_ctx->wait_max[fuzzer_cnx_state_ready] <= 1 || fuzz_ctx->wait_max[fuzzer_cnx_state_ready] <= 1) {
+        DBG_PRINTF("Connection fuzzing state % d, wait_max %d, waited_max %d", fuzzer_cnx_state_ready,
+            fuzz_ctx->wait_max[fuzzer_cnx_state_ready], fuzz_ctx->waited_max[fuzzer_cnx_state_ready]);
+        ret = -1;
     }
 
-    return dest_addr;
+    if (total_tried != nb_cnx_required) {
+        DBG_PRINTF("Tried %zu instead of %zu", total_tried, nb_cnx_required);
+        ret = -1;
+    }
+    return ret;
 }
 
-/* Packet departure from selected node */
-int fuzi_q_test_packet_departure(fuzi_q_test_config_t* config, int node_id, int* is_active)
+/* Basic loop, supporting 4 variations */
+int fuzi_q_basic_test_loop(int fuzz_client, int fuzz_server)
 {
     int ret = 0;
-    picoquictest_sim_packet_t* packet = picoquictest_sim_link_create_packet();
+    fuzi_q_mode_enum client_fuzz_mode = (fuzz_client) ? fuzi_q_mode_client : fuzi_q_mode_clean;
+    fuzi_q_mode_enum server_fuzz_mode = (fuzz_server) ? fuzi_q_mode_server : fuzi_q_mode_clean_server;
+    size_t nb_cnx_required = 16;
+    const uint64_t max_time = 360000000;
+    const int max_inactive = 128;
+    fuzi_q_sim_config_t* config = fuzi_q_sim_basic_config_create(fuzi_q_test_link_spec, client_fuzz_mode, server_fuzz_mode,
+        4, nb_cnx_required, 360000000, NULL, NULL, ".", NULL, NULL, fuzi_q_test_picoquic_solution_dir);
 
-    if (packet == NULL) {
-        /* memory error during test. Something is really wrong. */
+    if (config == NULL) {
         ret = -1;
     }
     else {
-        /* check whether there is something to send */
-        int if_index = 0;
-
-        ret = picoquic_prepare_next_packet(config->nodes[node_id].quic, config->simulated_time,
-            packet->bytes, PICOQUIC_MAX_PACKET_SIZE, &packet->length,
-            &packet->addr_to, &packet->addr_from, &if_index, NULL, NULL);
+        ret = fuzi_q_sim_run(config, max_time, max_inactive);
+    }
 
-        if (ret != 0)
-        {
-            /* useless test, but makes it easier to add a breakpoint under debugger */
-            free(packet);
+    if (ret == 0) {
+        fuzi_q_ctx_t* fuzi_q_ctx = &config->nodes[1];
+        if (fuzi_q_ctx->server_is_down) {
+            DBG_PRINTF("Server down at time %" PRIu64, config->simulated_time);
             ret = -1;
         }
-        else if (packet->length > 0) {
-            /* Find the exit link. This assumes destination addresses are available on only one link */
-            int link_id = fuzi_q_test_find_send_link(config, node_id, (struct sockaddr*)&packet->addr_to, &packet->addr_from);
-
-            if (link_id >= 0) {
-                *is_active = 1;
-                picoquictest_sim_link_submit(config->links[link_id], packet, config->simulated_time);
-            }
-            else {
-                /* packet cannot be routed. */
-                free(packet);
-            }
+        else if (fuzi_q_ctx->nb_cnx_tried != nb_cnx_required) {
+            DBG_PRINTF("Tried %zu connections instead of %zu" PRIu64, fuzi_q_ctx->nb_cnx_tried, nb_cnx_required);
+            ret = -1;
+        }
+        else if (client_fuzz_mode == fuzi_q_mode_client) {
+            ret = fuzi_q_test_check_fuzz(nb_cnx_required, &fuzi_q_ctx->fuzz_ctx);
         }
     }
 
+    /* Clear everything. */
+    if (config != NULL) {
+        fuzi_q_sim_config_delete(config);
+    }
+
     return ret;
 }
 
-int fuzi_q_test_post_departure(fuzi_q_test_config_t* config, int node_id, int* is_active)
-{
-    fuzi_q_ctx_t * fuzi_q_ctx = &config->nodes[node_id];
-    int ret = 0;
 
-    if (fuzi_q_ctx->fuzz_mode == fuzi_q_mode_client ||
-        fuzi_q_ctx->fuzz_mode == fuzi_q_mode_clean) {
-        ret = fuzi_q_loop_check_cnx(fuzi_q_ctx, config->simulated_time, is_active);
-    }
+/* Basic test, place holder for now. */
+int fuzi_q_basic_test()
+{
+    return fuzi_q_basic_test_loop(0, 0);
+}
 
-    return ret;
+/* Basic test, place holder for now. */
+int fuzi_q_basic_client_test()
+{
+    return fuzi_q_basic_test_loop(1, 0);
 }
 
-/* Process arrival of a packet from a link */
-int fuzi_q_test_packet_arrival(fuzi_q_test_config_t* config, int link_id, int* is_active)
+/* Several clients with two addresses each, sharing the server.
+ * Check that each address is routed to its own link and node, then
+ * that the clients together do the required trials. */
+int fuzi_q_basic_multi_test()
 {
     int ret = 0;
-    picoquictest_sim_packet_t* packet = picoquictest_sim_link_dequeue(config->links[link_id], config->simulated_time);
+    const int nb_clients = 4;
+    const int nb_addresses = 2;
+    size_t nb_cnx_required = 16;
+    size_t nb_cnx_tried = 0;
+    fuzi_q_sim_config_t* config = fuzi_q_sim_topology_create(nb_clients, nb_addresses, fuzi_q_test_link_spec, fuzi_q_mode_client,
+        fuzi_q_mode_clean_server, 4, nb_cnx_required, 360000000, NULL, NULL, ".", NULL, NULL,
+        fuzi_q_test_picoquic_solution_dir, NULL);
 
-    if (packet == NULL) {
-        /* unexpected, probably bug in test program */
+    if (config == NULL || config->nb_nodes != nb_clients + 1) {
         ret = -1;
     }
-    else {
-        int node_id = fuzi_q_test_find_dest_node(config, link_id, (struct sockaddr*)&packet->addr_to);
-        uint64_t loss = (config->simulate_loss & 1);
-        config->simulate_loss >>= 1;
-        config->simulate_loss |= (loss << 63);
 
-        if (node_id >= 0 && loss == 0) {
-            *is_active = 1;
+    for (int i = 0; ret == 0 && i < config->nb_attachments; i++) {
+        struct sockaddr_storage srce_addr = { 0 };
+        struct sockaddr* addr = (struct sockaddr*)&config->attachments[i].node_addr;
+        int srce_node = (i == 0) ? 1 : 0;
+        int link_id = fuzi_q_sim_find_send_link(config, srce_node, addr, &srce_addr);
 
-            ret = picoquic_incoming_packet(config->nodes[node_id].quic,
-                packet->bytes, (uint32_t)packet->length,
-                (struct sockaddr*)&packet->addr_from,
-                (struct sockaddr*)&packet->addr_to, 0, 0,
-                config->simulated_time);
+        if (link_id != i || fuzi_q_sim_find_dest_node(config, link_id, addr) != config->attachments[i].node_id ||
+            fuzi_q_sim_find_dest_node(config, (i + 1) % config->nb_links, addr) != -1 ||
+            picoquic_compare_addr((struct sockaddr*)&srce_addr, fuzi_q_sim_find_node_addr(config, srce_node)) != 0) {
+            DBG_PRINTF("Wrong route for attachment %d, link %d", i, link_id);
+            ret = -1;
         }
-        else {
-            /* simulated loss */
+    }
+
+    if (ret == 0) {
+        ret = fuzi_q_sim_run(config, 360000000, 128);
+    }
+
+    for (int c = 1; ret == 0 && c <= nb_clients; c++) {
+        if (config->nodes[c].server_is_down) {
+            DBG_PRINTF("Server down for client %d at time %" PRIu64, c, config->simulated_time);
+            ret = -1;
         }
-        free(packet);
+        nb_cnx_tried += config->nodes[c].nb_cnx_tried;
+    }
+
+    if (ret == 0 && nb_cnx_tried != nb_cnx_required) {
+        DBG_PRINTF("Tried %zu connections instead of %zu", nb_cnx_tried, nb_cnx_required);
+        ret = -1;
+    }
+
+    if (config != NULL) {
+        fuzi_q_sim_config_delete(config);
     }
 
     return ret;
 }
 
-/* Execute the loop */
-int fuzi_q_test_loop_step(fuzi_q_test_config_t* config, int* is_active)
+/* Heap of the next event times of nodes and links. The event popped
+ * from the heap must be the one that a linear scan would find: the
+ * earliest, and for the same time, the lowest number, so nodes before
+ * links. Times are drawn in a small range to create many ties, and
+ * changed up and down.
+ */
+static int fuzi_q_sim_event_scan(fuzi_q_sim_config_t* config)
+{
+    int first = 0;
+
+    for (int i = 1; i < config->nb_events; i++) {
+        if (config->event_time[i] < config->event_time[first]) {
+            first = i;
+        }
+    }
+    return first;
+}
+
+static int fuzi_q_sim_event_heap_check(fuzi_q_sim_config_t* config)
 {
     int ret = 0;
-    int next_step_type = 0;
-    int next_step_index = 0;
-    uint64_t next_time = UINT64_MAX;
-
-    /* Check which node has the lowest wait time */
-    for (int i = 0; i < config->nb_nodes; i++) {
-        /* Look at both quic timer and fuzi level timer */
-        uint64_t quic_time = picoquic_get_next_wake_time(config->nodes[i].quic, config->simulated_time);
-        uint64_t fuzz_time = fuzi_q_next_time(&config->nodes[i]);
-        if (quic_time > fuzz_time) {
-            quic_time = fuzz_time;
-        }
-        if (quic_time < next_time) {
-            next_time = quic_time;
-            next_step_type = 1;
-            next_step_index = i;
-        }
-    }
-    /* Check which link has the lowest arrival time */
-    for (int i = 0; i < config->nb_links; i++) {
-        if (config->links[i]->first_packet != NULL &&
-            config->links[i]->first_packet->arrival_time < next_time) {
-            next_time = config->links[i]->first_packet->arrival_time;
-            next_step_type = 2;
-            next_step_index = i;
-        }
-    }
-    if (next_time < UINT64_MAX) {
-        /* Update the time */
-        if (next_time > config->simulated_time) {
-            config->simulated_time = next_time;
-        }
-        switch (next_step_type) {
-        case 1: /* context #next_step_index is ready to send data */
-            ret = fuzi_q_test_packet_departure(config, next_step_index, is_active);
-            if (ret == 0) {
-                ret = fuzi_q_test_post_departure(config, next_step_index, is_active);
-            }
-            break;
-        case 2:
-            /* If arrival, take next packet, find destination by address, and submit to end-of-link context */
-            ret = fuzi_q_test_packet_arrival(config, next_step_index, is_active);
-            break;
-        default:
-            /* This should never happen! */
+
+    for (int x = 0; ret == 0 && x < config->nb_events; x++) {
+        int event_id = config->event_heap[x];
+        int parent = config->event_heap[(x - 1) / 2];
+
+        if (config->event_pos[event_id] != x) {
+            ret = -1;
+        }
+        else if (x > 0 && (config->event_time[parent] > config->event_time[event_id] ||
+            (config->event_time[parent] == config->event_time[event_id] && parent > event_id))) {
             ret = -1;
-            break;
         }
     }
-    else {
+    if (ret == 0 && config->event_heap[0] != fuzi_q_sim_event_scan(config)) {
         ret = -1;
     }
-
     return ret;
 }
 
-/* Delete a configuration */
-void fuzi_q_test_config_delete(fuzi_q_test_config_t* config)
+int fuzi_q_sim_event_heap_test()
 {
-    if (config->nodes != NULL) {
-        for (int i = 0; i < config->nb_nodes; i++) {
-            fuzi_q_release_client_context(&config->nodes[i]);
+    int ret = 0;
+    fuzi_q_sim_config_t config;
+    uint64_t random_ctx = 0xe7e4;
+
+    memset(&config, 0, sizeof(config));
+    config.nb_nodes = 5;
+    config.nb_links = 8;
+    config.nb_events = config.nb_nodes + config.nb_links;
+    config.event_time = (uint64_t*)malloc(config.nb_events * sizeof(uint64_t));
+    config.event_heap = (int*)malloc(config.nb_events * sizeof(int));
+    config.event_pos = (int*)malloc(config.nb_events * sizeof(int));
+    if (config.event_time == NULL || config.event_heap == NULL || config.event_pos == NULL) {
+        ret = -1;
+    }
+    else {
+        for (int i = 0; i < config.nb_events; i++) {
+            config.event_time[i] = UINT64_MAX;
+            config.event_heap[i] = i;
+            config.event_pos[i] = i;
         }
-        free(config->nodes);
     }
 
-    if (config->links != NULL) {
-        for (int i = 0; i < config->nb_links; i++) {
-            if (config->links[i] != NULL) {
-                picoquictest_sim_link_delete(config->links[i]);
-            }
+    /* All events at the same time pop in the order of their numbers */
+    for (int i = config.nb_events - 1; ret == 0 && i >= 0; i--) {
+        fuzi_q_sim_event_update(&config, i, 1000);
+    }
+    for (int i = 0; ret == 0 && i < config.nb_events; i++) {
+        if (config.event_heap[0] != i || fuzi_q_sim_event_heap_check(&config) != 0) {
+            DBG_PRINTF("Popped event %d instead of %d", config.event_heap[0], i);
+            ret = -1;
+        }
+        else {
+            fuzi_q_sim_event_update(&config, i, UINT64_MAX);
         }
-        free(config->links);
     }
 
-    if (config->return_links != NULL) {
-        free(config->return_links);
-    }
+    /* Random updates, earlier or later, then pop everything */
+    for (int step = 0; ret == 0 && step < 4096; step++) {
+        int event_id = (int)picoquic_test_uniform_random(&random_ctx, config.nb_events);
+        uint64_t event_time = (picoquic_test_uniform_random(&random_ctx, 16) == 0) ? UINT64_MAX :
+            picoquic_test_uniform_random(&random_ctx, 8);
+
+        fuzi_q_sim_event_update(&config, event_id, event_time);
+        if (fuzi_q_sim_event_heap_check(&config) != 0) {
+            DBG_PRINTF("Heap differs from the scan after step %d", step);
+            ret = -1;
+        }
+        else if ((step % 512) == 511) {
+            while (ret == 0 && config.event_time[config.event_heap[0]] < UINT64_MAX) {
+                int first = config.event_heap[0];
 
-    if (config->attachments != NULL) {
-        free(config->attachments);
+                fuzi_q_sim_event_update(&config, first, UINT64_MAX);
+                if (fuzi_q_sim_event_heap_check(&config) != 0) {
+                    DBG_PRINTF("Heap differs from the scan after popping event %d", first);
+                    ret = -1;
+                }
+            }
+        }
     }
 
-    free(config);
+    if (config.event_time != NULL) {
+        free(config.event_time);
+    }
+    if (config.event_heap != NULL) {
+        free(config.event_heap);
+    }
+    if (config.event_pos != NULL) {
+        free(config.event_pos);
+    }
+    return ret;
 }
 
-/* Create a configuration */
-fuzi_q_test_config_t* fuzi_q_test_config_create(int nb_nodes, int nb_links, int nb_attachments, int nb_sources)
+/* Farm of shards, as run in sim mode. Check that the trials are split
+ * between the shards, that each shard starts from its own branch of the
+ * initial CID, and that the results of the shards are added. Then check
+ * that the shards that fail are reported in order, with their CID.
+ */
+static int fuzi_q_sim_farm_check_shards(fuzi_q_sim_farm_t* farm, size_t nb_cnx_required)
 {
-    fuzi_q_test_config_t* config = (fuzi_q_test_config_t*)malloc(sizeof(fuzi_q_test_config_t));
-
-    if (config != NULL) {
-        int success = 1;
-
-        memset(config, 0, sizeof(fuzi_q_test_config_t));
-        memset(config->ticket_encryption_key, 0x55, sizeof(config->ticket_encryption_key));
-
-        /* Locate the default cert, key and root in the Picoquic solution*/
-        if (picoquic_get_input_path(config->test_server_cert_file, sizeof(config->test_server_cert_file),
-            fuzi_q_test_picoquic_solution_dir, PICOQUIC_TEST_FILE_SERVER_CERT) != 0 ||
-            picoquic_get_input_path(config->test_server_key_file, sizeof(config->test_server_key_file),
-                fuzi_q_test_picoquic_solution_dir, PICOQUIC_TEST_FILE_SERVER_KEY) != 0 ||
-            picoquic_get_input_path(config->test_server_cert_store_file, sizeof(config->test_server_cert_store_file),
-                fuzi_q_test_picoquic_solution_dir, PICOQUIC_TEST_FILE_CERT_STORE) != 0) {
-            success = 0;
-        }
-
-        if (nb_nodes <= 0 || nb_nodes > 0xffff) {
-            success = 0;
-        }
-        else if (success) {
-            config->nodes = (fuzi_q_ctx_t*)malloc(nb_nodes * sizeof(fuzi_q_ctx_t));
-            success &= (config->nodes != NULL);
-            if (success) {
-                memset(config->nodes, 0, nb_nodes * sizeof(fuzi_q_ctx_t));
-                config->nb_nodes = nb_nodes;
-            }
+    int ret = 0;
+    size_t nb_required = 0;
+    size_t nb_tried = 0;
+
+    for (int i = 0; ret == 0 && i < farm->nb_shards; i++) {
+        fuzi_q_sim_shard_t* shard = &farm->shards[i];
+        picoquic_connection_id_t branch_cid;
+
+        fuzzer_branch_cid(&farm->root_cid, i, &branch_cid);
+        if (shard->nb_cnx_required != fuzi_q_trials_share(nb_cnx_required, farm->nb_shards, i) ||
+            shard->nb_cnx_tried != shard->nb_cnx_required || shard->ret != 0) {
+            DBG_PRINTF("Shard %d tried %zu connections out of %zu, ret %d", i, shard->nb_cnx_tried,
+                shard->nb_cnx_required, shard->ret);
+            ret = -1;
         }
-
-        if (nb_links <= 0 || nb_links > 0xffff) {
-            success = 0;
+        else if (picoquic_compare_connection_id(&shard->shard_cid, &branch_cid) != 0 ||
+            (i == 0 && picoquic_compare_connection_id(&shard->shard_cid, &farm->root_cid) != 0)) {
+            DBG_PRINTF("Shard %d does not start from its branch of the initial CID", i);
+            ret = -1;
         }
-        else if (success) {
-            config->links = (picoquictest_sim_link_t**)malloc(nb_links * sizeof(picoquictest_sim_link_t*));
-            config->return_links = (int*)malloc(nb_links * sizeof(int));
-            success &= (config->links != NULL);
-
-            if (success) {
-                memset(config->links, 0, nb_links * sizeof(picoquictest_sim_link_t*));
-                config->nb_links = nb_links;
-
-                for (int i = 0; success && (i < nb_links); i++) {
-                    picoquictest_sim_link_t* link = picoquictest_sim_link_create(0.01, 10000, NULL, 0, config->simulated_time);
-                    config->links[i] = link;
-                    success &= (link != NULL);
-                }
+        for (int j = 0; ret == 0 && j < i; j++) {
+            if (picoquic_compare_connection_id(&shard->shard_cid, &farm->shards[j].shard_cid) == 0) {
+                DBG_PRINTF("Shards %d and %d start from the same CID", j, i);
+                ret = -1;
             }
         }
+        nb_required += shard->nb_cnx_required;
+        nb_tried += shard->nb_cnx_tried;
+    }
+    if (ret == 0 && (nb_required != nb_cnx_required || farm->summary.nb_cnx_tried != nb_tried ||
+        farm->nb_shards_run != farm->nb_shards)) {
+        DBG_PRINTF("Summary of %d shards has %zu trials, %zu expected", farm->nb_shards_run,
+            farm->summary.nb_cnx_tried, nb_cnx_required);
+        ret = -1;
+    }
+    return ret;
+}
 
+/* With the counter scheme, client c of a shard uses the indices
+ * first_cid_index + c + k * cid_stride. The ranges of the shards do not
+ * overlap if all shards have the same stride and all clients start at
+ * a different offset in the stride, including when a shard has fewer
+ * clients than the farm.
+ */
+static int fuzi_q_sim_farm_check_cid_index(fuzi_q_sim_farm_t* farm)
+{
+    int ret = 0;
+    uint64_t stride = (uint64_t)farm->nb_shards * farm->nb_clients;
+    uint8_t used[64];
 
-        if (nb_attachments <= 0 || nb_attachments > 0xffff) {
-            success = 0;
-        }
-        else if (success) {
-            config->attachments = (fuzi_q_test_attach_t*)malloc(nb_attachments * sizeof(fuzi_q_test_attach_t));
-            success &= (config->attachments != NULL);
-
-            if (success) {
-                memset(config->attachments, 0, nb_attachments * sizeof(fuzi_q_test_attach_t));
-                config->nb_attachments = nb_attachments;
-                for (int i = 0; success && (i < config->nb_attachments); i++) {
-                    char addr_text[128];
-                    fuzi_q_test_attach_t* p_attach = &config->attachments[i];
+    memset(used, 0, sizeof(used));
+    if (stride > sizeof(used)) {
+        ret = -1;
+    }
+    for (int i = 0; ret == 0 && i < farm->nb_shards; i++) {
+        fuzi_q_sim_shard_t* shard = &farm->shards[i];
 
-                    if (picoquic_sprintf(addr_text, sizeof(addr_text), NULL, "%x::%x", i + 0x1000, i + 0x1000) == 0) {
-                        picoquic_store_text_addr(&p_attach->node_addr, addr_text, i + 0x1000);
-                    }
-                    else {
-                        success = 0;
-                    }
-                }
-            }
+        if (shard->cid_stride != stride || shard->nb_clients > farm->nb_clients ||
+            shard->first_cid_index < farm->first_cid_index) {
+            DBG_PRINTF("Shard %d has stride %" PRIu64 ", %d clients", i, shard->cid_stride, shard->nb_clients);
+            ret = -1;
         }
+        for (int c = 0; ret == 0 && c < shard->nb_clients; c++) {
+            uint64_t offset = shard->first_cid_index + c - farm->first_cid_index;
 
-        if (!success) {
-            fuzi_q_test_config_delete(config);
-            config = NULL;
+            if (offset >= stride || used[offset]) {
+                DBG_PRINTF("Client %d of shard %d starts at index %" PRIu64 ", already used", c, i,
+                    shard->first_cid_index + c);
+                ret = -1;
+            }
+            else {
+                used[offset] = 1;
+            }
         }
     }
-
-    return config;
+    return ret;
 }
 
-int fuzi_q_set_test_client_ctx(fuzi_q_test_config_t* test_config, fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_mode_enum fuzz_mode,
-    size_t nb_cnx_ctx, size_t nb_cnx_required, uint64_t duration_max, char const * client_scenario_text, 
-    struct sockaddr* server_addr, char const * qlog_dir)
+int fuzi_q_sim_farm_test()
 {
     int ret = 0;
-    uint64_t current_time = test_config->simulated_time; 
-    static const char* test_scenario_default = "0:index.html;4:0:/1000;8:4:/12345";
-    picoquic_quic_config_t config = { 0 };
-    config.nb_connections = (uint32_t)(2*nb_cnx_ctx);
-    config.cnx_id_length = 8;
-
-    fuzi_q_ctx->fuzz_mode = fuzz_mode;
-    fuzi_q_ctx->config = NULL;
-    fuzi_q_ctx->up_time_interval = 60000000; /* Use 1 minute by default -- hanshake timer is set to 30 seconds. */
-    fuzi_q_ctx->cnx_duration_min = UINT64_MAX;
-
-    fuzi_q_ctx->end_of_time = (duration_max == 0) ? UINT64_MAX : current_time + duration_max * 1000000;
-    fuzi_q_ctx->nb_cnx_required = (nb_cnx_required == 0) ? SIZE_MAX : nb_cnx_required;
-    fuzi_q_ctx->next_success_time = current_time + fuzi_q_ctx->up_time_interval;
-
-    if (fuzi_q_ctx->alpn != NULL && strcmp(fuzi_q_ctx->alpn, QUICPERF_ALPN) == 0) {
-        /* Set a QUICPERF client */
-        fuzi_q_ctx->is_quicperf = 1;
-        fprintf(stdout, "Getting ready to fuzz QUICPERF server\n");
+    picoquic_quic_config_t config;
+    fuzi_q_sim_farm_t farm;
+    fuzzer_bandit_shared_t bandit_shared;
+    picoquic_connection_id_t init_cid = { { 0xfa, 0x53, 0, 0, 0, 0, 0, 1 }, 8 };
+    const size_t nb_cnx_required = 10;
+
+    memset(&config, 0, sizeof(config));
+    memset(&farm, 0, sizeof(farm));
+    config.nb_connections = 4;
+    if (fuzzer_bandit_open(&bandit_shared, "exp3") != 0 ||
+        fuzi_q_sim_farm_init(&farm, &config, nb_cnx_required, 0, &init_cid, 3, 2, NULL, NULL, 1) != 0) {
+        ret = -1;
     }
     else {
-        if (client_scenario_text == NULL) {
-            client_scenario_text = test_scenario_default;
+        size_t nb_cnx = 0;
+        double max_weight = 0;
+
+        farm.link_spec = fuzi_q_test_link_spec;
+        farm.picoquic_solution_dir = fuzi_q_test_picoquic_solution_dir;
+        farm.bandit_shared = &bandit_shared;
+        if (fuzi_q_sim_farm_run(&farm, 2) != 0 || farm.nb_failures != 0 || farm.summary.server_is_down) {
+            DBG_PRINTF("Farm failed, %zu failures", farm.nb_failures);
+            ret = -1;
         }
-
-        fprintf(stdout, "Testing scenario: <%s>\n", client_scenario_text);
-        ret = demo_client_parse_scenario_desc(client_scenario_text, &fuzi_q_ctx->client_sc_nb, &fuzi_q_ctx->client_sc);
-        if (ret != 0) {
-            fprintf(stdout, "Cannot parse the specified scenario.\n");
+        else {
+            ret = fuzi_q_sim_farm_check_shards(&farm, nb_cnx_required);
+        }
+        /* The counters of the fuzzer and the weights of the strategies are those of all shards */
+        for (int i = 0; i < fuzzer_cnx_state_max; i++) {
+            nb_cnx += farm.summary.fuzz_ctx.nb_cnx_tried[i];
+        }
+        for (int i = 0; ret == 0 && i < FUZZER_NB_STRATEGIES; i++) {
+            if (!(farm.bandit_weight[i] > 0)) {
+                ret = -1;
+            }
+            else if (farm.bandit_weight[i] > max_weight) {
+                max_weight = farm.bandit_weight[i];
+            }
+        }
+        if (ret == 0 && (farm.summary.fuzz_ctx.nb_entry_stats != farm.settings.corpus.nb_entries ||
+            nb_cnx != nb_cnx_required || max_weight != 1.0)) {
+            DBG_PRINTF("%s", "Counters or weights of the shards not added");
+            ret = -1;
         }
     }
+    fuzi_q_sim_farm_release(&farm);
+    fuzzer_bandit_close(&bandit_shared);
 
-    /* Create QUIC context */
     if (ret == 0) {
-        fuzi_q_ctx->quic = picoquic_create_and_configure(&config, NULL, NULL, current_time, &test_config->simulated_time);
-        if (fuzi_q_ctx->quic == NULL) {
+        /* Fewer trials than shards times clients: 3 clients for the first
+         * shard, 2 for the second, and the ranges of indices do not overlap */
+        if (fuzi_q_sim_farm_init(&farm, &config, 5, 0, &init_cid, 2, 3, NULL, NULL, 0) != 0) {
             ret = -1;
         }
         else {
-            fuzi_q_fuzzer_init(&fuzi_q_ctx->fuzz_ctx, NULL, NULL);
-            fuzi_q_ctx->fuzz_ctx.parent = fuzi_q_ctx;
-            if (fuzz_mode != fuzi_q_mode_clean) {
-                picoquic_set_fuzz(fuzi_q_ctx->quic, fuzi_q_fuzzer, &fuzi_q_ctx->fuzz_ctx);
+            farm.link_spec = fuzi_q_test_link_spec;
+            farm.picoquic_solution_dir = fuzi_q_test_picoquic_solution_dir;
+            farm.cid_scheme = fuzzer_cid_scheme_counter;
+            farm.first_cid_index = 7;
+            if (fuzi_q_sim_farm_run(&farm, 2) != 0 || farm.nb_failures != 0) {
+                DBG_PRINTF("Farm failed, %zu failures", farm.nb_failures);
+                ret = -1;
             }
-
-            if (qlog_dir != NULL) {
-                picoquic_set_qlog(fuzi_q_ctx->quic, qlog_dir);
+            else if ((ret = fuzi_q_sim_farm_check_shards(&farm, 5)) == 0 &&
+                (farm.shards[0].nb_clients != 3 || farm.shards[1].nb_clients != 2)) {
+                DBG_PRINTF("Shards have %d and %d clients", farm.shards[0].nb_clients, farm.shards[1].nb_clients);
+                ret = -1;
+            }
+            if (ret == 0) {
+                ret = fuzi_q_sim_farm_check_cid_index(&farm);
             }
         }
+        fuzi_q_sim_farm_release(&farm);
     }
 
-    /* Create empty connection contexts */
     if (ret == 0) {
-        picoquic_store_addr(&fuzi_q_ctx->server_address, server_addr);
-        fuzi_q_ctx->cnx_ctx = (fuzi_q_cnx_ctx_t*)malloc(sizeof(fuzi_q_cnx_ctx_t) * nb_cnx_ctx);
-        if (fuzi_q_ctx->cnx_ctx == NULL) {
+        /* The servers cannot start without their certificate: all shards fail */
+        config.server_cert_file = "fuzi_q_no_such_cert.pem";
+        config.server_key_file = "fuzi_q_no_such_key.pem";
+        if (fuzi_q_sim_farm_init(&farm, &config, nb_cnx_required, 0, &init_cid, 3, 2, NULL, NULL, 0) != 0) {
             ret = -1;
         }
         else {
-            memset(fuzi_q_ctx->cnx_ctx, 0, sizeof(fuzi_q_cnx_ctx_t) * nb_cnx_ctx);
-            fuzi_q_ctx->nb_cnx_ctx = nb_cnx_ctx;
+            farm.cid_scheme = fuzzer_cid_scheme_counter;
+            farm.first_cid_index = 5;
+            if (fuzi_q_sim_farm_run(&farm, 2) == 0 || farm.nb_failures != 3) {
+                DBG_PRINTF("Expected 3 failed shards, got %zu", farm.nb_failures);
+                ret = -1;
+            }
+            for (size_t i = 0; ret == 0 && i < farm.nb_failures; i++) {
+                if (farm.failures[i].shard_id != (int)i || farm.failures[i].ret == 0 ||
+                    farm.failures[i].cid_index != 5 + 2 * i ||
+                    picoquic_compare_connection_id(&farm.failures[i].icid, &init_cid) != 0) {
+                    DBG_PRINTF("Failure %zu not reported correctly", i);
+                    ret = -1;
+                }
+            }
         }
-    }
-
-    /* Initialize the client connections */
-    if (ret == 0) {
-        int is_active = 0;
-        ret = fuzi_q_loop_check_cnx(fuzi_q_ctx, current_time, &is_active);
+        fuzi_q_sim_farm_release(&farm);
     }
 
     return ret;
 }
 
-int fuzi_q_set_test_server_ctx(fuzi_q_test_config_t* test_config, fuzi_q_ctx_t* fuzi_q_ctx, fuzi_q_mode_enum fuzz_mode,
-    size_t nb_cnx_ctx, uint64_t duration_max, struct sockaddr* server_addr, char const* qlog_dir)
+/* Link models: parsing of the specification, and impairments drawn
+ * as specified, the same way for the same seed. */
+static int fuzi_q_link_impair_run(fuzi_q_link_impair_t* impair, size_t nb_packets, size_t length, size_t* nb_received)
 {
     int ret = 0;
-    picoquic_quic_config_t config = { 0 };
-    config.nb_connections = (uint32_t)(4*nb_cnx_ctx);
-    config.server_cert_file = test_config->test_server_cert_file;
-    config.server_key_file = test_config->test_server_key_file;
-    config.cnx_id_length = 8;
+    uint64_t current_time = 0;
+    uint64_t last_time = 0;
+    picoquictest_sim_packet_t* packet;
 
-    if (server_addr != NULL) {
-        if (server_addr->sa_family == AF_INET) {
-            config.server_port = ((struct sockaddr_in*)server_addr)->sin_port;
+    *nb_received = 0;
+    for (size_t i = 0; ret == 0 && i < nb_packets; i++) {
+        if ((packet = picoquictest_sim_link_create_packet()) == NULL) {
+            ret = -1;
         }
-        else if (server_addr->sa_family == AF_INET) {
-            config.server_port = ((struct sockaddr_in6*)server_addr)->sin6_port;
+        else {
+            packet->length = length;
+            current_time += 100;
+            fuzi_q_link_impair_submit(impair, packet, current_time);
         }
     }
-
-fuzi_q_ctx->quic = picoquic_create_and_configure(&config, NULL, NULL, test_config->simulated_time,
-        &test_config->simulated_time);
-    if (fuzi_q_ctx->quic == NULL) {
-        ret = -1;
-    }
-    else {
-        fuzi_q_ctx->fuzz_mode = fuzz_mode;
-        fuzi_q_fuzzer_init(&fuzi_q_ctx->fuzz_ctx, NULL, NULL);
-        if (fuzz_mode != fuzi_q_mode_clean_server) {
-            picoquic_set_fuzz(fuzi_q_ctx->quic, fuzi_q_fuzzer, &fuzi_q_ctx->fuzz_ctx);
-        }
-
-        picoquic_set_alpn_select_fn(fuzi_q_ctx->quic, (picoquic_alpn_select_fn)picoquic_demo_server_callback_select_alpn);
-
-        picoquic_set_mtu_max(fuzi_q_ctx->quic, PICOQUIC_MAX_PACKET_SIZE);
-
-        if (qlog_dir != NULL)
-        {
-            picoquic_set_qlog(fuzi_q_ctx->quic, qlog_dir);
+    while ((packet = fuzi_q_link_impair_dequeue(impair, UINT64_MAX)) != NULL) {
+        if (packet->arrival_time < last_time) {
+            ret = -1;
         }
+        last_time = packet->arrival_time;
+        (*nb_received)++;
+        free(packet);
     }
-
     return ret;
 }
 
-fuzi_q_test_config_t* fuzi_q_test_basic_config_create(uint64_t simulate_loss, fuzi_q_mode_enum client_fuzz_mode, fuzi_q_mode_enum server_fuzz_mode,
-    size_t nb_cnx_ctx, size_t nb_cnx_required, uint64_t duration_max, char const* client_scenario_text, char const* qlog_dir)
+int fuzi_q_link_model_test()
 {
-    /* Create a configuration with just two nodes, two links, one source and two attachment points.*/
-    fuzi_q_test_config_t* config = fuzi_q_test_config_create(2, 2, 2, 1);
-    struct sockaddr* server_addr = NULL;
-    int a_ret = 0;
-    int s_ret = 0;
-    int c_ret = 0;
-
-    if (config != NULL) {
-        /* Populate the attachments */
-        config->return_links[0] = 1;
-        config->attachments[0].link_id = 0;
-        config->attachments[0].node_id = 0;
-        config->return_links[1] = 0;
-        config->attachments[1].link_id = 1;
-        config->attachments[1].node_id = 1;
-        /* Set the desired loss pattern */
-        config->simulate_loss = simulate_loss;
-
-        /* Find the server address */
-        server_addr = fuzi_q_test_find_send_addr(config, 1, 0);
-        if (server_addr == NULL) {
-            a_ret = -1;
-        }
-        else {
-            /* configure server on nodes[0], client on nodes[1].
-             * Apply fuzz_mode to client and to server
-             */
-            s_ret = fuzi_q_set_test_server_ctx(config, &config->nodes[0], server_fuzz_mode,
-                nb_cnx_ctx, duration_max, server_addr, qlog_dir);
-            c_ret = fuzi_q_set_test_client_ctx(config, &config->nodes[1], client_fuzz_mode,
-                nb_cnx_ctx, nb_cnx_required, duration_max, client_scenario_text,
-                server_addr, qlog_dir);
-        }
-        if (a_ret != 0 || s_ret != 0 || c_ret != 0) {
-            DBG_PRINTF("Configuration failed, address: %d, server: %d, client: %d", a_ret, s_ret, c_ret);
-            fuzi_q_test_config_delete(config);
-            config = NULL;
-        }
-    }
-    return config;
-}
-
-int fuzi_q_test_check_fuzz(size_t nb_cnx_required, fuzzer_ctx_t * fuzz_ctx)
-{
-    size_t total_tried = 0;
     int ret = 0;
-
-    for (int i = 0; ret == 0 && i < fuzzer_cnx_state_max; i++)
-    {
-        total_tried += fuzz_ctx->nb_cnx_tried[i];
-        if (fuzz_ctx->nb_cnx_tried[i] == 0) {
-            DBG_PRINTF("No trials for connection fuzzing state %d", i);
-            ret = -1;
-        }
-        else if (fuzz_ctx->nb_cnx_tried[i] > fuzz_ctx->nb_cnx_fuzzed[i]) {
-            DBG_PRINTF("Connection fuzzing state % d, tried %zu, fuzzed %zu", i,
-                fuzz_ctx->nb_cnx_tried[i], fuzz_ctx->nb_cnx_fuzzed[i]);
-            ret = -1;
-        }
-    }
-
-    if (fuzz_ctx->wait_max[fuzzer_cnx_state_ready] <= 1 || fuzz_ctx->wait_max[fuzzer_cnx_state_ready] <= 1) {
-        DBG_PRINTF("Connection fuzzing state % d, wait_max %d, waited_max %d", fuzzer_cnx_state_ready,
-            fuzz_ctx->wait_max[fuzzer_cnx_state_ready], fuzz_ctx->waited_max[fuzzer_cnx_state_ready]);
+    fuzi_q_link_model_t model;
+    fuzi_q_link_impair_t impair[2];
+    size_t nb_received[2];
+    char const* bad_specs[] = { "bw=0", "foo=1", "1:", "loss=2", "reorder=0.1", "lat=10,", "x:lat=10" };
+
+    if (fuzi_q_link_model_get("bw=100,lat=20000;1:ge=0.1:0.5:0.8,mtu=1200;dup=0.5,seed=7", 0, &model) != 0 ||
+        model.data_rate_in_gbps != 0.1 || model.latency != 20000 || model.duplicate_rate != 0.5 ||
+        model.seed != 7 || model.mtu != 0 || model.ge_p_bad != 0) {
+        DBG_PRINTF("%s", "Wrong model for link 0");
         ret = -1;
     }
-
-    if (total_tried != nb_cnx_required) {
-        DBG_PRINTF("Tried %zu instead of %zu", total_tried, nb_cnx_required);
+    else if (fuzi_q_link_model_get("bw=100,lat=20000;1:ge=0.1:0.5:0.8,mtu=1200;dup=0.5,seed=7", 1, &model) != 0 ||
+        model.ge_p_bad != 0.1 || model.ge_p_good != 0.5 || model.loss_bad != 0.8 || model.mtu != 1200 ||
+        model.latency != 20000) {
+        DBG_PRINTF("%s", "Wrong model for link 1");
         ret = -1;
     }
-    return ret;
-}
 
-/* Basic loop, supporting 4 variations */
-int fuzi_q_basic_test_loop(int fuzz_client, int fuzz_server, int simulate_loss)
-{
-    int ret = 0;
-    fuzi_q_mode_enum client_fuzz_mode = (fuzz_client) ? fuzi_q_mode_client : fuzi_q_mode_clean;
-    fuzi_q_mode_enum server_fuzz_mode = (fuzz_server) ? fuzi_q_mode_server : fuzi_q_mode_clean_server;
-    int nb_steps = 0;
-    int nb_inactive = 0;
-    size_t nb_cnx_required = 16;
-    const uint64_t max_time = 360000000;
-    const int max_inactive = 128;
-    fuzi_q_test_config_t* config = fuzi_q_test_basic_config_create(simulate_loss, client_fuzz_mode, server_fuzz_mode,
-        4, nb_cnx_required, 360000000, NULL, ".");
-
-    while (ret == 0 && nb_inactive < max_inactive && config->simulated_time < max_time) {
-        /* Run the simulation. Monitor the connection. Monitor the media. */
-        int is_active = 0;
-
-        ret = fuzi_q_test_loop_step(config, &is_active);
-        if (ret == PICOQUIC_NO_ERROR_TERMINATE_PACKET_LOOP) {
-            ret = 0;
-            break;
-        }
-
-        if (ret != 0) {
-            DBG_PRINTF("Fail on loop step %d, %d, active: ret=%d", nb_steps, is_active, ret);
-            break;
+    for (size_t i = 0; ret == 0 && i < sizeof(bad_specs) / sizeof(char const*); i++) {
+        if (fuzi_q_link_model_get(bad_specs[i], 0, &model) == 0) {
+            DBG_PRINTF("Accepted invalid specification: %s", bad_specs[i]);
+            ret = -1;
         }
+    }
 
-        nb_steps++;
-
-        if (is_active) {
-            nb_inactive = 0;
-        }
-        else {
-            nb_inactive++;
-            if (nb_inactive >= max_inactive) {
-                DBG_PRINTF("Exit loop after too many inactive: %d", nb_inactive);
-                ret = -1;
-                break;
-            }
+    /* Bursts of losses, reordering and duplicates */
+    if (ret == 0 && fuzi_q_link_model_get("ge=0.05:0.3,reorder=0.1:5000,dup=0.1,jitter=300,mtu=1200", 0, &model) != 0) {
+        ret = -1;
+    }
+    for (int i = 0; ret == 0 && i < 2; i++) {
+        fuzi_q_link_impair_init(&impair[i], &model, 1);
+        ret = fuzi_q_link_impair_run(&impair[i], 1000, 1000, &nb_received[i]);
+        if (ret == 0 && (impair[i].nb_lost == 0 || impair[i].nb_reordered == 0 || impair[i].nb_duplicated == 0 ||
+            nb_received[i] != 1000 - impair[i].nb_lost + impair[i].nb_duplicated)) {
+            DBG_PRINTF("Lost %" PRIu64 ", reordered %" PRIu64 ", duplicated %" PRIu64 ", received %zu",
+                impair[i].nb_lost, impair[i].nb_reordered, impair[i].nb_duplicated, nb_received[i]);
+            ret = -1;
         }
+        fuzi_q_link_impair_release(&impair[i]);
+    }
+    if (ret == 0 && (impair[0].nb_lost != impair[1].nb_lost || nb_received[0] != nb_received[1])) {
+        DBG_PRINTF("%s", "Different impairments for the same seed");
+        ret = -1;
     }
 
+    /* Packets larger than the MTU do not go through */
     if (ret == 0) {
-        fuzi_q_ctx_t* fuzi_q_ctx = &config->nodes[1];
-        if (fuzi_q_ctx->server_is_down) {
-            DBG_PRINTF("Server down at time %" PRIu64, config->simulated_time);
-            ret = -1;
-        }
-        else if (fuzi_q_ctx->nb_cnx_tried != nb_cnx_required) {
-            DBG_PRINTF("Tried %zu connections instead of %zu" PRIu64, fuzi_q_ctx->nb_cnx_tried, nb_cnx_required);
+        fuzi_q_link_impair_init(&impair[0], &model, 1);
+        ret = fuzi_q_link_impair_run(&impair[0], 100, 1300, &nb_received[0]);
+        if (ret == 0 && (nb_received[0] != 0 || impair[0].nb_too_big + impair[0].nb_lost != 100)) {
+            DBG_PRINTF("Received %zu packets larger than the MTU", nb_received[0]);
             ret = -1;
         }
-        else if (client_fuzz_mode == fuzi_q_mode_client) {
-            ret = fuzi_q_test_check_fuzz(nb_cnx_required, &fuzi_q_ctx->fuzz_ctx);
-        }
-    }
-
-    /* Clear everything. */
-    if (config != NULL) {
-        fuzi_q_test_config_delete(config);
+        fuzi_q_link_impair_release(&impair[0]);
     }
 
     return ret;
 }
-
-
-/* Basic test, place holder for now. */
-int fuzi_q_basic_test()
-{
-    return fuzi_q_basic_test_loop(0,0,0);
-}
-
-/* Basic test, place holder for now. */
-int fuzi_q_basic_client_test()
-{
-    return fuzi_q_basic_test_loop(1, 0, 0);
-}
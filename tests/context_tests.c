@@ -22,6 +22,7 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
 #include <picoquic.h>
 #include <picoquic_internal.h>
 #include <picoquic_utils.h>
@@ -48,46 +49,35 @@ picoquic_connection_id_t test_icid[] = {
 
 size_t nb_test_icid = sizeof(test_icid) / sizeof(picoquic_connection_id_t);
 
+/* Count the contexts filed in the time wheel, verify that each of
+ * them is filed in the right bucket, after the more recently filed
+ * ones, no later than its last use, and that it can be found in the
+ * table. Then verify that the count matches.
+ */
 int icid_table_check_chain(fuzzer_ctx_t* ctx, size_t nb_expected)
 {
     int ret = 0;
-    /* Check MRU chain */
-    size_t mru_count = 0;
-    size_t lru_count = 0;
-    fuzzer_icid_ctx_t* next = ctx->icid_mru;
-    while (ret == 0) {
-        if (next == NULL) {
-            if (mru_count < nb_expected) {
-                ret = -1;
-            }
-            break;
-        }
-        else {
-            mru_count++;
-            if (mru_count > nb_expected) {
+    size_t count = 0;
+
+    for (size_t bucket = 0; ret == 0 && bucket < FUZZER_WHEEL_SIZE; bucket++) {
+        fuzzer_icid_ctx_t* previous = NULL;
+        fuzzer_icid_ctx_t* next = ctx->icid_wheel[bucket];
+        while (next != NULL) {
+            count++;
+            if (count > nb_expected || next->wheel_prev != previous ||
+                next->wheel_tick % FUZZER_WHEEL_SIZE != bucket ||
+                (previous != NULL && previous->wheel_tick < next->wheel_tick) ||
+                next->wheel_tick > next->last_time / FUZZER_WHEEL_TICK + 1 ||
+                fuzzer_find_icid_ctx(ctx, &next->icid) != next) {
                 ret = -1;
                 break;
             }
-            next = next->icid_after;
+            previous = next;
+            next = next->wheel_next;
         }
     }
-    /* Check MRU chain */
-    next = ctx->icid_lru;
-    while (ret == 0) {
-        if (next == NULL) {
-            if (lru_count < nb_expected) {
-                ret = -1;
-            }
-            break;
-        }
-        else {
-            lru_count++;
-            if (lru_count > nb_expected) {
-                ret = -1;
-                break;
-            }
-            next = next->icid_before;
-        }
+    if (ret == 0 && count != nb_expected) {
+        ret = -1;
     }
     return ret;
 }
@@ -96,6 +86,7 @@ int icid_table_test()
 {
     int ret = 0;
     uint64_t current_time = 0;
+    fuzzer_icid_ctx_t* icid_ctx[sizeof(test_icid) / sizeof(picoquic_connection_id_t)];
     fuzzer_icid_ctx_t* fuzz_cnx_ctx;
     fuzzer_ctx_t ctx = { 0 };
 
@@ -104,36 +95,53 @@ int icid_table_test()
     for (int trials = 0; ret == 0 && trials < 3; trials++)
     {
         /* Create once, then check again, and verify that all entries are in the table in the right order */
-        for (size_t i = 0; i < nb_test_icid; i++) {
+        for (size_t i = 0; ret == 0 && i < nb_test_icid; i++) {
             current_time += 1000;
-            (void)fuzzer_get_icid_ctx(&ctx, &test_icid[i], current_time);
+            fuzz_cnx_ctx = fuzzer_get_icid_ctx(&ctx, &test_icid[i], current_time);
+            if (fuzz_cnx_ctx == NULL || picoquic_compare_connection_id(&fuzz_cnx_ctx->icid, &test_icid[i]) != 0) {
+                DBG_PRINTF("Wrong entry #%zu", i);
+                ret = -1;
+            }
+            else if (trials == 0) {
+                icid_ctx[i] = fuzz_cnx_ctx;
+            }
+            else if (icid_ctx[i] != fuzz_cnx_ctx) {
+                DBG_PRINTF("Entry #%zu created twice", i);
+                ret = -1;
+            }
             if (ret == 0) {
-                ret = icid_table_check_chain(&ctx, ctx.icid_tree.size);
+                ret = icid_table_check_chain(&ctx, ctx.nb_icid);
                 if (ret != 0) {
-                    DBG_PRINTF("Chain invalid after %zu trials, step %zu", trials + 1, i);
+                    DBG_PRINTF("Chain invalid after %d trials, step %zu", trials + 1, i);
                 }
             }
         }
-        if (ret == 0 && ctx.icid_tree.size != nb_test_icid)
+        if (ret == 0 && ctx.nb_icid != nb_test_icid)
         {
-            DBG_PRINTF("Wrong tree size #%zu", ctx.icid_tree.size);
+            DBG_PRINTF("Wrong table size #%zu", ctx.nb_icid);
             ret = -1;
         }
 
-        fuzz_cnx_ctx = ctx.icid_lru;
+        /* All contexts were created in the same tick. Lookups do not move them,
+         * so the bucket lists them from the last created to the first. */
+        fuzz_cnx_ctx = ctx.icid_wheel[0];
 
-        for (size_t i = 0; ret == 0 && i < nb_test_icid; i++) {
+        for (size_t i = nb_test_icid; ret == 0 && i > 0; i--) {
             if (fuzz_cnx_ctx == NULL) {
-                DBG_PRINTF("Missing entry #%zu", i);
+                DBG_PRINTF("Missing entry #%zu", i - 1);
                 ret = -1;
             }
-            else if (picoquic_compare_connection_id(&fuzz_cnx_ctx->icid, &test_icid[i]) != 0) {
-                DBG_PRINTF("Wrong LRU entry #%zu", i);
+            else if (picoquic_compare_connection_id(&fuzz_cnx_ctx->icid, &test_icid[i - 1]) != 0) {
+                DBG_PRINTF("Wrong wheel entry #%zu", i - 1);
                 ret = -1;
             }
-            else
-            {
-                fuzz_cnx_ctx = fuzz_cnx_ctx->icid_before;
+            else if (!fuzz_cnx_ctx->clock_bit ||
+                fuzz_cnx_ctx->last_time != current_time - 1000 * (nb_test_icid - i)) {
+                DBG_PRINTF("Use of entry #%zu not recorded", i - 1);
+                ret = -1;
+            }
+            else {
+                fuzz_cnx_ctx = fuzz_cnx_ctx->wheel_next;
             }
         }
 
@@ -141,15 +149,506 @@ int icid_table_test()
             DBG_PRINTF("%s", "One entry too many!");
             ret = -1;
         }
+    }
+
+    /* Set a capacity, verify that the number of contexts is bounded, and
+     * that the evicted contexts are removed from the table. All contexts
+     * were used, so the CLOCK scan clears all the bits then evicts from
+     * the head of the bucket, keeping the first contexts created. */
+    if (ret == 0) {
+        size_t capacity = 4;
+        fuzi_q_fuzzer_set_capacity(&ctx, capacity);
+        if (ctx.nb_icid != capacity || icid_table_check_chain(&ctx, capacity) != 0) {
+            DBG_PRINTF("Wrong number of contexts after capacity set: %zu", ctx.nb_icid);
+            ret = -1;
+        }
+        for (size_t i = 0; ret == 0 && i < nb_test_icid; i++) {
+            fuzz_cnx_ctx = fuzzer_find_icid_ctx(&ctx, &test_icid[i]);
+            if ((fuzz_cnx_ctx != NULL) != (i < capacity) ||
+                (fuzz_cnx_ctx != NULL && fuzz_cnx_ctx != icid_ctx[i])) {
+                DBG_PRINTF("Wrong context kept or evicted after capacity set, #%zu", i);
+                ret = -1;
+            }
+        }
+    }
+
+    fuzi_q_fuzzer_release(&ctx);
+    return ret;
+}
+
+/* Check that exactly the listed test contexts can be found */
+static int icid_wheel_check_kept(fuzzer_ctx_t* ctx, char const* kept)
+{
+    int ret = 0;
+
+    for (size_t i = 0; ret == 0 && i < strlen(kept); i++) {
+        int is_kept = kept[i] == '1';
+
+        if ((fuzzer_find_icid_ctx(ctx, &test_icid[i]) != NULL) != is_kept) {
+            DBG_PRINTF("Context #%zu should %sbe kept", i, (is_kept) ? "" : "not ");
+            ret = -1;
+        }
+    }
+    if (ret == 0 && icid_table_check_chain(ctx, ctx->nb_icid) != 0) {
+        DBG_PRINTF("%s", "Wheel invalid");
+        ret = -1;
+    }
+    return ret;
+}
+
+/* Verify that the contexts not used for 2*FUZI_Q_MAX_SILENCE are expired
+ * by the time wheel, at most one tick late, and that the used ones are
+ * filed again and kept. Then verify that when the capacity is reached,
+ * the CLOCK scan gives a second chance to the contexts used since the
+ * last scan.
+ */
+int icid_wheel_test()
+{
+    int ret = 0;
+    fuzzer_ctx_t ctx = { 0 };
+
+    fuzi_q_fuzzer_init(&ctx, NULL, NULL);
+
+    for (size_t i = 0; i < 4; i++) {
+        (void)fuzzer_get_icid_ctx(&ctx, &test_icid[i], 1000 * (i + 1));
+    }
+    /* Use contexts 1 and 3 again. No context has expired yet. */
+    (void)fuzzer_get_icid_ctx(&ctx, &test_icid[1], 2 * FUZI_Q_MAX_SILENCE);
+    (void)fuzzer_get_icid_ctx(&ctx, &test_icid[3], 2 * FUZI_Q_MAX_SILENCE);
+    if (ctx.nb_icid != 4 || icid_wheel_check_kept(&ctx, "1111") != 0) {
+        DBG_PRINTF("Contexts expired too early, %zu left", ctx.nb_icid);
+        ret = -1;
+    }
+    /* One tick after expiry, the contexts 0 and 2 are gone. */
+    if (ret == 0) {
+        (void)fuzzer_get_icid_ctx(&ctx, &test_icid[4], 2 * FUZI_Q_MAX_SILENCE + 4000 + FUZZER_WHEEL_TICK);
+        if (ctx.nb_icid != 3 || icid_wheel_check_kept(&ctx, "01011") != 0) {
+            DBG_PRINTF("Wrong contexts after first expiry, %zu left", ctx.nb_icid);
+            ret = -1;
+        }
+    }
+    /* Later, only the context just used is left */
+    if (ret == 0) {
+        (void)fuzzer_get_icid_ctx(&ctx, &test_icid[4], 4 * FUZI_Q_MAX_SILENCE + 2 * FUZZER_WHEEL_TICK);
+        if (ctx.nb_icid != 1 || icid_wheel_check_kept(&ctx, "00001") != 0) {
+            DBG_PRINTF("Wrong contexts after second expiry, %zu left", ctx.nb_icid);
+            ret = -1;
+        }
+    }
+    fuzi_q_fuzzer_release(&ctx);
+
+    if (ret == 0) {
+        /* Stay before the first sweep, which would also clear the CLOCK bits */
+        uint64_t current_time = 1000;
+
+        fuzi_q_fuzzer_init(&ctx, NULL, NULL);
+        fuzi_q_fuzzer_set_capacity(&ctx, 4);
+        for (size_t i = 0; i < 4; i++) {
+            (void)fuzzer_get_icid_ctx(&ctx, &test_icid[i], current_time++);
+        }
+        /* All contexts were used: the scan clears the bits, then evicts
+         * the first context that it finds, the last one filed. */
+        (void)fuzzer_get_icid_ctx(&ctx, &test_icid[4], current_time++);
+        if (ctx.nb_icid != 4 || icid_wheel_check_kept(&ctx, "11101") != 0) {
+            DBG_PRINTF("%s", "Wrong context evicted when all were used");
+            ret = -1;
+        }
+        else {
+            /* Use context 0 again. Context 4 was created since the last scan,
+             * so the next scan skips it and evicts context 2. */
+            (void)fuzzer_get_icid_ctx(&ctx, &test_icid[0], current_time++);
+            (void)fuzzer_get_icid_ctx(&ctx, &test_icid[5], current_time++);
+            if (ctx.nb_icid != 4 || icid_wheel_check_kept(&ctx, "110011") != 0) {
+                DBG_PRINTF("%s", "Wrong context evicted after second chance");
+                ret = -1;
+            }
+            else {
+                /* Context 5 is skipped, and context 4 is the first one not used
+                 * since the last scan. Context 0 is still kept. */
+                (void)fuzzer_get_icid_ctx(&ctx, &test_icid[6], current_time++);
+                if (ctx.nb_icid != 4 || icid_wheel_check_kept(&ctx, "1100011") != 0) {
+                    DBG_PRINTF("%s", "Context used since the last scan was evicted");
+                    ret = -1;
+                }
+            }
+        }
+        fuzi_q_fuzzer_release(&ctx);
+    }
+
+    return ret;
+}
+
+/* Fill the index of client connections, verify that every ICID
+ * can be found, then release every other connection and verify
+ * that the remaining ones are still found after the backward shifts.
+ */
+int cnx_index_test()
+{
+    int ret = 0;
+    fuzi_q_ctx_t fuzi_q_ctx = { 0 };
+    const size_t nb_cnx = 257;
+
+    fuzi_q_fuzzer_init(&fuzi_q_ctx.fuzz_ctx, NULL, NULL);
+    ret = fuzi_q_create_cnx_ctx(&fuzi_q_ctx, nb_cnx);
+
+    for (size_t i = 0; ret == 0 && i < nb_cnx; i++) {
+        fuzi_q_cnx_ctx_t* cnx_ctx = &fuzi_q_ctx.cnx_ctx[i];
+        fuzzer_random_cid(&fuzi_q_ctx.fuzz_ctx, &cnx_ctx->icid);
+        cnx_ctx->icid_hash = fuzzer_icid_hash(&cnx_ctx->icid);
+        fuzi_q_cnx_index_insert(&fuzi_q_ctx, cnx_ctx);
+    }
+
+    for (size_t i = 0; ret == 0 && i < nb_cnx; i++) {
+        fuzi_q_cnx_ctx_t* cnx_ctx = &fuzi_q_ctx.cnx_ctx[i];
+        fuzi_q_mark_active(&fuzi_q_ctx, &cnx_ctx->icid, cnx_ctx->icid_hash, 1000, 1);
+        if (cnx_ctx->next_time != 1000 + FUZI_Q_MAX_SILENCE || !cnx_ctx->was_fuzzed) {
+            DBG_PRINTF("Connection #%zu not marked active", i);
+            ret = -1;
+        }
+    }
+
+    for (size_t i = 0; ret == 0 && i < nb_cnx; i += 2) {
+        fuzi_q_cnx_index_remove(&fuzi_q_ctx, &fuzi_q_ctx.cnx_ctx[i]);
+    }
+
+    for (size_t i = 0; ret == 0 && i < nb_cnx; i++) {
+        fuzi_q_cnx_ctx_t* cnx_ctx = &fuzi_q_ctx.cnx_ctx[i];
+        fuzi_q_cnx_ctx_t* found = fuzi_q_cnx_index_find(&fuzi_q_ctx, &cnx_ctx->icid, cnx_ctx->icid_hash);
+        if (found != (((i & 1) == 0) ? NULL : cnx_ctx)) {
+            DBG_PRINTF("Wrong index lookup for connection #%zu", i);
+            ret = -1;
+        }
+    }
+
+    fuzi_q_release_client_context(&fuzi_q_ctx);
+    return ret;
+}
+
+/* Verify that the heap is ordered by heap_time, and that the heap index
+ * of each connection points back to its position in the heap.
+ */
+static int cnx_heap_check(fuzi_q_ctx_t* fuzi_q_ctx, size_t nb_expected)
+{
+    int ret = (fuzi_q_ctx->cnx_heap_size == nb_expected) ? 0 : -1;
+
+    for (size_t x = 0; ret == 0 && x < fuzi_q_ctx->cnx_heap_size; x++) {
+        fuzi_q_cnx_ctx_t* cnx_ctx = &fuzi_q_ctx->cnx_ctx[fuzi_q_ctx->cnx_heap[x]];
+        if (cnx_ctx->heap_index != x ||
+            (x > 0 && fuzi_q_ctx->cnx_ctx[fuzi_q_ctx->cnx_heap[(x - 1) / 2]].heap_time > cnx_ctx->heap_time)) {
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+/* Timer heap and dirty list of the client connections. Fill the heap,
+ * remove some entries, then let the loop expire the connections whose
+ * deadline passed. The connections whose deadline was pushed back are
+ * refreshed instead, and no slot is ever queued twice.
+ */
+int cnx_heap_test()
+{
+    int ret = 0;
+    fuzi_q_ctx_t fuzi_q_ctx = { 0 };
+    const size_t nb_cnx = 257;
+    const uint64_t check_time = 50000;
+    uint64_t random_ctx = 0xc0ffee;
+    size_t nb_in_heap = 0;
+    int is_active = 0;
+
+    fuzi_q_fuzzer_init(&fuzi_q_ctx.fuzz_ctx, NULL, NULL);
+    ret = fuzi_q_create_cnx_ctx(&fuzi_q_ctx, nb_cnx);
+    fuzi_q_ctx.end_of_time = UINT64_MAX;
+    fuzi_q_ctx.next_success_time = UINT64_MAX;
+
+    for (size_t i = 0; ret == 0 && i < nb_cnx; i++) {
+        fuzi_q_cnx_ctx_t* cnx_ctx = &fuzi_q_ctx.cnx_ctx[i];
+        cnx_ctx->next_time = picoquic_test_uniform_random(&random_ctx, 2 * check_time);
+        fuzi_q_cnx_heap_insert(&fuzi_q_ctx, cnx_ctx);
+        nb_in_heap++;
+        if (cnx_heap_check(&fuzi_q_ctx, nb_in_heap) != 0) {
+            DBG_PRINTF("Heap invalid after insert #%zu", i);
+            ret = -1;
+        }
+    }
+
+    for (size_t i = 0; ret == 0 && i < nb_cnx; i += 3) {
+        fuzi_q_cnx_heap_remove(&fuzi_q_ctx, &fuzi_q_ctx.cnx_ctx[i]);
+        fuzi_q_ctx.cnx_ctx[i].heap_index = SIZE_MAX;
+        nb_in_heap--;
+        if (cnx_heap_check(&fuzi_q_ctx, nb_in_heap) != 0) {
+            DBG_PRINTF("Heap invalid after removal #%zu", i);
+            ret = -1;
+        }
+    }
+
+    /* Push back the deadline of every other connection, without updating the heap */
+    for (size_t i = 1; ret == 0 && i < nb_cnx; i += 2) {
+        fuzi_q_ctx.cnx_ctx[i].next_time += 2 * check_time;
+    }
+
+    /* Marking twice queues once */
+    for (int pass = 0; ret == 0 && pass < 2; pass++) {
+        for (size_t i = 0; i < nb_cnx; i += 5) {
+            fuzi_q_mark_dirty(&fuzi_q_ctx, &fuzi_q_ctx.cnx_ctx[i]);
+        }
+        if (fuzi_q_ctx.nb_cnx_dirty != (nb_cnx + 4) / 5) {
+            DBG_PRINTF("Dirty list has %zu entries after pass %d", fuzi_q_ctx.nb_cnx_dirty, pass);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        (void)fuzi_q_loop_check_cnx(&fuzi_q_ctx, check_time, &is_active);
+        if (fuzi_q_ctx.nb_cnx_dirty != 0 || cnx_heap_check(&fuzi_q_ctx, nb_in_heap) != 0) {
+            DBG_PRINTF("After loop, %zu dirty, heap check %d", fuzi_q_ctx.nb_cnx_dirty,
+                cnx_heap_check(&fuzi_q_ctx, nb_in_heap));
+            ret = -1;
+        }
+    }
+
+    for (size_t i = 0; ret == 0 && i < nb_cnx; i++) {
+        fuzi_q_cnx_ctx_t* cnx_ctx = &fuzi_q_ctx.cnx_ctx[i];
+        if (cnx_ctx->is_dirty) {
+            DBG_PRINTF("Connection #%zu still dirty", i);
+            ret = -1;
+        }
+        else if (i % 3 != 0) {
+            /* Expired connections wait to be released with heap_time UINT64_MAX,
+             * the others have a deadline after the check time */
+            if (cnx_ctx->heap_time <= check_time ||
+                (cnx_ctx->next_time <= check_time && cnx_ctx->heap_time != UINT64_MAX)) {
+                DBG_PRINTF("Connection #%zu, next %" PRIu64 ", heap %" PRIu64, i, cnx_ctx->next_time, cnx_ctx->heap_time);
+                ret = -1;
+            }
+        }
+    }
+
+    /* The connections are not started, the heap is just emptied */
+    fuzi_q_ctx.cnx_heap_size = 0;
+    fuzi_q_release_client_context(&fuzi_q_ctx);
+    return ret;
+}
+
+/* Benchmark of the ICID table. Create a large number of live contexts,
+ * then measure the throughput of lookups in random order. Finally, touch
+ * half of the contexts and verify that the time wheel removes the other half.
+ */
+static int icid_table_bench_one(size_t nb_icid)
+{
+    int ret = 0;
+    fuzzer_ctx_t ctx = { 0 };
+    picoquic_connection_id_t* icids = (picoquic_connection_id_t*)malloc(sizeof(picoquic_connection_id_t) * nb_icid);
+    size_t const nb_rounds = 4;
+    size_t const stride = 1000003;
+    uint64_t start_time;
+    uint64_t lookup_time;
+
+    fuzi_q_fuzzer_init(&ctx, NULL, NULL);
+    if (icids == NULL) {
+        ret = -1;
+    }
+
+    for (size_t i = 0; ret == 0 && i < nb_icid; i++) {
+        fuzzer_random_cid(&ctx, &icids[i]);
+        if (fuzzer_get_icid_ctx(&ctx, &icids[i], 0) == NULL) {
+            DBG_PRINTF("Cannot create context #%zu", i);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0 && ctx.nb_icid != nb_icid) {
+        DBG_PRINTF("Expected %zu contexts, got %zu", nb_icid, ctx.nb_icid);
+        ret = -1;
+    }
+
+    start_time = picoquic_current_time();
+    for (size_t r = 0; ret == 0 && r < nb_rounds; r++) {
+        size_t x = r;
+        for (size_t i = 0; i < nb_icid; i++) {
+            fuzzer_icid_ctx_t* icid_ctx;
+            x = (x + stride) % nb_icid;
+            icid_ctx = fuzzer_get_icid_ctx(&ctx, &icids[x], 0);
+            if (icid_ctx == NULL || picoquic_compare_connection_id(&icid_ctx->icid, &icids[x]) != 0) {
+                DBG_PRINTF("Lookup of context #%zu fails", x);
+                ret = -1;
+                break;
+            }
+        }
+    }
+    lookup_time = picoquic_current_time() - start_time;
+
+    if (ret == 0) {
+        double seconds = ((double)lookup_time) / 1000000.0;
+        fprintf(stdout, "ICID table, %zu contexts: %zu lookups in %fs, %.0f lookups/s\n",
+            nb_icid, nb_rounds * nb_icid, seconds, (seconds > 0) ? ((double)(nb_rounds * nb_icid)) / seconds : 0.0);
+    }
+
+    /* Touch the odd contexts, then let the even ones expire */
+    for (size_t i = 1; ret == 0 && i < nb_icid; i += 2) {
+        if (fuzzer_get_icid_ctx(&ctx, &icids[i], 2 * FUZI_Q_MAX_SILENCE) == NULL) {
+            ret = -1;
+        }
+    }
+    if (ret == 0) {
+        /* Expiry is checked once per tick of the time wheel, so it may be late by one tick */
+        (void)fuzzer_get_icid_ctx(&ctx, &icids[1], 3 * FUZI_Q_MAX_SILENCE);
+        if (ctx.nb_icid != nb_icid / 2) {
+            DBG_PRINTF("Expected %zu contexts after expiry, got %zu", nb_icid / 2, ctx.nb_icid);
+            ret = -1;
+        }
+        else {
+            ret = icid_table_check_chain(&ctx, nb_icid / 2);
+        }
+    }
+
+    fuzi_q_fuzzer_release(&ctx);
+    if (icids != NULL) {
+        free(icids);
+    }
+    return ret;
+}
+
+int icid_table_bench()
+{
+    int ret = icid_table_bench_one(100000);
+
+    if (ret == 0) {
+        ret = icid_table_bench_one(1000000);
+    }
+    return ret;
+}
+
+/* Verify that the counter scheme produces the same CIDs when stepping
+ * through the indices or computing one index directly, that threads
+ * interleaving the indices get the same CIDs, and that the CIDs differ.
+ */
+int cid_counter_test()
+{
+    int ret = 0;
+    fuzzer_ctx_t ctx = { 0 };
+    fuzzer_ctx_t thread_ctx = { 0 };
+    picoquic_connection_id_t icid[64];
+    picoquic_connection_id_t init_cid = { { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 }, 12 };
+    size_t const nb_cid = sizeof(icid) / sizeof(picoquic_connection_id_t);
+
+    fuzi_q_fuzzer_init(&ctx, &init_cid, NULL);
+    fuzzer_set_cid_scheme(&ctx, fuzzer_cid_scheme_counter, 0, 1);
+    for (size_t i = 0; i < nb_cid; i++) {
+        fuzzer_random_cid(&ctx, &icid[i]);
+        if (icid[i].id_len != init_cid.id_len) {
+            DBG_PRINTF("Wrong length for CID #%zu", i);
+            ret = -1;
+            break;
+        }
+        for (size_t j = 0; ret == 0 && j < i; j++) {
+            if (picoquic_compare_connection_id(&icid[i], &icid[j]) == 0) {
+                DBG_PRINTF("CID #%zu same as CID #%zu", i, j);
+                ret = -1;
+            }
+        }
+    }
 
-        if (ret == 0) {
-            ret = icid_table_check_chain(&ctx, nb_test_icid);
-            if (ret != 0) {
-                DBG_PRINTF("Chain invalid after %d trials", trials+1);
+    for (size_t i = 0; ret == 0 && i < nb_cid; i++) {
+        picoquic_connection_id_t direct_cid;
+        fuzzer_counter_cid(&ctx, i, &direct_cid);
+        if (picoquic_compare_connection_id(&icid[i], &direct_cid) != 0) {
+            DBG_PRINTF("Direct computation of CID #%zu differs", i);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        fuzi_q_fuzzer_init(&thread_ctx, &init_cid, NULL);
+        fuzzer_set_cid_scheme(&thread_ctx, fuzzer_cid_scheme_counter, 3, 4);
+        for (size_t i = 3; ret == 0 && i < nb_cid; i += 4) {
+            picoquic_connection_id_t thread_cid;
+            fuzzer_random_cid(&thread_ctx, &thread_cid);
+            if (picoquic_compare_connection_id(&icid[i], &thread_cid) != 0) {
+                DBG_PRINTF("Thread computation of CID #%zu differs", i);
+                ret = -1;
             }
         }
     }
 
+    if (ret == 0) {
+        fuzzer_cid_scheme_enum cid_scheme;
+        uint64_t first_index;
+        if (fuzzer_parse_cid_scheme("counter:12345", &cid_scheme, &first_index) != 0 ||
+            cid_scheme != fuzzer_cid_scheme_counter || first_index != 12345 ||
+            fuzzer_parse_cid_scheme("sha256", &cid_scheme, &first_index) != 0 ||
+            cid_scheme != fuzzer_cid_scheme_sha256_chain ||
+            fuzzer_parse_cid_scheme("counter:", &cid_scheme, &first_index) == 0 ||
+            fuzzer_parse_cid_scheme("counters", &cid_scheme, &first_index) == 0) {
+            DBG_PRINTF("%s", "Parsing of CID scheme fails");
+            ret = -1;
+        }
+    }
+
     fuzi_q_fuzzer_release(&ctx);
+    fuzi_q_fuzzer_release(&thread_ctx);
     return ret;
-}
\ No newline at end of file
+}
+
+/* Check the parsing of the client options, and the share of the
+ * trials between threads, shards or clients.
+ */
+int client_options_test()
+{
+    int ret = 0;
+    int nb_threads = 1;
+    int nb_shards = 0;
+    int nb_clients = 1;
+    char const* bad_threads[] = { "", "0", "-1", "2:", "2:0", "2:3:4:5", "2x", ":3", "2:3:" };
+
+    if (fuzi_q_parse_threads("4", &nb_threads, &nb_shards, &nb_clients) != 0 ||
+        nb_threads != 4 || nb_shards != 0 || nb_clients != 1) {
+        DBG_PRINTF("%s", "Cannot parse the number of threads");
+        ret = -1;
+    }
+    else if (fuzi_q_parse_threads("2:8:3", &nb_threads, &nb_shards, &nb_clients) != 0 ||
+        nb_threads != 2 || nb_shards != 8 || nb_clients != 3) {
+        DBG_PRINTF("%s", "Cannot parse the number of threads, shards and clients");
+        ret = -1;
+    }
+
+    for (size_t i = 0; ret == 0 && i < sizeof(bad_threads) / sizeof(char const*); i++) {
+        if (fuzi_q_parse_threads(bad_threads[i], &nb_threads, &nb_shards, &nb_clients) == 0) {
+            DBG_PRINTF("Accepted invalid thread option: \"%s\"", bad_threads[i]);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        if (fuzi_q_option_letters_overlap("d:f:X:J:", "a:b:cT:u:") != 0) {
+            DBG_PRINTF("%s", "Found an overlap between distinct letters");
+            ret = -1;
+        }
+        else if (fuzi_q_option_letters_overlap("d:f:X:T:", "a:b:cT:u:") != 'T') {
+            DBG_PRINTF("%s", "Did not find the overlap of -T");
+            ret = -1;
+        }
+    }
+
+    for (int nb_shares = 1; ret == 0 && nb_shares <= 7; nb_shares++) {
+        for (size_t nb_required = 0; ret == 0 && nb_required <= 20; nb_required++) {
+            size_t total = 0;
+            size_t share_min = SIZE_MAX;
+            size_t share_max = 0;
+
+            for (int i = 0; i < nb_shares; i++) {
+                size_t share = fuzi_q_trials_share(nb_required, nb_shares, i);
+                total += share;
+                share_min = (share < share_min) ? share : share_min;
+                share_max = (share > share_max) ? share : share_max;
+            }
+            if (total != nb_required || share_max - share_min > 1) {
+                DBG_PRINTF("Bad share of %zu trials between %d: total %zu, min %zu, max %zu",
+                    nb_required, nb_shares, total, share_min, share_max);
+                ret = -1;
+            }
+        }
+    }
+
+    return ret;
+}
@@ -29,10 +29,32 @@ extern "C" {
 #endif
     extern char const* fuzi_q_test_picoquic_solution_dir;
     extern char const* fuzi_q_test_solution_dir;
+    extern char const* fuzi_q_test_link_spec;
 
     int fuzi_q_basic_test();
     int fuzi_q_basic_client_test();
     int icid_table_test();
+    int cnx_index_test();
+    int icid_table_bench();
+    int cid_counter_test();
+    int frame_index_test();
+    int frame_fuzzer_table_test();
+    int bandit_test();
+    int pilot_stream_test();
+    int corpus_pack_test();
+    int corpus_file_test();
+    int corpus_class_test();
+    int corpus_layer_test();
+    int corpus_alpn_test();
+    int corpus_check_test();
+    int entry_stats_test();
+    int fuzi_q_basic_multi_test();
+    int fuzi_q_sim_event_heap_test();
+    int fuzi_q_sim_farm_test();
+    int fuzi_q_link_model_test();
+    int cnx_heap_test();
+    int client_options_test();
+    int icid_wheel_test();
 
 #ifdef __cplusplus
 }
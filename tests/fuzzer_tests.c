@@ -0,0 +1,1067 @@
+/*
+* Author: Christian Huitema
+* Copyright (c) 2022, Private Octopus, Inc.
+* All rights reserved.
+*
+* Permission to use, copy, modify, and distribute this software for any
+* purpose with or without fee is hereby granted, provided that the above
+* copyright notice and this permission notice appear in all copies.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL Private Octopus, Inc. BE LIABLE FOR ANY
+* DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+* ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <picoquic.h>
+#include <picoquic_internal.h>
+#include <picoquic_utils.h>
+#include "fuzi_q.h"
+
+/* Index a packet with a few frames and trailing padding, verify
+ * the offsets, types and start of padding, then verify that the
+ * index is correctly updated after inserting a frame, and that the
+ * frame header fuzzer never modifies the trailing padding.
+ */
+static int frame_index_check(fuzzer_frame_index_t* frame_index, size_t nb_expected,
+    const size_t* offsets, const uint64_t* frame_types)
+{
+    int ret = 0;
+
+    if (frame_index->nb_frames != nb_expected) {
+        DBG_PRINTF("Expected %zu frames, got %zu", nb_expected, frame_index->nb_frames);
+        ret = -1;
+    }
+    for (size_t i = 0; ret == 0 && i < nb_expected; i++) {
+        if (frame_index->frames[i].offset != offsets[i] || frame_index->frames[i].frame_type != frame_types[i] ||
+            (i + 1 < nb_expected && frame_index->frames[i].offset + frame_index->frames[i].length != offsets[i + 1])) {
+            DBG_PRINTF("Wrong index for frame #%zu", i);
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+/* The packets that are not modified by a fuzzing strategy are passed
+ * to the frame header fuzzer with the index built over the whole
+ * packet. Even when the padding has a much larger weight than the
+ * other frames, the fuzzer only picks frames before final_pad.
+ */
+static int frame_index_padding_check(fuzzer_frame_index_t* frame_index)
+{
+    int ret = 0;
+    fuzzer_ctx_t ctx = { 0 };
+    fuzzer_pilot_t pilot;
+    uint64_t random_context = 0xf00d5eedull;
+    uint8_t packet[32];
+    size_t const header_length = 3;
+    size_t const final_pad = 8;
+    size_t padding_id;
+
+    fuzzer_frame_fuzzers_init(&ctx);
+    padding_id = fuzzer_frame_fuzzer_find(&ctx, picoquic_frame_type_padding);
+    if (fuzzer_set_frame_weight(&ctx, "padding", 1000) != 0) {
+        ret = -1;
+    }
+    fuzzer_pilot_init(&pilot, &random_context);
+
+    for (int i = 0; ret == 0 && i < 256; i++) {
+        memset(packet, 0, sizeof(packet));
+        memset(packet + header_length, picoquic_frame_type_ping, final_pad - header_length);
+        fuzzer_frame_index_build(frame_index, packet, sizeof(packet), header_length);
+        if (frame_index->padding_start != final_pad ||
+            (frame_index->nb_frames > 0 && frame_index->frames[frame_index->nb_frames - 1].offset >= final_pad)) {
+            DBG_PRINTF("Trailing padding indexed, padding starts at %zu", frame_index->padding_start);
+            ret = -1;
+        }
+        else if (frame_header_fuzzer(&ctx, NULL, NULL, &pilot, packet, frame_index) == 0) {
+            DBG_PRINTF("%s", "No frame picked by the header fuzzer");
+            ret = -1;
+        }
+        else {
+            for (size_t j = final_pad; j < sizeof(packet); j++) {
+                if (packet[j] != 0) {
+                    DBG_PRINTF("Padding byte %zu fuzzed, trial %d", j, i);
+                    ret = -1;
+                    break;
+                }
+            }
+        }
+    }
+    if (ret == 0 && ctx.frame_hits[padding_id] != 0) {
+        DBG_PRINTF("Trailing padding picked %" PRIu64 " times", ctx.frame_hits[padding_id]);
+        ret = -1;
+    }
+    return ret;
+}
+
+int frame_index_test()
+{
+    int ret = 0;
+    uint8_t packet[64] = {
+        0x40, 0xaa, 0xbb,
+        picoquic_frame_type_ping,
+        picoquic_frame_type_max_data, 0x40, 0x20,
+        picoquic_frame_type_ping,
+        0, 0, 0, 0, 0 };
+    size_t const header_length = 3;
+    size_t const length = 13;
+    uint8_t max_data[3] = { picoquic_frame_type_max_data, 0x41, 0x00 };
+    size_t const offsets[] = { 3, 4, 7 };
+    uint64_t const frame_types[] = { picoquic_frame_type_ping, picoquic_frame_type_max_data,
+        picoquic_frame_type_ping };
+    size_t const inserted_offsets[] = { 3, 6, 7, 10 };
+    uint64_t const inserted_types[] = { picoquic_frame_type_max_data, picoquic_frame_type_ping,
+        picoquic_frame_type_max_data, picoquic_frame_type_ping };
+    fuzzer_frame_index_t frame_index;
+
+    if (fuzzer_frame_index_init(&frame_index, FUZZER_MAX_NB_FRAMES) != 0) {
+        DBG_PRINTF("%s", "Cannot allocate the frame index");
+        return -1;
+    }
+
+    fuzzer_frame_index_build(&frame_index, packet, length, header_length);
+    ret = frame_index_check(&frame_index, 3, offsets, frame_types);
+    if (ret == 0 && frame_index.padding_start != 8) {
+        DBG_PRINTF("Padding starts at %zu instead of 8", frame_index.padding_start);
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        /* Insert a frame at the beginning, as the fuzzer does */
+        size_t final_pad = frame_index.padding_start;
+        memmove(packet + header_length + sizeof(max_data), packet + header_length, final_pad - header_length);
+        memcpy(packet + header_length, max_data, sizeof(max_data));
+        fuzzer_frame_index_trim(&frame_index, final_pad);
+        fuzzer_frame_index_insert(&frame_index, packet, 0, header_length, header_length + sizeof(max_data));
+        ret = frame_index_check(&frame_index, 4, inserted_offsets, inserted_types);
+    }
+
+    if (ret == 0) {
+        ret = frame_index_padding_check(&frame_index);
+    }
+
+    if (ret == 0) {
+        /* Every frame of a packet filled with pings is indexed */
+        memset(packet + header_length, picoquic_frame_type_ping, sizeof(packet) - header_length);
+        fuzzer_frame_index_build(&frame_index, packet, sizeof(packet), header_length);
+        if (frame_index.nb_frames != sizeof(packet) - header_length || frame_index.padding_start != sizeof(packet) ||
+            frame_index.frames[frame_index.nb_frames - 1].offset != sizeof(packet) - 1) {
+            DBG_PRINTF("Wrong index of %zu pings", sizeof(packet) - header_length);
+            ret = -1;
+        }
+    }
+
+    fuzzer_frame_index_release(&frame_index);
+
+    if (ret == 0) {
+        /* A smaller index is filled up to its size, including after insertion */
+        if (fuzzer_frame_index_init(&frame_index, 8) != 0) {
+            ret = -1;
+        }
+        else {
+            fuzzer_frame_index_build(&frame_index, packet, sizeof(packet), header_length);
+            if (frame_index.nb_frames != 8) {
+                ret = -1;
+            }
+            else {
+                fuzzer_frame_index_insert(&frame_index, packet, 4, 7, 10);
+                if (frame_index.nb_frames != 8 || frame_index.frames[7].offset != 10) {
+                    ret = -1;
+                }
+                else {
+                    /* Adding frames at the end of a full index, as strategy 0 does, leaves it unchanged */
+                    fuzzer_frame_index_insert(&frame_index, packet, frame_index.nb_frames, 11, 14);
+                    if (frame_index.nb_frames != 8 || frame_index.frames[7].offset != 10) {
+                        ret = -1;
+                    }
+                }
+            }
+            if (ret != 0) {
+                DBG_PRINTF("%s", "Wrong index when the size is limited");
+            }
+            fuzzer_frame_index_release(&frame_index);
+        }
+    }
+
+    return ret;
+}
+
+/* Verify that every frame type is dispatched to the registered fuzzer,
+ * and that frame weights can be set by name or loaded from a file.
+ */
+int frame_fuzzer_table_test()
+{
+    int ret = 0;
+    fuzzer_ctx_t ctx = { 0 };
+    char const* weights_file = "fuzi_q_frame_weights_test.txt";
+    struct st_frame_fuzzer_case_t {
+        uint64_t frame_type;
+        char const* name;
+    } cases[] = {
+        { picoquic_frame_type_padding, "padding" },
+        { picoquic_frame_type_ack_ecn, "ack" },
+        { picoquic_frame_type_stream_range_min + 3, "stream" },
+        { picoquic_frame_type_max_streams_unidir, "max_streams" },
+        { picoquic_frame_type_handshake_done, "handshake_done" },
+        { picoquic_frame_type_datagram_l, "datagram" },
+        { picoquic_frame_type_ack_frequency, "ack_frequency" },
+        { picoquic_frame_type_bdp, "bdp" },
+        { 0x1f, "default" },
+        { 0x1234567, "default" }
+    };
+
+    fuzi_q_fuzzer_init(&ctx, NULL, NULL);
+
+    for (size_t i = 0; ret == 0 && i < sizeof(cases) / sizeof(cases[0]); i++) {
+        char const* name = fuzzer_frame_fuzzer_name(fuzzer_frame_fuzzer_find(&ctx, cases[i].frame_type));
+        if (name == NULL || strcmp(name, cases[i].name) != 0) {
+            DBG_PRINTF("Frame type 0x%" PRIx64 " dispatched to %s instead of %s", cases[i].frame_type,
+                (name == NULL) ? "nothing" : name, cases[i].name);
+            ret = -1;
+        }
+    }
+
+    if (ret == 0 && (ctx.frame_weights_set || fuzzer_set_frame_weight(&ctx, "no_such_frame", 2) == 0)) {
+        DBG_PRINTF("%s", "Unexpected weight setting");
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        FILE* F = picoquic_file_open(weights_file, "w");
+        if (F == NULL) {
+            ret = -1;
+        }
+        else {
+            fprintf(F, "# Focus on ACK and STREAM\n\nack 10\nstream 20\npadding 0\n");
+            (void)picoquic_file_close(F);
+            ret = fuzzer_load_frame_weights(&ctx, weights_file);
+        }
+        if (ret == 0 && (!ctx.frame_weights_set ||
+            ctx.frame_weight[fuzzer_frame_fuzzer_find(&ctx, picoquic_frame_type_ack)] != 10 ||
+            ctx.frame_weight[fuzzer_frame_fuzzer_find(&ctx, picoquic_frame_type_stream_range_max)] != 20 ||
+            ctx.frame_weight[fuzzer_frame_fuzzer_find(&ctx, picoquic_frame_type_padding)] != 0 ||
+            ctx.frame_weight[fuzzer_frame_fuzzer_find(&ctx, picoquic_frame_type_ping)] != 1)) {
+            DBG_PRINTF("%s", "Frame weights not loaded");
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        FILE* F = picoquic_file_open(weights_file, "w");
+        if (F == NULL) {
+            ret = -1;
+        }
+        else {
+            fprintf(F, "stream\n");
+            (void)picoquic_file_close(F);
+            if (fuzzer_load_frame_weights(&ctx, weights_file) == 0) {
+                DBG_PRINTF("%s", "Invalid weights file accepted");
+                ret = -1;
+            }
+        }
+    }
+
+    (void)remove(weights_file);
+    fuzi_q_fuzzer_release(&ctx);
+    return ret;
+}
+
+/* Verify that the adaptive choice of strategy depends only on the pilot
+ * and the rewards, that a reward increases the probability of the
+ * rewarded strategy, and that the decisions of a trace are replayed.
+ */
+int bandit_test()
+{
+    int ret = 0;
+    fuzzer_ctx_t ctx = { 0 };
+    fuzzer_bandit_shared_t shared;
+    char const* trace_file = "fuzi_q_bandit_test.txt";
+    char spec[64];
+    picoquic_connection_id_t icid = { { 0xb4, 0x4d, 0x17, 0, 0, 0, 0, 1 }, 8 };
+    uint64_t pilots[3] = { 0x1234, 0x9abc, 0xfff0 };
+    uint64_t arms[3];
+    double prob_before[FUZZER_NB_STRATEGIES];
+    double prob_after[FUZZER_NB_STRATEGIES];
+    fuzzer_icid_ctx_t* icid_ctx;
+
+    fuzi_q_fuzzer_init(&ctx, NULL, NULL);
+    (void)snprintf(spec, sizeof(spec), "exp3:%s", trace_file);
+    if (fuzzer_bandit_open(&shared, "exp4") == 0 || fuzzer_bandit_open(&shared, spec) != 0) {
+        DBG_PRINTF("%s", "Bandit specification not parsed correctly");
+        ret = -1;
+    }
+    else {
+        fuzzer_bandit_enable(&ctx, &shared);
+        icid_ctx = fuzzer_get_icid_ctx(&ctx, &icid, 0);
+        fuzzer_bandit_probabilities(&ctx.bandit, prob_before);
+        for (int i = 0; ret == 0 && i < 3; i++) {
+            arms[i] = fuzzer_bandit_select(&ctx, icid_ctx, pilots[i]);
+            if (arms[i] >= FUZZER_NB_STRATEGIES || arms[i] != fuzzer_bandit_select(&ctx, icid_ctx, pilots[i])) {
+                DBG_PRINTF("Strategy choice %d is not deterministic", i);
+                ret = -1;
+            }
+        }
+        if (ret == 0 && (icid_ctx->bandit_arm != (int)arms[0] || ctx.bandit.nb_pulls[arms[0]] != 1)) {
+            DBG_PRINTF("%s", "First strategy not recorded");
+            ret = -1;
+        }
+        if (ret == 0) {
+            fuzzer_bandit_reward(&ctx, &icid, 1.0);
+            fuzzer_bandit_probabilities(&ctx.bandit, prob_after);
+            if (icid_ctx->bandit_arm != -1 || ctx.bandit.nb_rewards[arms[0]] != 1 ||
+                !(prob_after[arms[0]] > prob_before[arms[0]])) {
+                DBG_PRINTF("%s", "Reward not credited");
+                ret = -1;
+            }
+        }
+        if (ret == 0) {
+            /* The updates of two bandits that started from the same weights add up */
+            fuzzer_bandit_t merged = { 0 };
+            double start_weight[FUZZER_NB_STRATEGIES];
+            double prob_merged[FUZZER_NB_STRATEGIES];
+
+            for (int i = 0; i < FUZZER_NB_STRATEGIES; i++) {
+                start_weight[i] = 1.0;
+                merged.weight[i] = 1.0;
+            }
+            fuzzer_bandit_merge_weights(merged.weight, start_weight, &ctx.bandit);
+            fuzzer_bandit_merge_weights(merged.weight, start_weight, &ctx.bandit);
+            fuzzer_bandit_probabilities(&merged, prob_merged);
+            if (merged.weight[arms[0]] != 1.0 || !(prob_merged[arms[0]] > prob_after[arms[0]])) {
+                DBG_PRINTF("%s", "Updates of the strategy weights not merged");
+                ret = -1;
+            }
+        }
+        if (ret == 0) {
+            /* The reward of a connection whose context is not found is counted as lost */
+            picoquic_connection_id_t evicted_icid = { { 0xb4, 0x4d, 0x17, 0, 0, 0, 0, 2 }, 8 };
+
+            fuzzer_bandit_reward(&ctx, &evicted_icid, 1.0);
+            if (ctx.bandit.nb_lost_rewards != 1) {
+                DBG_PRINTF("%s", "Lost reward not counted");
+                ret = -1;
+            }
+        }
+        /* The lines of the trace are buffered until flushed */
+        fuzzer_bandit_flush(&ctx.bandit);
+        fuzzer_bandit_close(&shared);
+    }
+
+    if (ret == 0) {
+        /* Replay the decisions with different pilots */
+        (void)snprintf(spec, sizeof(spec), "replay:%s", trace_file);
+        if (fuzzer_bandit_open(&shared, spec) != 0 || shared.nb_decisions != 6) {
+            DBG_PRINTF("%s", "Cannot load the bandit trace");
+            ret = -1;
+        }
+        else {
+            fuzzer_bandit_enable(&ctx, &shared);
+            icid_ctx->nb_bandit_decisions = 0;
+            for (int i = 0; ret == 0 && i < 3; i++) {
+                if (fuzzer_bandit_select(&ctx, icid_ctx, ~pilots[i]) != arms[i] ||
+                    fuzzer_bandit_select(&ctx, icid_ctx, pilots[i] + 0x5555) != arms[i]) {
+                    DBG_PRINTF("Decision %d not replayed", i);
+                    ret = -1;
+                }
+            }
+        }
+        fuzzer_bandit_close(&shared);
+    }
+
+    (void)remove(trace_file);
+    fuzi_q_fuzzer_release(&ctx);
+    return ret;
+}
+
+/* Verify that the pilot stream hands out the bits of the random
+ * context in order, only calls the generator when the reservoir is
+ * exhausted, and draws ranges without bias.
+ */
+int pilot_stream_test()
+{
+    int ret = 0;
+    uint64_t random_context = 0x0123456789abcdefull;
+    uint64_t check_context = random_context;
+    uint64_t w1 = picoquic_test_random(&check_context);
+    uint64_t w2 = picoquic_test_random(&check_context);
+    fuzzer_pilot_t pilot;
+    fuzzer_pilot_t other;
+    uint64_t counts[3] = { 0, 0, 0 };
+
+    fuzzer_pilot_init(&pilot, &random_context);
+    if (fuzzer_pilot_bits(&pilot, 60) != (w1 & 0x0fffffffffffffffull) ||
+        fuzzer_pilot_bits(&pilot, 8) != ((w1 >> 60) | ((w2 & 0x0f) << 4)) ||
+        random_context != check_context) {
+        DBG_PRINTF("%s", "Pilot bits not drawn in order");
+        ret = -1;
+    }
+    for (int i = 0; ret == 0 && i < 60; i++) {
+        if (fuzzer_pilot_bits(&pilot, 1) != ((w2 >> (4 + i)) & 1)) {
+            DBG_PRINTF("Wrong pilot bit %d", i);
+            ret = -1;
+        }
+    }
+    if (ret == 0 && random_context != check_context) {
+        DBG_PRINTF("%s", "Unexpected call to the random generator");
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        uint64_t other_context = 0x0123456789abcdefull;
+
+        random_context = other_context;
+        fuzzer_pilot_init(&pilot, &random_context);
+        fuzzer_pilot_init(&other, &other_context);
+        for (int i = 0; ret == 0 && i < 3000; i++) {
+            uint64_t x = fuzzer_pilot_range(&pilot, 3);
+            if (x >= 3 || x != fuzzer_pilot_range(&other, 3) ||
+                fuzzer_pilot_bits(&pilot, 5) != fuzzer_pilot_bits(&other, 5)) {
+                DBG_PRINTF("Pilot stream not reproducible at draw %d", i);
+                ret = -1;
+            }
+            else {
+                counts[x]++;
+            }
+        }
+        for (int i = 0; ret == 0 && i < 3; i++) {
+            if (counts[i] < 900 || counts[i] > 1100) {
+                DBG_PRINTF("Biased range, value %d drawn %" PRIu64 " times", i, counts[i]);
+                ret = -1;
+            }
+        }
+    }
+
+    return ret;
+}
+
+/* Verify that the packed corpus holds the same frames as the list of
+ * test frames, back to back, with their names and decoded types.
+ */
+int corpus_pack_test()
+{
+    int ret = 0;
+    uint8_t bad_type[] = { 0x40 };
+    fuzi_q_frames_t frame_list[] = {
+        { "padding", NULL, 0 },
+        { "empty", NULL, 0 },
+        { "bad_type", bad_type, sizeof(bad_type) }
+    };
+    uint8_t padding[] = { 0, 0, 0 };
+    fuzi_q_corpus_t corpus;
+
+    frame_list[0].val = padding;
+    frame_list[0].len = sizeof(padding);
+
+    if (fuzi_q_corpus_pack(&corpus, frame_list, 3) != 0 || corpus.nb_entries != 2 ||
+        corpus.entries[0].frame_type != 0 || corpus.entries[0].length != 3 ||
+        corpus.entries[1].flags != FUZI_Q_CORPUS_FLAG_BAD_TYPE ||
+        strcmp(fuzi_q_corpus_name(&corpus, 1), "bad_type") != 0) {
+        DBG_PRINTF("%s", "Small corpus not packed correctly");
+        ret = -1;
+    }
+    fuzi_q_corpus_release(&corpus);
+
+    if (ret == 0 && fuzi_q_corpus_pack(&corpus, fuzi_q_frame_list, nb_fuzi_q_frame_list) != 0) {
+        DBG_PRINTF("%s", "Cannot pack the test frames");
+        ret = -1;
+    }
+    else if (ret == 0) {
+        size_t offset = 0;
+
+        if (corpus.nb_entries != nb_fuzi_q_frame_list) {
+            DBG_PRINTF("Packed %zu frames out of %zu", corpus.nb_entries, nb_fuzi_q_frame_list);
+            ret = -1;
+        }
+        for (size_t i = 0; ret == 0 && i < corpus.nb_entries; i++) {
+            if (corpus.entries[i].offset != offset || corpus.entries[i].length != fuzi_q_frame_list[i].len ||
+                memcmp(fuzi_q_corpus_frame(&corpus, i), fuzi_q_frame_list[i].val, fuzi_q_frame_list[i].len) != 0 ||
+                strcmp(fuzi_q_corpus_name(&corpus, i), fuzi_q_frame_list[i].name) != 0) {
+                DBG_PRINTF("Frame %zu (%s) not packed correctly", i, fuzi_q_frame_list[i].name);
+                ret = -1;
+            }
+            offset += corpus.entries[i].length;
+        }
+        fuzi_q_corpus_release(&corpus);
+    }
+
+    return ret;
+}
+
+/* Write the test frames to a corpus file, map it back, and verify that
+ * it can replace or complete the frames of a fuzzer context, that
+ * duplicate frames are not added, and that a truncated file is rejected.
+ */
+int corpus_file_test()
+{
+    int ret = 0;
+    char const* corpus_file = "fuzi_q_corpus_test.bin";
+    char const* merge_spec = "+fuzi_q_corpus_test.bin";
+    char const* extra_file = "fuzi_q_corpus_extra.bin";
+    char const* extra_spec = "+fuzi_q_corpus_extra.bin";
+    uint8_t extra_frame[] = { 0x1f, 0xfe, 0xed, 0xfa, 0xce };
+    fuzi_q_frames_t extra_list[] = {
+        { "extra_frame", NULL, 0 }
+    };
+    fuzzer_ctx_t ctx = { 0 };
+    fuzi_q_corpus_t loaded;
+    size_t nb_builtin;
+
+    extra_list[0].val = extra_frame;
+    extra_list[0].len = sizeof(extra_frame);
+
+    fuzi_q_fuzzer_init(&ctx, NULL, NULL);
+    nb_builtin = ctx.corpus.nb_entries;
+
+    if (fuzi_q_corpus_export(NULL, corpus_file) != 0 || fuzi_q_corpus_load(&loaded, corpus_file) != 0) {
+        DBG_PRINTF("%s", "Cannot write and load the corpus file");
+        ret = -1;
+    }
+    else {
+        if (loaded.mapped_size == 0 || loaded.nb_entries != nb_builtin || loaded.blob_size != ctx.corpus.blob_size ||
+            memcmp(loaded.entries, ctx.corpus.entries, nb_builtin * sizeof(fuzi_q_corpus_entry_t)) != 0 ||
+            memcmp(loaded.blob, ctx.corpus.blob, loaded.blob_size) != 0) {
+            DBG_PRINTF("%s", "Loaded corpus differs from the built-in one");
+            ret = -1;
+        }
+        fuzi_q_corpus_release(&loaded);
+    }
+
+    if (ret == 0 && (fuzzer_load_corpus(&ctx, merge_spec) != 0 || ctx.corpus.nb_entries != nb_builtin)) {
+        DBG_PRINTF("%s", "Duplicate frames merged");
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        if (fuzi_q_corpus_pack(&loaded, extra_list, 1) != 0 || fuzi_q_corpus_write(&loaded, extra_file) != 0) {
+            ret = -1;
+        }
+        fuzi_q_corpus_release(&loaded);
+    }
+    if (ret == 0 && (fuzzer_load_corpus(&ctx, extra_spec) != 0 || ctx.corpus.nb_entries != nb_builtin + 1 ||
+        ctx.corpus.mapped_size != 0 ||
+        strcmp(fuzi_q_corpus_name(&ctx.corpus, nb_builtin), "extra_frame") != 0 ||
+        memcmp(fuzi_q_corpus_frame(&ctx.corpus, nb_builtin), extra_frame, sizeof(extra_frame)) != 0)) {
+        DBG_PRINTF("%s", "Corpus file not merged");
+        ret = -1;
+    }
+
+    if (ret == 0 && (fuzzer_load_corpus(&ctx, corpus_file) != 0 || ctx.corpus.nb_entries != nb_builtin ||
+        ctx.corpus.mapped_size == 0)) {
+        DBG_PRINTF("%s", "Corpus file not loaded in place of the test frames");
+        ret = -1;
+    }
+
+    if (ret == 0) {
+        /* The mapped corpus is shared, and releasing the contexts that
+         * share it leaves it in place. A context without settings has
+         * no test frames. */
+        fuzzer_ctx_t copy;
+        fuzzer_ctx_t empty;
+        const uint32_t* entry_ids;
+
+        (void)fuzzer_set_frame_weight(&ctx, "stream", 7);
+        if (fuzi_q_fuzzer_init_shared(&copy, NULL, NULL, &ctx) != 0 || copy.corpus.nb_entries != nb_builtin ||
+            !copy.corpus.is_shared || copy.corpus.entries != ctx.corpus.entries ||
+            copy.nb_entry_stats != nb_builtin || copy.entry_stats == ctx.entry_stats || !copy.frame_weights_set ||
+            memcmp(copy.frame_weight, ctx.frame_weight, sizeof(ctx.frame_weight)) != 0 ||
+            fuzi_q_corpus_view(&copy.corpus, fuzi_q_alpn_any, &entry_ids) != nb_builtin ||
+            strcmp(fuzi_q_corpus_name(&copy.corpus, 0), fuzi_q_corpus_name(&ctx.corpus, 0)) != 0 ||
+            fuzi_q_corpus_classify(&copy.corpus) == 0) {
+            DBG_PRINTF("%s", "Settings not shared");
+            ret = -1;
+        }
+        fuzi_q_fuzzer_release(&copy);
+        if (ret == 0 && (ctx.corpus.mapped_size == 0 || ctx.corpus.nb_entries != nb_builtin ||
+            fuzi_q_corpus_view(&ctx.corpus, fuzi_q_alpn_any, &entry_ids) != nb_builtin)) {
+            DBG_PRINTF("%s", "Shared corpus released with the context");
+            ret = -1;
+        }
+        if (ret == 0) {
+            if (fuzi_q_fuzzer_init_shared(&empty, NULL, NULL, NULL) != 0 ||
+                empty.corpus.nb_entries != 0 || empty.nb_entry_stats != 0) {
+                DBG_PRINTF("%s", "Test frames in a context without settings");
+                ret = -1;
+            }
+            fuzi_q_fuzzer_release(&empty);
+        }
+    }
+
+    if (ret == 0) {
+        /* Truncate the file, after unmapping it */
+        size_t truncated_size = ctx.corpus.mapped_size - 1;
+        uint8_t* truncated = (uint8_t*)malloc(truncated_size);
+        FILE* F = NULL;
+
+        if (truncated != NULL) {
+            memcpy(truncated, ctx.corpus.memory, truncated_size);
+            fuzi_q_corpus_release(&ctx.corpus);
+            F = picoquic_file_open(corpus_file, "wb");
+        }
+        if (F == NULL) {
+            ret = -1;
+        }
+        else {
+            (void)fwrite(truncated, 1, truncated_size, F);
+            (void)picoquic_file_close(F);
+            if (fuzi_q_corpus_load(&loaded, corpus_file) == 0) {
+                DBG_PRINTF("%s", "Truncated corpus file accepted");
+                fuzi_q_corpus_release(&loaded);
+                ret = -1;
+            }
+        }
+        if (truncated != NULL) {
+            free(truncated);
+        }
+    }
+
+    fuzi_q_fuzzer_release(&ctx);
+    (void)remove(corpus_file);
+    (void)remove(extra_file);
+    return ret;
+}
+
+/* Verify the classification of the test frames by frame type, and by
+ * packet epoch and connection state.
+ */
+int corpus_class_test()
+{
+    int ret = 0;
+    fuzi_q_corpus_t corpus;
+
+    if (fuzi_q_corpus_pack(&corpus, fuzi_q_frame_list, nb_fuzi_q_frame_list) != 0 ||
+        fuzi_q_corpus_classify(&corpus) != 0) {
+        DBG_PRINTF("%s", "Cannot classify the test frames");
+        return -1;
+    }
+
+    /* Each entry is found exactly once in the list of its type */
+    for (size_t i = 0; ret == 0 && i < corpus.nb_entries; i++) {
+        const uint32_t* entry_ids = NULL;
+        size_t nb_ids = fuzi_q_corpus_by_type(&corpus, corpus.entries[i].frame_type, &entry_ids);
+        size_t nb_same = 0;
+        int found = 0;
+
+        for (size_t j = 0; j < corpus.nb_entries; j++) {
+            nb_same += (corpus.entries[j].frame_type == corpus.entries[i].frame_type);
+        }
+        for (size_t j = 0; j < nb_ids; j++) {
+            if (corpus.entries[entry_ids[j]].frame_type != corpus.entries[i].frame_type) {
+                found = -1;
+                break;
+            }
+            found += (entry_ids[j] == i);
+        }
+        if (nb_ids != nb_same || found != 1) {
+            DBG_PRINTF("Frame %zu (%s) not indexed by type", i, fuzi_q_corpus_name(&corpus, i));
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        const uint32_t* entry_ids = NULL;
+        size_t nb_ids = fuzi_q_corpus_bucket(&corpus, fuzi_q_alpn_any, fuzi_q_epoch_1rtt, fuzzer_cnx_state_closing, &entry_ids);
+
+        /* All frames can be sent in 1-RTT packets */
+        if (nb_ids != corpus.nb_entries) {
+            DBG_PRINTF("Found %zu frames for 1-RTT, expected %zu", nb_ids, corpus.nb_entries);
+            ret = -1;
+        }
+        for (int epoch = 0; ret == 0 && epoch < fuzi_q_epoch_max; epoch++) {
+            for (int state = 0; ret == 0 && state < fuzzer_cnx_state_max; state++) {
+                nb_ids = fuzi_q_corpus_bucket(&corpus, fuzi_q_alpn_any, (fuzi_q_epoch_enum)epoch, (fuzzer_cnx_state_enum)state, &entry_ids);
+                for (size_t j = 0; ret == 0 && j < nb_ids; j++) {
+                    uint64_t frame_type = corpus.entries[entry_ids[j]].frame_type;
+
+                    if ((frame_type == picoquic_frame_type_handshake_done &&
+                        (epoch != fuzi_q_epoch_1rtt || state < fuzzer_cnx_state_ready)) ||
+                        (frame_type == picoquic_frame_type_max_data && epoch == fuzi_q_epoch_initial) ||
+                        (frame_type == picoquic_frame_type_crypto_hs && epoch == fuzi_q_epoch_0rtt)) {
+                        DBG_PRINTF("Frame %s not expected in epoch %d, state %d",
+                            fuzi_q_corpus_name(&corpus, entry_ids[j]), epoch, state);
+                        ret = -1;
+                    }
+                }
+            }
+        }
+    }
+
+    fuzi_q_corpus_release(&corpus);
+    return ret;
+}
+
+/* Verify that application layer frames are tagged in the corpus, and
+ * that they are correctly wrapped in STREAM frames.
+ */
+/* Verify that application layer frames are injected on the stream of
+ * their layer, at the offset taken from the state of the connection.
+ */
+static int corpus_layer_stream_test()
+{
+    int ret = 0;
+    uint64_t simulated_time = 0;
+    struct sockaddr_storage server_addr;
+    picoquic_quic_t* quic = NULL;
+    picoquic_cnx_t* cnx = NULL;
+    struct st_layer_stream_case_t {
+        fuzi_q_layer_enum layer;
+        uint64_t stream_id;
+        uint64_t offset;
+    } cases[] = {
+        { fuzi_q_layer_h3_control, 2, 17 },
+        { fuzi_q_layer_qpack_encoder, 6, 5 },
+        { fuzi_q_layer_qpack_decoder, 10, 0 },
+        { fuzi_q_layer_h3_request, 4, 321 },
+        { fuzi_q_layer_app, 4, 321 }
+    };
+    uint64_t stream_offsets[][2] = { { 0, 1000 }, { 2, 17 }, { 4, 321 }, { 6, 5 }, { 3, 99 } };
+
+    (void)picoquic_store_text_addr(&server_addr, "127.0.0.1", 4443);
+    if ((quic = picoquic_create(8, NULL, NULL, NULL, "h3", NULL, NULL, NULL, NULL, NULL,
+        simulated_time, &simulated_time, NULL, NULL, 0)) == NULL ||
+        (cnx = picoquic_create_cnx(quic, picoquic_null_connection_id, picoquic_null_connection_id,
+            (struct sockaddr*)&server_addr, simulated_time, 0, PICOQUIC_TEST_SNI, "h3", 1)) == NULL) {
+        DBG_PRINTF("%s", "Cannot create the client connection");
+        ret = -1;
+    }
+    /* Open the client streams, and the server control stream, as if data was sent */
+    for (size_t i = 0; ret == 0 && i < sizeof(stream_offsets) / sizeof(stream_offsets[0]); i++) {
+        picoquic_stream_head_t* stream = picoquic_create_stream(cnx, stream_offsets[i][0]);
+
+        if (stream == NULL) {
+            DBG_PRINTF("Cannot create stream %" PRIu64, stream_offsets[i][0]);
+            ret = -1;
+        }
+        else {
+            stream->sent_offset = stream_offsets[i][1];
+        }
+    }
+    /* Each layer is injected on its stream, at the offset of the next bytes */
+    for (size_t i = 0; ret == 0 && i < sizeof(cases) / sizeof(cases[0]); i++) {
+        uint64_t stream_id = UINT64_MAX;
+        uint64_t offset = UINT64_MAX;
+
+        fuzzer_app_stream(cnx, cases[i].layer, &stream_id, &offset);
+        if (stream_id != cases[i].stream_id || offset != cases[i].offset) {
+            DBG_PRINTF("Layer %d on stream %" PRIu64 " at %" PRIu64 ", expected %" PRIu64 " at %" PRIu64,
+                cases[i].layer, stream_id, offset, cases[i].stream_id, cases[i].offset);
+            ret = -1;
+        }
+    }
+    if (quic != NULL) {
+        picoquic_free(quic);
+    }
+
+    return ret;
+}
+
+int corpus_layer_test()
+{
+    int ret = 0;
+    uint8_t settings[] = { 0x04, 0x00 };
+    uint8_t expected[] = { 0x0e, 0x02, 0x52, 0x34, 0x02, 0x04, 0x00 };
+    uint8_t frame[16];
+    fuzi_q_corpus_t corpus;
+    int nb_found = 0;
+
+    if (fuzi_q_corpus_pack(&corpus, fuzi_q_frame_list, nb_fuzi_q_frame_list) != 0) {
+        DBG_PRINTF("%s", "Cannot pack the test frames");
+        return -1;
+    }
+    for (size_t i = 0; ret == 0 && i < corpus.nb_entries; i++) {
+        char const* name = fuzi_q_corpus_name(&corpus, i);
+
+        if ((strcmp(name, "h3_settings_empty") == 0 &&
+            (corpus.entries[i].layer != fuzi_q_layer_h3_control ||
+                corpus.entries[i].frame_type != picoquic_frame_type_stream_range_min)) ||
+            (strcmp(name, "qpack_dec_header_block_ack") == 0 && corpus.entries[i].layer != fuzi_q_layer_qpack_decoder) ||
+            (strcmp(name, "padding") == 0 && corpus.entries[i].layer != fuzi_q_layer_quic)) {
+            DBG_PRINTF("Frame %s has layer %d, type 0x%" PRIx64, name, corpus.entries[i].layer, corpus.entries[i].frame_type);
+            ret = -1;
+        }
+        nb_found += (corpus.entries[i].layer != fuzi_q_layer_quic);
+    }
+    fuzi_q_corpus_release(&corpus);
+
+    if (ret == 0 && nb_found == 0) {
+        DBG_PRINTF("%s", "No application layer frame in the corpus");
+        ret = -1;
+    }
+    if (ret == 0 && (fuzzer_stream_wrap(frame, sizeof(frame), 2, 0x1234, settings, sizeof(settings)) != sizeof(expected) ||
+        memcmp(frame, expected, sizeof(expected)) != 0)) {
+        DBG_PRINTF("%s", "Settings frame not wrapped correctly");
+        ret = -1;
+    }
+    if (ret == 0 && fuzzer_stream_wrap(frame, sizeof(expected) - 1, 2, 0x1234, settings, sizeof(settings)) != 0) {
+        DBG_PRINTF("%s", "Wrapped frame larger than the buffer");
+        ret = -1;
+    }
+    if (ret == 0) {
+        ret = corpus_layer_stream_test();
+    }
+
+    return ret;
+}
+
+/* Verify the per ALPN views of the corpus */
+int corpus_alpn_test()
+{
+    int ret = 0;
+    fuzi_q_corpus_t corpus;
+    size_t nb_layer[fuzi_q_layer_max] = { 0 };
+    size_t expected[fuzi_q_alpn_max];
+
+    if (fuzi_q_alpn_from_name("h3") != fuzi_q_alpn_h3 || fuzi_q_alpn_from_name("h3-29") != fuzi_q_alpn_h3 ||
+        fuzi_q_alpn_from_name("hq-interop") != fuzi_q_alpn_hq || fuzi_q_alpn_from_name(QUICPERF_ALPN) != fuzi_q_alpn_perf ||
+        fuzi_q_alpn_from_name("h3x") != fuzi_q_alpn_any || fuzi_q_alpn_from_name(NULL) != fuzi_q_alpn_any) {
+        DBG_PRINTF("%s", "ALPN not mapped to the expected view");
+        return -1;
+    }
+    if (fuzi_q_corpus_pack(&corpus, fuzi_q_frame_list, nb_fuzi_q_frame_list) != 0 ||
+        fuzi_q_corpus_classify(&corpus) != 0) {
+        DBG_PRINTF("%s", "Cannot classify the test frames");
+        return -1;
+    }
+    for (size_t i = 0; i < corpus.nb_entries; i++) {
+        nb_layer[corpus.entries[i].layer]++;
+    }
+    expected[fuzi_q_alpn_any] = corpus.nb_entries;
+    expected[fuzi_q_alpn_h3] = corpus.nb_entries - nb_layer[fuzi_q_layer_app];
+    expected[fuzi_q_alpn_hq] = nb_layer[fuzi_q_layer_quic];
+    expected[fuzi_q_alpn_perf] = nb_layer[fuzi_q_layer_quic];
+
+    for (int alpn = 0; ret == 0 && alpn < fuzi_q_alpn_max; alpn++) {
+        const uint32_t* entry_ids = NULL;
+        size_t nb_ids = fuzi_q_corpus_view(&corpus, (fuzi_q_alpn_enum)alpn, &entry_ids);
+
+        if (nb_ids != expected[alpn]) {
+            DBG_PRINTF("View %d has %zu entries instead of %zu", alpn, nb_ids, expected[alpn]);
+            ret = -1;
+        }
+        /* Buckets of a view only hold entries of that view */
+        nb_ids = fuzi_q_corpus_bucket(&corpus, (fuzi_q_alpn_enum)alpn, fuzi_q_epoch_1rtt, fuzzer_cnx_state_ready, &entry_ids);
+        if (ret == 0 && nb_ids != expected[alpn]) {
+            DBG_PRINTF("1-RTT bucket of view %d has %zu entries instead of %zu", alpn, nb_ids, expected[alpn]);
+            ret = -1;
+        }
+        for (size_t j = 0; ret == 0 && j < nb_ids; j++) {
+            int layer = corpus.entries[entry_ids[j]].layer;
+            if ((alpn == fuzi_q_alpn_h3 && layer == fuzi_q_layer_app) ||
+                ((alpn == fuzi_q_alpn_hq || alpn == fuzi_q_alpn_perf) && layer != fuzi_q_layer_quic)) {
+                DBG_PRINTF("Frame %s in view %d", fuzi_q_corpus_name(&corpus, entry_ids[j]), alpn);
+                ret = -1;
+            }
+        }
+    }
+
+    fuzi_q_corpus_release(&corpus);
+    return ret;
+}
+
+/* Verify that packed frames are checked with picoquic_skip_frame, and
+ * that duplicate frames are removed.
+ */
+int corpus_check_test()
+{
+    int ret = 0;
+    uint8_t max_data[] = { 0x10, 0x05 };
+    uint8_t truncated[] = { 0x10, 0x44 };
+    uint8_t unknown[] = { 0x21, 0x00 };
+    fuzi_q_frames_t frame_list[] = {
+        { "max_data", max_data, sizeof(max_data), fuzi_q_layer_quic },
+        { "truncated", truncated, sizeof(truncated), fuzi_q_layer_quic },
+        { "max_data_copy", max_data, sizeof(max_data), fuzi_q_layer_quic },
+        { "unknown", unknown, sizeof(unknown), fuzi_q_layer_quic },
+        { "max_data_h3", max_data, sizeof(max_data), fuzi_q_layer_h3_control }
+    };
+    char const* expected_names[] = { "max_data", "truncated", "unknown", "max_data_h3" };
+    uint16_t expected_flags[] = { 0, FUZI_Q_CORPUS_FLAG_TRUNCATED, FUZI_Q_CORPUS_FLAG_INVALID, 0 };
+    fuzi_q_corpus_t corpus;
+
+    if (fuzi_q_corpus_pack(&corpus, frame_list, 5) != 0 || fuzi_q_corpus_dedup(&corpus) != 0 ||
+        corpus.nb_entries != 4) {
+        DBG_PRINTF("%s", "Duplicate frame not removed");
+        ret = -1;
+    }
+    for (size_t i = 0; ret == 0 && i < 4; i++) {
+        if (strcmp(fuzi_q_corpus_name(&corpus, i), expected_names[i]) != 0 ||
+            corpus.entries[i].flags != expected_flags[i] ||
+            memcmp(fuzi_q_corpus_frame(&corpus, i), (i == 1) ? truncated : ((i == 2) ? unknown : max_data), 2) != 0) {
+            DBG_PRINTF("Entry %zu (%s) flags 0x%x", i, fuzi_q_corpus_name(&corpus, i), corpus.entries[i].flags);
+            ret = -1;
+        }
+    }
+    fuzi_q_corpus_release(&corpus);
+
+    return ret;
+}
+
+/* Compare the content of a file to the expected text */
+static int entry_stats_file_check(char const* file_name, char const* expected)
+{
+    int ret = 0;
+    FILE* F = picoquic_file_open(file_name, "r");
+    char buffer[1024];
+    size_t length = 0;
+
+    if (F == NULL) {
+        ret = -1;
+    }
+    else {
+        length = fread(buffer, 1, sizeof(buffer) - 1, F);
+        buffer[length] = 0;
+        (void)picoquic_file_close(F);
+        if (strcmp(buffer, expected) != 0) {
+            DBG_PRINTF("Unexpected content of %s:\n%s", file_name, buffer);
+            ret = -1;
+        }
+    }
+    return ret;
+}
+
+/* Names of frames loaded from a corpus file may contain commas, quotes
+ * or line breaks. Check that they are quoted in CSV and escaped in JSON,
+ * and that the connections open at the end of the run are counted apart.
+ */
+static int entry_stats_names_test(fuzzer_ctx_t* ctx)
+{
+    int ret = 0;
+    uint8_t ping[] = { 0x01 };
+    fuzi_q_frames_t frame_list[] = {
+        { "a,b", NULL, 0 },
+        { "q\"x", NULL, 0 },
+        { "n\nl\\", NULL, 0 }
+    };
+    picoquic_connection_id_t icid = { { 0xe5, 0x7a, 0x75, 0, 0, 0, 0, 2 }, 8 };
+    fuzzer_icid_ctx_t* icid_ctx;
+
+    for (size_t i = 0; i < 3; i++) {
+        frame_list[i].val = ping;
+        frame_list[i].len = sizeof(ping);
+    }
+    fuzi_q_corpus_release(&ctx->corpus);
+    if (fuzi_q_corpus_pack(&ctx->corpus, frame_list, 3) != 0 || fuzzer_entry_stats_reset(ctx) != 0 ||
+        (icid_ctx = fuzzer_get_icid_ctx(ctx, &icid, 0)) == NULL) {
+        DBG_PRINTF("%s", "Cannot set the corpus");
+        ret = -1;
+    }
+    else {
+        fuzzer_entry_injected(ctx, icid_ctx, 2);
+        fuzzer_entry_outcome(ctx, &icid, fuzzer_entry_outcome_open_at_end);
+        if (ctx->entry_stats[2].nb_open_at_end != 1 || ctx->entry_stats[2].nb_timeout != 0) {
+            DBG_PRINTF("%s", "Connection open at the end not counted");
+            ret = -1;
+        }
+    }
+    if (ret == 0 && (fuzzer_entry_stats_write(ctx, "fuzi_q_entry_names_test.csv") != 0 ||
+        entry_stats_file_check("fuzi_q_entry_names_test.csv",
+            "name,frame_type,layer,injected,connections,peer_close,timeout,server_down,open_at_end\n"
+            "\"a,b\",1,0,0,0,0,0,0,0\n"
+            "\"q\"\"x\",1,0,0,0,0,0,0,0\n"
+            "\"n\nl\\\",1,0,1,1,0,0,0,1\n") != 0)) {
+        ret = -1;
+    }
+    if (ret == 0 && (fuzzer_entry_stats_write(ctx, "fuzi_q_entry_names_test.json") != 0 ||
+        entry_stats_file_check("fuzi_q_entry_names_test.json",
+            "[\n"
+            "{\"name\": \"a,b\", \"frame_type\": 1, \"layer\": 0, \"injected\": 0, \"connections\": 0, "
+            "\"peer_close\": 0, \"timeout\": 0, \"server_down\": 0, \"open_at_end\": 0},\n"
+            "{\"name\": \"q\\\"x\", \"frame_type\": 1, \"layer\": 0, \"injected\": 0, \"connections\": 0, "
+            "\"peer_close\": 0, \"timeout\": 0, \"server_down\": 0, \"open_at_end\": 0},\n"
+            "{\"name\": \"n\\nl\\\\\", \"frame_type\": 1, \"layer\": 0, \"injected\": 1, \"connections\": 1, "
+            "\"peer_close\": 0, \"timeout\": 0, \"server_down\": 0, \"open_at_end\": 1}\n"
+            "]\n") != 0)) {
+        ret = -1;
+    }
+    return ret;
+}
+
+/* Check that the injected test frames are credited with the outcome of
+ * the connection once, that the counters of two workers add up, and that
+ * they are written with one line per test frame.
+ */
+int entry_stats_test()
+{
+    int ret = 0;
+    fuzzer_ctx_t ctx;
+    fuzzer_ctx_t other;
+    char const* stats_file = "fuzi_q_entry_stats_test.csv";
+    picoquic_connection_id_t icid = { { 0xe5, 0x7a, 0x75, 0, 0, 0, 0, 1 }, 8 };
+    fuzzer_icid_ctx_t* icid_ctx;
+
+    fuzi_q_fuzzer_init(&ctx, NULL, NULL);
+    fuzi_q_fuzzer_init(&other, NULL, NULL);
+    if (ctx.nb_entry_stats != ctx.corpus.nb_entries || ctx.nb_entry_stats < 2 ||
+        (icid_ctx = fuzzer_get_icid_ctx(&ctx, &icid, 0)) == NULL) {
+        DBG_PRINTF("%s", "Entry counters not allocated");
+        ret = -1;
+    }
+    else {
+        fuzzer_entry_injected(&ctx, icid_ctx, 0);
+        fuzzer_entry_injected(&ctx, icid_ctx, 1);
+        fuzzer_entry_injected(&ctx, icid_ctx, 0);
+        fuzzer_entry_outcome(&ctx, &icid, fuzzer_entry_outcome_peer_close);
+        fuzzer_entry_outcome(&ctx, &icid, fuzzer_entry_outcome_timeout);
+        if (ctx.entry_stats[0].nb_injected != 2 || ctx.entry_stats[0].nb_cnx != 1 ||
+            ctx.entry_stats[1].nb_injected != 1 || ctx.entry_stats[1].nb_peer_close != 1 ||
+            ctx.entry_stats[0].nb_peer_close != 1 || ctx.entry_stats[0].nb_timeout != 0) {
+            DBG_PRINTF("%s", "Outcome not credited once to the injected frames");
+            ret = -1;
+        }
+    }
+    if (ret == 0) {
+        other.entry_stats[0].nb_injected = 3;
+        other.entry_stats[0].nb_server_down = 1;
+        if (fuzzer_entry_stats_merge(&ctx, &other) != 0 ||
+            ctx.entry_stats[0].nb_injected != 5 || ctx.entry_stats[0].nb_server_down != 1) {
+            DBG_PRINTF("%s", "Entry counters not merged");
+            ret = -1;
+        }
+    }
+    if (ret == 0 && fuzzer_entry_stats_write(&ctx, stats_file) != 0) {
+        DBG_PRINTF("Cannot write %s", stats_file);
+        ret = -1;
+    }
+    if (ret == 0) {
+        FILE* F = picoquic_file_open(stats_file, "r");
+        char line[256];
+        size_t nb_lines = 0;
+        char const* first_name = fuzi_q_corpus_name(&ctx.corpus, 0);
+        size_t first_len = strlen(first_name);
+
+        if (F == NULL) {
+            ret = -1;
+        }
+        else {
+            while (fgets(line, sizeof(line), F) != NULL) {
+                if (nb_lines == 1 && (strncmp(line, first_name, first_len) != 0 || line[first_len] != ',')) {
+                    ret = -1;
+                }
+                nb_lines++;
+            }
+            (void)picoquic_file_close(F);
+            if (ret != 0 || nb_lines != ctx.nb_entry_stats + 1) {
+                DBG_PRINTF("Unexpected content of %s, %zu lines", stats_file, nb_lines);
+                ret = -1;
+            }
+        }
+    }
+    if (ret == 0) {
+        ret = entry_stats_names_test(&ctx);
+    }
+    fuzi_q_fuzzer_release(&other);
+    fuzi_q_fuzzer_release(&ctx);
+
+    return ret;
+}